@@ -3,11 +3,19 @@
 %bcond_without libcap
 %bcond_without systemtap
 %bcond_without seccomp
+%bcond_without kadm5
+# rpmbuild --with static_pie for static-pie setuid helpers, needs glibc-static
+%bcond_with static_pie
+
+# rpmbuild --define 'kcron_shards 256' for <dir>/s<uid % 256>/<uid> keytabs
+%{!?kcron_shards:%global kcron_shards 0}
 
 %if 0%{?rhel} < 9 && 0%{?fedora} < 31
 %bcond_with landlock
+%bcond_with io_uring
 %else
 %bcond_without landlock
+%bcond_without io_uring
 %endif
 
 Name:		fermilab-util_kcron
@@ -29,7 +37,7 @@ BuildRequires: checksec openssl procps-ng
 %endif
 
 %if %{with libcap}
-BuildRequires:	libcap libcap-devel
+BuildRequires:	kernel-headers
 %endif
 %if %{with systemtap}
 BuildRequires:	systemtap-sdt-devel
@@ -40,9 +48,16 @@ BuildRequires:	libseccomp-devel
 %if %{with landlock}
 BuildRequires:	kernel-devel
 %endif
+%if %{with kadm5}
+BuildRequires:	krb5-devel
+%endif
+%if %{with static_pie}
+BuildRequires:	glibc-static
+%endif
 
 BuildRequires:	cmake >= 3.14
 BuildRequires:	asciidoc redhat-rpm-config coreutils bash gcc
+BuildRequires:	systemd-rpm-macros
 
 %if 0%{?rhel} < 9
 BuildRequires:	gcc-toolset-13 scl-utils
@@ -56,6 +71,14 @@ Requires:	util-linux coreutils
 The kcron utility has a long history at Fermilab.  It is useful
 for running daemons and automatic jobs with kerberos rights.
 
+%package devel
+Summary:	Header and pkg-config file for libkcron
+Requires:	%{name}%{?_isa} = %{version}-%{release}
+
+%description devel
+libkcron tells batch system plugins where kcron keeps the keytab of a
+user and whether it is there, without running client-keytab-name.
+
 
 %prep
 %setup -q -n kcron
@@ -91,10 +114,28 @@ source scl_source enable gcc-toolset-13
  -DUSE_LANDLOCK=ON \
 %else
  -DUSE_LANDLOCK=OFF \
+%endif
+%if %{with io_uring}
+ -DUSE_IO_URING=ON \
+%else
+ -DUSE_IO_URING=OFF \
+%endif
+%if %{with kadm5}
+ -DUSE_KADM5=ON \
+%else
+ -DUSE_KADM5=OFF \
+%endif
+%if %{with static_pie}
+ -DUSE_STATIC_PIE=ON \
+%else
+ -DUSE_STATIC_PIE=OFF \
 %endif
  -DCMAKE_VERBOSE_MAKEFILE:BOOL=ON \
  -DCMAKE_RULE_MESSAGES:BOOL=ON \
  -DCLIENT_KEYTAB_DIR=%{_localstatedir}/kerberos/krb5/user \
+ -DCLIENT_KEYTAB_SHARDS=%{kcron_shards} \
+ -DSYSTEMD_UNIT_DIR=%{_unitdir} \
+ -DSYSTEMD_TMPFILES_DIR=%{_tmpfilesdir} \
  -Wdeprecated ..
 
 %if 0%{?rhel} < 8 && 0%{?fedora} < 31
@@ -140,8 +181,19 @@ done
 %endif
 
 %post
+%{?ldconfig}
 %{__mkdir_p} --mode=0755 %{_localstatedir}/kerberos/krb5/user
 %{__chmod} 0751 %{_localstatedir}/kerberos/krb5/user
+%systemd_post kcron-keytabd.socket kcron-prefetchd.service kcron-ticketd.socket kcron-indexd.service
+%tmpfiles_create kcron.conf
+
+%preun
+%systemd_preun kcron-keytabd.socket kcron-keytabd.service kcron-prefetchd.service kcron-ticketd.socket kcron-ticketd.service kcron-indexd.service
+
+%postun
+%{?ldconfig}
+%systemd_postun kcron-keytabd.service
+%systemd_postun_with_restart kcron-prefetchd.service kcron-ticketd.service kcron-indexd.service
 
 %files
 %defattr(0644,root,root,0755)
@@ -149,15 +201,44 @@ done
 %attr(0755,root,root) %{_bindir}/*
 %config(noreplace) %{_sysconfdir}/sysconfig/kcron
 %attr(0755,root,root) /usr/libexec/kcron/client-keytab-name
+%attr(0755,root,root) %{_libexecdir}/kcron/request-kcron-keytab
+%attr(0755,root,root) %{_libexecdir}/kcron/kcron-ktlist
+%attr(0755,root,root) %{_libexecdir}/kcron/kcron-config
+%attr(0700,root,root) %{_libexecdir}/kcron/kcron-keytabd
+%attr(0700,root,root) %{_libexecdir}/kcron/kcron-prefetchd
+%attr(0700,root,root) %{_libexecdir}/kcron/kcron-ticketd
+%attr(0700,root,root) %{_libexecdir}/kcron/kcron-indexd
+%attr(0700,root,root) %{_sbindir}/kcron-provision
+%attr(0700,root,root) %{_sbindir}/kcron-shard-migrate
+%attr(0700,root,root) %{_sbindir}/kcron-audit
+%{_unitdir}/kcron-keytabd.socket
+%{_unitdir}/kcron-keytabd.service
+%{_unitdir}/kcron-prefetchd.service
+%{_unitdir}/kcron-ticketd.socket
+%{_unitdir}/kcron-ticketd.service
+%{_unitdir}/kcron-indexd.service
+%{_tmpfilesdir}/kcron.conf
+%{_datadir}/kcron/
+%{_libdir}/libkcron.so.1*
+%if %{with kadm5}
+%attr(0755,root,root) %{_libexecdir}/kcron/kcron-kadmin
+%endif
 
 %if %{with libcap}
 # If you can edit the memory this allocates, you can redirect the caps
 #  so we still suid to prevent this. user 'bin' is basically unusable anyway.
 %attr(4711,bin,root) %caps(cap_chown=p cap_dac_override=p) %{_libexecdir}/kcron/init-kcron-keytab
+%attr(4711,bin,root) %caps(cap_chown=p cap_dac_override=p) %{_libexecdir}/kcron/kcron
 %else
 %attr(4711,root,root) %{_libexecdir}/kcron/init-kcron-keytab
+%attr(4711,root,root) %{_libexecdir}/kcron/kcron
 %endif
 
+%files devel
+%{_includedir}/libkcron.h
+%{_libdir}/libkcron.so
+%{_libdir}/pkgconfig/libkcron.pc
+
 
 %changelog
 
@@ -1,8 +1,9 @@
 /*
  *
- * A simple program that generates a blank keytab in a deterministic location.
+ * A simple program that prints where the keytab for a user lives.
  *
- * It should be SETUID(3p) root or have the right CAPABILITIES(7).
+ * With uids or usernames on the command line or in a file, it prints
+ * uid<TAB>path<TAB>exists for each of them, root may ask about anyone.
  *
  */
 #include "autoconf.h" /* for our automatic config bits        */
@@ -44,47 +45,337 @@
 #define __PROGRAM_NAME "client-keytab-name"
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include "kcron_filename.h"
 
-int main(void) {
+#if USE_STATIC_PIE == 1
+/* no NSS in a static-pie build, see batch_resolve() */
+#else
+#include <pwd.h>
 
-  const char *nullstring = NULL;
+#include "kcron_nss.h"
+#endif
+
+struct name_query {
+  char *text; /* as it was given */
+  uid_t uid;
+  int resolved;
+};
+
+struct name_batch {
+  struct name_query *queries;
+  size_t count;
+  size_t allocated;
+};
+
+static char keytab[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_dirname[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_filename[FILE_PATH_MAX_LENGTH + 3];
+
+/* stdio would malloc a buffer for the first printf, and batch output goes out in large writes */
+static char output_buffer[65536];
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-f file] [uid|user]...\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  Without arguments print the keytab path of the caller.\n");
+  (void)fprintf(stderr, "  Otherwise print uid<TAB>path<TAB>exists for every uid or user given,\n");
+  (void)fprintf(stderr, "  one per line in file ('-' for stdin) and/or on the command line.\n");
+  (void)fprintf(stderr, "  Only root may ask about other users.\n");
+}
+
+static int batch_add(struct name_batch *batch, const char *text) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int batch_add(struct name_batch *batch, const char *text) {
+
+  struct name_query *grown = NULL;
+
+  if (batch->count == batch->allocated) {
+    batch->allocated = (batch->allocated == 0) ? 1024 : batch->allocated * 2;
+    grown = realloc(batch->queries, batch->allocated * sizeof(*batch->queries));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    batch->queries = grown;
+  }
 
-  char *keytab = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-  char *keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-  char *keytab_filename = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  batch->queries[batch->count].text = strdup(text);
+  batch->queries[batch->count].uid = 0;
+  batch->queries[batch->count].resolved = 0;
+  if (batch->queries[batch->count].text == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  batch->count++;
+  return 0;
+}
 
-  if ((keytab == nullstring) || (keytab_dirname == nullstring) || (keytab_filename == nullstring)) {
-    if (keytab != nullstring) {
-      (void)free(keytab);
+static int batch_read(struct name_batch *batch, const char *filename) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int batch_read(struct name_batch *batch, const char *filename) {
+
+  FILE *file = stdin;
+  char *line = NULL;
+  size_t line_size = 0;
+  size_t length = 0;
+  int result = 0;
+
+  if (strcmp(filename, "-") != 0) {
+    file = fopen(filename, "re");
+    if (file == NULL) {
+      (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, filename, strerror(errno));
+      return 1;
     }
-    if (keytab_dirname != nullstring) {
-      (void)free(keytab_dirname);
+  }
+
+  while (getline(&line, &line_size, file) != -1) {
+    length = strcspn(line, " \t\r\n#");
+    line[length] = '\0';
+    if (length == 0) {
+      continue;
     }
-    if (keytab_filename != nullstring) {
-      (void)free(keytab_filename);
+    if (batch_add(batch, line) != 0) {
+      result = 1;
+      break;
     }
+  }
 
-    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+  (void)free(line);
+  if (file != stdin) {
+    (void)fclose(file);
+  }
+  return result;
+}
+
+/* all digits is a uid, like the other kcron tools a name is never a number */
+static int parse_uid(const char *text, uid_t *uid) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_uid(const char *text, uid_t *uid) {
+
+  unsigned long value = 0;
+  char *end = NULL;
+
+  if (text[0] < '0' || text[0] > '9') {
+    return 1;
+  }
+
+  errno = 0;
+  value = strtoul(text, &end, 10);
+  if (errno != 0 || *end != '\0' || value >= (unsigned long)(uid_t)-1) {
+    return 1;
+  }
+
+  *uid = (uid_t)value;
+  return 0;
+}
+
+#if USE_STATIC_PIE == 1
+/*
+ * A static glibc still loads the NSS modules of the glibc it was linked
+ * against to look up a user, so a static-pie build only takes uids.
+ */
+static int batch_resolve(struct name_batch *batch) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int batch_resolve(struct name_batch *batch) {
+
+  int result = 0;
+
+  for (size_t i = 0; i < batch->count; i++) {
+    if (parse_uid(batch->queries[i].text, &batch->queries[i].uid) == 0) {
+      batch->queries[i].resolved = 1;
+      continue;
+    }
+    (void)fprintf(stderr, "%s: %s is not a uid, this static build cannot look up usernames.\n", __PROGRAM_NAME, batch->queries[i].text);
+    result = 1;
+  }
+  return result;
+}
+#else
+/*
+ * Usernames are looked up in one pass over the passwd database when we
+ * are root, anyone else can only name themselves so one getpwuid() will do.
+ */
+static int batch_resolve(struct name_batch *batch) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int batch_resolve(struct name_batch *batch) {
+
+  struct kcron_nss_cache nss = {0};
+  const struct kcron_nss_user *user = NULL;
+  const struct passwd *pw = NULL;
+  size_t names = 0;
+  int loaded = 0;
+  int result = 0;
+
+  for (size_t i = 0; i < batch->count; i++) {
+    if (parse_uid(batch->queries[i].text, &batch->queries[i].uid) == 0) {
+      batch->queries[i].resolved = 1;
+    } else {
+      names++;
+    }
+  }
+
+  if (names == 0) {
+    return 0;
+  }
+
+  if (getuid() == 0) {
+    if (kcron_nss_load(&nss) != 0) {
+      return 1;
+    }
+    loaded = 1;
+  } else {
+    pw = getpwuid(getuid());
+  }
+
+  for (size_t i = 0; i < batch->count; i++) {
+    if (batch->queries[i].resolved == 1) {
+      continue;
+    }
+
+    if (loaded == 1) {
+      user = kcron_nss_by_name(&nss, batch->queries[i].text);
+      if (user != NULL) {
+        batch->queries[i].uid = user->uid;
+        batch->queries[i].resolved = 1;
+        continue;
+      }
+      /* SSSD without 'enumerate = true' leaves users out of getpwent() */
+      pw = getpwnam(batch->queries[i].text);
+      if (pw != NULL) {
+        batch->queries[i].uid = pw->pw_uid;
+        batch->queries[i].resolved = 1;
+        continue;
+      }
+    } else if (pw != NULL && strcmp(pw->pw_name, batch->queries[i].text) == 0) {
+      batch->queries[i].uid = pw->pw_uid;
+      batch->queries[i].resolved = 1;
+      continue;
+    } else if (pw != NULL) {
+      /* someone else, and not ours to look up */
+      (void)fprintf(stderr, "%s: Only root may look up %s.\n", __PROGRAM_NAME, batch->queries[i].text);
+      result = 1;
+      continue;
+    }
+
+    (void)fprintf(stderr, "%s: Unknown user %s.\n", __PROGRAM_NAME, batch->queries[i].text);
+    result = 1;
+  }
+
+  if (loaded == 1) {
+    kcron_nss_free(&nss);
+  }
+  return result;
+}
+#endif
+
+static int batch_print(const struct name_batch *batch) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int batch_print(const struct name_batch *batch) {
+
+  const uid_t caller = getuid();
+  struct stat st = {0};
+  const char *exists = NULL;
+  int result = 0;
+
+  for (size_t i = 0; i < batch->count; i++) {
+    const struct name_query *query = &batch->queries[i];
+
+    if (query->resolved == 0) {
+      continue;
+    }
+
+    if (caller != 0 && query->uid != caller) {
+      (void)fprintf(stderr, "%s: Only root may look up uid %u.\n", __PROGRAM_NAME, (unsigned)query->uid);
+      result = 1;
+      continue;
+    }
+
+    if (get_filenames_for_uid(query->uid, keytab_dirname, keytab_filename, keytab) != 0) {
+      (void)fprintf(stderr, "%s: Cannot determine keytab filename for uid %u.\n", __PROGRAM_NAME, (unsigned)query->uid);
+      result = 1;
+      continue;
+    }
+
+    if (fstatat(AT_FDCWD, keytab, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+      exists = "yes";
+    } else if (errno == ENOENT || errno == ENOTDIR) {
+      exists = "no";
+    } else {
+      (void)fprintf(stderr, "%s: Cannot stat %s: %s\n", __PROGRAM_NAME, keytab, strerror(errno));
+      exists = "unknown";
+      result = 1;
+    }
+
+    (void)printf("%u\t%s\t%s\n", (unsigned)query->uid, keytab, exists);
+  }
+
+  return result;
+}
+
+static int run_batch(int argc, char *argv[], const char *filename) __attribute__((nonnull(2))) __attribute__((warn_unused_result));
+static int run_batch(int argc, char *argv[], const char *filename) {
+
+  struct name_batch batch = {0};
+  int result = 0;
+
+  if (filename != NULL) {
+    result |= batch_read(&batch, filename);
+  }
+  for (int i = 0; i < argc && result == 0; i++) {
+    result |= batch_add(&batch, argv[i]);
+  }
+
+  if (result == 0) {
+    result |= batch_resolve(&batch);
+    result |= batch_print(&batch);
+  }
+
+  for (size_t i = 0; i < batch.count; i++) {
+    (void)free(batch.queries[i].text);
+  }
+  (void)free(batch.queries);
+
+  if (fflush(stdout) != 0) {
+    (void)fprintf(stderr, "%s: Cannot write results: %s\n", __PROGRAM_NAME, strerror(errno));
+    result = 1;
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+
+  const char *filename = NULL;
+  int opt = 0;
+
+  if (setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set a buffer for stdout.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
+  while ((opt = getopt(argc, argv, "f:h")) != -1) {
+    switch (opt) {
+    case 'f':
+      filename = optarg;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (filename != NULL || optind < argc) {
+    exit((run_batch(argc - optind, argv + optind, filename) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
   if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
-    (void)free(keytab);
-    (void)free(keytab_dirname);
-    (void)free(keytab_filename);
     (void)fprintf(stderr, "%s: Cannot determine keytab filename.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
   (void)printf("%s\n", keytab);
 
-  (void)free(keytab);
-  (void)free(keytab_dirname);
-  (void)free(keytab_filename);
-
   exit(EXIT_SUCCESS);
 }
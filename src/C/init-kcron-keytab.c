@@ -48,481 +48,97 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/capability.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "kcron_caps.h"
-#include "kcron_empty_keytab_file.h"
+#include "kcron_fdpass.h"
 #include "kcron_filename.h"
+#include "kcron_keytab.h"
+#include "kcron_probes.h"
 #include "kcron_setup.h"
 
-#ifndef _0600
-#define _0600 S_IRUSR | S_IWUSR
-#endif
-#ifndef _0700
-#define _0700 S_IRWXU
-#endif
-
-static int mkdir_if_missing(const char *dir, uid_t owner, gid_t group, mode_t mode) __attribute__((nonnull(1))) __attribute__((access(read_only, 1))) __attribute__((warn_unused_result));
-static int mkdir_if_missing(const char *dir, uid_t owner, gid_t group, mode_t mode) {
-
-#if USE_CAPABILITIES == 1
-  const cap_value_t caps[] = {CAP_CHOWN, CAP_DAC_OVERRIDE};
-#else
-  const cap_value_t caps[] = {-1};
-#endif
-  int num_caps = sizeof(caps) / sizeof(cap_value_t);
-
-  struct stat st = {0};
-
-  const char *nullstring = NULL;
-
-  DIR *my_dir = NULL;
-  const DIR *null_dir = NULL;
-
-  const uid_t uid = getuid();
-  const uid_t euid = geteuid();
-
-  if (dir == nullstring) {
-    /* nothing to do - no dir passed */
-    return 0;
-  }
-
-  if (stat(dir, &st) == 0) {
-    /* exists*/
-    if (S_ISDIR(st.st_mode)) {
-      /* and is a directory */
-      return 0;
-    } else {
-      /* whatever this is, it is not acceptable here */
-      (void)fprintf(stderr, "%s: %s is not a directory.\n", __PROGRAM_NAME, dir);
-      return 1;
-    }
-  }
-
-  if (enable_capabilities(caps, num_caps) != 0) {
-    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  /* use of CAP_DAC_OVERRIDE */
-  if (mkdir(dir, mode) != 0) {
-    (void)disable_capabilities();
-    (void)fprintf(stderr, "%s: Unable to mkdir %s\n", __PROGRAM_NAME, dir);
-    return 1;
-  }
-
-  if (disable_capabilities() != 0) {
-    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  if (euid != uid) {
-    /* use of CAP_DAC_OVERRIDE as we may not be able to chdir/make files otherwise   */
-    /* as the dir may be chmod 700 for not our euid */
-    if (enable_capabilities(caps, num_caps) != 0) {
-      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-      return 1;
-    }
-  }
-
-  /* use the inode of the dir we made earlier so folks can't move it      */
-  /* there is still a small race condition, but we are somewhat protected */
-  /* since opendir should make sure this is a directory.                  */
-  /* use of CAP_DAC_OVERRIDE */
-  my_dir = opendir(dir);
-
-  if (my_dir == null_dir) {
-    (void)disable_capabilities();
-    (void)fprintf(stderr, "%s: Unable to locate %s ?\n", __PROGRAM_NAME, dir);
-    (void)fprintf(stderr, "%s: This may be a permissions error?\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  /* did the directory really create on disk */
-  if (fstat(dirfd(my_dir), &st) != 0) {
-    (void)closedir(my_dir);
-    (void)disable_capabilities();
-    (void)fprintf(stderr, "%s: %s could not be created.\n", __PROGRAM_NAME, dir);
-    (void)fprintf(stderr, "%s: This may be a permissions error?\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  if (disable_capabilities() != 0) {
-    /* technically we might not have active caps now, but eh              */
-    (void)closedir(my_dir);
-    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  if (!S_ISDIR(st.st_mode)) {
-    (void)closedir(my_dir);
-    (void)disable_capabilities();
-    (void)fprintf(stderr, "%s: %s is not a directory.\n", __PROGRAM_NAME, dir);
-    return 1;
-  }
-
-  if (enable_capabilities(caps, num_caps) != 0) {
-    (void)closedir(my_dir);
-    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  /* use of CAP_CHOWN */
-  if (fchown(dirfd(my_dir), owner, group) != 0) {
-    (void)closedir(my_dir);
-    (void)disable_capabilities();
-    (void)fprintf(stderr, "%s: Unable to chown %i:%i %s\n", __PROGRAM_NAME, owner, group, dir);
-    (void)fprintf(stderr, "%s: This may be a permissions error?\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  if (disable_capabilities() != 0) {
-    (void)closedir(my_dir);
-    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  (void)closedir(my_dir);
-  return 0;
-}
-
-static int chown_chmod_keytab(int filedescriptor, const char *keytab) __attribute__((nonnull(2))) __attribute__((access(read_only, 2))) __attribute__((warn_unused_result));
-static int chown_chmod_keytab(int filedescriptor, const char *keytab) {
-
-#if USE_CAPABILITIES == 1
-  const cap_value_t keytab_caps[] = {CAP_CHOWN};
-#else
-  const cap_value_t keytab_caps[] = {-1};
-#endif
-  const int num_caps = sizeof(keytab_caps) / sizeof(cap_value_t);
-
-  const uid_t uid = getuid();
-  const gid_t gid = getgid();
-
-  struct stat st = {0};
-
-  if (filedescriptor == 0) {
-    (void)fprintf(stderr, "%s: Invalid file %s.\n", __PROGRAM_NAME, keytab);
-    return 1;
-  }
-
-  if (enable_capabilities(keytab_caps, num_caps) != 0) {
-    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  /* did the file really create on disk */
-  /* use of CAP_DAC_OVERRIDE because dir should be chmod 700 */
-  if (fstat(filedescriptor, &st) != 0) {
-    (void)fprintf(stderr, "%s: Cannot stat file %s.\n", __PROGRAM_NAME, keytab);
-    return 1;
-  }
-
-  if (disable_capabilities() != 0) {
-    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-    return 1;
-  }
-
-  if (!S_ISREG(st.st_mode)) {
-    (void)fprintf(stderr, "%s: %s is not a regular file.\n", __PROGRAM_NAME, keytab);
-    return 1;
-  }
-
-  /* ensure permissions are as expected on keytab file */
-  /* newly created file should have out euid as owner, so no caps needed */
-  if (fchmod(filedescriptor, _0600) != 0) {
-    (void)disable_capabilities();
-    (void)fprintf(stderr, "%s: Unable to chmod %o %s\n", __PROGRAM_NAME, _0600, keytab);
-    return 1;
-  }
-
-  /* Set the right owner of our keytab */
-  /* Don't switch euid to uid as that may permit write to program memory */
-  if (st.st_uid != uid || st.st_gid != gid) {
-
-    if (enable_capabilities(keytab_caps, num_caps) != 0) {
-      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-      return 1;
-    }
-
-    /* use of CAP_CHOWN, needed for SUID mode */
-    if (fchown(filedescriptor, uid, gid) != 0) {
-      (void)disable_capabilities();
-      (void)fprintf(stderr, "%s: Unable to chown %d:%d %s\n", __PROGRAM_NAME, uid, gid, keytab);
-      return 1;
-    }
-
-    if (disable_capabilities() != 0) {
-      (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-      return 1;
-    }
-  }
-
-  return 0;
-}
-
 void constructor(void) __attribute__((constructor));
 void constructor(void) {
   /* Setup runtime hardening /before/ main() is even called */
   (void)harden_runtime();
 }
 
-int main(void) {
-
-  struct stat st = {0};
+/* fixed storage, nothing is allocated once we are running as root */
+static char keytab[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_dirname[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_filename[FILE_PATH_MAX_LENGTH + 3];
+static char client_keytab_dirname[FILE_PATH_MAX_LENGTH + 3];
 
-  const char *nullstring = NULL;
-  int filedescriptor = 0;
-  int stat_code = -1;
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-s]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  Create the keytab if it is missing and print its path.\n");
+  (void)fprintf(stderr, "  -s  send the keytab directory over the socket on fd %d instead\n", KCRON_FDPASS_SOCKET);
+}
 
-  DIR *keytab_dir = NULL;
-  const DIR *null_dir = NULL;
+int main(int argc, char *argv[]) {
 
-#if USE_CAPABILITIES == 1
-  const cap_value_t caps[] = {CAP_DAC_OVERRIDE};
-#else
-  const cap_value_t caps[] = {-1};
-#endif
-  const int num_caps = sizeof(caps) / sizeof(cap_value_t);
+  int send_dir = 0;
+  int dir_fd = -1;
+  int opt = 0;
+  int rc = 0;
 
-  const uid_t euid = geteuid();
   const uid_t uid = getuid();
   const gid_t gid = getgid();
 
-  char *keytab = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-  char *keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-  char *keytab_filename = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-
-  char *client_keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-
-  /* verify memory can be allocated */
-  if ((keytab == nullstring) || (keytab_dirname == nullstring) || (keytab_filename == nullstring) || (client_keytab_dirname == nullstring)) {
-    if (keytab != nullstring) {
-      (void)free(keytab);
-    }
-    if (keytab_dirname != nullstring) {
-      (void)free(keytab_dirname);
-    }
-    if (keytab_filename != nullstring) {
-      (void)free(keytab_filename);
-    }
-    if (client_keytab_dirname != nullstring) {
-      (void)free(client_keytab_dirname);
+  while ((opt = getopt(argc, argv, "sh")) != -1) {
+    switch (opt) {
+    case 's':
+      send_dir = 1;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
     }
+  }
 
-    (void)fprintf(stderr, "%s: Unable to allocate memory.\n", __PROGRAM_NAME);
+  if (optind != argc) {
+    usage();
     exit(EXIT_FAILURE);
   }
 
   /* is our client keytab directory set*/
   if (get_client_dirname(client_keytab_dirname) != 0) {
     (void)fprintf(stderr, "%s: Client keytab directory not set.\n", __PROGRAM_NAME);
-    (void)free(keytab);
-    (void)free(keytab_dirname);
-    (void)free(keytab_filename);
-    (void)free(client_keytab_dirname);
-    exit(EXIT_FAILURE);
-  }
-
-  /* look for our client keytab directory */
-  if (stat(client_keytab_dirname, &st) == -1) {
-    (void)fprintf(stderr, "%s: Client keytab directory does not exist: %s.\n", __PROGRAM_NAME, client_keytab_dirname);
-    (void)fprintf(stderr, "%s: Contact your admin to have it created.\n", __PROGRAM_NAME);
-    (void)free(keytab);
-    (void)free(keytab_dirname);
-    (void)free(keytab_filename);
-    (void)free(client_keytab_dirname);
     exit(EXIT_FAILURE);
   }
 
   /* find our filenames */
-  if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
+  KCRON_STAGE_ENTRY(KCRON_STAGE_FILENAMES);
+  rc = get_filenames(keytab_dirname, keytab_filename, keytab);
+  KCRON_STAGE_RETURN(KCRON_STAGE_FILENAMES, rc);
+  if (rc != 0) {
     (void)fprintf(stderr, "%s: Cannot determine keytab filename.\n", __PROGRAM_NAME);
-    (void)free(keytab);
-    (void)free(keytab_dirname);
-    (void)free(keytab_filename);
-    (void)free(client_keytab_dirname);
     exit(EXIT_FAILURE);
   }
 
-  /* make sure our storage directory exists */
-  if (mkdir_if_missing(keytab_dirname, uid, gid, _0700) != 0) {
-    (void)fprintf(stderr, "%s: Cannot make dir %s.\n", __PROGRAM_NAME, keytab_dirname);
-    (void)free(keytab);
-    (void)free(keytab_dirname);
-    (void)free(keytab_filename);
-    (void)free(client_keytab_dirname);
+  /* If keytab is missing make it */
+  if (create_keytab_if_missing_at(keytab_dirname, keytab_filename, keytab, uid, gid, (send_dir == 1) ? &dir_fd : NULL) != 0) {
     exit(EXIT_FAILURE);
   }
 
-  if (euid != uid) {
-    /* use of CAP_DAC_OVERRIDE as we may not be able to chdir otherwise   */
-    if (enable_capabilities(caps, num_caps) != 0) {
-      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
+  /* the caller knows the path, it wants the directory we already checked */
+  if (send_dir == 1) {
+    rc = kcron_send_fd(KCRON_FDPASS_SOCKET, dir_fd);
+    (void)close(dir_fd);
+    if (rc != 0) {
+      (void)fprintf(stderr, "%s: Cannot send keytab directory: %s\n", __PROGRAM_NAME, strerror(rc));
       exit(EXIT_FAILURE);
     }
+    exit(EXIT_SUCCESS);
   }
 
-  /* look for our keytab */
-  stat_code = stat(keytab, &st);
-
-  if (disable_capabilities() != 0) {
-    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-    (void)free(keytab);
-    (void)free(keytab_dirname);
-    (void)free(keytab_filename);
-    (void)free(client_keytab_dirname);
-    exit(EXIT_FAILURE);
-  }
-
-  /* If keytab is missing make it */
-  /* If it exists but has the wrong permissions/owner do nothing, it is safer */
-  if (stat_code == -1) {
-
-    if (euid != uid) {
-      /* use of CAP_DAC_OVERRIDE as we may not be able to chdir otherwise   */
-      if (enable_capabilities(caps, num_caps) != 0) {
-        (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
-        (void)free(keytab);
-        (void)free(keytab_dirname);
-        (void)free(keytab_filename);
-        (void)free(client_keytab_dirname);
-        exit(EXIT_FAILURE);
-      }
-    }
-
-    /* use the inode of the dir we made earlier so folks can't move it      */
-    /* there is still a small race condition, but we are somewhat protected */
-    /* since opendir should make sure this is a directory                   */
-    keytab_dir = opendir(keytab_dirname);
-
-    /* did the dir really open */
-    if (keytab_dir == null_dir) {
-      (void)fprintf(stderr, "%s: Unable to locate %s ?\n", __PROGRAM_NAME, keytab_dirname);
-      (void)fprintf(stderr, "%s: This may be a permissions error?\n", __PROGRAM_NAME);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    if (fstat(dirfd(keytab_dir), &st) != 0) {
-      (void)fprintf(stderr, "%s: %s could not be read.\n", __PROGRAM_NAME, keytab_dirname);
-      (void)closedir(keytab_dir);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    if (disable_capabilities() != 0) {
-      (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    if (!S_ISDIR(st.st_mode)) {
-      (void)fprintf(stderr, "%s: %s is not a directory.\n", __PROGRAM_NAME, keytab_dirname);
-      (void)closedir(keytab_dir);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    filedescriptor = openat(dirfd(keytab_dir), keytab_filename, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, _0600);
-
-    if (disable_capabilities() != 0) {
-      /* technically we might not have active caps now, but eh              */
-      (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    /* did the file really create at the target location */
-    if (filedescriptor == 0) {
-      (void)fprintf(stderr, "%s: %s is missing, cannot create.\n", __PROGRAM_NAME, keytab);
-      (void)closedir(keytab_dir);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    /* we have the fd, don't need this one any more */
-    (void)closedir(keytab_dir);
-
-    /* did the file really create on disk */
-    if (fstat(filedescriptor, &st) != 0) {
-      (void)fprintf(stderr, "%s: %s could not be created.\n", __PROGRAM_NAME, keytab);
-      (void)close(filedescriptor);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    /* is the file a normal file */
-    if (!S_ISREG(st.st_mode)) {
-      (void)fprintf(stderr, "%s: %s is not a file.\n", __PROGRAM_NAME, keytab);
-      (void)close(filedescriptor);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    /* write to it first to ensure its content is right before we set owner/mode */
-    if (write_empty_keytab(filedescriptor) != 0) {
-      (void)fprintf(stderr, "%s: Cannot create keytab : %s.\n", __PROGRAM_NAME, keytab);
-      (void)close(filedescriptor);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    if (chown_chmod_keytab(filedescriptor, keytab) != 0) {
-      (void)fprintf(stderr, "%s: Cannot set permissions on keytab : %s.\n", __PROGRAM_NAME, keytab);
-      (void)close(filedescriptor);
-      (void)free(keytab);
-      (void)free(keytab_dirname);
-      (void)free(keytab_filename);
-      (void)free(client_keytab_dirname);
-      exit(EXIT_FAILURE);
-    }
-
-    (void)close(filedescriptor);
-  } /* no else required, this exists to make it */
-
   (void)printf("%s\n", keytab);
 
-  (void)free(keytab);
-  (void)free(keytab_dirname);
-  (void)free(keytab_filename);
-  (void)free(client_keytab_dirname);
-
   exit(EXIT_SUCCESS);
 }
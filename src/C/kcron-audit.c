@@ -0,0 +1,610 @@
+/*
+ *
+ * Check the owner, mode and type of every keytab directory and keytab
+ * under the client keytab directory, and find keytabs whose account is gone.
+ *
+ * Each directory is read with large getdents64() buffers and every
+ * STATX(2) goes out in one batch.
+ *
+ * With -x the keytab directories of accounts that are gone are removed.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-audit"
+#endif
+
+#include "autoconf.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_audit.h"
+#include "kcron_filename.h"
+#include "kcron_nss.h"
+#include "kcron_statx.h"
+
+/* a 50k entry directory is ~2MiB of dirents, so a few calls at most */
+#define AUDIT_GETDENTS_SIZE (1024 * 1024)
+
+/* see linux_dirent64 in getdents(2), glibc only wraps it from 2.30 */
+struct audit_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+struct audit_options {
+  int json;
+  int all;
+  int allow_uring;
+  int remove_orphans;
+  int dry_run;
+  long num_threads;
+  const char *directory;
+};
+
+/* a numeric directory, which should be a user's keytab directory */
+struct audit_entry {
+  uid_t uid;
+  int dir_fd;
+  int shard; /* -1 directly in the client directory */
+  unsigned int problems;
+  int have_keytab;
+  mode_t keytab_mode;
+  uint64_t keytab_size;
+  char name[12];
+  char keytab[12 + sizeof(KCRON_KEYTAB_FILENAME)];
+};
+
+/* anything else worth a line: shards and names that do not belong */
+struct audit_other {
+  char *path;
+  unsigned int problems;
+};
+
+struct audit_state {
+  struct audit_entry *entries;
+  size_t num_entries;
+  size_t allocated_entries;
+  struct audit_other *others;
+  size_t num_others;
+  size_t allocated_others;
+  int *shard_fds;
+  size_t num_shard_fds;
+  size_t allocated_shard_fds;
+  char *buffer;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-j] [-a] [-t threads] [-T] [-d dir] [-x [-n]]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -j          one JSON object per line\n");
+  (void)fprintf(stderr, "  -a          list every keytab directory, not only the ones with problems\n");
+  (void)fprintf(stderr, "  -t threads  threads for STATX(2) when io_uring is not available (default: online CPUs)\n");
+  (void)fprintf(stderr, "  -T          always use threads, never io_uring\n");
+  (void)fprintf(stderr, "  -d dir      audit dir rather than %s\n", __CLIENT_KEYTAB_DIR);
+  (void)fprintf(stderr, "  -x          remove the keytab directories of orphaned uids\n");
+  (void)fprintf(stderr, "  -n          with -x, only report what would be removed\n");
+}
+
+static int add_other(struct audit_state *state, const char *prefix, const char *name, unsigned int problems) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+static int add_other(struct audit_state *state, const char *prefix, const char *name, unsigned int problems) {
+
+  struct audit_other *grown = NULL;
+  char *path = NULL;
+
+  if (state->num_others == state->allocated_others) {
+    state->allocated_others = (state->allocated_others == 0) ? 64 : state->allocated_others * 2;
+    grown = realloc(state->others, state->allocated_others * sizeof(struct audit_other));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    state->others = grown;
+  }
+  if (asprintf(&path, "%s/%s", prefix, name) < 0) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  state->others[state->num_others].path = path;
+  state->others[state->num_others].problems = problems;
+  state->num_others++;
+  return 0;
+}
+
+static int add_entry(struct audit_state *state, int dir_fd, int shard, uid_t uid, const char *name) __attribute__((nonnull(1, 5))) __attribute__((warn_unused_result));
+static int add_entry(struct audit_state *state, int dir_fd, int shard, uid_t uid, const char *name) {
+
+  struct audit_entry *grown = NULL;
+  struct audit_entry *entry = NULL;
+
+  if (state->num_entries == state->allocated_entries) {
+    state->allocated_entries = (state->allocated_entries == 0) ? 4096 : state->allocated_entries * 2;
+    grown = realloc(state->entries, state->allocated_entries * sizeof(struct audit_entry));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    state->entries = grown;
+  }
+
+  entry = &state->entries[state->num_entries++];
+  entry->uid = uid;
+  entry->dir_fd = dir_fd;
+  entry->shard = shard;
+  entry->problems = 0;
+  entry->have_keytab = 0;
+  (void)snprintf(entry->name, sizeof(entry->name), "%s", name);
+  (void)snprintf(entry->keytab, sizeof(entry->keytab), "%s/%s", name, KCRON_KEYTAB_FILENAME);
+  return 0;
+}
+
+static int walk_dir(struct audit_state *state, int dir_fd, int shard, const char *prefix, uid_t owner) __attribute__((nonnull(1, 4))) __attribute__((warn_unused_result));
+static int walk_dir(struct audit_state *state, int dir_fd, int shard, const char *prefix, uid_t owner) {
+
+  char display[FILE_PATH_MAX_LENGTH] = {0};
+  char **shards = NULL;
+  size_t num_shards = 0;
+  struct stat st = {0};
+  unsigned long number = 0;
+  unsigned int problems = 0;
+  long got = 0;
+  int shard_fd = -1;
+  int *grown_fds = NULL;
+  char **grown = NULL;
+  int result = 0;
+
+  while ((got = syscall(SYS_getdents64, dir_fd, state->buffer, AUDIT_GETDENTS_SIZE)) > 0) {
+    for (long offset = 0; offset < got;) {
+      const struct audit_dirent64 *dirent = (const struct audit_dirent64 *)(state->buffer + offset);
+      offset += dirent->d_reclen;
+
+      if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0) {
+        continue;
+      }
+      if (kcron_audit_parse_number(dirent->d_name, &number) == 0) {
+        result |= add_entry(state, dir_fd, shard, (uid_t)number, dirent->d_name);
+        continue;
+      }
+      /* shards only at the top, either layout may be there mid kcron-shard-migrate */
+      if (shard < 0 && strncmp(dirent->d_name, KCRON_SHARD_PREFIX, strlen(KCRON_SHARD_PREFIX)) == 0 &&
+          kcron_audit_parse_number(dirent->d_name + strlen(KCRON_SHARD_PREFIX), &number) == 0 && (dirent->d_type == DT_DIR || dirent->d_type == DT_UNKNOWN)) {
+        /* read after this directory, as we reuse the one buffer */
+        grown = realloc(shards, (num_shards + 1) * sizeof(char *));
+        if (grown == NULL || (grown[num_shards] = strdup(dirent->d_name)) == NULL) {
+          (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+          shards = (grown == NULL) ? shards : grown;
+          result = 1;
+          break;
+        }
+        shards = grown;
+        num_shards++;
+        continue;
+      }
+      result |= add_other(state, prefix, dirent->d_name, KCRON_AUDIT_STRAY);
+    }
+  }
+  if (got < 0) {
+    (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, prefix, strerror(errno));
+    result = 1;
+  }
+
+  for (size_t i = 0; i < num_shards; i++) {
+    (void)snprintf(display, sizeof(display), "%s/%s", prefix, shards[i]);
+    shard_fd = openat(dir_fd, shards[i], O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (shard_fd < 0) {
+      result |= add_other(state, prefix, shards[i], (errno == ENOTDIR || errno == ELOOP) ? KCRON_AUDIT_STRAY : KCRON_AUDIT_UNREADABLE);
+      (void)free(shards[i]);
+      continue;
+    }
+
+    /* the same rules mkshardat_if_missing() makes them with */
+    problems = 0;
+    if (kcron_audit_parse_number(shards[i] + strlen(KCRON_SHARD_PREFIX), &number) != 0) {
+      number = 0;
+    }
+    if (fstat(shard_fd, &st) != 0) {
+      problems |= KCRON_AUDIT_UNREADABLE;
+    } else {
+      problems |= (st.st_uid != owner) ? KCRON_AUDIT_SHARD_OWNER : 0;
+      problems |= ((st.st_mode & 07777) != KCRON_SHARD_MODE) ? KCRON_AUDIT_SHARD_MODE : 0;
+    }
+    problems |= (kcron_audit_shard_is_used((unsigned int)number, __CLIENT_KEYTAB_SHARDS) == 0) ? KCRON_AUDIT_MISPLACED : 0;
+    result |= add_other(state, prefix, shards[i], problems);
+
+    if (state->num_shard_fds == state->allocated_shard_fds) {
+      state->allocated_shard_fds = (state->allocated_shard_fds == 0) ? 256 : state->allocated_shard_fds * 2;
+      grown_fds = realloc(state->shard_fds, state->allocated_shard_fds * sizeof(int));
+      if (grown_fds == NULL) {
+        (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+        (void)close(shard_fd);
+        result = 1;
+        (void)free(shards[i]);
+        continue;
+      }
+      state->shard_fds = grown_fds;
+    }
+    state->shard_fds[state->num_shard_fds++] = shard_fd;
+    result |= walk_dir(state, shard_fd, (int)number, display, owner);
+    (void)free(shards[i]);
+  }
+  (void)free(shards);
+  return result;
+}
+
+static void check_entry(struct audit_entry *entry, const struct kcron_statx_request *dir, const struct kcron_statx_request *keytab, const struct kcron_nss_cache *nss)
+    __attribute__((nonnull(1, 2, 3, 4)));
+static void check_entry(struct audit_entry *entry, const struct kcron_statx_request *dir, const struct kcron_statx_request *keytab, const struct kcron_nss_cache *nss) {
+
+  if (nss->count > 0 && kcron_nss_by_uid(nss, entry->uid) == NULL) {
+    entry->problems |= KCRON_AUDIT_ORPHAN;
+  }
+
+  entry->problems |= kcron_audit_check(entry->uid, entry->shard, __CLIENT_KEYTAB_SHARDS, &dir->stx, dir->error, &keytab->stx, keytab->error);
+
+  if (dir->error == 0 && S_ISDIR(dir->stx.stx_mode) && keytab->error == 0) {
+    entry->have_keytab = 1;
+    entry->keytab_mode = keytab->stx.stx_mode & 07777;
+    entry->keytab_size = keytab->stx.stx_size;
+  }
+}
+
+/*
+ * Remove an orphan's keytab directory and what kcron leaves in it.
+ * Returns 0 when it is gone, or was left because its uid resolves after all.
+ */
+static int remove_orphan(const struct audit_entry *entry, const char *path, int dry_run) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int remove_orphan(const struct audit_entry *entry, const char *path, int dry_run) {
+
+  const struct dirent *dirent = NULL;
+  DIR *dir = NULL;
+  int user_fd = -1;
+  int result = 0;
+
+  /* without enumerate = true SSSD lists only some accounts, so ask once more */
+  errno = 0;
+  if (getpwuid(entry->uid) != NULL) {
+    (void)fprintf(stderr, "%s: uid %u resolves, NSS enumeration is incomplete, keeping %s\n", __PROGRAM_NAME, entry->uid, path);
+    return 0;
+  }
+  if (errno != 0 && errno != ENOENT && errno != ESRCH && errno != EBADF && errno != EPERM) {
+    (void)fprintf(stderr, "%s: Cannot look up uid %u, keeping %s: %s\n", __PROGRAM_NAME, entry->uid, path, strerror(errno));
+    return 1;
+  }
+
+  if (dry_run == 1) {
+    (void)fprintf(stderr, "%s: would remove %s\n", __PROGRAM_NAME, path);
+    return 0;
+  }
+
+  user_fd = openat(entry->dir_fd, entry->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (user_fd >= 0) {
+    dir = fdopendir(user_fd);
+  }
+  if (dir == NULL) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    if (user_fd >= 0) {
+      (void)close(user_fd);
+    }
+    return 1;
+  }
+
+  /* the keytab and any temporary names, never a subdirectory */
+  while ((dirent = readdir(dir)) != NULL) {
+    if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0) {
+      continue;
+    }
+    if (unlinkat(dirfd(dir), dirent->d_name, 0) != 0) {
+      (void)fprintf(stderr, "%s: Cannot remove %s/%s: %s\n", __PROGRAM_NAME, path, dirent->d_name, strerror(errno));
+      result = 1;
+    }
+  }
+  (void)closedir(dir);
+
+  if (result == 0 && unlinkat(entry->dir_fd, entry->name, AT_REMOVEDIR) != 0) {
+    (void)fprintf(stderr, "%s: Cannot remove %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    result = 1;
+  }
+  if (result == 0) {
+    (void)fprintf(stderr, "%s: removed %s\n", __PROGRAM_NAME, path);
+  }
+  return result;
+}
+
+static void json_string(const char *text) __attribute__((nonnull(1)));
+static void json_string(const char *text) {
+  (void)putchar('"');
+  for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+    if (*p == '"' || *p == '\\') {
+      (void)putchar('\\');
+      (void)putchar(*p);
+    } else if (*p < 0x20) {
+      (void)printf("\\u%04x", *p);
+    } else {
+      (void)putchar(*p);
+    }
+  }
+  (void)putchar('"');
+}
+
+/* one row per line, whatever the names in there look like */
+static void table_string(const char *text) __attribute__((nonnull(1)));
+static void table_string(const char *text) {
+  for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+    if (*p < 0x20 || *p == 0x7f || *p == '\\') {
+      (void)printf("\\%03o", *p);
+    } else {
+      (void)putchar(*p);
+    }
+  }
+}
+
+static void print_problems(unsigned int problems, int json) {
+  int first = 1;
+
+  if (json == 1) {
+    (void)putchar('[');
+  }
+  for (size_t i = 0; i < sizeof(kcron_audit_problem_names) / sizeof(kcron_audit_problem_names[0]); i++) {
+    if ((problems & (1U << i)) == 0) {
+      continue;
+    }
+    if (first == 0) {
+      (void)putchar(',');
+    }
+    if (json == 1) {
+      json_string(kcron_audit_problem_names[i]);
+    } else {
+      (void)fputs(kcron_audit_problem_names[i], stdout);
+    }
+    first = 0;
+  }
+  if (json == 1) {
+    (void)putchar(']');
+  } else if (first == 1) {
+    (void)fputs("ok", stdout);
+  }
+}
+
+static void print_row(const char *uid, const char *path, unsigned int problems, const struct audit_entry *entry, int json) __attribute__((nonnull(1, 2)));
+static void print_row(const char *uid, const char *path, unsigned int problems, const struct audit_entry *entry, int json) {
+  if (json == 0) {
+    (void)printf("%s\t", uid);
+    print_problems(problems, json);
+    (void)putchar('\t');
+    table_string(path);
+    (void)putchar('\n');
+    return;
+  }
+
+  (void)printf("{\"uid\":%s,\"path\":", (uid[0] == '-') ? "null" : uid);
+  json_string(path);
+  (void)fputs(",\"problems\":", stdout);
+  print_problems(problems, json);
+  if (entry != NULL && entry->have_keytab == 1) {
+    (void)printf(",\"keytab_mode\":\"%04o\",\"keytab_size\":%llu", (unsigned int)entry->keytab_mode, (unsigned long long)entry->keytab_size);
+  }
+  (void)fputs("}\n", stdout);
+}
+
+static int cmp_entry_uid(const void *a, const void *b) {
+  const struct audit_entry *left = a;
+  const struct audit_entry *right = b;
+  return (left->uid > right->uid) - (left->uid < right->uid);
+}
+
+int main(int argc, char *argv[]) {
+
+  struct audit_options options = {.json = 0, .all = 0, .allow_uring = 1, .remove_orphans = 0, .dry_run = 0, .num_threads = sysconf(_SC_NPROCESSORS_ONLN), .directory = __CLIENT_KEYTAB_DIR};
+  struct audit_state state = {0};
+  struct kcron_nss_cache nss = {0};
+  struct kcron_statx_request *requests = NULL;
+  struct timespec started = {0};
+  struct timespec finished = {0};
+  struct stat st = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  char uid[16] = {0};
+  char *end = NULL;
+  size_t with_problems = 0;
+  size_t orphans = 0;
+  size_t removed = 0;
+  int backend = 0;
+  int opt = 0;
+  int result = 0;
+
+  while ((opt = getopt(argc, argv, "jat:Td:xnh")) != -1) {
+    switch (opt) {
+    case 'j':
+      options.json = 1;
+      break;
+    case 'a':
+      options.all = 1;
+      break;
+    case 't':
+      errno = 0;
+      options.num_threads = strtol(optarg, &end, 10);
+      if (errno != 0 || *end != '\0' || options.num_threads < 1) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'T':
+      options.allow_uring = 0;
+      break;
+    case 'd':
+      options.directory = optarg;
+      break;
+    case 'x':
+      options.remove_orphans = 1;
+      break;
+    case 'n':
+      options.dry_run = 1;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (options.dry_run == 1 && options.remove_orphans == 0) {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &started);
+
+  /* one pass over passwd answers every orphan check below */
+  if (kcron_nss_load(&nss) != 0) {
+    exit(EXIT_FAILURE);
+  }
+  if (nss.count == 0) {
+    (void)fprintf(stderr, "%s: NSS listed no accounts, not looking for orphans.\n", __PROGRAM_NAME);
+  }
+
+  const int client_fd = open(options.directory, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (client_fd < 0 || fstat(client_fd, &st) != 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, options.directory, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  state.buffer = malloc(AUDIT_GETDENTS_SIZE);
+  if (state.buffer == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+  result |= walk_dir(&state, client_fd, -1, options.directory, st.st_uid);
+  (void)free(state.buffer);
+
+  /* the directory and its keytab for each entry, all in one batch */
+  requests = calloc(state.num_entries * 2 + 1, sizeof(struct kcron_statx_request));
+  if (requests == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < state.num_entries; i++) {
+    requests[2 * i].dir_fd = state.entries[i].dir_fd;
+    requests[2 * i].path = state.entries[i].name;
+    requests[2 * i + 1].dir_fd = state.entries[i].dir_fd;
+    requests[2 * i + 1].path = state.entries[i].keytab;
+  }
+  backend = kcron_statx_batch(requests, state.num_entries * 2, options.num_threads, options.allow_uring);
+  if (backend < 0) {
+    (void)fprintf(stderr, "%s: io_uring failed part way, run again with -T.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < state.num_entries; i++) {
+    check_entry(&state.entries[i], &requests[2 * i], &requests[2 * i + 1], &nss);
+  }
+  (void)clock_gettime(CLOCK_MONOTONIC, &finished);
+
+  for (size_t i = 0; i < state.num_others; i++) {
+    if (state.others[i].problems != 0) {
+      with_problems++;
+    }
+    if (state.others[i].problems != 0 || options.all == 1) {
+      print_row("-", state.others[i].path, state.others[i].problems, NULL, options.json);
+    }
+    (void)free(state.others[i].path);
+  }
+
+  /* the requests point into the entries, they are done with now */
+  (void)free(requests);
+  qsort(state.entries, state.num_entries, sizeof(struct audit_entry), cmp_entry_uid);
+
+  for (size_t i = 0; i < state.num_entries; i++) {
+    const struct audit_entry *entry = &state.entries[i];
+    if (entry->problems != 0) {
+      with_problems++;
+    }
+    if ((entry->problems & KCRON_AUDIT_ORPHAN) != 0) {
+      orphans++;
+    }
+    if (entry->problems == 0 && options.all == 0) {
+      continue;
+    }
+    (void)snprintf(uid, sizeof(uid), "%u", entry->uid);
+    if (entry->shard < 0) {
+      (void)snprintf(path, sizeof(path), "%s/%s", options.directory, entry->name);
+    } else {
+      (void)snprintf(path, sizeof(path), "%s/%s%d/%s", options.directory, KCRON_SHARD_PREFIX, entry->shard, entry->name);
+    }
+    print_row(uid, path, entry->problems, entry, options.json);
+
+    if (options.remove_orphans == 1 && (entry->problems & KCRON_AUDIT_ORPHAN) != 0) {
+      if (remove_orphan(entry, path, options.dry_run) != 0) {
+        result = 1;
+      } else if (options.dry_run == 0) {
+        removed++;
+        /* nothing left to complain about */
+        with_problems -= (entry->problems == KCRON_AUDIT_ORPHAN) ? 1 : 0;
+      }
+    }
+  }
+
+  (void)fprintf(stderr, "%s: %zu keytab directories, %zu problems, %zu orphans, %zu removed, checked in %.3fs with %s\n", __PROGRAM_NAME, state.num_entries, with_problems, orphans, removed,
+                (double)(finished.tv_sec - started.tv_sec) + (double)(finished.tv_nsec - started.tv_nsec) / 1e9,
+                (backend == KCRON_STATX_BACKEND_IO_URING) ? "io_uring" : "threads");
+
+  for (size_t i = 0; i < state.num_shard_fds; i++) {
+    (void)close(state.shard_fds[i]);
+  }
+  (void)close(client_fd);
+  (void)free(state.entries);
+  (void)free(state.others);
+  (void)free(state.shard_fds);
+  kcron_nss_free(&nss);
+
+  if (result != 0 || with_problems != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
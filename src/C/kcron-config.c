@@ -0,0 +1,205 @@
+/*
+ *
+ * Resolve the default realm, user and node name for the kcron scripts.
+ *
+ * The answer is printed as shell assignments for kcron.sysconfig to eval.
+ * With -c it is also cached, keyed on the files krb5.conf pulled in, so
+ * the common case needs no helper processes at all.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-config"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "kcron_krb5conf.h"
+
+#define KCRON_DEFAULT_KRB5_CONFIG "/etc/krb5.conf"
+
+static struct kcron_krb5conf conf;
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-c] [-C cache]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -c        also write the answer to %s/<uid>\n", __KCRON_CONFIG_CACHE_DIR);
+  (void)fprintf(stderr, "  -C cache  write the answer to this file instead\n");
+}
+
+/* single quote for the shell, ' becomes '\'' */
+static void shell_quote(FILE *output, const char *text) __attribute__((nonnull(1, 2)));
+static void shell_quote(FILE *output, const char *text) {
+  (void)fputc('\'', output);
+  for (const char *p = text; *p != '\0'; p++) {
+    if (*p == '\'') {
+      (void)fputs("'\\''", output);
+    } else {
+      (void)fputc(*p, output);
+    }
+  }
+  (void)fputc('\'', output);
+}
+
+static void print_config(FILE *output, const char *krb5_config, const char *whoami, const char *nodename) __attribute__((nonnull(1, 2, 3, 4)));
+static void print_config(FILE *output, const char *krb5_config, const char *whoami, const char *nodename) {
+  (void)fputs("DEFAULT_REALM=", output);
+  shell_quote(output, conf.default_realm);
+  (void)fputs("\nKCRON_CONFIG_WHOAMI=", output);
+  shell_quote(output, whoami);
+  (void)fputs("\nKCRON_CONFIG_NODENAME=", output);
+  shell_quote(output, nodename);
+  (void)fputs("\nKCRON_CONFIG_KRB5=", output);
+  shell_quote(output, krb5_config);
+  (void)fputs("\nKCRON_CONFIG_DEPS=(", output);
+  for (size_t i = 0; i < conf.num_deps; i++) {
+    if (i > 0) {
+      (void)fputc(' ', output);
+    }
+    shell_quote(output, conf.deps[i]);
+  }
+  (void)fputs(")\n", output);
+}
+
+/*
+ * The cache directory is sticky and world writable, so write a private
+ * temporary file and rename it over our own name.  The rename fails if
+ * someone else already owns that name, the scripts refuse such a file.
+ */
+static int write_cache(const char *cache, const char *krb5_config, const char *whoami, const char *nodename) __attribute__((nonnull(1, 2, 3, 4)));
+static int write_cache(const char *cache, const char *krb5_config, const char *whoami, const char *nodename) {
+  char temporary[FILE_PATH_MAX_LENGTH] = {0};
+  FILE *output = NULL;
+
+  (void)snprintf(temporary, sizeof(temporary), "%s.XXXXXX", cache);
+
+  const int fd = mkstemp(temporary);
+  if (fd < 0) {
+    return 1;
+  }
+
+  output = fdopen(fd, "w");
+  if (output == NULL) {
+    (void)close(fd);
+    (void)unlink(temporary);
+    return 1;
+  }
+
+  print_config(output, krb5_config, whoami, nodename);
+
+  if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0 || fclose(output) != 0) {
+    (void)unlink(temporary);
+    return 1;
+  }
+
+  if (rename(temporary, cache) != 0) {
+    (void)unlink(temporary);
+    return 1;
+  }
+
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+  char cache[FILE_PATH_MAX_LENGTH] = {0};
+  struct utsname uts = {0};
+  const struct passwd *pw = NULL;
+  const char *krb5_config = getenv("KRB5_CONFIG");
+  int write_to_cache = 0;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "cC:h")) != -1) {
+    switch (opt) {
+    case 'c':
+      write_to_cache = 1;
+      break;
+    case 'C':
+      write_to_cache = 1;
+      (void)snprintf(cache, sizeof(cache), "%s", optarg);
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (krb5_config == NULL || krb5_config[0] == '\0') {
+    krb5_config = KCRON_DEFAULT_KRB5_CONFIG;
+  }
+
+  if (kcron_krb5conf_load(krb5_config, &conf) != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  pw = getpwuid(geteuid());
+  if (pw == NULL) {
+    (void)fprintf(stderr, "%s: Cannot find a passwd entry for uid %u.\n", __PROGRAM_NAME, geteuid());
+    exit(EXIT_FAILURE);
+  }
+
+  if (uname(&uts) != 0) {
+    (void)fprintf(stderr, "%s: Cannot determine the node name: %s\n", __PROGRAM_NAME, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  print_config(stdout, krb5_config, pw->pw_name, uts.nodename);
+
+  if (write_to_cache == 1) {
+    if (cache[0] == '\0') {
+      (void)snprintf(cache, sizeof(cache), "%s/%u", __KCRON_CONFIG_CACHE_DIR, geteuid());
+    }
+    /* no cache is only slower, never an error */
+    (void)write_cache(cache, krb5_config, pw->pw_name, uts.nodename);
+  }
+
+  if (fflush(stdout) != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,271 @@
+/*
+ *
+ * Answer questions about keytabs from the kcron-indexd snapshot,
+ * without touching the keytab store.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-index"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_audit.h"
+#include "kcron_index.h"
+
+struct index_options {
+  const char *index_file;
+  int json;
+  int all;
+  long max_age;    /* seconds since the last heartbeat, -1 to not check */
+  long benchmark;  /* lookups per uid to time, 0 for none */
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-f file] [-j] [-m seconds] [-b count] [-a | user...]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -f file     read this index (default %s)\n", __KCRON_INDEX_FILE);
+  (void)fprintf(stderr, "  -j          one JSON object per line\n");
+  (void)fprintf(stderr, "  -a          list every keytab directory in the index\n");
+  (void)fprintf(stderr, "  -m seconds  fail if kcron-indexd has not been heard from in this long\n");
+  (void)fprintf(stderr, "  -b count    time count lookups of each user\n");
+  (void)fprintf(stderr, "  user        a user name or uid, the status is 1 if any are missing or have problems\n");
+}
+
+static long parse_count(const char *text) __attribute__((nonnull(1)));
+static long parse_count(const char *text) {
+  char *end = NULL;
+  long number = 0;
+
+  errno = 0;
+  number = strtol(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || number < 0) {
+    return -1;
+  }
+  return number;
+}
+
+static int parse_user(const char *text, uid_t *uid) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_user(const char *text, uid_t *uid) {
+  unsigned long number = 0;
+
+  if (kcron_audit_parse_number(text, &number) == 0) {
+    *uid = (uid_t)number;
+    return 0;
+  }
+  const struct passwd *pw = getpwnam(text);
+  if (pw == NULL) {
+    return 1;
+  }
+  *uid = pw->pw_uid;
+  return 0;
+}
+
+static void print_problems(const struct kcron_index_record *record, int json) __attribute__((nonnull(1)));
+static void print_problems(const struct kcron_index_record *record, int json) {
+  int first = 1;
+
+  if (json == 1) {
+    (void)putchar('[');
+  }
+  for (size_t i = 0; i < sizeof(kcron_audit_problem_names) / sizeof(kcron_audit_problem_names[0]); i++) {
+    if ((record->problems & (1U << i)) == 0) {
+      continue;
+    }
+    (void)printf((json == 1) ? "%s\"%s\"" : "%s%s", (first == 1) ? "" : ",", kcron_audit_problem_names[i]);
+    first = 0;
+  }
+  if ((record->flags & KCRON_INDEX_FLAG_DAMAGED) != 0) {
+    (void)printf((json == 1) ? "%s\"%s\"" : "%s%s", (first == 1) ? "" : ",", "keytab-damaged");
+    first = 0;
+  }
+  if (json == 1) {
+    (void)putchar(']');
+  } else if (first == 1) {
+    (void)fputs("ok", stdout);
+  }
+}
+
+static void print_record(const struct kcron_index_record *record, int json) __attribute__((nonnull(1)));
+static void print_record(const struct kcron_index_record *record, int json) {
+  if (json == 0) {
+    (void)printf("%u\t%d\t%llu\t%llu\t%lld\t%u\t%u\t%04o\t", record->uid, record->shard, (unsigned long long)record->inode, (unsigned long long)record->size,
+                 (long long)record->mtime, record->kvno, record->entries, record->keytab_mode);
+    print_problems(record, json);
+    (void)putchar('\n');
+    return;
+  }
+  (void)printf("{\"uid\":%u,\"shard\":%d,\"inode\":%llu,\"size\":%llu,\"mtime\":%lld,\"kvno\":%u,\"entries\":%u,\"keytab_mode\":\"%04o\",\"dir_mode\":\"%04o\",\"problems\":",
+               record->uid, record->shard, (unsigned long long)record->inode, (unsigned long long)record->size, (long long)record->mtime, record->kvno, record->entries,
+               record->keytab_mode, record->dir_mode);
+  print_problems(record, json);
+  (void)fputs("}\n", stdout);
+}
+
+static int cmp_record_uid(const void *a, const void *b) {
+  const struct kcron_index_record *left = a;
+  const struct kcron_index_record *right = b;
+  return (left->uid > right->uid) - (left->uid < right->uid);
+}
+
+int main(int argc, char *argv[]) {
+
+  struct index_options options = {.index_file = __KCRON_INDEX_FILE, .json = 0, .all = 0, .max_age = -1, .benchmark = 0};
+  struct kcron_index index = {0};
+  struct kcron_index_header header = {0};
+  struct kcron_index_record record = {0};
+  struct kcron_index_record *records = NULL;
+  struct timespec started = {0};
+  struct timespec finished = {0};
+  uid_t uid = 0;
+  long count = 0;
+  int error = 0;
+  int opt = 0;
+  int result = EXIT_SUCCESS;
+
+  while ((opt = getopt(argc, argv, "f:jam:b:h")) != -1) {
+    switch (opt) {
+    case 'f':
+      options.index_file = optarg;
+      break;
+    case 'j':
+      options.json = 1;
+      break;
+    case 'a':
+      options.all = 1;
+      break;
+    case 'm':
+      options.max_age = parse_count(optarg);
+      if (options.max_age < 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'b':
+      options.benchmark = parse_count(optarg);
+      if (options.benchmark < 1) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  error = kcron_index_open(&index, options.index_file);
+  if (error != 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, options.index_file, (error == EINVAL) ? "not a kcron index" : strerror(error));
+    exit(EXIT_FAILURE);
+  }
+  if (kcron_index_stat(&index, &header) != 0) {
+    (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, options.index_file, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  if (options.max_age >= 0 && (long)(time(NULL) - header.heartbeat) > options.max_age) {
+    (void)fprintf(stderr, "%s: kcron-indexd was last heard from %llds ago.\n", __PROGRAM_NAME, (long long)(time(NULL) - header.heartbeat));
+    result = EXIT_FAILURE;
+  }
+
+  if (options.all == 1) {
+    count = kcron_index_dump(&index, &records);
+    if (count < 0) {
+      (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, options.index_file, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    qsort(records, (size_t)count, sizeof(struct kcron_index_record), cmp_record_uid);
+    for (long i = 0; i < count; i++) {
+      print_record(&records[i], options.json);
+    }
+    (void)free(records);
+  } else if (optind == argc) {
+    (void)printf("records\t%u\nslots\t%u\nbuilt\t%lld\nupdated\t%lld\nheartbeat\t%lld\n", header.num_records, header.num_slots, (long long)header.built,
+                 (long long)header.updated, (long long)header.heartbeat);
+  }
+
+  for (int i = optind; i < argc && options.all == 0; i++) {
+    if (parse_user(argv[i], &uid) != 0) {
+      (void)fprintf(stderr, "%s: No such user: %s\n", __PROGRAM_NAME, argv[i]);
+      result = EXIT_FAILURE;
+      continue;
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &started);
+    for (long n = 0; n < options.benchmark; n++) {
+      if (kcron_index_lookup(&index, uid, &record) < 0) {
+        break;
+      }
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &finished);
+    if (options.benchmark > 0) {
+      (void)fprintf(stderr, "%s: %ld lookups of %u took %.1fns each\n", __PROGRAM_NAME, options.benchmark, uid,
+                    ((double)(finished.tv_sec - started.tv_sec) * 1e9 + (double)(finished.tv_nsec - started.tv_nsec)) / (double)options.benchmark);
+    }
+
+    switch (kcron_index_lookup(&index, uid, &record)) {
+    case 1:
+      print_record(&record, options.json);
+      if (record.problems != 0 || record.flags != 0) {
+        result = EXIT_FAILURE;
+      }
+      break;
+    case 0:
+      (void)fprintf(stderr, "%s: %u has no keytab directory.\n", __PROGRAM_NAME, uid);
+      result = EXIT_FAILURE;
+      break;
+    default:
+      (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, options.index_file, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  kcron_index_close(&index);
+  exit(result);
+}
@@ -0,0 +1,742 @@
+/*
+ *
+ * Keep an index of the client keytab directory up to date with inotify
+ * and publish it as a snapshot file any reader can map, see kcron_index.h.
+ *
+ * The store is walked once at start, then only the user directories
+ * inotify names are looked at again.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-indexd"
+#endif
+
+#include "autoconf.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <grp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_audit.h"
+#include "kcron_filename.h"
+#include "kcron_index.h"
+#include "kcron_keytab_parse.h"
+
+#define INDEXD_EVENT_BUFFER (64 * 1024)
+
+/* without every watch we fall back to walking the store this often */
+#define INDEXD_FALLBACK_RESCAN 300
+
+/* keytabs are read into this, a mapping would let their owners SIGBUS us */
+static unsigned char indexd_keytab_buffer[KCRON_KEYTAB_READ_MAX * 16];
+
+#define INDEXD_DIR_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_ONLYDIR | IN_DONT_FOLLOW)
+#define INDEXD_USER_MASK (INDEXD_DIR_MASK | IN_CLOSE_WRITE | IN_EXCL_UNLINK)
+
+#define INDEXD_WATCH_NONE 0
+#define INDEXD_WATCH_CLIENT 1
+#define INDEXD_WATCH_SHARD 2
+#define INDEXD_WATCH_USER 3
+
+struct indexd_options {
+  const char *directory;
+  const char *index_file;
+  gid_t group;
+  unsigned int rescan;    /* seconds, 0 for only when inotify cannot keep up */
+  unsigned int heartbeat; /* seconds */
+};
+
+/* what a watch descriptor is watching, the kernel hands them out in order */
+struct indexd_watch {
+  int kind;
+  int shard;
+  uid_t uid;
+};
+
+/* a user directory to look at again, the last one for a uid wins */
+struct indexd_change {
+  uid_t uid;
+  int shard;
+  size_t order;
+};
+
+struct indexd_state {
+  struct kcron_index_writer writer;
+  const struct indexd_options *options;
+  int inotify_fd;
+  int client_fd;
+  int *shard_fds; /* by shard number, -1 where there is none */
+  size_t num_shard_fds;
+  struct indexd_watch *watches;
+  size_t num_watches;
+  struct indexd_change *changes;
+  size_t num_changes;
+  size_t allocated_changes;
+  size_t order;
+  int out_of_watches;
+  int rescan;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-f file] [-g group] [-r seconds] [-H seconds] [-d dir]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -f file     publish the index here (default %s)\n", __KCRON_INDEX_FILE);
+  (void)fprintf(stderr, "  -g group    let group read the index, otherwise only root can\n");
+  (void)fprintf(stderr, "  -r seconds  walk the whole store again this often (default 0, only when inotify overflows)\n");
+  (void)fprintf(stderr, "  -H seconds  update the heartbeat in the index this often (default 10)\n");
+  (void)fprintf(stderr, "  -d dir      index dir rather than %s\n", __CLIENT_KEYTAB_DIR);
+}
+
+static int parse_seconds(const char *text, unsigned int *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_seconds(const char *text, unsigned int *value) {
+  char *end = NULL;
+  unsigned long number = 0;
+
+  errno = 0;
+  number = strtoul(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || *text == '-' || number > 86400) {
+    return 1;
+  }
+  *value = (unsigned int)number;
+  return 0;
+}
+
+static void harden_service(void) __attribute__((flatten));
+static void harden_service(void) {
+  if (freopen("/dev/null", "r", stdin) == NULL) {
+    (void)fprintf(stderr, "%s: Cannot reset stdin to /dev/null.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set no_new_privs.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)umask(077);
+}
+
+static int shard_fd(const struct indexd_state *state, int shard) __attribute__((nonnull(1)));
+static int shard_fd(const struct indexd_state *state, int shard) {
+  if (shard < 0) {
+    return state->client_fd;
+  }
+  if ((size_t)shard >= state->num_shard_fds) {
+    return -1;
+  }
+  return state->shard_fds[shard];
+}
+
+static void user_dir_path(const struct indexd_state *state, int shard, uid_t uid, char *path, size_t size) __attribute__((nonnull(1, 4)));
+static void user_dir_path(const struct indexd_state *state, int shard, uid_t uid, char *path, size_t size) {
+  if (shard < 0) {
+    (void)snprintf(path, size, "%s/%u", state->options->directory, uid);
+  } else {
+    (void)snprintf(path, size, "%s/%s%d/%u", state->options->directory, KCRON_SHARD_PREFIX, shard, uid);
+  }
+}
+
+static void add_watch(struct indexd_state *state, const char *path, uint32_t mask, int kind, int shard, uid_t uid) __attribute__((nonnull(1, 2)));
+static void add_watch(struct indexd_state *state, const char *path, uint32_t mask, int kind, int shard, uid_t uid) {
+
+  struct indexd_watch *grown = NULL;
+  size_t allocated = 0;
+
+  const int wd = inotify_add_watch(state->inotify_fd, path, mask);
+  if (wd < 0) {
+    if (errno == ENOSPC && state->out_of_watches == 0) {
+      (void)fprintf(stderr, "%s: Out of inotify watches, raise fs.inotify.max_user_watches; walking the store every %ds until then.\n", __PROGRAM_NAME,
+                    INDEXD_FALLBACK_RESCAN);
+      state->out_of_watches = 1;
+    }
+    return;
+  }
+
+  if ((size_t)wd >= state->num_watches) {
+    allocated = (state->num_watches == 0) ? 4096 : state->num_watches;
+    while (allocated <= (size_t)wd) {
+      allocated *= 2;
+    }
+    grown = realloc(state->watches, allocated * sizeof(struct indexd_watch));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      exit(EXIT_FAILURE);
+    }
+    (void)memset(grown + state->num_watches, 0, (allocated - state->num_watches) * sizeof(struct indexd_watch));
+    state->watches = grown;
+    state->num_watches = allocated;
+  }
+
+  /* a directory that moved keeps its descriptor, this updates where it is */
+  state->watches[wd].kind = kind;
+  state->watches[wd].shard = shard;
+  state->watches[wd].uid = uid;
+}
+
+static void add_change(struct indexd_state *state, uid_t uid, int shard) __attribute__((nonnull(1)));
+static void add_change(struct indexd_state *state, uid_t uid, int shard) {
+
+  struct indexd_change *grown = NULL;
+
+  if (state->num_changes == state->allocated_changes) {
+    state->allocated_changes = (state->allocated_changes == 0) ? 4096 : state->allocated_changes * 2;
+    grown = realloc(state->changes, state->allocated_changes * sizeof(struct indexd_change));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      exit(EXIT_FAILURE);
+    }
+    state->changes = grown;
+  }
+  state->changes[state->num_changes].uid = uid;
+  state->changes[state->num_changes].shard = shard;
+  state->changes[state->num_changes].order = state->order++;
+  state->num_changes++;
+}
+
+static void add_user_dir(struct indexd_state *state, int shard, uid_t uid) __attribute__((nonnull(1)));
+static void add_user_dir(struct indexd_state *state, int shard, uid_t uid) {
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+
+  user_dir_path(state, shard, uid, path, sizeof(path));
+  add_watch(state, path, INDEXD_USER_MASK, INDEXD_WATCH_USER, shard, uid);
+  add_change(state, uid, shard);
+}
+
+static void scan_dir(struct indexd_state *state, int dir_fd, int shard) __attribute__((nonnull(1)));
+
+/* a shard directory we have not seen before, watch it and everything in it */
+static void add_shard(struct indexd_state *state, const char *name) __attribute__((nonnull(1, 2)));
+static void add_shard(struct indexd_state *state, const char *name) {
+
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  unsigned long number = 0;
+  int *grown = NULL;
+  size_t allocated = 0;
+
+  if (strncmp(name, KCRON_SHARD_PREFIX, strlen(KCRON_SHARD_PREFIX)) != 0 || kcron_audit_parse_number(name + strlen(KCRON_SHARD_PREFIX), &number) != 0 ||
+      number > INT32_MAX) {
+    return;
+  }
+
+  const int fd = openat(state->client_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  if ((size_t)number >= state->num_shard_fds) {
+    allocated = (size_t)number + 1;
+    grown = realloc(state->shard_fds, allocated * sizeof(int));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      exit(EXIT_FAILURE);
+    }
+    for (size_t i = state->num_shard_fds; i < allocated; i++) {
+      grown[i] = -1;
+    }
+    state->shard_fds = grown;
+    state->num_shard_fds = allocated;
+  }
+  if (state->shard_fds[number] >= 0) {
+    (void)close(state->shard_fds[number]);
+  }
+  state->shard_fds[number] = fd;
+
+  (void)snprintf(path, sizeof(path), "%s/%s", state->options->directory, name);
+  add_watch(state, path, INDEXD_DIR_MASK, INDEXD_WATCH_SHARD, (int)number, 0);
+  scan_dir(state, fd, (int)number);
+}
+
+/* queue every user directory under dir_fd, and walk any shards at the top */
+static void scan_dir(struct indexd_state *state, int dir_fd, int shard) {
+
+  struct dirent *dirent = NULL;
+  unsigned long number = 0;
+
+  const int fd = dup(dir_fd);
+  if (fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, state->options->directory, strerror(errno));
+    return;
+  }
+  DIR *dir = fdopendir(fd);
+  if (dir == NULL) {
+    (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, state->options->directory, strerror(errno));
+    (void)close(fd);
+    return;
+  }
+  rewinddir(dir);
+
+  while ((dirent = readdir(dir)) != NULL) {
+    if (kcron_audit_parse_number(dirent->d_name, &number) == 0) {
+      add_user_dir(state, shard, (uid_t)number);
+    } else if (shard < 0 && (dirent->d_type == DT_DIR || dirent->d_type == DT_UNKNOWN)) {
+      add_shard(state, dirent->d_name);
+    }
+  }
+  (void)closedir(dir);
+}
+
+/*
+ * Look at one user directory and its keytab.
+ * Returns 1 with a record, 0 if the directory is not there.
+ */
+static int build_record(const struct indexd_state *state, uid_t uid, int shard, struct kcron_index_record *record) __attribute__((nonnull(1, 4)))
+__attribute__((warn_unused_result));
+static int build_record(const struct indexd_state *state, uid_t uid, int shard, struct kcron_index_record *record) {
+
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  struct statx dir = {0};
+  struct statx keytab = {0};
+  char name[12] = {0};
+  char keytab_name[12 + sizeof(KCRON_KEYTAB_FILENAME)] = {0};
+  size_t offset = 0;
+  int dir_error = 0;
+  int keytab_error = 0;
+  int rc = 0;
+
+  const int parent_fd = shard_fd(state, shard);
+  if (parent_fd < 0) {
+    return 0;
+  }
+
+  (void)snprintf(name, sizeof(name), "%u", uid);
+  (void)snprintf(keytab_name, sizeof(keytab_name), "%u/%s", uid, KCRON_KEYTAB_FILENAME);
+
+  if (statx(parent_fd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_BASIC_STATS, &dir) != 0) {
+    if (errno == ENOENT) {
+      return 0;
+    }
+    dir_error = errno;
+  }
+  if (statx(parent_fd, keytab_name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_BASIC_STATS, &keytab) != 0) {
+    keytab_error = errno;
+  }
+
+  (void)memset(record, 0, sizeof(struct kcron_index_record));
+  record->uid = (uint32_t)uid;
+  record->shard = shard;
+  record->problems = kcron_audit_check(uid, shard, __CLIENT_KEYTAB_SHARDS, &dir, dir_error, &keytab, keytab_error);
+  record->dir_mode = (dir_error == 0) ? (dir.stx_mode & 07777U) : 0;
+
+  if (dir_error != 0 || !S_ISDIR(dir.stx_mode) || keytab_error != 0) {
+    return 1;
+  }
+  record->inode = keytab.stx_ino;
+  record->size = keytab.stx_size;
+  record->mtime = keytab.stx_mtime.tv_sec;
+  record->mtime_nsec = keytab.stx_mtime.tv_nsec;
+  record->keytab_mode = keytab.stx_mode & 07777U;
+  if (!S_ISREG(keytab.stx_mode)) {
+    return 1;
+  }
+
+  if (kcron_keytab_read_at(parent_fd, keytab_name, indexd_keytab_buffer, sizeof(indexd_keytab_buffer), &map) != 0) {
+    record->flags |= KCRON_INDEX_FLAG_DAMAGED;
+    return 1;
+  }
+  while ((rc = kcron_keytab_next(&map, &offset, &entry)) == 1) {
+    record->entries++;
+    record->kvno = (entry.kvno > record->kvno) ? entry.kvno : record->kvno;
+  }
+  if (rc < 0) {
+    record->flags |= KCRON_INDEX_FLAG_DAMAGED;
+  }
+  kcron_keytab_unmap(&map);
+  return 1;
+}
+
+/* where this build puts uid, when the layout is sharded */
+static int home_shard(uid_t uid, unsigned int shards) __attribute__((const));
+static int home_shard(uid_t uid, unsigned int shards) { return (shards == 0) ? -1 : (int)(uid % shards); }
+
+/* gone from where the event said, but kcron-shard-migrate may have moved it either way */
+static int find_elsewhere(const struct indexd_state *state, const struct indexd_change *change, struct kcron_index_record *record) __attribute__((nonnull(1, 2, 3)))
+__attribute__((warn_unused_result));
+static int find_elsewhere(const struct indexd_state *state, const struct indexd_change *change, struct kcron_index_record *record) {
+
+  int candidates[3] = {home_shard(change->uid, __CLIENT_KEYTAB_SHARDS), -1, change->shard};
+
+  const uint32_t slot = kcron_index_find_slot(&state->writer, (uint32_t)change->uid);
+  if (slot != UINT32_MAX && state->writer.records[slot].slot_state == KCRON_INDEX_SLOT_USED) {
+    candidates[2] = state->writer.records[slot].shard;
+  }
+
+  for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    if (candidates[i] != change->shard && build_record(state, change->uid, candidates[i], record) == 1) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int cmp_change(const void *a, const void *b) {
+  const struct indexd_change *left = a;
+  const struct indexd_change *right = b;
+  if (left->uid != right->uid) {
+    return (left->uid > right->uid) - (left->uid < right->uid);
+  }
+  return (left->order > right->order) - (left->order < right->order);
+}
+
+/* build every queued record first, so readers only wait out the copying */
+static void apply_changes(struct indexd_state *state) __attribute__((nonnull(1)));
+static void apply_changes(struct indexd_state *state) {
+
+  struct kcron_index_record *records = NULL;
+  uint32_t *gone = NULL;
+  size_t num_records = 0;
+  size_t num_gone = 0;
+  int error = 0;
+
+  if (state->num_changes == 0) {
+    return;
+  }
+  qsort(state->changes, state->num_changes, sizeof(struct indexd_change), cmp_change);
+
+  records = calloc(state->num_changes, sizeof(struct kcron_index_record));
+  gone = calloc(state->num_changes, sizeof(uint32_t));
+  if (records == NULL || gone == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < state->num_changes; i++) {
+    const struct indexd_change *change = &state->changes[i];
+    if (i + 1 < state->num_changes && state->changes[i + 1].uid == change->uid) {
+      continue;
+    }
+    if (build_record(state, change->uid, change->shard, &records[num_records]) == 1) {
+      num_records++;
+      continue;
+    }
+    if (find_elsewhere(state, change, &records[num_records]) == 1) {
+      num_records++;
+      continue;
+    }
+    gone[num_gone++] = (uint32_t)change->uid;
+  }
+  state->num_changes = 0;
+
+  error = kcron_index_reserve(&state->writer, num_records);
+  if (error != 0) {
+    (void)fprintf(stderr, "%s: Cannot grow %s: %s\n", __PROGRAM_NAME, state->options->index_file, strerror(error));
+    exit(EXIT_FAILURE);
+  }
+
+  kcron_index_begin(&state->writer);
+  for (size_t i = 0; i < num_records; i++) {
+    /* reserve made the room */
+    error |= kcron_index_put(&state->writer, &records[i]);
+  }
+  for (size_t i = 0; i < num_gone; i++) {
+    kcron_index_remove(&state->writer, gone[i]);
+  }
+  kcron_index_end(&state->writer);
+
+  if (error != 0) {
+    (void)fprintf(stderr, "%s: %s is full.\n", __PROGRAM_NAME, state->options->index_file);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)free(records);
+  (void)free(gone);
+}
+
+/* walk the whole store into a new index and publish that */
+static void full_scan(struct indexd_state *state) __attribute__((nonnull(1)));
+static void full_scan(struct indexd_state *state) {
+
+  struct kcron_index_writer writer = {0};
+  struct kcron_index_record record = {0};
+  struct timespec started = {0};
+  struct timespec finished = {0};
+  int error = 0;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &started);
+
+  state->num_changes = 0;
+  state->rescan = 0;
+  scan_dir(state, state->client_fd, -1);
+  qsort(state->changes, state->num_changes, sizeof(struct indexd_change), cmp_change);
+
+  error = kcron_index_create(&writer, state->options->index_file, kcron_index_slots_for(state->num_changes), (state->options->group == (gid_t)-1) ? _0600 : (_0600 | S_IRGRP),
+                             state->options->group);
+  if (error != 0) {
+    (void)fprintf(stderr, "%s: Cannot create %s: %s\n", __PROGRAM_NAME, state->options->index_file, strerror(error));
+    exit(EXIT_FAILURE);
+  }
+
+  /* nobody reads this one yet, no need for the sequence count */
+  for (size_t i = 0, end = 0; i < state->num_changes; i = end) {
+    const struct indexd_change *change = &state->changes[i];
+    /* in both layouts mid migration, keep the one this build looks at */
+    for (end = i + 1; end < state->num_changes && state->changes[end].uid == change->uid; end++) {
+      if (state->changes[end].shard == home_shard(change->uid, __CLIENT_KEYTAB_SHARDS)) {
+        change = &state->changes[end];
+      }
+    }
+    if (build_record(state, change->uid, change->shard, &record) == 1 && kcron_index_put(&writer, &record) != 0) {
+      (void)fprintf(stderr, "%s: %s is full.\n", __PROGRAM_NAME, state->options->index_file);
+      exit(EXIT_FAILURE);
+    }
+  }
+  state->num_changes = 0;
+
+  error = kcron_index_publish(&writer, &state->writer);
+  if (error != 0) {
+    (void)fprintf(stderr, "%s: Cannot publish %s: %s\n", __PROGRAM_NAME, state->options->index_file, strerror(error));
+    kcron_index_abandon(&writer);
+    exit(EXIT_FAILURE);
+  }
+  state->writer = writer;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &finished);
+  (void)fprintf(stderr, "%s: indexed %u keytab directories in %.3fs\n", __PROGRAM_NAME, writer.header->num_records,
+                (double)(finished.tv_sec - started.tv_sec) + (double)(finished.tv_nsec - started.tv_nsec) / 1e9);
+}
+
+static void handle_event(struct indexd_state *state, const struct inotify_event *event) __attribute__((nonnull(1, 2)));
+static void handle_event(struct indexd_state *state, const struct inotify_event *event) {
+
+  unsigned long number = 0;
+
+  if ((event->mask & IN_Q_OVERFLOW) != 0) {
+    state->rescan = 1;
+    return;
+  }
+  if (event->wd < 0 || (size_t)event->wd >= state->num_watches) {
+    return;
+  }
+
+  struct indexd_watch *watch = &state->watches[event->wd];
+  const char *name = (event->len > 0) ? event->name : "";
+
+  if ((event->mask & IN_IGNORED) != 0) {
+    if (watch->kind == INDEXD_WATCH_CLIENT) {
+      (void)fprintf(stderr, "%s: %s went away.\n", __PROGRAM_NAME, state->options->directory);
+      exit(EXIT_FAILURE);
+    }
+    if (watch->kind == INDEXD_WATCH_SHARD) {
+      state->rescan = 1;
+    }
+    watch->kind = INDEXD_WATCH_NONE;
+    return;
+  }
+
+  switch (watch->kind) {
+  case INDEXD_WATCH_CLIENT:
+  case INDEXD_WATCH_SHARD:
+    if (kcron_audit_parse_number(name, &number) == 0) {
+      if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+        add_user_dir(state, (watch->kind == INDEXD_WATCH_CLIENT) ? -1 : watch->shard, (uid_t)number);
+      } else {
+        add_change(state, (uid_t)number, (watch->kind == INDEXD_WATCH_CLIENT) ? -1 : watch->shard);
+      }
+    } else if (watch->kind == INDEXD_WATCH_CLIENT && (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+      add_shard(state, name);
+    } else if (watch->kind == INDEXD_WATCH_CLIENT && (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0 &&
+               strncmp(name, KCRON_SHARD_PREFIX, strlen(KCRON_SHARD_PREFIX)) == 0) {
+      /* rare enough to just start over */
+      state->rescan = 1;
+    }
+    break;
+  case INDEXD_WATCH_USER:
+    if (event->len == 0 || strcmp(name, KCRON_KEYTAB_FILENAME) == 0) {
+      add_change(state, watch->uid, watch->shard);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  struct indexd_options options = {.directory = __CLIENT_KEYTAB_DIR, .index_file = __KCRON_INDEX_FILE, .group = (gid_t)-1, .rescan = 0, .heartbeat = 10};
+  struct indexd_state state = {0};
+  struct pollfd fds[2] = {0};
+  struct signalfd_siginfo info = {0};
+  const struct group *group = NULL;
+  char *buffer = NULL;
+  sigset_t hangup;
+  time_t last_scan = 0;
+  time_t last_beat = 0;
+  time_t now = 0;
+  ssize_t got = 0;
+  int opt = 0;
+  int ready = 0;
+
+  while ((opt = getopt(argc, argv, "f:g:r:H:d:h")) != -1) {
+    switch (opt) {
+    case 'f':
+      options.index_file = optarg;
+      break;
+    case 'g':
+      group = getgrnam(optarg);
+      if (group == NULL) {
+        (void)fprintf(stderr, "%s: No such group: %s\n", __PROGRAM_NAME, optarg);
+        exit(EXIT_FAILURE);
+      }
+      options.group = group->gr_gid;
+      break;
+    case 'r':
+      if (parse_seconds(optarg, &options.rescan) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'H':
+      if (parse_seconds(optarg, &options.heartbeat) != 0 || options.heartbeat == 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'd':
+      options.directory = optarg;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  (void)harden_service();
+
+  state.options = &options;
+  state.client_fd = open(options.directory, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (state.client_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, options.directory, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  state.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (state.inotify_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot start inotify: %s\n", __PROGRAM_NAME, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  add_watch(&state, options.directory, INDEXD_DIR_MASK, INDEXD_WATCH_CLIENT, -1, 0);
+  if (state.num_watches == 0) {
+    (void)fprintf(stderr, "%s: Cannot watch %s: %s\n", __PROGRAM_NAME, options.directory, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  buffer = malloc(INDEXD_EVENT_BUFFER);
+  if (buffer == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)sigemptyset(&hangup);
+  (void)sigaddset(&hangup, SIGHUP);
+  (void)sigprocmask(SIG_BLOCK, &hangup, NULL);
+  const int signal_fd = signalfd(-1, &hangup, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signal_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot watch for SIGHUP: %s\n", __PROGRAM_NAME, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  /* the watches go in first, so nothing between the walk and now is lost */
+  full_scan(&state);
+  last_scan = time(NULL);
+  last_beat = last_scan;
+
+  fds[0].fd = state.inotify_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = signal_fd;
+  fds[1].events = POLLIN;
+
+  while (1) {
+    ready = poll(fds, 2, (int)options.heartbeat * 1000);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      (void)fprintf(stderr, "%s: Cannot poll inotify: %s\n", __PROGRAM_NAME, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    if (fds[1].revents & POLLIN) {
+      while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        state.rescan = 1;
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      while ((got = read(state.inotify_fd, buffer, INDEXD_EVENT_BUFFER)) > 0) {
+        for (ssize_t offset = 0; offset < got;) {
+          const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+          offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+          handle_event(&state, event);
+        }
+      }
+    }
+
+    now = time(NULL);
+    if (options.rescan > 0 && now - last_scan >= (time_t)options.rescan) {
+      state.rescan = 1;
+    }
+    if (state.out_of_watches == 1 && now - last_scan >= INDEXD_FALLBACK_RESCAN) {
+      state.rescan = 1;
+    }
+
+    if (state.rescan == 1) {
+      full_scan(&state);
+      last_scan = now;
+    } else {
+      apply_changes(&state);
+    }
+
+    if (now - last_beat >= (time_t)options.heartbeat) {
+      kcron_index_heartbeat(&state.writer);
+      last_beat = now;
+    }
+  }
+}
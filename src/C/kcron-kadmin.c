@@ -0,0 +1,817 @@
+/*
+ *
+ * A simple program that creates a cron principal and extracts its keys
+ * into the kcron keytab over a single kadmin session.
+ *
+ * With -H it does the same for one principal per host in a list, each
+ * worker process over its own kadmin session, and leaves the keytabs in
+ * a staging tree for distribution.
+ *
+ * With -D it deletes every cron principal matching the globs instead.
+ *
+ * It expects KRB5CCNAME to hold a kadmin/admin ticket, kcroninit sets that up.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-kadmin"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kcron_empty_keytab_file.h"
+#include "kcron_fdpass.h"
+#include "kcron_filename.h"
+#include "kcron_kadm5.h"
+#include "kcron_keytab_parse.h"
+#include "kcron_keytab_tmpfile.h"
+
+#ifndef _0700
+#define _0700 S_IRWXU
+#endif
+
+#define KADMIN_MAX_WORKERS 64
+#define KADMIN_DEFAULT_WORKERS 8
+#define KADMIN_MAX_ENCTYPES 16
+
+/* when the keys a keytab already holds are left alone */
+struct kadmin_policy {
+  int force;
+  int num_required;
+  krb5_enctype required[KADMIN_MAX_ENCTYPES];
+};
+
+struct kadmin_host {
+  char *name;
+  int result;
+};
+
+/* shared with the worker processes, they take hosts from next and write back how it went */
+struct kadmin_progress {
+  atomic_size_t next;
+  int result[];
+};
+
+/* the workers are separate processes, this must work without a lock */
+_Static_assert(ATOMIC_LONG_LOCK_FREE == 2, "atomic_size_t must be lock free to share it between processes");
+
+struct kadmin_batch {
+  struct kadmin_host *hosts;
+  size_t count;
+  size_t allocated;
+  struct kadmin_progress *progress;
+  const char *admin_principal;
+  const char *realm;
+  const char *prefix;
+  const char *stage_dir;
+  const struct kadmin_policy *policy;
+  int stage_fd;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s -p admin_principal [-r realm] [-f] [-e enctypes] [-I init-kcron-keytab] principal\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "       %s -p admin_principal [-r realm] [-f] [-e enctypes] -H hosts -o stage_dir [-j jobs] primary/instance\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "       %s -p admin_principal [-r realm] -D [-n] glob...\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  Create principal if missing and extract its keys into the kcron keytab.\n");
+  (void)fprintf(stderr, "  -f            new keys even if the keytab holds the current ones\n");
+  (void)fprintf(stderr, "  -e enctypes   the current keys must include these, comma separated\n");
+  (void)fprintf(stderr, "  -I helper     have this init-kcron-keytab make the keytab and hand over its directory\n");
+  (void)fprintf(stderr, "  -H hosts      one host per line, '-' for stdin, principal is primary/instance/host\n");
+  (void)fprintf(stderr, "  -o stage_dir  write stage_dir/host/%s for each host\n", KCRON_KEYTAB_FILENAME);
+  (void)fprintf(stderr, "  -j jobs       kadmin sessions at once (default %d)\n", KADMIN_DEFAULT_WORKERS);
+  (void)fprintf(stderr, "  -D            delete the cron principals matching each glob, as in list_principals\n");
+  (void)fprintf(stderr, "  -n            with -D, only list what would be deleted\n");
+}
+
+static int has_enctype(const krb5_enctype *enctypes, int num_enctypes, krb5_enctype enctype) __attribute__((nonnull(1))) __attribute__((pure));
+static int has_enctype(const krb5_enctype *enctypes, int num_enctypes, krb5_enctype enctype) {
+  for (int i = 0; i < num_enctypes; i++) {
+    if (enctypes[i] == enctype) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * 1 when filename in dir_fd holds a key for principal_name at kvno for
+ * every enctype the KDC has, and those include every required enctype.
+ * New keys would only bump the kvno and break every other copy.
+ */
+static int keytab_is_current(int dir_fd, const char *filename, const char *principal_name, krb5_kvno kvno, const krb5_enctype *enctypes, int num_enctypes,
+                             const struct kadmin_policy *policy) __attribute__((nonnull(2, 3, 5, 7))) __attribute__((warn_unused_result));
+static int keytab_is_current(int dir_fd, const char *filename, const char *principal_name, krb5_kvno kvno, const krb5_enctype *enctypes, int num_enctypes,
+                             const struct kadmin_policy *policy) {
+
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  krb5_enctype held[KADMIN_MAX_ENCTYPES] = {0};
+  size_t offset = 0;
+  int num_held = 0;
+  int rc = 0;
+
+  if (num_enctypes == 0) {
+    return 0;
+  }
+  for (int i = 0; i < policy->num_required; i++) {
+    if (has_enctype(enctypes, num_enctypes, policy->required[i]) == 0) {
+      return 0;
+    }
+  }
+
+  if (kcron_keytab_map_at(dir_fd, filename, &map) != 0) {
+    return 0;
+  }
+  while ((rc = kcron_keytab_next(&map, &offset, &entry)) == 1) {
+    if (entry.kvno == kvno && num_held < KADMIN_MAX_ENCTYPES && kcron_keytab_principal_is(&entry, principal_name) == 1) {
+      held[num_held++] = entry.enctype;
+    }
+  }
+  kcron_keytab_unmap(&map);
+  if (rc < 0) {
+    return 0;
+  }
+
+  for (int i = 0; i < num_enctypes; i++) {
+    if (has_enctype(held, num_held, enctypes[i]) == 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Create principal_name if missing and add new keys for it to filename in
+ * dir_fd, on top of the keys already there when keep is 1.  The keys go
+ * into an unnamed file, or a dotted one in dir_fd without O_TMPFILE, that
+ * replaces filename once verified.  Unless the policy forces it, a keytab
+ * that already holds the current keys is kept.
+ */
+static int extract_keytab(krb5_context context, void *server_handle, const char *principal_name, int dir_fd, const char *filename, const char *path, int keep,
+                          const struct kadmin_policy *policy) __attribute__((nonnull(2, 3, 5, 6, 8))) __attribute__((warn_unused_result));
+static int extract_keytab(krb5_context context, void *server_handle, const char *principal_name, int dir_fd, const char *filename, const char *path, int keep,
+                          const struct kadmin_policy *policy) {
+
+  krb5_principal principal = NULL;
+  krb5_enctype enctypes[KADMIN_MAX_ENCTYPES] = {0};
+  krb5_kvno kvno = 0;
+  char *full_name = NULL;
+  int num_enctypes = 0;
+  int current = 0;
+  char keytab_name[FILE_PATH_MAX_LENGTH + 11] = {0};
+  char temp_name[FILE_PATH_MAX_LENGTH] = {0};
+  int filedescriptor = -1;
+  int error = 0;
+  int result = 0;
+
+  if (krb5_parse_name(context, principal_name, &principal) != 0) {
+    (void)fprintf(stderr, "%s: Invalid principal %s.\n", __PROGRAM_NAME, principal_name);
+    return 1;
+  }
+
+  if (kcron_kadm5_ensure_principal(context, server_handle, principal, principal_name) != 0) {
+    (void)fprintf(stderr, "%s: Cannot create principal %s.\n", __PROGRAM_NAME, principal_name);
+    (void)krb5_free_principal(context, principal);
+    return 1;
+  }
+
+  if (policy->force == 0) {
+    if (kcron_kadm5_current_keys(context, server_handle, principal, &kvno, enctypes, KADMIN_MAX_ENCTYPES, &num_enctypes) != 0) {
+      (void)krb5_free_principal(context, principal);
+      return 1;
+    }
+    if (krb5_unparse_name(context, principal, &full_name) == 0) {
+      current = keytab_is_current(dir_fd, filename, full_name, kvno, enctypes, num_enctypes, policy);
+      (void)krb5_free_unparsed_name(context, full_name);
+    }
+    if (current == 1) {
+      (void)printf("Keytab %s already holds kvno %u of %s, keeping it (-f makes new keys).\n", path, kvno, principal_name);
+      (void)krb5_free_principal(context, principal);
+      return 0;
+    }
+  }
+
+  /* a cron job never reads a half written keytab */
+  if (keep == 1) {
+    filedescriptor = kcron_keytab_tmpfile_copy(dir_fd, filename);
+  } else {
+    filedescriptor = kcron_keytab_tmpfile(dir_fd, O_RDWR);
+    if (filedescriptor >= 0 && write_empty_keytab_nosync(filedescriptor) != 0) {
+      error = errno;
+      (void)close(filedescriptor);
+      filedescriptor = -1;
+      errno = error;
+    }
+  }
+  if (filedescriptor < 0 && kcron_keytab_tmpfile_unsupported(errno) == 1) {
+    /* no O_TMPFILE here, a named file beside it still never walks path */
+    filedescriptor = kcron_keytab_tempname(dir_fd, filename, temp_name, sizeof(temp_name), O_RDWR);
+    if (filedescriptor >= 0 && ((keep == 1) ? kcron_keytab_copy_into(filedescriptor, dir_fd, filename) : write_empty_keytab_nosync(filedescriptor)) != 0) {
+      error = errno;
+      (void)close(filedescriptor);
+      (void)unlinkat(dir_fd, temp_name, 0);
+      filedescriptor = -1;
+      errno = error;
+    }
+  }
+  if (filedescriptor < 0) {
+    (void)fprintf(stderr, "%s: Cannot copy keytab %s: %s.\n", __PROGRAM_NAME, path, strerror(errno));
+    (void)krb5_free_principal(context, principal);
+    return 1;
+  }
+  (void)snprintf(keytab_name, sizeof(keytab_name), "WRFILE:/proc/self/fd/%d", filedescriptor);
+
+  (void)printf("Extracting keytab...\n");
+  if (kcron_kadm5_extract(context, server_handle, principal, keytab_name, &kvno) != 0) {
+    (void)fprintf(stderr, "%s: Unable to extract %s keys into keytab %s.\n", __PROGRAM_NAME, principal_name, path);
+    result = 1;
+  }
+
+  if (result == 0) {
+    if (kcron_keytab_verify(context, keytab_name, principal, kvno) != 0) {
+      (void)fprintf(stderr, "%s: Unable to verify %s keys in keytab %s.\n", __PROGRAM_NAME, principal_name, path);
+      result = 1;
+    }
+  }
+
+  if (result == 0) {
+    if (fchmod(filedescriptor, _0600) != 0 || fsync(filedescriptor) != 0) {
+      (void)fprintf(stderr, "%s: Unable to sync keytab %s: %s.\n", __PROGRAM_NAME, path, strerror(errno));
+      result = 1;
+    } else if (temp_name[0] != '\0') {
+      if (renameat(dir_fd, temp_name, dir_fd, filename) != 0) {
+        (void)fprintf(stderr, "%s: Unable to replace keytab %s: %s.\n", __PROGRAM_NAME, path, strerror(errno));
+        result = 1;
+      } else {
+        temp_name[0] = '\0';
+      }
+    } else if ((error = kcron_keytab_replace(filedescriptor, dir_fd, filename)) != 0) {
+      (void)fprintf(stderr, "%s: Unable to replace keytab %s: %s.\n", __PROGRAM_NAME, path, strerror(error));
+      result = 1;
+    }
+  }
+
+  if (result == 0) {
+    (void)printf("Created keytab %s\n", path);
+  }
+
+  (void)close(filedescriptor);
+  if (temp_name[0] != '\0') {
+    /* the keys never made it into place, drop what we wrote */
+    (void)unlinkat(dir_fd, temp_name, 0);
+  }
+  (void)krb5_free_principal(context, principal);
+  return result;
+}
+
+static int compare_hosts(const void *left, const void *right) __attribute__((nonnull(1, 2)));
+static int compare_hosts(const void *left, const void *right) {
+  return strcmp(((const struct kadmin_host *)left)->name, ((const struct kadmin_host *)right)->name);
+}
+
+static int batch_read_hosts(struct kadmin_batch *batch, const char *filename) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int batch_read_hosts(struct kadmin_batch *batch, const char *filename) {
+
+  struct kadmin_host *grown = NULL;
+  FILE *file = stdin;
+  char *line = NULL;
+  size_t line_size = 0;
+  size_t length = 0;
+  int result = 0;
+
+  if (strcmp(filename, "-") != 0) {
+    file = fopen(filename, "re");
+    if (file == NULL) {
+      (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, filename, strerror(errno));
+      return 1;
+    }
+  }
+
+  while (getline(&line, &line_size, file) != -1) {
+    length = strcspn(line, " \t\r\n#");
+    line[length] = '\0';
+    if (length == 0) {
+      continue;
+    }
+
+    /* it names a directory in the staging tree */
+    if (strchr(line, '/') != NULL || strcmp(line, ".") == 0 || strcmp(line, "..") == 0) {
+      (void)fprintf(stderr, "%s: Invalid host %s.\n", __PROGRAM_NAME, line);
+      result = 1;
+      continue;
+    }
+
+    if (batch->count == batch->allocated) {
+      batch->allocated = (batch->allocated == 0) ? 64 : batch->allocated * 2;
+      grown = realloc(batch->hosts, batch->allocated * sizeof(*batch->hosts));
+      if (grown == NULL) {
+        (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+        result = 1;
+        break;
+      }
+      batch->hosts = grown;
+    }
+
+    batch->hosts[batch->count].name = strdup(line);
+    batch->hosts[batch->count].result = 1;
+    if (batch->hosts[batch->count].name == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      result = 1;
+      break;
+    }
+    batch->count++;
+  }
+
+  (void)free(line);
+  if (file != stdin) {
+    (void)fclose(file);
+  }
+
+  /* a host listed twice would have its first keys thrown away */
+  if (batch->count > 1) {
+    size_t unique = 1;
+    qsort(batch->hosts, batch->count, sizeof(*batch->hosts), compare_hosts);
+    for (size_t i = 1; i < batch->count; i++) {
+      if (strcmp(batch->hosts[i].name, batch->hosts[unique - 1].name) == 0) {
+        (void)free(batch->hosts[i].name);
+      } else {
+        batch->hosts[unique++] = batch->hosts[i];
+      }
+    }
+    batch->count = unique;
+  }
+  return result;
+}
+
+static int batch_host(krb5_context context, void *server_handle, const struct kadmin_batch *batch, const char *host) __attribute__((nonnull(2, 3, 4)))
+__attribute__((warn_unused_result));
+static int batch_host(krb5_context context, void *server_handle, const struct kadmin_batch *batch, const char *host) {
+
+  char principal_name[FILE_PATH_MAX_LENGTH] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  int host_fd = -1;
+  int result = 0;
+
+  if (batch->realm != NULL) {
+    (void)snprintf(principal_name, sizeof(principal_name), "%s/%s@%s", batch->prefix, host, batch->realm);
+  } else {
+    (void)snprintf(principal_name, sizeof(principal_name), "%s/%s", batch->prefix, host);
+  }
+  (void)snprintf(path, sizeof(path), "%s/%s/%s", batch->stage_dir, host, KCRON_KEYTAB_FILENAME);
+
+  if (mkdirat(batch->stage_fd, host, _0700) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s/%s: %s\n", __PROGRAM_NAME, batch->stage_dir, host, strerror(errno));
+    return 1;
+  }
+  host_fd = openat(batch->stage_fd, host, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (host_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s/%s: %s\n", __PROGRAM_NAME, batch->stage_dir, host, strerror(errno));
+    return 1;
+  }
+
+  /* every host gets a keytab with just its own new keys */
+  result = extract_keytab(context, server_handle, principal_name, host_fd, KCRON_KEYTAB_FILENAME, path, 0, batch->policy);
+
+  (void)close(host_fd);
+  return result;
+}
+
+static void batch_worker(const struct kadmin_batch *batch) __attribute__((nonnull(1)));
+static void batch_worker(const struct kadmin_batch *batch) {
+  struct kadmin_progress *progress = batch->progress;
+  krb5_context context = NULL;
+  void *server_handle = NULL;
+  size_t index = 0;
+
+  /*
+   * Nothing promises libkadm5clnt and its gssrpc are safe with sessions in
+   * several threads, so each worker is a process with its own context and
+   * kadmin session, sharing only the progress mapping with its siblings.
+   */
+  if (krb5_init_context(&context) != 0) {
+    (void)fprintf(stderr, "%s: Cannot initialize kerberos.\n", __PROGRAM_NAME);
+    return;
+  }
+  if (kcron_kadm5_open(context, batch->admin_principal, batch->realm, &server_handle) != 0) {
+    (void)krb5_free_context(context);
+    return;
+  }
+
+  while ((index = atomic_fetch_add(&progress->next, 1)) < batch->count) {
+    progress->result[index] = batch_host(context, server_handle, batch, batch->hosts[index].name);
+  }
+
+  (void)kadm5_destroy(server_handle);
+  (void)krb5_free_context(context);
+}
+
+static int run_batch(struct kadmin_batch *batch, long num_workers) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int run_batch(struct kadmin_batch *batch, long num_workers) {
+
+  const char *stage_dir = batch->stage_dir;
+  const size_t progress_size = sizeof(struct kadmin_progress) + batch->count * sizeof(int);
+
+  pid_t workers[KADMIN_MAX_WORKERS];
+  long started = 0;
+  size_t staged = 0;
+  int result = 0;
+
+  if (num_workers > KADMIN_MAX_WORKERS) {
+    num_workers = KADMIN_MAX_WORKERS;
+  }
+  if ((size_t)num_workers > batch->count) {
+    num_workers = (long)batch->count;
+  }
+
+  if (mkdir(stage_dir, _0700) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s: %s\n", __PROGRAM_NAME, stage_dir, strerror(errno));
+    return 1;
+  }
+  batch->stage_fd = open(stage_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (batch->stage_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, stage_dir, strerror(errno));
+    return 1;
+  }
+
+  batch->progress = mmap(NULL, progress_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (batch->progress == MAP_FAILED) {
+    (void)fprintf(stderr, "%s: Cannot map worker progress: %s\n", __PROGRAM_NAME, strerror(errno));
+    (void)close(batch->stage_fd);
+    return 1;
+  }
+  atomic_init(&batch->progress->next, 0);
+  for (size_t i = 0; i < batch->count; i++) {
+    batch->progress->result[i] = 1;
+  }
+
+  /* or the children print what is buffered here again */
+  (void)fflush(NULL);
+
+  for (started = 0; started < num_workers; started++) {
+    workers[started] = fork();
+    if (workers[started] < 0) {
+      break;
+    }
+    if (workers[started] == 0) {
+      /* whole lines, so the workers' output does not interleave mid line */
+      (void)setvbuf(stdout, NULL, _IOLBF, 0);
+      batch_worker(batch);
+      (void)fflush(NULL);
+      _exit(EXIT_SUCCESS);
+    }
+  }
+  if (started == 0) {
+    /* no workers, do the work ourselves */
+    batch_worker(batch);
+  }
+  for (long i = 0; i < started; i++) {
+    while (waitpid(workers[i], NULL, 0) < 0 && errno == EINTR) {
+    }
+  }
+  for (size_t i = 0; i < batch->count; i++) {
+    batch->hosts[i].result = batch->progress->result[i];
+  }
+  (void)munmap(batch->progress, progress_size);
+  batch->progress = NULL;
+  (void)close(batch->stage_fd);
+
+  /* a host no worker got to, because its session failed or it died, failed too */
+  for (size_t i = 0; i < batch->count; i++) {
+    if (batch->hosts[i].result == 0) {
+      staged++;
+    } else {
+      (void)fprintf(stderr, "%s: No keytab for host %s.\n", __PROGRAM_NAME, batch->hosts[i].name);
+      result = 1;
+    }
+  }
+  (void)printf("%zu of %zu keytabs staged in %s\n", staged, batch->count, stage_dir);
+
+  return result;
+}
+
+static int parse_enctypes(const char *text, struct kadmin_policy *policy) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_enctypes(const char *text, struct kadmin_policy *policy) {
+
+  char names[256] = {0};
+  char *saveptr = NULL;
+  int result = 0;
+
+  if (strlen(text) >= sizeof(names)) {
+    return 1;
+  }
+  (void)strcpy(names, text);
+
+  for (char *name = strtok_r(names, ", ", &saveptr); name != NULL; name = strtok_r(NULL, ", ", &saveptr)) {
+    if (policy->num_required == KADMIN_MAX_ENCTYPES || krb5_string_to_enctype(name, &policy->required[policy->num_required]) != 0) {
+      (void)fprintf(stderr, "%s: Unknown enctype %s.\n", __PROGRAM_NAME, name);
+      result = 1;
+      continue;
+    }
+    policy->num_required++;
+  }
+  return result;
+}
+
+static int delete_matching(const char *admin_principal, const char *realm, char *globs[], int num_globs, int dry_run) __attribute__((nonnull(1, 3)))
+__attribute__((warn_unused_result));
+static int delete_matching(const char *admin_principal, const char *realm, char *globs[], int num_globs, int dry_run) {
+
+  krb5_context context = NULL;
+  void *server_handle = NULL;
+  size_t deleted = 0;
+  int result = 0;
+
+  if (krb5_init_context(&context) != 0) {
+    (void)fprintf(stderr, "%s: Cannot initialize kerberos.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /* every glob over the one session */
+  if (kcron_kadm5_open(context, admin_principal, realm, &server_handle) != 0) {
+    (void)krb5_free_context(context);
+    return 1;
+  }
+
+  for (int i = 0; i < num_globs; i++) {
+    result |= kcron_kadm5_delete_matching(context, server_handle, globs[i], dry_run, &deleted);
+  }
+  (void)printf("%zu principals %s\n", deleted, (dry_run == 1) ? "would be deleted" : "deleted");
+
+  (void)kadm5_destroy(server_handle);
+  (void)krb5_free_context(context);
+  return result;
+}
+
+/*
+ * Run init-kcron-keytab with a socket on KCRON_FDPASS_SOCKET, it creates
+ * the keytab if needed and sends back the directory it checked.  We then
+ * write through that descriptor and never walk the path ourselves.
+ */
+static int open_dir_from_helper(const char *helper) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int open_dir_from_helper(const char *helper) {
+
+  int sockets[2] = {-1, -1};
+  int dir_fd = -1;
+  int error = 0;
+  int status = 0;
+  pid_t pid = 0;
+
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+    (void)fprintf(stderr, "%s: Cannot make a socket for %s: %s.\n", __PROGRAM_NAME, helper, strerror(errno));
+    return -1;
+  }
+
+  (void)fflush(stdout);
+  pid = fork();
+  if (pid < 0) {
+    (void)fprintf(stderr, "%s: Cannot run %s: %s.\n", __PROGRAM_NAME, helper, strerror(errno));
+    (void)close(sockets[0]);
+    (void)close(sockets[1]);
+    return -1;
+  }
+
+  if (pid == 0) {
+    /* dup2() clears close-on-exec, unless the socket is already there */
+    if (sockets[1] == KCRON_FDPASS_SOCKET) {
+      (void)fcntl(sockets[1], F_SETFD, 0);
+    } else if (dup2(sockets[1], KCRON_FDPASS_SOCKET) != KCRON_FDPASS_SOCKET) {
+      _exit(127);
+    }
+    (void)execl(helper, helper, "-s", (char *)NULL);
+    _exit(127);
+  }
+
+  (void)close(sockets[1]);
+  dir_fd = kcron_recv_fd(sockets[0]);
+  error = errno;
+  (void)close(sockets[0]);
+
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      status = -1;
+      break;
+    }
+  }
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    (void)fprintf(stderr, "%s: %s could not make the keytab.\n", __PROGRAM_NAME, helper);
+    if (dir_fd >= 0) {
+      (void)close(dir_fd);
+    }
+    return -1;
+  }
+
+  if (dir_fd < 0) {
+    (void)fprintf(stderr, "%s: No keytab directory from %s: %s.\n", __PROGRAM_NAME, helper, strerror(error));
+    return -1;
+  }
+
+  return dir_fd;
+}
+
+int main(int argc, char *argv[]) {
+
+  struct kadmin_batch batch = {0};
+  struct kadmin_policy policy = {0};
+  krb5_context context = NULL;
+  void *server_handle = NULL;
+
+  const char *nullstring = NULL;
+  const char *admin_principal = NULL;
+  const char *realm = NULL;
+  const char *principal_name = NULL;
+  const char *hosts = NULL;
+  const char *stage_dir = NULL;
+  const char *init_helper = NULL;
+  char *end = NULL;
+  long num_workers = KADMIN_DEFAULT_WORKERS;
+  int delete = 0;
+  int dry_run = 0;
+  int dir_fd = -1;
+  int opt = 0;
+  int result = 0;
+
+  while ((opt = getopt(argc, argv, "p:r:fe:I:H:o:j:Dnh")) != -1) {
+    switch (opt) {
+    case 'p':
+      admin_principal = optarg;
+      break;
+    case 'r':
+      realm = optarg;
+      break;
+    case 'f':
+      policy.force = 1;
+      break;
+    case 'e':
+      if (parse_enctypes(optarg, &policy) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'I':
+      init_helper = optarg;
+      break;
+    case 'H':
+      hosts = optarg;
+      break;
+    case 'o':
+      stage_dir = optarg;
+      break;
+    case 'j':
+      errno = 0;
+      num_workers = strtol(optarg, &end, 10);
+      if (errno != 0 || end == optarg || *end != '\0' || num_workers < 1) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'D':
+      delete = 1;
+      break;
+    case 'n':
+      dry_run = 1;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (delete == 1) {
+    if ((admin_principal == nullstring) || (optind == argc) || (hosts != nullstring)) {
+      usage();
+      exit(EXIT_FAILURE);
+    }
+    result = delete_matching(admin_principal, realm, &argv[optind], argc - optind, dry_run);
+    exit((result == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  if ((admin_principal == nullstring) || (optind != argc - 1) || (dry_run == 1) || ((hosts == nullstring) != (stage_dir == nullstring)) ||
+      ((hosts != nullstring) && (init_helper != nullstring))) {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+  principal_name = argv[optind];
+
+  if (hosts != nullstring) {
+    batch.admin_principal = admin_principal;
+    batch.realm = realm;
+    batch.prefix = principal_name;
+    batch.stage_dir = stage_dir;
+    batch.policy = &policy;
+    result = batch_read_hosts(&batch, hosts);
+    if (result == 0 && batch.count == 0) {
+      (void)fprintf(stderr, "%s: No hosts in %s.\n", __PROGRAM_NAME, hosts);
+      result = 1;
+    }
+    if (result == 0) {
+      result = run_batch(&batch, num_workers);
+    }
+    for (size_t i = 0; i < batch.count; i++) {
+      (void)free(batch.hosts[i].name);
+    }
+    (void)free(batch.hosts);
+    exit((result == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  char *keytab = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  char *keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  char *keytab_filename = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+
+  if ((keytab == nullstring) || (keytab_dirname == nullstring) || (keytab_filename == nullstring)) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
+    (void)fprintf(stderr, "%s: Cannot determine keytab filename.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (init_helper != nullstring) {
+    dir_fd = open_dir_from_helper(init_helper);
+    if (dir_fd < 0) {
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    dir_fd = open(keytab_dirname, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dir_fd < 0) {
+      (void)fprintf(stderr, "%s: Cannot open keytab directory %s: %s.\n", __PROGRAM_NAME, keytab_dirname, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (krb5_init_context(&context) != 0) {
+    (void)fprintf(stderr, "%s: Cannot initialize kerberos.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (kcron_kadm5_open(context, admin_principal, realm, &server_handle) != 0) {
+    (void)krb5_free_context(context);
+    exit(EXIT_FAILURE);
+  }
+
+  result = extract_keytab(context, server_handle, principal_name, dir_fd, keytab_filename, keytab, 1, &policy);
+
+  (void)kadm5_destroy(server_handle);
+  (void)krb5_free_context(context);
+  (void)close(dir_fd);
+
+  (void)free(keytab);
+  (void)free(keytab_dirname);
+  (void)free(keytab_filename);
+
+  if (result != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,369 @@
+/*
+ *
+ * A simple service that generates blank keytabs in a deterministic location
+ * for whomever connects to its socket.
+ *
+ * It should be started by systemd as root from kcron-keytabd.socket
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-keytabd"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_caps.h"
+#include "kcron_filename.h"
+#include "kcron_keytab.h"
+#include "kcron_keytabd.h"
+#include "kcron_listen.h"
+#include "kcron_probes.h"
+
+#if USE_LANDLOCK == 1
+#include "kcron_landlock.h"
+#endif
+
+/* requests accepted per wakeup, they are then handled one after another */
+#define KEYTABD_BATCH_MAX 64
+
+/* exit when idle, systemd will start us again on the next connection */
+#define KEYTABD_IDLE_TIMEOUT_MS 60000
+
+struct keytabd_request {
+  int fd;
+  uid_t uid;
+  gid_t gid;
+  int result; /* 0 once this slot's keytab is in place */
+};
+
+static void harden_service(void) __attribute__((flatten));
+static void harden_service(void) {
+  if (freopen("/dev/null", "r", stdin) == NULL) {
+    (void)fprintf(stderr, "%s: Cannot reset stdin to /dev/null.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (prctl(PR_SET_DUMPABLE, 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot disable core dumps.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set no_new_privs.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (clearenv() != 0) {
+    (void)fprintf(stderr, "%s: Cannot clear environment variables.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)umask(077);
+
+#if USE_LANDLOCK == 1
+  /* the listening socket is already open, so only the keytab tree remains reachable */
+  KCRON_STAGE_ENTRY(KCRON_STAGE_LANDLOCK);
+  (void)set_kcron_landlock();
+  KCRON_STAGE_RETURN(KCRON_STAGE_LANDLOCK, 0);
+#endif
+
+  if (disable_capabilities() != 0) {
+    (void)fprintf(stderr, "%s: Cannot drop extra permissions.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* every request in a batch must arrive within this, however many there are */
+#define KEYTABD_REQUEST_TIMEOUT_MS 1000
+
+static long elapsed_ms(const struct timespec *start) __attribute__((nonnull(1)));
+static long elapsed_ms(const struct timespec *start) {
+  struct timespec now = {0};
+  (void)clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long)(now.tv_sec - start->tv_sec) * 1000L + (long)(now.tv_nsec - start->tv_nsec) / 1000000L;
+}
+
+/* returns 1 for a valid request, 0 if the client is not done yet, -1 to drop it */
+static int read_request(const struct keytabd_request *request) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int read_request(const struct keytabd_request *request) {
+
+  char buffer[sizeof(KEYTABD_REQUEST)] = {0};
+  const ssize_t received = recv(request->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+  if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return 0;
+  }
+  if (received != (ssize_t)strlen(KEYTABD_REQUEST) || memcmp(buffer, KEYTABD_REQUEST, strlen(KEYTABD_REQUEST)) != 0) {
+    return -1;
+  }
+  return 1;
+}
+
+static int accept_batch(int listen_fd, struct keytabd_request *batch, int batch_max) __attribute__((nonnull(2))) __attribute__((warn_unused_result));
+static int accept_batch(int listen_fd, struct keytabd_request *batch, int batch_max) {
+
+  struct pollfd waiting[KEYTABD_BATCH_MAX] = {0};
+  int slot[KEYTABD_BATCH_MAX] = {0};
+  int asked[KEYTABD_BATCH_MAX] = {0};
+  struct timespec start = {0};
+  int accepted = 0;
+  int count = 0;
+  int num_waiting = 0;
+  int ready = 0;
+  long remaining = 0;
+  int fd = -1;
+
+  struct ucred peer = {0};
+  socklen_t peer_len = sizeof(peer);
+
+  if (batch_max > KEYTABD_BATCH_MAX) {
+    batch_max = KEYTABD_BATCH_MAX;
+  }
+
+  while (accepted < batch_max) {
+    fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (fd < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) && (errno != ECONNABORTED)) {
+        (void)fprintf(stderr, "%s: Cannot accept connection: %s\n", __PROGRAM_NAME, strerror(errno));
+      }
+      break;
+    }
+
+    peer_len = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) != 0 || peer_len != sizeof(peer)) {
+      (void)fprintf(stderr, "%s: Cannot identify peer, dropping connection.\n", __PROGRAM_NAME);
+      (void)close(fd);
+      continue;
+    }
+
+    batch[accepted].fd = fd;
+    batch[accepted].uid = peer.uid;
+    batch[accepted].gid = peer.gid;
+    batch[accepted].result = 1;
+    asked[accepted] = 0;
+    accepted++;
+  }
+
+  /*
+   * The requests must be read, closing with one unread resets the peer.
+   * One deadline covers them all so idle clients cannot stall the rest.
+   */
+  (void)clock_gettime(CLOCK_MONOTONIC, &start);
+  while (1) {
+    num_waiting = 0;
+    for (int i = 0; i < accepted; i++) {
+      if (asked[i] == 0) {
+        waiting[num_waiting].fd = batch[i].fd;
+        waiting[num_waiting].events = POLLIN;
+        waiting[num_waiting].revents = 0;
+        slot[num_waiting] = i;
+        num_waiting++;
+      }
+    }
+
+    remaining = KEYTABD_REQUEST_TIMEOUT_MS - elapsed_ms(&start);
+    if (num_waiting == 0 || remaining <= 0) {
+      break;
+    }
+
+    ready = poll(waiting, (nfds_t)num_waiting, (int)remaining);
+    if (ready < 0 && errno != EINTR) {
+      (void)fprintf(stderr, "%s: Cannot poll requests: %s\n", __PROGRAM_NAME, strerror(errno));
+      break;
+    }
+
+    for (int i = 0; i < num_waiting && ready > 0; i++) {
+      if (waiting[i].revents == 0) {
+        continue;
+      }
+      asked[slot[i]] = read_request(&batch[slot[i]]);
+    }
+  }
+
+  /* keep the valid requests, in the order they arrived */
+  for (int i = 0; i < accepted; i++) {
+    if (asked[i] != 1) {
+      (void)fprintf(stderr, "%s: %s from uid %d, dropping connection.\n", __PROGRAM_NAME, (asked[i] == 0) ? "No request in time" : "Invalid request",
+                    batch[i].uid);
+      (void)close(batch[i].fd);
+      continue;
+    }
+    batch[count++] = batch[i];
+  }
+
+  return count;
+}
+
+static void serve_batch(struct keytabd_request *batch, int count, char *keytab_dirname, char *keytab_filename, char *keytab, char *reply) __attribute__((nonnull(1, 3, 4, 5, 6)));
+static void serve_batch(struct keytabd_request *batch, int count, char *keytab_dirname, char *keytab_filename, char *keytab, char *reply) {
+
+  int done = 0;
+  int rc = 0;
+
+  for (int i = 0; i < count; i++) {
+
+    /* a user starting many jobs at once only needs the work done one time */
+    done = 0;
+    for (int j = 0; j < i; j++) {
+      if (batch[j].uid == batch[i].uid && batch[j].gid == batch[i].gid) {
+        batch[i].result = batch[j].result;
+        done = 1;
+        break;
+      }
+    }
+
+    /* the path is only a string, so every slot gets its own */
+    KCRON_STAGE_ENTRY(KCRON_STAGE_FILENAMES);
+    rc = get_filenames_for_uid(batch[i].uid, keytab_dirname, keytab_filename, keytab);
+    KCRON_STAGE_RETURN(KCRON_STAGE_FILENAMES, rc);
+
+    if (rc != 0) {
+      (void)fprintf(stderr, "%s: Cannot determine keytab filename for uid %d.\n", __PROGRAM_NAME, batch[i].uid);
+      batch[i].result = 1;
+    } else if (done == 0) {
+      batch[i].result = 0;
+      if (create_keytab_if_missing(keytab_dirname, keytab_filename, keytab, batch[i].uid, batch[i].gid) != 0) {
+        (void)fprintf(stderr, "%s: Cannot create keytab for uid %d.\n", __PROGRAM_NAME, batch[i].uid);
+        batch[i].result = 1;
+      }
+    }
+
+    if (batch[i].result == 0) {
+      (void)snprintf(reply, KEYTABD_REPLY_MAX_LENGTH, "0 %s", keytab);
+    } else {
+      (void)snprintf(reply, KEYTABD_REPLY_MAX_LENGTH, "1 Cannot create keytab, see the %s journal", __PROGRAM_NAME);
+    }
+
+    if (send(batch[i].fd, reply, strlen(reply), MSG_NOSIGNAL) < 0) {
+      (void)fprintf(stderr, "%s: Cannot reply to uid %d: %s\n", __PROGRAM_NAME, batch[i].uid, strerror(errno));
+    }
+    (void)close(batch[i].fd);
+  }
+}
+
+int main(void) {
+
+  struct stat st = {0};
+  struct pollfd listener = {0};
+  struct keytabd_request *batch = NULL;
+
+  const char *nullstring = NULL;
+  const struct keytabd_request *nullbatch = NULL;
+  int count = 0;
+  int ready = 0;
+
+  const int listen_fd = get_listen_fd();
+  if (listen_fd < 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  (void)harden_service();
+
+  char *keytab = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  char *keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  char *keytab_filename = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  char *client_keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
+  char *reply = calloc(KEYTABD_REPLY_MAX_LENGTH + 1, sizeof(char));
+  batch = calloc(KEYTABD_BATCH_MAX, sizeof(struct keytabd_request));
+
+  /* verify memory can be allocated, we exit right away so no need to free */
+  if ((keytab == nullstring) || (keytab_dirname == nullstring) || (keytab_filename == nullstring) || (client_keytab_dirname == nullstring) || (reply == nullstring) ||
+      (batch == nullbatch)) {
+    (void)fprintf(stderr, "%s: Unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (get_client_dirname(client_keytab_dirname) != 0) {
+    (void)fprintf(stderr, "%s: Client keytab directory not set.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (stat(client_keytab_dirname, &st) == -1) {
+    (void)fprintf(stderr, "%s: Client keytab directory does not exist: %s.\n", __PROGRAM_NAME, client_keytab_dirname);
+    exit(EXIT_FAILURE);
+  }
+
+  if (fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK) != 0) {
+    (void)fprintf(stderr, "%s: Cannot make socket non-blocking.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  listener.fd = listen_fd;
+  listener.events = POLLIN;
+
+  /* The helpers we share with init-kcron-keytab exit on hard errors,    */
+  /* that is fine here as systemd will restart us on the next request.  */
+  while (1) {
+    ready = poll(&listener, 1, KEYTABD_IDLE_TIMEOUT_MS);
+    if (ready == 0) {
+      break;
+    }
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      (void)fprintf(stderr, "%s: Cannot poll socket: %s\n", __PROGRAM_NAME, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    count = accept_batch(listen_fd, batch, KEYTABD_BATCH_MAX);
+    (void)serve_batch(batch, count, keytab_dirname, keytab_filename, keytab, reply);
+  }
+
+  (void)free(keytab);
+  (void)free(keytab_dirname);
+  (void)free(keytab_filename);
+  (void)free(client_keytab_dirname);
+  (void)free(reply);
+  (void)free(batch);
+
+  exit(EXIT_SUCCESS);
+}
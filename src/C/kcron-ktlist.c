@@ -0,0 +1,346 @@
+/*
+ *
+ * List the entries of one or many keytabs without forking klist.
+ *
+ * Each keytab is mapped read only and walked in place, so checking every
+ * keytab on a host is a single process.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-ktlist"
+#endif
+
+#include "autoconf.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_filename.h"
+#include "kcron_keytab_parse.h"
+
+struct ktlist_options {
+  int json;
+  int quiet;
+  const char *principal;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-j] [-q] [-p principal] [-a] [-f list] [keytab...]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -j            one JSON object per keytab\n");
+  (void)fprintf(stderr, "  -q            print nothing, only set the exit status\n");
+  (void)fprintf(stderr, "  -p principal  only entries for principal, fail if a keytab has none\n");
+  (void)fprintf(stderr, "  -a            every keytab under %s\n", __CLIENT_KEYTAB_DIR);
+  (void)fprintf(stderr, "  -f list       keytab paths one per line, '-' for stdin\n");
+}
+
+static void json_bytes(const unsigned char *p, size_t length) __attribute__((nonnull(1)));
+static void json_bytes(const unsigned char *p, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (p[i] == '"' || p[i] == '\\') {
+      (void)putchar('\\');
+      (void)putchar(p[i]);
+    } else if (p[i] < 0x20) {
+      (void)printf("\\u%04x", p[i]);
+    } else {
+      (void)putchar(p[i]);
+    }
+  }
+}
+
+static void json_string(const char *text) __attribute__((nonnull(1)));
+static void json_string(const char *text) {
+  (void)putchar('"');
+  json_bytes((const unsigned char *)text, strlen(text));
+  (void)putchar('"');
+}
+
+static void json_principal(const struct kcron_keytab_entry *entry) __attribute__((nonnull(1)));
+static void json_principal(const struct kcron_keytab_entry *entry) {
+  const unsigned char *p = entry->components;
+  uint16_t length = 0;
+
+  (void)putchar('"');
+  for (uint16_t i = 0; i < entry->num_components; i++) {
+    length = kcron_keytab_u16(p);
+    if (i > 0) {
+      (void)putchar('/');
+    }
+    json_bytes(p + 2, length);
+    p += 2 + length;
+  }
+  (void)putchar('@');
+  json_bytes(entry->realm, entry->realm_length);
+  (void)putchar('"');
+}
+
+/* returns 0 if the keytab was read and, with -p, had the principal */
+static int list_keytab(int dir_fd, const char *name, const char *display, const struct ktlist_options *options) __attribute__((nonnull(2, 3, 4)));
+static int list_keytab(int dir_fd, const char *name, const char *display, const struct ktlist_options *options) {
+
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  struct tm tm = {0};
+  char timestamp[32] = {0};
+  size_t offset = 0;
+  size_t matched = 0;
+  time_t when = 0;
+  int rc = 0;
+  int error = 0;
+
+  error = kcron_keytab_map_at(dir_fd, name, &map);
+  if (error != 0) {
+    if (options->json == 1 && options->quiet == 0) {
+      (void)printf("{\"keytab\":");
+      json_string(display);
+      (void)printf(",\"error\":");
+      json_string(strerror(error));
+      (void)printf("}\n");
+    } else if (options->quiet == 0) {
+      (void)fprintf(stderr, "%s: Cannot read keytab %s: %s\n", __PROGRAM_NAME, display, (error == EINVAL) ? "not a 0x0502 keytab" : strerror(error));
+    }
+    return 1;
+  }
+
+  if (options->quiet == 0) {
+    if (options->json == 1) {
+      (void)printf("{\"keytab\":");
+      json_string(display);
+      (void)printf(",\"entries\":[");
+    } else {
+      (void)printf("Keytab name: FILE:%s\nKVNO Timestamp            Principal\n", display);
+    }
+  }
+
+  while ((rc = kcron_keytab_next(&map, &offset, &entry)) == 1) {
+    if (options->principal != NULL && kcron_keytab_principal_is(&entry, options->principal) == 0) {
+      continue;
+    }
+    matched++;
+
+    if (options->quiet == 1) {
+      continue;
+    }
+
+    when = (time_t)entry.timestamp;
+    if (gmtime_r(&when, &tm) == NULL || strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm) == 0) {
+      timestamp[0] = '\0';
+    }
+
+    if (options->json == 1) {
+      (void)printf("%s{\"principal\":", (matched > 1) ? "," : "");
+      json_principal(&entry);
+      (void)printf(",\"kvno\":%u,\"enctype\":%u,\"enctype_name\":\"%s\",\"timestamp\":%u}", entry.kvno, entry.enctype, kcron_keytab_enctype_name(entry.enctype), entry.timestamp);
+    } else {
+      (void)printf("%4u %s ", entry.kvno, timestamp);
+      kcron_keytab_fprint_principal(stdout, &entry);
+      (void)printf(" (%s)\n", kcron_keytab_enctype_name(entry.enctype));
+    }
+  }
+
+  if (options->quiet == 0 && options->json == 1) {
+    (void)printf("]%s}\n", (rc < 0) ? ",\"error\":\"damaged keytab\"" : "");
+  }
+
+  kcron_keytab_unmap(&map);
+
+  if (rc < 0) {
+    if (options->quiet == 0 && options->json == 0) {
+      (void)fprintf(stderr, "%s: Keytab %s is damaged.\n", __PROGRAM_NAME, display);
+    }
+    return 1;
+  }
+
+  if (options->principal != NULL && matched == 0) {
+    if (options->quiet == 0 && options->json == 0) {
+      (void)fprintf(stderr, "%s: %s not found in %s.\n", __PROGRAM_NAME, options->principal, display);
+    }
+    return 1;
+  }
+
+  return 0;
+}
+
+static int list_user_dirs(int dir_fd, const char *prefix, const struct ktlist_options *options) __attribute__((nonnull(2, 3)));
+static int list_user_dirs(int dir_fd, const char *prefix, const struct ktlist_options *options) {
+
+  char name[FILE_PATH_MAX_LENGTH] = {0};
+  char display[FILE_PATH_MAX_LENGTH] = {0};
+  const struct dirent *dirent = NULL;
+  int shard_fd = -1;
+  int result = 0;
+
+  DIR *dir = fdopendir(dir_fd);
+  if (dir == NULL) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, prefix, strerror(errno));
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  while ((dirent = readdir(dir)) != NULL) {
+    if (dirent->d_name[0] == '.' || dirent->d_type == DT_REG) {
+      continue;
+    }
+    (void)snprintf(display, sizeof(display), "%s/%s", prefix, dirent->d_name);
+
+    /* either layout, or both part way through kcron-shard-migrate */
+    if (strncmp(dirent->d_name, KCRON_SHARD_PREFIX, strlen(KCRON_SHARD_PREFIX)) == 0) {
+      shard_fd = openat(dirfd(dir), dirent->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (shard_fd < 0) {
+        (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, display, strerror(errno));
+        result = 1;
+        continue;
+      }
+      result |= list_user_dirs(shard_fd, display, options);
+      continue;
+    }
+
+    (void)snprintf(name, sizeof(name), "%s/%s", dirent->d_name, KCRON_KEYTAB_FILENAME);
+    (void)snprintf(display, sizeof(display), "%s/%s", prefix, name);
+    result |= list_keytab(dirfd(dir), name, display, options);
+  }
+
+  (void)closedir(dir);
+  return result;
+}
+
+static int list_client_dir(const struct ktlist_options *options) __attribute__((nonnull(1)));
+static int list_client_dir(const struct ktlist_options *options) {
+
+  const int client_fd = open(__CLIENT_KEYTAB_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (client_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, __CLIENT_KEYTAB_DIR, strerror(errno));
+    return 1;
+  }
+
+  return list_user_dirs(client_fd, __CLIENT_KEYTAB_DIR, options);
+}
+
+static int list_from_file(const char *list, const struct ktlist_options *options) __attribute__((nonnull(1, 2)));
+static int list_from_file(const char *list, const struct ktlist_options *options) {
+
+  char line[FILE_PATH_MAX_LENGTH] = {0};
+  int result = 0;
+
+  FILE *input = (strcmp(list, "-") == 0) ? stdin : fopen(list, "re");
+  if (input == NULL) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, list, strerror(errno));
+    return 1;
+  }
+
+  while (fgets(line, sizeof(line), input) != NULL) {
+    line[strcspn(line, "\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    result |= list_keytab(AT_FDCWD, line, line, options);
+  }
+
+  if (input != stdin) {
+    (void)fclose(input);
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+
+  struct ktlist_options options = {0};
+  const char *list = NULL;
+  int all_keytabs = 0;
+  int listed = 0;
+  int result = 0;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "jqp:af:h")) != -1) {
+    switch (opt) {
+    case 'j':
+      options.json = 1;
+      break;
+    case 'q':
+      options.quiet = 1;
+      break;
+    case 'p':
+      options.principal = optarg;
+      break;
+    case 'a':
+      all_keytabs = 1;
+      break;
+    case 'f':
+      list = optarg;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (list != NULL) {
+    result |= list_from_file(list, &options);
+    listed = 1;
+  }
+
+  if (all_keytabs == 1) {
+    result |= list_client_dir(&options);
+    listed = 1;
+  }
+
+  for (int i = optind; i < argc; i++) {
+    result |= list_keytab(AT_FDCWD, argv[i], argv[i], &options);
+    listed = 1;
+  }
+
+  if (listed == 0) {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (fflush(stdout) != 0) {
+    result = 1;
+  }
+
+  if (result != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
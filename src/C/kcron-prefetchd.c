@@ -0,0 +1,698 @@
+/*
+ *
+ * Get cron users their TGT a little before their jobs run, spread over a
+ * window and rate limited, so the KDC sees a steady trickle rather than
+ * every job on the farm at the top of the hour.
+ *
+ * It must be run as root, it is not meant to be SETUID(3p).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-prefetchd"
+#endif
+
+#include "autoconf.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_cron.h"
+#include "kcron_filename.h"
+#include "kcron_keytab_parse.h"
+#include "kcron_nss.h"
+#include "kcron_tgt.h"
+
+#define PREFETCH_SYSTEM_CRONTAB "/etc/crontab"
+#define PREFETCH_SYSTEM_CRON_DIR "/etc/cron.d"
+#define PREFETCH_MAX_CHILDREN 16
+#define PREFETCH_KINIT_TIMEOUT 30
+#define PREFETCH_CCACHE_NAME "tgt"
+
+struct prefetch_options {
+  unsigned int window;   /* seconds to spread acquisitions over */
+  unsigned int lead;     /* seconds before the job the window closes */
+  unsigned int rescan;   /* seconds between crontab reads */
+  unsigned int lifetime; /* how long we assume a TGT lasts */
+  double rate;           /* acquisitions per second */
+  const char *ccache;    /* KRB5CCNAME template, %u is the uid, NULL for ours */
+  int dry_run;
+};
+
+struct prefetch_user {
+  uid_t uid;
+  gid_t gid;
+  char principal[512];
+  char keytab[FILE_PATH_MAX_LENGTH];
+  time_t next_run;      /* next cron job, 0 for none in sight */
+  time_t fire_at;       /* when we go for the TGT, 0 for not at all */
+  time_t last_acquired; /* survives a rescan */
+  pid_t child;
+};
+
+struct prefetch_job {
+  struct kcron_cron_entry entry;
+  size_t user;
+};
+
+struct prefetch_state {
+  struct prefetch_user *users;
+  size_t num_users;
+  size_t allocated_users;
+  struct prefetch_job *jobs;
+  size_t num_jobs;
+  size_t allocated_jobs;
+  struct prefetch_user **queue; /* users with a fire_at, soonest first */
+  size_t queue_length;
+  size_t queue_next;
+  size_t running;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-n] [-w window] [-l lead] [-r rate] [-i rescan] [-L lifetime] [-c ccache]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -w seconds  spread each user's kinit over this long (default 600)\n");
+  (void)fprintf(stderr, "  -l seconds  finish this long before the job starts (default 60)\n");
+  (void)fprintf(stderr, "  -r rate     at most this many kinit per second (default 5)\n");
+  (void)fprintf(stderr, "  -i seconds  reread the crontabs this often (default 300), or on SIGHUP\n");
+  (void)fprintf(stderr, "  -L seconds  a TGT we got is good for this long (default 36000)\n");
+  (void)fprintf(stderr, "  -c ccache   KRB5CCNAME for the TGT, %%u for the uid (default: FILE:%s/%%u/%s)\n", __PREFETCH_CCACHE_DIR, PREFETCH_CCACHE_NAME);
+  (void)fprintf(stderr, "  -n          print the plan and exit\n");
+}
+
+static int parse_seconds(const char *text, unsigned int *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_seconds(const char *text, unsigned int *value) {
+  char *end = NULL;
+  unsigned long number = 0;
+
+  errno = 0;
+  number = strtoul(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || *text == '-' || number > 86400 * 7) {
+    return 1;
+  }
+  *value = (unsigned int)number;
+  return 0;
+}
+
+static int cmp_user_uid(const void *a, const void *b) {
+  const struct prefetch_user *left = a;
+  const struct prefetch_user *right = b;
+  return (left->uid > right->uid) - (left->uid < right->uid);
+}
+
+static int cmp_fire_at(const void *a, const void *b) {
+  const struct prefetch_user *const *left = a;
+  const struct prefetch_user *const *right = b;
+  return ((*left)->fire_at > (*right)->fire_at) - ((*left)->fire_at < (*right)->fire_at);
+}
+
+static struct prefetch_user *find_user(const struct prefetch_state *state, uid_t uid) __attribute__((nonnull(1)));
+static struct prefetch_user *find_user(const struct prefetch_state *state, uid_t uid) {
+  const struct prefetch_user key = {.uid = uid};
+  if (state->num_users == 0) {
+    return NULL;
+  }
+  return bsearch(&key, state->users, state->num_users, sizeof(struct prefetch_user), cmp_user_uid);
+}
+
+static void free_state(struct prefetch_state *state) __attribute__((nonnull(1)));
+static void free_state(struct prefetch_state *state) {
+  (void)free(state->users);
+  (void)free(state->jobs);
+  (void)free(state->queue);
+  (void)memset(state, 0, sizeof(*state));
+}
+
+/* a user with a keytab that holds at least one key */
+static int add_user(struct prefetch_state *state, const struct kcron_nss_cache *nss, int parent_fd, const char *name, const char *display)
+    __attribute__((nonnull(1, 2, 4, 5))) __attribute__((warn_unused_result));
+static int add_user(struct prefetch_state *state, const struct kcron_nss_cache *nss, int parent_fd, const char *name, const char *display) {
+
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  char principal[512] = {0};
+  struct prefetch_user *grown = NULL;
+  struct prefetch_user *user = NULL;
+  const struct kcron_nss_user *account = NULL;
+  char *end = NULL;
+  unsigned long uid = 0;
+
+  errno = 0;
+  uid = strtoul(name, &end, 10);
+  if (errno != 0 || end == name || *end != '\0') {
+    return 0;
+  }
+  account = kcron_nss_by_uid(nss, (uid_t)uid);
+  if (account == NULL) {
+    return 0;
+  }
+
+  (void)snprintf(path, sizeof(path), "%s/%s", name, KCRON_KEYTAB_FILENAME);
+  if (kcron_keytab_first_principal_at(parent_fd, path, principal, sizeof(principal)) != 0) {
+    return 0;
+  }
+
+  if (state->num_users == state->allocated_users) {
+    state->allocated_users = (state->allocated_users == 0) ? 1024 : state->allocated_users * 2;
+    grown = realloc(state->users, state->allocated_users * sizeof(struct prefetch_user));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    state->users = grown;
+  }
+
+  user = &state->users[state->num_users++];
+  (void)memset(user, 0, sizeof(*user));
+  user->uid = account->uid;
+  user->gid = account->gid;
+  (void)snprintf(user->principal, sizeof(user->principal), "%s", principal);
+  (void)snprintf(user->keytab, sizeof(user->keytab), "%s/%s", display, KCRON_KEYTAB_FILENAME);
+  return 0;
+}
+
+/* either layout, or both part way through kcron-shard-migrate */
+static int scan_keytabs(struct prefetch_state *state, const struct kcron_nss_cache *nss, int dir_fd, const char *prefix) __attribute__((nonnull(1, 2, 4)));
+static int scan_keytabs(struct prefetch_state *state, const struct kcron_nss_cache *nss, int dir_fd, const char *prefix) {
+
+  char display[FILE_PATH_MAX_LENGTH] = {0};
+  const struct dirent *dirent = NULL;
+  int shard_fd = -1;
+  int result = 0;
+
+  DIR *dir = fdopendir(dir_fd);
+  if (dir == NULL) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, prefix, strerror(errno));
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  while ((dirent = readdir(dir)) != NULL) {
+    if (dirent->d_name[0] == '.' || dirent->d_type == DT_REG) {
+      continue;
+    }
+    (void)snprintf(display, sizeof(display), "%s/%s", prefix, dirent->d_name);
+
+    if (strncmp(dirent->d_name, KCRON_SHARD_PREFIX, strlen(KCRON_SHARD_PREFIX)) == 0) {
+      shard_fd = openat(dirfd(dir), dirent->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (shard_fd >= 0) {
+        result |= scan_keytabs(state, nss, shard_fd, display);
+      }
+      continue;
+    }
+    result |= add_user(state, nss, dirfd(dir), dirent->d_name, display);
+  }
+
+  (void)closedir(dir);
+  return result;
+}
+
+/* 'system' crontabs name the user on each line, a spool crontab is all 'owner' */
+static int read_crontab(struct prefetch_state *state, const struct kcron_nss_cache *nss, const char *path, const struct prefetch_user *owner) __attribute__((nonnull(1, 2, 3)));
+static int read_crontab(struct prefetch_state *state, const struct kcron_nss_cache *nss, const char *path, const struct prefetch_user *owner) {
+
+  char line[4096] = {0};
+  char name[256] = {0};
+  struct kcron_cron_entry entry = {0};
+  struct prefetch_job *grown = NULL;
+  const struct prefetch_user *user = owner;
+  const struct kcron_nss_user *account = NULL;
+  unsigned int line_number = 0;
+
+  FILE *crontab = fopen(path, "re");
+  if (crontab == NULL) {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), crontab) != NULL) {
+    line_number++;
+    switch (kcron_cron_parse_line(line, &entry, (owner == NULL) ? name : NULL, sizeof(name))) {
+    case 1:
+      break;
+    case 0:
+      continue;
+    default:
+      (void)fprintf(stderr, "%s: %s:%u: cannot read this schedule, skipping it.\n", __PROGRAM_NAME, path, line_number);
+      continue;
+    }
+
+    if (owner == NULL) {
+      account = kcron_nss_by_name(nss, name);
+      user = (account == NULL) ? NULL : find_user(state, account->uid);
+      if (user == NULL) {
+        continue;
+      }
+    }
+
+    if (state->num_jobs == state->allocated_jobs) {
+      state->allocated_jobs = (state->allocated_jobs == 0) ? 1024 : state->allocated_jobs * 2;
+      grown = realloc(state->jobs, state->allocated_jobs * sizeof(struct prefetch_job));
+      if (grown == NULL) {
+        (void)fclose(crontab);
+        (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+        return 1;
+      }
+      state->jobs = grown;
+    }
+    state->jobs[state->num_jobs].entry = entry;
+    state->jobs[state->num_jobs].user = (size_t)(user - state->users);
+    state->num_jobs++;
+  }
+
+  (void)fclose(crontab);
+  return 0;
+}
+
+static int read_crontabs(struct prefetch_state *state, const struct kcron_nss_cache *nss) __attribute__((nonnull(1, 2)));
+static int read_crontabs(struct prefetch_state *state, const struct kcron_nss_cache *nss) {
+
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  const struct kcron_nss_user *account = NULL;
+  const struct dirent *dirent = NULL;
+  DIR *dir = NULL;
+  int result = 0;
+
+  for (size_t i = 0; i < state->num_users; i++) {
+    account = kcron_nss_by_uid(nss, state->users[i].uid);
+    (void)snprintf(path, sizeof(path), "%s/%s", __CRONTAB_SPOOL_DIR, account->name);
+    result |= read_crontab(state, nss, path, &state->users[i]);
+  }
+
+  result |= read_crontab(state, nss, PREFETCH_SYSTEM_CRONTAB, NULL);
+
+  dir = opendir(PREFETCH_SYSTEM_CRON_DIR);
+  if (dir == NULL) {
+    return result;
+  }
+  while ((dirent = readdir(dir)) != NULL) {
+    /* cron(8) skips the same names */
+    if (dirent->d_name[0] == '.' || strchr(dirent->d_name, '~') != NULL || strstr(dirent->d_name, ".rpm") != NULL) {
+      continue;
+    }
+    (void)snprintf(path, sizeof(path), "%s/%s", PREFETCH_SYSTEM_CRON_DIR, dirent->d_name);
+    result |= read_crontab(state, nss, path, NULL);
+  }
+  (void)closedir(dir);
+  return result;
+}
+
+/* the first minute after 'now' each user has a job, up to 'horizon' seconds out */
+static void find_next_runs(struct prefetch_state *state, time_t now, unsigned int horizon) __attribute__((nonnull(1)));
+static void find_next_runs(struct prefetch_state *state, time_t now, unsigned int horizon) {
+
+  struct tm tm = {0};
+  size_t remaining = state->num_users;
+
+  for (size_t i = 0; i < state->num_users; i++) {
+    state->users[i].next_run = 0;
+  }
+
+  for (time_t minute = now - now % 60 + 60; minute <= now + (time_t)horizon && remaining > 0; minute += 60) {
+    (void)localtime_r(&minute, &tm);
+    for (size_t j = 0; j < state->num_jobs; j++) {
+      struct prefetch_user *user = &state->users[state->jobs[j].user];
+      if (user->next_run == 0 && kcron_cron_matches(&state->jobs[j].entry, &tm) == 1) {
+        user->next_run = minute;
+        remaining--;
+      }
+    }
+  }
+}
+
+static int plan(struct prefetch_state *state, const struct prefetch_options *options, time_t now) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int plan(struct prefetch_state *state, const struct prefetch_options *options, time_t now) {
+
+  struct prefetch_user *user = NULL;
+  uint32_t jitter = 0;
+
+  find_next_runs(state, now, options->lead + options->window + options->rescan);
+
+  state->queue = calloc(state->num_users + 1, sizeof(struct prefetch_user *));
+  if (state->queue == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  for (size_t i = 0; i < state->num_users; i++) {
+    user = &state->users[i];
+    user->fire_at = 0;
+    if (user->next_run == 0) {
+      continue;
+    }
+    /* the one we got last time will still do */
+    if (user->last_acquired != 0 && user->last_acquired + (time_t)(options->lifetime / 2) >= user->next_run) {
+      continue;
+    }
+
+    if (options->window > 0 && getrandom(&jitter, sizeof(jitter), GRND_NONBLOCK) != sizeof(jitter)) {
+      jitter = (uint32_t)random();
+    }
+    user->fire_at = user->next_run - (time_t)options->lead - ((options->window > 0) ? (time_t)(jitter % options->window) : 0);
+    if (user->fire_at < now) {
+      user->fire_at = now;
+    }
+    state->queue[state->queue_length++] = user;
+  }
+
+  qsort(state->queue, state->queue_length, sizeof(struct prefetch_user *), cmp_fire_at);
+  return 0;
+}
+
+/* a fresh look at who has keytabs and crontabs, keeping what we know about each uid */
+static int rescan(struct prefetch_state *state, const struct prefetch_options *options) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int rescan(struct prefetch_state *state, const struct prefetch_options *options) {
+
+  struct prefetch_state fresh = {0};
+  struct kcron_nss_cache nss = {0};
+  struct prefetch_user *old = NULL;
+  int client_fd = -1;
+
+  if (kcron_nss_load(&nss) != 0) {
+    return 1;
+  }
+
+  client_fd = open(__CLIENT_KEYTAB_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (client_fd < 0) {
+    (void)fprintf(stderr, "%s: Client keytab directory does not exist: %s.\n", __PROGRAM_NAME, __CLIENT_KEYTAB_DIR);
+    kcron_nss_free(&nss);
+    return 1;
+  }
+  (void)scan_keytabs(&fresh, &nss, client_fd, __CLIENT_KEYTAB_DIR);
+
+  if (fresh.num_users > 0) {
+    qsort(fresh.users, fresh.num_users, sizeof(struct prefetch_user), cmp_user_uid);
+  }
+  if (read_crontabs(&fresh, &nss) != 0) {
+    kcron_nss_free(&nss);
+    free_state(&fresh);
+    return 1;
+  }
+  kcron_nss_free(&nss);
+
+  for (size_t i = 0; i < fresh.num_users; i++) {
+    old = find_user(state, fresh.users[i].uid);
+    if (old != NULL) {
+      fresh.users[i].last_acquired = old->last_acquired;
+      fresh.users[i].child = old->child;
+      fresh.running += (old->child > 0) ? 1 : 0;
+    }
+  }
+
+  if (plan(&fresh, options, time(NULL)) != 0) {
+    free_state(&fresh);
+    return 1;
+  }
+
+  free_state(state);
+  *state = fresh;
+  return 0;
+}
+
+static void reap(struct prefetch_state *state) __attribute__((nonnull(1)));
+static void reap(struct prefetch_state *state) {
+
+  int status = 0;
+  pid_t child = 0;
+
+  while ((child = waitpid(-1, &status, WNOHANG)) > 0) {
+    for (size_t i = 0; i < state->num_users; i++) {
+      if (state->users[i].child != child) {
+        continue;
+      }
+      state->users[i].child = 0;
+      state->running--;
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        state->users[i].last_acquired = time(NULL);
+      } else {
+        (void)fprintf(stderr, "%s: kinit for %s (uid %u) failed.\n", __PROGRAM_NAME, state->users[i].principal, state->users[i].uid);
+      }
+      break;
+    }
+  }
+}
+
+static void print_plan(const struct prefetch_state *state) __attribute__((nonnull(1)));
+static void print_plan(const struct prefetch_state *state) {
+
+  char fire_at[32] = {0};
+  char next_run[32] = {0};
+  struct tm tm = {0};
+
+  for (size_t i = 0; i < state->queue_length; i++) {
+    (void)strftime(fire_at, sizeof(fire_at), "%F %T", localtime_r(&state->queue[i]->fire_at, &tm));
+    (void)strftime(next_run, sizeof(next_run), "%F %T", localtime_r(&state->queue[i]->next_run, &tm));
+    (void)printf("%s\t%u\t%s\t%s\n", fire_at, state->queue[i]->uid, state->queue[i]->principal, next_run);
+  }
+  (void)fprintf(stderr, "%s: %zu users with keytabs, %zu cron jobs, %zu kinit planned\n", __PROGRAM_NAME, state->num_users, state->num_jobs, state->queue_length);
+}
+
+/*
+ * Never the user's default ccache, that may hold their own TGT from an
+ * interactive login, so by default each user gets a directory of ours.
+ */
+static int prefetch_ccache_dir(int ccache_dir_fd, const struct prefetch_user *user, char *ccache, size_t size) __attribute__((nonnull(2, 3)))
+__attribute__((warn_unused_result));
+static int prefetch_ccache_dir(int ccache_dir_fd, const struct prefetch_user *user, char *ccache, size_t size) {
+
+  char subdir[32] = {0};
+  struct stat st = {0};
+
+  (void)snprintf(subdir, sizeof(subdir), "%u", user->uid);
+  if (mkdirat(ccache_dir_fd, subdir, S_IRWXU) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s/%s: %s\n", __PROGRAM_NAME, __PREFETCH_CCACHE_DIR, subdir, strerror(errno));
+    return 1;
+  }
+  /* only we can make entries in here, so this is the one we made */
+  if (fstatat(ccache_dir_fd, subdir, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode) ||
+      ((st.st_uid != user->uid || st.st_gid != user->gid) && fchownat(ccache_dir_fd, subdir, user->uid, user->gid, AT_SYMLINK_NOFOLLOW) != 0)) {
+    (void)fprintf(stderr, "%s: Cannot give %s/%s to uid %u.\n", __PROGRAM_NAME, __PREFETCH_CCACHE_DIR, subdir, user->uid);
+    return 1;
+  }
+
+  (void)snprintf(ccache, size, "FILE:%s/%s/%s", __PREFETCH_CCACHE_DIR, subdir, PREFETCH_CCACHE_NAME);
+  return 0;
+}
+
+static uint64_t monotonic_ns(void) {
+  struct timespec ts = {0};
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+
+  struct prefetch_options options = {.window = 600, .lead = 60, .rescan = 300, .lifetime = 36000, .rate = 5.0, .ccache = NULL, .dry_run = 0};
+  struct prefetch_state state = {0};
+  struct prefetch_user *user = NULL;
+  struct timespec timeout = {0};
+  char ccache[FILE_PATH_MAX_LENGTH] = {0};
+  char *end = NULL;
+  const char *percent = NULL;
+  sigset_t waited;
+  uint64_t next_allowed = 0;
+  uint64_t interval_ns = 0;
+  uint64_t wait_ns = 0;
+  time_t next_rescan = 0;
+  time_t now = 0;
+  int ccache_dir_fd = -1;
+  int opt = 0;
+  int signal_number = 0;
+  int running = 1;
+
+  while ((opt = getopt(argc, argv, "w:l:r:i:L:c:nh")) != -1) {
+    switch (opt) {
+    case 'w':
+      if (parse_seconds(optarg, &options.window) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'l':
+      if (parse_seconds(optarg, &options.lead) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'i':
+      if (parse_seconds(optarg, &options.rescan) != 0 || options.rescan < 60) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'L':
+      if (parse_seconds(optarg, &options.lifetime) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'r':
+      errno = 0;
+      options.rate = strtod(optarg, &end);
+      if (errno != 0 || *end != '\0' || !(options.rate > 0.0)) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'c':
+      options.ccache = optarg;
+      break;
+    case 'n':
+      options.dry_run = 1;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (geteuid() != 0) {
+    (void)fprintf(stderr, "%s: must be run as root.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (options.ccache == NULL && options.dry_run == 0) {
+    ccache_dir_fd = open(__PREFETCH_CCACHE_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (ccache_dir_fd < 0) {
+      (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, __PREFETCH_CCACHE_DIR, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* everything we wait for arrives through sigtimedwait() */
+  (void)sigemptyset(&waited);
+  (void)sigaddset(&waited, SIGCHLD);
+  (void)sigaddset(&waited, SIGHUP);
+  (void)sigaddset(&waited, SIGTERM);
+  (void)sigaddset(&waited, SIGINT);
+  (void)sigprocmask(SIG_BLOCK, &waited, NULL);
+
+  interval_ns = (uint64_t)(1000000000.0 / options.rate);
+
+  while (running == 1) {
+    now = time(NULL);
+
+    if (now >= next_rescan) {
+      if (rescan(&state, &options) != 0 && state.users == NULL) {
+        exit(EXIT_FAILURE);
+      }
+      next_rescan = now + (time_t)options.rescan;
+      if (options.dry_run == 1) {
+        print_plan(&state);
+        break;
+      }
+    }
+
+    /* start whatever is due, no faster than the rate allows */
+    while (state.queue_next < state.queue_length && state.queue[state.queue_next]->fire_at <= now && state.running < PREFETCH_MAX_CHILDREN &&
+           monotonic_ns() >= next_allowed) {
+      user = state.queue[state.queue_next++];
+      if (user->child > 0) {
+        continue;
+      }
+      if (options.ccache == NULL) {
+        if (prefetch_ccache_dir(ccache_dir_fd, user, ccache, sizeof(ccache)) != 0) {
+          continue;
+        }
+      } else {
+        /* only the one %u is expanded */
+        percent = strstr(options.ccache, "%u");
+        if (percent == NULL) {
+          (void)snprintf(ccache, sizeof(ccache), "%s", options.ccache);
+        } else {
+          (void)snprintf(ccache, sizeof(ccache), "%.*s%u%s", (int)(percent - options.ccache), options.ccache, user->uid, percent + 2);
+        }
+      }
+      user->child = kcron_tgt_acquire(__KINIT_PATH, user->uid, user->gid, user->keytab, user->principal, ccache, PREFETCH_KINIT_TIMEOUT);
+      if (user->child < 0) {
+        user->child = 0;
+        (void)fprintf(stderr, "%s: Cannot fork for uid %u: %s\n", __PROGRAM_NAME, user->uid, strerror(errno));
+      } else {
+        state.running++;
+      }
+      next_allowed = ((next_allowed > monotonic_ns()) ? next_allowed : monotonic_ns()) + interval_ns;
+    }
+
+    /* sleep until the next kinit is due, the rate allows it or it is time to rescan */
+    wait_ns = (uint64_t)(next_rescan - now) * 1000000000ULL;
+    if (state.queue_next < state.queue_length && state.running < PREFETCH_MAX_CHILDREN) {
+      if (state.queue[state.queue_next]->fire_at > now) {
+        wait_ns = (uint64_t)(state.queue[state.queue_next]->fire_at - now) * 1000000000ULL;
+      } else if (next_allowed > monotonic_ns()) {
+        wait_ns = next_allowed - monotonic_ns();
+      } else {
+        wait_ns = 0;
+      }
+    }
+    timeout.tv_sec = (time_t)(wait_ns / 1000000000ULL);
+    timeout.tv_nsec = (long)(wait_ns % 1000000000ULL);
+
+    signal_number = sigtimedwait(&waited, NULL, &timeout);
+    switch (signal_number) {
+    case SIGCHLD:
+      reap(&state);
+      break;
+    case SIGHUP:
+      next_rescan = 0;
+      break;
+    case SIGTERM:
+    case SIGINT:
+      running = 0;
+      break;
+    default:
+      break;
+    }
+    /* a child may have finished while we were busy */
+    reap(&state);
+  }
+
+  if (ccache_dir_fd >= 0) {
+    (void)close(ccache_dir_fd);
+  }
+  free_state(&state);
+  exit(EXIT_SUCCESS);
+}
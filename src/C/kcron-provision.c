@@ -0,0 +1,510 @@
+/*
+ *
+ * A simple program that pre-creates blank keytabs for many users at once.
+ *
+ * It must be run as root, it is not meant to be SETUID(3p).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-provision"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "kcron_empty_keytab_file.h"
+#include "kcron_filename.h"
+#include "kcron_keytab.h"
+#include "kcron_nss.h"
+
+#ifndef _0600
+#define _0600 S_IRUSR | S_IWUSR
+#endif
+#ifndef _0700
+#define _0700 S_IRWXU
+#endif
+
+#define PROVISION_MAX_THREADS 64
+#define PROVISION_DEFAULT_MIN_UID 1000
+/* -r queues one job per uid, so a typo must not queue billions */
+#define PROVISION_MAX_RANGE 1048576UL
+
+enum provision_result { PROVISION_FAILED = -1, PROVISION_EXISTS = 0, PROVISION_CREATED = 1 };
+
+struct provision_job {
+  uid_t uid;
+  gid_t gid;
+  int has_gid;
+  int result;
+};
+
+struct provision_queue {
+  struct provision_job *jobs;
+  size_t count;
+  size_t allocated;
+  atomic_size_t next;
+  int client_fd;
+  int have_default_gid;
+  gid_t default_gid;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-j threads] [-a [-m min_uid]] [-u uid]... [-r first-last] [-f manifest] [-g gid]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -a          every account NSS enumerates with uid >= min_uid (default %d)\n", PROVISION_DEFAULT_MIN_UID);
+  (void)fprintf(stderr, "  -u uid      this uid, may be repeated\n");
+  (void)fprintf(stderr, "  -r a-b      every uid from a to b, at most %lu of them\n", PROVISION_MAX_RANGE);
+  (void)fprintf(stderr, "  -f file     one 'uid' or 'uid:gid' per line, '-' for stdin\n");
+  (void)fprintf(stderr, "  -g gid      group for uids without a passwd entry\n");
+  (void)fprintf(stderr, "  -j threads  worker threads (default: online CPUs)\n");
+}
+
+/* (uid_t)-1 and (gid_t)-1 mean "no change" to chown(), never a real id */
+static int parse_id(const char *text, unsigned long *id) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_id(const char *text, unsigned long *id) {
+  char *end = NULL;
+  errno = 0;
+  *id = strtoul(text, &end, 10);
+  if (errno != 0 || end == text || *text == '-' || *id >= (unsigned long)(uid_t)-1 || *id >= (unsigned long)(gid_t)-1) {
+    return 1;
+  }
+  return (*end == '\0' || *end == '\n' || *end == ':' || *end == '-') ? 0 : 1;
+}
+
+static int queue_add(struct provision_queue *queue, uid_t uid, const gid_t *gid) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int queue_add(struct provision_queue *queue, uid_t uid, const gid_t *gid) {
+
+  struct provision_job *grown = NULL;
+
+  if (queue->count == queue->allocated) {
+    queue->allocated = (queue->allocated == 0) ? 1024 : queue->allocated * 2;
+    grown = realloc(queue->jobs, queue->allocated * sizeof(struct provision_job));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    queue->jobs = grown;
+  }
+
+  queue->jobs[queue->count].uid = uid;
+  queue->jobs[queue->count].gid = (gid != NULL) ? *gid : 0;
+  queue->jobs[queue->count].has_gid = (gid != NULL) ? 1 : 0;
+  queue->jobs[queue->count].result = PROVISION_FAILED;
+  queue->count++;
+  return 0;
+}
+
+static void queue_resolve(struct provision_queue *queue, const struct kcron_nss_cache *nss) __attribute__((nonnull(1, 2)));
+static void queue_resolve(struct provision_queue *queue, const struct kcron_nss_cache *nss) {
+
+  const struct kcron_nss_user *user = NULL;
+  const struct passwd *pw = NULL;
+  size_t kept = 0;
+
+  for (size_t i = 0; i < queue->count; i++) {
+    if (queue->jobs[i].has_gid == 0) {
+      user = kcron_nss_by_uid(nss, queue->jobs[i].uid);
+      if (user != NULL) {
+        queue->jobs[i].gid = user->gid;
+      } else if ((pw = getpwuid(queue->jobs[i].uid)) != NULL) {
+        /* not every NSS backend enumerates, so ask directly before giving up */
+        queue->jobs[i].gid = pw->pw_gid;
+      } else if (queue->have_default_gid == 1) {
+        queue->jobs[i].gid = queue->default_gid;
+      } else {
+        (void)fprintf(stderr, "%s: uid %u has no passwd entry and no gid was given, skipping.\n", __PROGRAM_NAME, queue->jobs[i].uid);
+        continue;
+      }
+    }
+    queue->jobs[kept++] = queue->jobs[i];
+  }
+  queue->count = kept;
+}
+
+static int queue_manifest(struct provision_queue *queue, const char *manifest) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int queue_manifest(struct provision_queue *queue, const char *manifest) {
+
+  FILE *input = stdin;
+  char line[64] = {0};
+  const char *colon = NULL;
+  unsigned long uid = 0;
+  unsigned long gid = 0;
+  gid_t group = 0;
+  int result = 0;
+
+  if (strcmp(manifest, "-") != 0) {
+    input = fopen(manifest, "re");
+    if (input == NULL) {
+      (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, manifest, strerror(errno));
+      return 1;
+    }
+  }
+
+  while (fgets(line, sizeof(line), input) != NULL) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if (parse_id(line, &uid) != 0) {
+      (void)fprintf(stderr, "%s: Invalid manifest line: %s", __PROGRAM_NAME, line);
+      result = 1;
+      continue;
+    }
+    colon = strchr(line, ':');
+    if (colon != NULL) {
+      if (parse_id(colon + 1, &gid) != 0) {
+        (void)fprintf(stderr, "%s: Invalid manifest line: %s", __PROGRAM_NAME, line);
+        result = 1;
+        continue;
+      }
+      group = (gid_t)gid;
+      result |= queue_add(queue, (uid_t)uid, &group);
+    } else {
+      result |= queue_add(queue, (uid_t)uid, NULL);
+    }
+  }
+
+  if (input != stdin) {
+    (void)fclose(input);
+  }
+  return result;
+}
+
+static int provision_uid_at(int client_fd, uid_t uid, gid_t gid) __attribute__((warn_unused_result));
+static int provision_uid_at(int client_fd, uid_t uid, gid_t gid) {
+
+#if USE_CAPABILITIES == 1
+  const cap_value_t caps[] = {CAP_DAC_OVERRIDE};
+#else
+  const cap_value_t caps[] = {-1};
+#endif
+  const int num_caps = sizeof(caps) / sizeof(cap_value_t);
+
+  struct stat st = {0};
+  char subdir[64] = {0};
+  char keytab_dir[FILE_PATH_MAX_LENGTH] = {0};
+  char keytab[FILE_PATH_MAX_LENGTH] = {0};
+  const char *uid_str = subdir;
+  char *slash = NULL;
+  int parent_fd = client_fd;
+  int dir_fd = -1;
+  int filedescriptor = -1;
+  int open_errno = 0;
+  int named = 0;
+  int rc = 0;
+
+  if (get_client_subdir_for_uid(uid, __CLIENT_KEYTAB_SHARDS, subdir, sizeof(subdir)) != 0) {
+    return PROVISION_FAILED;
+  }
+  (void)snprintf(keytab_dir, sizeof(keytab_dir), "%s/%s", __CLIENT_KEYTAB_DIR, subdir);
+  (void)snprintf(keytab, sizeof(keytab), "%s/%s", keytab_dir, KCRON_KEYTAB_FILENAME);
+
+  /* sharded, so the user directory goes one level down */
+  slash = strchr(subdir, '/');
+  if (slash != NULL) {
+    *slash = '\0';
+    parent_fd = mkshardat_if_missing(client_fd, subdir, keytab_dir);
+    *slash = '/';
+    if (parent_fd < 0) {
+      return PROVISION_FAILED;
+    }
+    uid_str = slash + 1;
+  }
+
+  /* everything is relative to the client keytab directory, so no path walks */
+  dir_fd = mkdirat_if_missing(parent_fd, uid_str, keytab_dir, uid, gid, _0700);
+  if (parent_fd != client_fd) {
+    (void)close(parent_fd);
+  }
+  if (dir_fd < 0) {
+    return PROVISION_FAILED;
+  }
+
+  /* use of CAP_DAC_OVERRIDE, the directory is 0700 and owned by uid */
+  if (enable_capabilities(caps, num_caps) != 0) {
+    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+    (void)close(dir_fd);
+    return PROVISION_FAILED;
+  }
+
+  /* If it exists but has the wrong permissions/owner do nothing, it is safer */
+  if (fstatat(dir_fd, KCRON_KEYTAB_FILENAME, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+    (void)disable_capabilities();
+    (void)close(dir_fd);
+    return PROVISION_EXISTS;
+  }
+
+  /* unnamed until it is complete, like init-kcron-keytab */
+  filedescriptor = kcron_keytab_tmpfile(dir_fd, O_WRONLY);
+  open_errno = errno;
+  if (filedescriptor < 0 && kcron_keytab_tmpfile_unsupported(open_errno) == 1) {
+    filedescriptor = openat_beneath(dir_fd, KCRON_KEYTAB_FILENAME, O_WRONLY | O_CREAT | O_EXCL, _0600);
+    open_errno = errno;
+    named = 1;
+  }
+
+  (void)disable_capabilities();
+
+  if (filedescriptor < 0) {
+    (void)close(dir_fd);
+    if (open_errno == EEXIST) {
+      return PROVISION_EXISTS;
+    }
+    (void)fprintf(stderr, "%s: Unable to create %s: %s\n", __PROGRAM_NAME, keytab, strerror(open_errno));
+    return PROVISION_FAILED;
+  }
+
+  /* durability comes from the one syncfs() once every keytab is written */
+  if (write_empty_keytab_nosync(filedescriptor) != 0 || chown_chmod_keytab(filedescriptor, keytab, uid, gid) != 0) {
+    (void)fprintf(stderr, "%s: Unable to set up keytab for uid %u.\n", __PROGRAM_NAME, uid);
+    (void)close(filedescriptor);
+    (void)close(dir_fd);
+    return PROVISION_FAILED;
+  }
+
+  if (named == 0) {
+    if (enable_capabilities(caps, num_caps) != 0) {
+      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+      (void)close(filedescriptor);
+      (void)close(dir_fd);
+      return PROVISION_FAILED;
+    }
+    /* someone else linking one in first is fine */
+    rc = kcron_keytab_link(filedescriptor, dir_fd, KCRON_KEYTAB_FILENAME);
+    (void)disable_capabilities();
+    if (rc == EEXIST) {
+      (void)close(filedescriptor);
+      (void)close(dir_fd);
+      return PROVISION_EXISTS;
+    }
+    if (rc != 0) {
+      (void)fprintf(stderr, "%s: Cannot link keytab into place : %s: %s.\n", __PROGRAM_NAME, keytab, strerror(rc));
+      (void)close(filedescriptor);
+      (void)close(dir_fd);
+      return PROVISION_FAILED;
+    }
+  }
+
+  (void)close(filedescriptor);
+  (void)close(dir_fd);
+  return PROVISION_CREATED;
+}
+
+static void *provision_worker(void *arg) __attribute__((nonnull(1)));
+static void *provision_worker(void *arg) {
+  struct provision_queue *queue = arg;
+  size_t index = 0;
+
+  while ((index = atomic_fetch_add(&queue->next, 1)) < queue->count) {
+    queue->jobs[index].result = provision_uid_at(queue->client_fd, queue->jobs[index].uid, queue->jobs[index].gid);
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+
+  struct kcron_nss_cache nss = {0};
+  struct provision_queue queue = {0};
+  pthread_t threads[PROVISION_MAX_THREADS];
+
+  const char *range_dash = NULL;
+  unsigned long first = 0;
+  unsigned long last = 0;
+  unsigned long value = 0;
+  unsigned long min_uid = PROVISION_DEFAULT_MIN_UID;
+  long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  long started = 0;
+  int all_users = 0;
+  int need_nss = 0;
+  int opt = 0;
+  int result = 0;
+  size_t created = 0;
+  size_t existing = 0;
+  size_t failed = 0;
+
+  if (geteuid() != 0) {
+    (void)fprintf(stderr, "%s: must be run as root.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  while ((opt = getopt(argc, argv, "am:u:r:f:g:j:h")) != -1) {
+    switch (opt) {
+    case 'a':
+      all_users = 1;
+      break;
+    case 'm':
+      if (parse_id(optarg, &min_uid) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'u':
+      if (parse_id(optarg, &value) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      result |= queue_add(&queue, (uid_t)value, NULL);
+      break;
+    case 'r':
+      range_dash = strchr(optarg, '-');
+      if (range_dash == NULL || parse_id(optarg, &first) != 0 || parse_id(range_dash + 1, &last) != 0 || last < first || last - first >= PROVISION_MAX_RANGE) {
+        (void)fprintf(stderr, "%s: Invalid uid range %s.\n", __PROGRAM_NAME, optarg);
+        exit(EXIT_FAILURE);
+      }
+      for (value = first; value <= last; value++) {
+        result |= queue_add(&queue, (uid_t)value, NULL);
+      }
+      break;
+    case 'f':
+      result |= queue_manifest(&queue, optarg);
+      break;
+    case 'g':
+      if (parse_id(optarg, &value) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      queue.have_default_gid = 1;
+      queue.default_gid = (gid_t)value;
+      break;
+    case 'j':
+      if (parse_id(optarg, &value) != 0 || value == 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      num_threads = (long)value;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* one pass over passwd answers every gid lookup below, if there are any */
+  need_nss = all_users;
+  for (size_t i = 0; i < queue.count && need_nss == 0; i++) {
+    need_nss = (queue.jobs[i].has_gid == 0) ? 1 : 0;
+  }
+  if (need_nss == 1 && kcron_nss_load(&nss) != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  if (all_users == 1) {
+    for (size_t i = 0; i < nss.count; i++) {
+      if (nss.users[i].uid >= min_uid) {
+        result |= queue_add(&queue, nss.users[i].uid, &nss.users[i].gid);
+      }
+    }
+  }
+
+  queue_resolve(&queue, &nss);
+
+  if (queue.count == 0) {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+  if (num_threads > PROVISION_MAX_THREADS) {
+    num_threads = PROVISION_MAX_THREADS;
+  }
+  if ((size_t)num_threads > queue.count) {
+    num_threads = (long)queue.count;
+  }
+
+  queue.client_fd = open(__CLIENT_KEYTAB_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (queue.client_fd < 0) {
+    (void)fprintf(stderr, "%s: Client keytab directory does not exist: %s.\n", __PROGRAM_NAME, __CLIENT_KEYTAB_DIR);
+    exit(EXIT_FAILURE);
+  }
+
+  atomic_init(&queue.next, 0);
+  for (started = 0; started < num_threads; started++) {
+    if (pthread_create(&threads[started], NULL, provision_worker, &queue) != 0) {
+      break;
+    }
+  }
+  if (started == 0) {
+    /* no threads, do the work ourselves */
+    (void)provision_worker(&queue);
+  }
+  for (long i = 0; i < started; i++) {
+    (void)pthread_join(threads[i], NULL);
+  }
+
+  /* one group commit for every keytab rather than an fsync per file */
+  if (syncfs(queue.client_fd) != 0) {
+    (void)fprintf(stderr, "%s: Cannot sync %s: %s\n", __PROGRAM_NAME, __CLIENT_KEYTAB_DIR, strerror(errno));
+    result = 1;
+  }
+  (void)close(queue.client_fd);
+
+  for (size_t i = 0; i < queue.count; i++) {
+    switch (queue.jobs[i].result) {
+    case PROVISION_CREATED:
+      created++;
+      break;
+    case PROVISION_EXISTS:
+      existing++;
+      break;
+    default:
+      failed++;
+      break;
+    }
+  }
+
+  (void)printf("%s: %zu created, %zu already present, %zu failed\n", __PROGRAM_NAME, created, existing, failed);
+
+  (void)free(queue.jobs);
+  kcron_nss_free(&nss);
+
+  if (result != 0 || failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,108 @@
+/*
+ *
+ * Build time helper that compiles our seccomp allowlists into BPF programs,
+ * one per profile, and writes them out as a C header for kcron_seccomp.h to embed.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-seccomp-bpf"
+#endif
+
+#include "autoconf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "kcron_seccomp_rules.h"
+
+#define KCRON_SECCOMP_MAX_INSNS 4096 /* BPF_MAXINSNS */
+
+int main(int argc, char *argv[]) {
+
+  struct sock_filter program[KCRON_SECCOMP_MAX_INSNS];
+  scmp_filter_ctx ctx = NULL;
+  FILE *header = NULL;
+  size_t len = 0;
+
+  if (argc != 2) {
+    (void)fprintf(stderr, "Usage: %s output.h\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  header = fopen(argv[1], "we");
+  if (header == NULL) {
+    (void)fprintf(stderr, "%s: Cannot open %s.\n", __PROGRAM_NAME, argv[1]);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)fprintf(header, "/* Generated by %s from kcron_seccomp_rules.h, do not edit */\n", __PROGRAM_NAME);
+  (void)fprintf(header, "#ifndef KCRON_SECCOMP_BPF_H\n#define KCRON_SECCOMP_BPF_H 1\n\n");
+  (void)fprintf(header, "#include <linux/filter.h>\n\n");
+
+  for (size_t profile = 0; profile < KCRON_SECCOMP_NUM_PROFILES; profile++) {
+    ctx = kcron_seccomp_build_profile(&kcron_seccomp_profiles[profile]);
+    if (ctx == NULL) {
+      (void)fclose(header);
+      (void)remove(argv[1]);
+      exit(EXIT_FAILURE);
+    }
+
+    len = kcron_seccomp_export(ctx, program, KCRON_SECCOMP_MAX_INSNS);
+    (void)seccomp_release(ctx);
+    if (len == 0) {
+      (void)fclose(header);
+      (void)remove(argv[1]);
+      exit(EXIT_FAILURE);
+    }
+
+    (void)fprintf(header, "static const struct sock_filter %s[%zu] = {\n", kcron_seccomp_profiles[profile].name, len);
+    for (size_t i = 0; i < len; i++) {
+      (void)fprintf(header, "    {0x%04x, %u, %u, 0x%08x},\n", program[i].code, program[i].jt, program[i].jf, program[i].k);
+    }
+    (void)fprintf(header, "};\n\n");
+  }
+  (void)fprintf(header, "#endif\n");
+
+  if (fclose(header) != 0) {
+    (void)fprintf(stderr, "%s: Cannot write %s.\n", __PROGRAM_NAME, argv[1]);
+    (void)remove(argv[1]);
+    exit(EXIT_FAILURE);
+  }
+
+  exit(EXIT_SUCCESS);
+}
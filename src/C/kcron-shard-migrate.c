@@ -0,0 +1,375 @@
+/*
+ *
+ * Move keytab directories between the flat and sharded layouts of the
+ * client keytab directory, one RENAME(2) per user so every keytab is
+ * always in exactly one place.
+ *
+ * It must be run as root, it is not meant to be SETUID(3p).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-shard-migrate"
+#endif
+
+#include "autoconf.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "kcron_filename.h"
+
+/* an empty keytab is just the two byte version header */
+#define MIGRATE_EMPTY_KEYTAB_SIZE 2
+
+struct migrate_entry {
+  uid_t uid;
+  char from[32]; /* shard it sits in now, "" for the top level */
+};
+
+struct migrate_list {
+  struct migrate_entry *entries;
+  size_t count;
+  size_t allocated;
+};
+
+struct migrate_totals {
+  size_t moved;
+  size_t in_place;
+  size_t replaced;
+  size_t conflicts;
+  size_t failed;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-n] [-v] [-s shards] [-d dir]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -s shards  layout to move to, 0 for flat (default: %u, as built)\n", __CLIENT_KEYTAB_SHARDS);
+  (void)fprintf(stderr, "  -d dir     client keytab directory (default: %s)\n", __CLIENT_KEYTAB_DIR);
+  (void)fprintf(stderr, "  -n         only print what would move\n");
+  (void)fprintf(stderr, "  -v         print every move\n");
+}
+
+static int parse_uint(const char *text, unsigned long *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_uint(const char *text, unsigned long *value) {
+  char *end = NULL;
+
+  if (*text < '0' || *text > '9') {
+    return 1;
+  }
+  errno = 0;
+  *value = strtoul(text, &end, 10);
+  return (errno != 0 || *end != '\0') ? 1 : 0;
+}
+
+static int list_add(struct migrate_list *list, uid_t uid, const char *from) __attribute__((nonnull(1, 3))) __attribute__((warn_unused_result));
+static int list_add(struct migrate_list *list, uid_t uid, const char *from) {
+
+  struct migrate_entry *grown = NULL;
+
+  if (list->count == list->allocated) {
+    list->allocated = (list->allocated == 0) ? 1024 : list->allocated * 2;
+    grown = realloc(list->entries, list->allocated * sizeof(struct migrate_entry));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    list->entries = grown;
+  }
+
+  list->entries[list->count].uid = uid;
+  (void)snprintf(list->entries[list->count].from, sizeof(list->entries[list->count].from), "%s", from);
+  list->count++;
+  return 0;
+}
+
+/* every numeric directory in dir_fd, read in full before anything moves */
+static int scan_dir(int dir_fd, const char *from, struct migrate_list *list, struct migrate_list *shards) __attribute__((nonnull(2, 3)));
+static int scan_dir(int dir_fd, const char *from, struct migrate_list *list, struct migrate_list *shards) {
+
+  const size_t prefix_len = strlen(KCRON_SHARD_PREFIX);
+  const struct dirent *dirent = NULL;
+  unsigned long value = 0;
+  int result = 0;
+
+  DIR *dir = fdopendir(dir_fd);
+  if (dir == NULL) {
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  while ((dirent = readdir(dir)) != NULL) {
+    if (dirent->d_type != DT_DIR && dirent->d_type != DT_UNKNOWN) {
+      continue;
+    }
+    if (parse_uint(dirent->d_name, &value) == 0 && value <= (uid_t)-1) {
+      result |= list_add(list, (uid_t)value, from);
+    } else if (shards != NULL && strncmp(dirent->d_name, KCRON_SHARD_PREFIX, prefix_len) == 0 && parse_uint(dirent->d_name + prefix_len, &value) == 0) {
+      result |= list_add(shards, (uid_t)value, dirent->d_name);
+    }
+  }
+
+  (void)closedir(dir);
+  return result;
+}
+
+static int open_parent(int client_fd, const char *shard, int create) __attribute__((nonnull(2))) __attribute__((warn_unused_result));
+static int open_parent(int client_fd, const char *shard, int create) {
+
+  struct stat st = {0};
+  int shard_fd = -1;
+
+  if (shard[0] == '\0') {
+    return dup(client_fd);
+  }
+
+  if (create == 1 && mkdirat(client_fd, shard, KCRON_SHARD_MODE) == 0) {
+    /* like init-kcron-keytab, owner from the client dir and no umask */
+    shard_fd = openat(client_fd, shard, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (shard_fd < 0 || fstat(client_fd, &st) != 0 || fchmod(shard_fd, KCRON_SHARD_MODE) != 0 || fchown(shard_fd, st.st_uid, st.st_gid) != 0) {
+      (void)fprintf(stderr, "%s: Unable to set up shard %s: %s\n", __PROGRAM_NAME, shard, strerror(errno));
+      if (shard_fd >= 0) {
+        (void)close(shard_fd);
+      }
+      return -1;
+    }
+    return shard_fd;
+  }
+
+  shard_fd = openat(client_fd, shard, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (shard_fd < 0) {
+    (void)fprintf(stderr, "%s: Unable to open shard %s: %s\n", __PROGRAM_NAME, shard, strerror(errno));
+  }
+  return shard_fd;
+}
+
+static off_t keytab_size_at(int parent_fd, const char *uid_str) __attribute__((nonnull(2)));
+static off_t keytab_size_at(int parent_fd, const char *uid_str) {
+
+  char name[FILE_PATH_MAX_LENGTH] = {0};
+  struct stat st = {0};
+
+  (void)snprintf(name, sizeof(name), "%s/%s", uid_str, KCRON_KEYTAB_FILENAME);
+  if (fstatat(parent_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) {
+    return -1;
+  }
+  return st.st_size;
+}
+
+/*
+ * Someone ran a new init-kcron-keytab before we got to them, so there is
+ * a blank keytab where theirs should go.  Swap the two and drop the blank.
+ */
+static int replace_blank(int from_fd, int to_fd, const char *uid_str) __attribute__((nonnull(3))) __attribute__((warn_unused_result));
+static int replace_blank(int from_fd, int to_fd, const char *uid_str) {
+
+  char name[FILE_PATH_MAX_LENGTH] = {0};
+
+  if (keytab_size_at(to_fd, uid_str) != MIGRATE_EMPTY_KEYTAB_SIZE || keytab_size_at(from_fd, uid_str) <= MIGRATE_EMPTY_KEYTAB_SIZE) {
+    return 1;
+  }
+
+  if (syscall(SYS_renameat2, from_fd, uid_str, to_fd, uid_str, RENAME_EXCHANGE) != 0) {
+    return 1;
+  }
+
+  (void)snprintf(name, sizeof(name), "%s/%s", uid_str, KCRON_KEYTAB_FILENAME);
+  if (unlinkat(from_fd, name, 0) != 0 || unlinkat(from_fd, uid_str, AT_REMOVEDIR) != 0) {
+    (void)fprintf(stderr, "%s: Left the displaced blank keytab in place for uid %s: %s\n", __PROGRAM_NAME, uid_str, strerror(errno));
+  }
+  return 0;
+}
+
+static void migrate_one(int client_fd, const struct migrate_entry *entry, unsigned int shards, int dry_run, int verbose, struct migrate_totals *totals)
+    __attribute__((nonnull(2, 6)));
+static void migrate_one(int client_fd, const struct migrate_entry *entry, unsigned int shards, int dry_run, int verbose, struct migrate_totals *totals) {
+
+  char target[64] = {0};
+  char to[32] = {0};
+  char uid_str[32] = {0};
+  const char *slash = NULL;
+  int from_fd = -1;
+  int to_fd = -1;
+
+  (void)snprintf(uid_str, sizeof(uid_str), "%u", entry->uid);
+  if (get_client_subdir_for_uid(entry->uid, shards, target, sizeof(target)) != 0) {
+    totals->failed++;
+    return;
+  }
+  slash = strchr(target, '/');
+  if (slash != NULL) {
+    (void)snprintf(to, sizeof(to), "%.*s", (int)(slash - target), target);
+  }
+
+  if (strcmp(entry->from, to) == 0) {
+    totals->in_place++;
+    return;
+  }
+
+  if (dry_run == 1 || verbose == 1) {
+    (void)printf("%s%s%s -> %s\n", entry->from, entry->from[0] == '\0' ? "" : "/", uid_str, target);
+  }
+  if (dry_run == 1) {
+    totals->moved++;
+    return;
+  }
+
+  from_fd = open_parent(client_fd, entry->from, 0);
+  to_fd = open_parent(client_fd, to, 1);
+  if (from_fd < 0 || to_fd < 0) {
+    totals->failed++;
+  } else if (syscall(SYS_renameat2, from_fd, uid_str, to_fd, uid_str, RENAME_NOREPLACE) == 0) {
+    totals->moved++;
+  } else if (errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Unable to move uid %s to %s: %s\n", __PROGRAM_NAME, uid_str, target, strerror(errno));
+    totals->failed++;
+  } else if (replace_blank(from_fd, to_fd, uid_str) == 0) {
+    totals->replaced++;
+  } else {
+    (void)fprintf(stderr, "%s: uid %s already has a keytab directory at %s, leaving both.\n", __PROGRAM_NAME, uid_str, target);
+    totals->conflicts++;
+  }
+
+  if (from_fd >= 0) {
+    (void)close(from_fd);
+  }
+  if (to_fd >= 0) {
+    (void)close(to_fd);
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  struct migrate_list users = {0};
+  struct migrate_list shard_dirs = {0};
+  struct migrate_totals totals = {0};
+
+  const char *client_dir = __CLIENT_KEYTAB_DIR;
+  unsigned long shards = __CLIENT_KEYTAB_SHARDS;
+  int dry_run = 0;
+  int verbose = 0;
+  int client_fd = -1;
+  int shard_fd = -1;
+  int opt = 0;
+  int result = 0;
+
+  while ((opt = getopt(argc, argv, "s:d:nvh")) != -1) {
+    switch (opt) {
+    case 's':
+      if (parse_uint(optarg, &shards) != 0 || shards > 65536) {
+        (void)fprintf(stderr, "%s: invalid shard count '%s'\n", __PROGRAM_NAME, optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'd':
+      client_dir = optarg;
+      break;
+    case 'n':
+      dry_run = 1;
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (geteuid() != 0) {
+    (void)fprintf(stderr, "%s: must be run as root.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  client_fd = open(client_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (client_fd < 0) {
+    (void)fprintf(stderr, "%s: Client keytab directory does not exist: %s.\n", __PROGRAM_NAME, client_dir);
+    exit(EXIT_FAILURE);
+  }
+
+  /* the whole list first, so nothing we move gets read twice */
+  if (scan_dir(dup(client_fd), "", &users, &shard_dirs) != 0) {
+    (void)fprintf(stderr, "%s: Cannot read %s.\n", __PROGRAM_NAME, client_dir);
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < shard_dirs.count; i++) {
+    shard_fd = openat(client_fd, shard_dirs.entries[i].from, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (shard_fd < 0 || scan_dir(shard_fd, shard_dirs.entries[i].from, &users, NULL) != 0) {
+      (void)fprintf(stderr, "%s: Cannot read %s/%s.\n", __PROGRAM_NAME, client_dir, shard_dirs.entries[i].from);
+      result = 1;
+    }
+  }
+
+  for (size_t i = 0; i < users.count; i++) {
+    migrate_one(client_fd, &users.entries[i], (unsigned int)shards, dry_run, verbose, &totals);
+  }
+
+  /* shards the new layout no longer uses go once they are empty */
+  if (dry_run == 0) {
+    for (size_t i = 0; i < shard_dirs.count; i++) {
+      if ((shards == 0 || shard_dirs.entries[i].uid >= shards) && unlinkat(client_fd, shard_dirs.entries[i].from, AT_REMOVEDIR) != 0 && errno != ENOTEMPTY) {
+        (void)fprintf(stderr, "%s: Unable to remove %s/%s: %s\n", __PROGRAM_NAME, client_dir, shard_dirs.entries[i].from, strerror(errno));
+      }
+    }
+
+    if (syncfs(client_fd) != 0) {
+      (void)fprintf(stderr, "%s: Cannot sync %s: %s\n", __PROGRAM_NAME, client_dir, strerror(errno));
+      result = 1;
+    }
+  }
+  (void)close(client_fd);
+
+  (void)printf("%s: %zu %s, %zu already in place, %zu blank replaced, %zu conflicts, %zu failed\n", __PROGRAM_NAME, totals.moved, dry_run == 1 ? "to move" : "moved",
+               totals.in_place, totals.replaced, totals.conflicts, totals.failed);
+
+  (void)free(users.entries);
+  (void)free(shard_dirs.entries);
+
+  if (result != 0 || totals.conflicts != 0 || totals.failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,257 @@
+/*
+ *
+ * Get a copy of the TGT kcron-ticketd holds for us.
+ *
+ * With a command, it is run with KRB5CCNAME pointing at a private
+ * in-memory ccache its children inherit.  Without one, the ticket is
+ * written to the FILE ccache from -c or KRB5CCNAME.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-ticket"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "kcron_ticketd.h"
+
+#define TICKET_CCACHE_MAX_SIZE (64 * 1024)
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-c ccache] [command [args...]]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -c ccache  write the ticket to this FILE ccache (default: KRB5CCNAME or /tmp/krb5cc_<uid>)\n");
+  (void)fprintf(stderr, "  command    run it with the ticket in a private in-memory ccache\n");
+}
+
+/* returns the ccache memfd, or -1 */
+static int request_ticket(void) __attribute__((warn_unused_result));
+static int request_ticket(void) {
+
+  struct sockaddr_un addr = {0};
+  char text[TICKETD_REPLY_MAX_LENGTH + 1] = {0};
+  union {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = {.iov_base = text, .iov_len = TICKETD_REPLY_MAX_LENGTH};
+  struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)};
+  struct cmsghdr *cmsg = NULL;
+  ssize_t received = 0;
+  int ccache_fd = -1;
+
+  if (ticketd_sockaddr(&addr) != 0) {
+    return -1;
+  }
+
+  const int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    (void)fprintf(stderr, "%s: Cannot create socket: %s\n", __PROGRAM_NAME, strerror(errno));
+    return -1;
+  }
+
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot connect to %s: %s\n", __PROGRAM_NAME, addr.sun_path, strerror(errno));
+    (void)close(sock);
+    return -1;
+  }
+
+  if (send(sock, TICKETD_REQUEST, strlen(TICKETD_REQUEST), MSG_NOSIGNAL) < 0) {
+    (void)fprintf(stderr, "%s: Cannot send request: %s\n", __PROGRAM_NAME, strerror(errno));
+    (void)close(sock);
+    return -1;
+  }
+
+  (void)memset(&control, 0, sizeof(control));
+  received = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  (void)close(sock);
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+      (void)memcpy(&ccache_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+
+  if (received < 3 || (text[0] != '0' && text[0] != '1') || text[1] != ' ' || (text[0] == '0' && ccache_fd < 0)) {
+    (void)fprintf(stderr, "%s: No valid reply from %s.\n", __PROGRAM_NAME, addr.sun_path);
+    if (ccache_fd >= 0) {
+      (void)close(ccache_fd);
+    }
+    return -1;
+  }
+
+  text[received] = '\0';
+  if (text[0] != '0') {
+    (void)fprintf(stderr, "%s: %s\n", __PROGRAM_NAME, text + 2);
+    if (ccache_fd >= 0) {
+      (void)close(ccache_fd);
+    }
+    return -1;
+  }
+  return ccache_fd;
+}
+
+/* the shared copy is sealed, everyone gets their own to add service tickets to */
+static int copy_ccache(int from, int to) __attribute__((warn_unused_result));
+static int copy_ccache(int from, int to) {
+
+  struct stat st = {0};
+
+  if (fstat(from, &st) != 0 || st.st_size <= 0 || st.st_size > TICKET_CCACHE_MAX_SIZE) {
+    return 1;
+  }
+
+  unsigned char *data = malloc((size_t)st.st_size);
+  if (data == NULL) {
+    return 1;
+  }
+  if (pread(from, data, (size_t)st.st_size, 0) != st.st_size || write(to, data, (size_t)st.st_size) != st.st_size) {
+    (void)free(data);
+    return 1;
+  }
+  (void)free(data);
+  return 0;
+}
+
+/* replaced in one rename, so a running job never sees half a ccache */
+static int write_ccache(int ccache_fd, const char *name) __attribute__((nonnull(2))) __attribute__((warn_unused_result));
+static int write_ccache(int ccache_fd, const char *name) {
+
+  char temporary[FILE_PATH_MAX_LENGTH] = {0};
+  const char *path = name;
+
+  if (strncmp(name, "FILE:", strlen("FILE:")) == 0) {
+    path = name + strlen("FILE:");
+  } else if (strchr(name, ':') != NULL && name[0] != '/') {
+    (void)fprintf(stderr, "%s: Only FILE ccaches can be written, not %s.\n", __PROGRAM_NAME, name);
+    return 1;
+  }
+
+  if (snprintf(temporary, sizeof(temporary), "%s.XXXXXX", path) >= (int)sizeof(temporary)) {
+    (void)fprintf(stderr, "%s: %s is too long.\n", __PROGRAM_NAME, path);
+    return 1;
+  }
+
+  const int fd = mkostemp(temporary, O_CLOEXEC);
+  if (fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot create %s: %s\n", __PROGRAM_NAME, temporary, strerror(errno));
+    return 1;
+  }
+  if (copy_ccache(ccache_fd, fd) != 0 || close(fd) != 0 || rename(temporary, path) != 0) {
+    (void)fprintf(stderr, "%s: Cannot write %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    (void)unlink(temporary);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+  char name[FILE_PATH_MAX_LENGTH] = {0};
+  const char *ccache = NULL;
+  int opt = 0;
+
+  /* options stop at the command, its own options are its business */
+  while ((opt = getopt(argc, argv, "+c:h")) != -1) {
+    switch (opt) {
+    case 'c':
+      ccache = optarg;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (ccache != NULL && optind < argc) {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+
+  const int shared_fd = request_ticket();
+  if (shared_fd < 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  if (optind < argc) {
+    /* no MFD_CLOEXEC, the command and its children all use this one */
+    const int private_fd = memfd_create("krb5cc", 0);
+    if (private_fd < 0 || copy_ccache(shared_fd, private_fd) != 0) {
+      (void)fprintf(stderr, "%s: Cannot copy the ticket: %s\n", __PROGRAM_NAME, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    (void)close(shared_fd);
+
+    (void)snprintf(name, sizeof(name), "FILE:/proc/self/fd/%d", private_fd);
+    if (setenv("KRB5CCNAME", name, 1) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set KRB5CCNAME.\n", __PROGRAM_NAME);
+      exit(EXIT_FAILURE);
+    }
+    (void)execvp(argv[optind], argv + optind);
+    (void)fprintf(stderr, "%s: Cannot run %s: %s\n", __PROGRAM_NAME, argv[optind], strerror(errno));
+    exit(127);
+  }
+
+  if (ccache == NULL) {
+    ccache = getenv("KRB5CCNAME");
+  }
+  if (ccache == NULL) {
+    (void)snprintf(name, sizeof(name), "FILE:/tmp/krb5cc_%u", getuid());
+    ccache = name;
+  }
+
+  if (write_ccache(shared_fd, ccache) != 0) {
+    (void)close(shared_fd);
+    exit(EXIT_FAILURE);
+  }
+  (void)close(shared_fd);
+  exit(EXIT_SUCCESS);
+}
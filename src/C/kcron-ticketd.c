@@ -0,0 +1,641 @@
+/*
+ *
+ * Hand each local user one shared TGT from their kcron keytab.
+ *
+ * When many jobs of one user start together they would each read the
+ * keytab and ask the KDC for their own ticket.  Here the first request
+ * for a uid runs kinit, later requests for that uid wait on the same
+ * kinit, and everyone gets a copy of the resulting ccache.
+ *
+ * It is meant to be started from kcron-ticketd.socket, not SETUID(3p).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-ticketd"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_ccache.h"
+#include "kcron_filename.h"
+#include "kcron_keytab_parse.h"
+#include "kcron_listen.h"
+#include "kcron_ticketd.h"
+#include "kcron_tgt.h"
+
+#define TICKETD_CCACHE_NAME "tgt"
+#define TICKETD_CCACHE_MAX_SIZE (64 * 1024)
+#define TICKETD_KINIT_TIMEOUT 30
+
+/* wake up this often to let go of expired tickets */
+#define TICKETD_SWEEP_MS 60000
+
+/* connections still to send their request, each gets this long to do it */
+#define TICKETD_PENDING_MAX 64
+#define TICKETD_REQUEST_TIMEOUT_MS 1000
+
+struct ticketd_options {
+  unsigned int margin;  /* a ticket with less than this left is renewed */
+  unsigned int backoff; /* after a failed kinit, fail requests this long */
+};
+
+struct ticketd_user {
+  uid_t uid;
+  gid_t gid;
+  int ccache_fd; /* sealed memfd, -1 for none */
+  uint32_t endtime;
+  time_t failed_at;
+  pid_t child;
+  int *waiters;
+  size_t num_waiters;
+  size_t allocated_waiters;
+};
+
+struct ticketd_pending {
+  int fd;
+  uid_t uid;
+  gid_t gid;
+  struct timespec accepted;
+};
+
+struct ticketd_state {
+  struct ticketd_user *users;
+  size_t num_users;
+  size_t allocated_users;
+  int ccache_dir_fd;
+  struct ticketd_pending pending[TICKETD_PENDING_MAX];
+  size_t num_pending;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s [-m margin] [-b backoff]\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -m seconds  get a new TGT once the one we have has less than this left (default 1800)\n");
+  (void)fprintf(stderr, "  -b seconds  after kinit fails for a user, refuse them this long (default 30)\n");
+}
+
+static int parse_seconds(const char *text, unsigned int *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int parse_seconds(const char *text, unsigned int *value) {
+  char *end = NULL;
+  unsigned long number = 0;
+
+  errno = 0;
+  number = strtoul(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || *text == '-' || number > 86400) {
+    return 1;
+  }
+  *value = (unsigned int)number;
+  return 0;
+}
+
+static void harden_service(void) __attribute__((flatten));
+static void harden_service(void) {
+  if (freopen("/dev/null", "r", stdin) == NULL) {
+    (void)fprintf(stderr, "%s: Cannot reset stdin to /dev/null.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  /* we hold everyone's tickets */
+  if (prctl(PR_SET_DUMPABLE, 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot disable core dumps.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set no_new_privs.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)umask(077);
+}
+
+/* few users per node ask, a linear search is plenty */
+static struct ticketd_user *get_user(struct ticketd_state *state, uid_t uid, gid_t gid) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static struct ticketd_user *get_user(struct ticketd_state *state, uid_t uid, gid_t gid) {
+
+  struct ticketd_user *grown = NULL;
+  struct ticketd_user *user = NULL;
+
+  for (size_t i = 0; i < state->num_users; i++) {
+    if (state->users[i].uid == uid) {
+      return &state->users[i];
+    }
+  }
+
+  if (state->num_users == state->allocated_users) {
+    state->allocated_users = (state->allocated_users == 0) ? 64 : state->allocated_users * 2;
+    grown = realloc(state->users, state->allocated_users * sizeof(struct ticketd_user));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return NULL;
+    }
+    state->users = grown;
+  }
+
+  user = &state->users[state->num_users++];
+  (void)memset(user, 0, sizeof(*user));
+  user->uid = uid;
+  user->gid = gid;
+  user->ccache_fd = -1;
+  return user;
+}
+
+static void reply(int fd, uid_t uid, const char *text, int ccache_fd) __attribute__((nonnull(3)));
+static void reply(int fd, uid_t uid, const char *text, int ccache_fd) {
+
+  union {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = {.iov_base = (void *)text, .iov_len = strlen(text)};
+  struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+  struct cmsghdr *cmsg = NULL;
+
+  if (ccache_fd >= 0) {
+    (void)memset(&control, 0, sizeof(control));
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    (void)memcpy(CMSG_DATA(cmsg), &ccache_fd, sizeof(int));
+  }
+
+  if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+    (void)fprintf(stderr, "%s: Cannot reply to uid %u: %s\n", __PROGRAM_NAME, uid, strerror(errno));
+  }
+  (void)close(fd);
+}
+
+static void reply_ticket(int fd, const struct ticketd_user *user) __attribute__((nonnull(2)));
+static void reply_ticket(int fd, const struct ticketd_user *user) {
+  char text[TICKETD_REPLY_MAX_LENGTH] = {0};
+  (void)snprintf(text, sizeof(text), "0 %u", user->endtime);
+  reply(fd, user->uid, text, user->ccache_fd);
+}
+
+static void reply_waiters(struct ticketd_user *user, int success) __attribute__((nonnull(1)));
+static void reply_waiters(struct ticketd_user *user, int success) {
+  for (size_t i = 0; i < user->num_waiters; i++) {
+    if (success == 1) {
+      reply_ticket(user->waiters[i], user);
+    } else {
+      reply(user->waiters[i], user->uid, "1 Cannot get a ticket from your kcron keytab, see the " __PROGRAM_NAME " journal", -1);
+    }
+  }
+  user->num_waiters = 0;
+}
+
+static int add_waiter(struct ticketd_user *user, int fd) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int add_waiter(struct ticketd_user *user, int fd) {
+
+  int *grown = NULL;
+
+  if (user->num_waiters == user->allocated_waiters) {
+    user->allocated_waiters = (user->allocated_waiters == 0) ? 16 : user->allocated_waiters * 2;
+    grown = realloc(user->waiters, user->allocated_waiters * sizeof(int));
+    if (grown == NULL) {
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    user->waiters = grown;
+  }
+  user->waiters[user->num_waiters++] = fd;
+  return 0;
+}
+
+/* kinit runs as the user, so it writes into a directory they own under ours */
+static int start_kinit(struct ticketd_state *state, struct ticketd_user *user) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int start_kinit(struct ticketd_state *state, struct ticketd_user *user) {
+
+  char keytab[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char keytab_dirname[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char keytab_filename[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char principal[512] = {0};
+  char subdir[32] = {0};
+  char ccache[FILE_PATH_MAX_LENGTH] = {0};
+  struct stat st = {0};
+
+  if (get_filenames_for_uid(user->uid, keytab_dirname, keytab_filename, keytab) != 0) {
+    (void)fprintf(stderr, "%s: Cannot determine keytab filename for uid %u.\n", __PROGRAM_NAME, user->uid);
+    return 1;
+  }
+  if (kcron_keytab_first_principal_at(AT_FDCWD, keytab, principal, sizeof(principal)) != 0) {
+    (void)fprintf(stderr, "%s: No usable keys in %s for uid %u.\n", __PROGRAM_NAME, keytab, user->uid);
+    return 1;
+  }
+
+  (void)snprintf(subdir, sizeof(subdir), "%u", user->uid);
+  if (mkdirat(state->ccache_dir_fd, subdir, S_IRWXU) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s/%s: %s\n", __PROGRAM_NAME, __TICKETD_CCACHE_DIR, subdir, strerror(errno));
+    return 1;
+  }
+  /* only we can make entries in here, so this is the one we made */
+  if (fstatat(state->ccache_dir_fd, subdir, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode) ||
+      ((st.st_uid != user->uid || st.st_gid != user->gid) && fchownat(state->ccache_dir_fd, subdir, user->uid, user->gid, AT_SYMLINK_NOFOLLOW) != 0)) {
+    (void)fprintf(stderr, "%s: Cannot give %s/%s to uid %u.\n", __PROGRAM_NAME, __TICKETD_CCACHE_DIR, subdir, user->uid);
+    return 1;
+  }
+
+  (void)snprintf(ccache, sizeof(ccache), "FILE:%s/%s/%s", __TICKETD_CCACHE_DIR, subdir, TICKETD_CCACHE_NAME);
+  user->child = kcron_tgt_acquire(__KINIT_PATH, user->uid, user->gid, keytab, principal, ccache, TICKETD_KINIT_TIMEOUT);
+  if (user->child < 0) {
+    user->child = 0;
+    (void)fprintf(stderr, "%s: Cannot fork for uid %u: %s\n", __PROGRAM_NAME, user->uid, strerror(errno));
+    return 1;
+  }
+  return 0;
+}
+
+/* copy the ccache kinit wrote into a sealed memfd every client can share */
+static int load_ccache(struct ticketd_state *state, struct ticketd_user *user) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int load_ccache(struct ticketd_state *state, struct ticketd_user *user) {
+
+  char path[64] = {0};
+  struct stat st = {0};
+  unsigned char *data = NULL;
+  uint32_t endtime = 0;
+  ssize_t got = 0;
+  int memfd = -1;
+
+  (void)snprintf(path, sizeof(path), "%u/%s", user->uid, TICKETD_CCACHE_NAME);
+
+  /* the user owns this, so expect anything: a fifo, a link, a huge file */
+  const int fd = openat(state->ccache_dir_fd, path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+  if (fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open the ccache for uid %u: %s\n", __PROGRAM_NAME, user->uid, strerror(errno));
+    return 1;
+  }
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != user->uid || st.st_size <= 0 || st.st_size > TICKETD_CCACHE_MAX_SIZE) {
+    (void)fprintf(stderr, "%s: The ccache for uid %u is not what kinit writes.\n", __PROGRAM_NAME, user->uid);
+    (void)close(fd);
+    return 1;
+  }
+
+  data = malloc((size_t)st.st_size);
+  if (data == NULL) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    (void)close(fd);
+    return 1;
+  }
+  got = pread(fd, data, (size_t)st.st_size, 0);
+  (void)close(fd);
+
+  if (got != (ssize_t)st.st_size || kcron_ccache_tgt_endtime(data, (size_t)got, &endtime) != 0) {
+    (void)fprintf(stderr, "%s: No TGT in the ccache for uid %u.\n", __PROGRAM_NAME, user->uid);
+    (void)free(data);
+    return 1;
+  }
+
+  memfd = memfd_create("kcron-tgt", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0 || write(memfd, data, (size_t)got) != got || fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+    (void)fprintf(stderr, "%s: Cannot copy the ccache for uid %u: %s\n", __PROGRAM_NAME, user->uid, strerror(errno));
+    if (memfd >= 0) {
+      (void)close(memfd);
+    }
+    (void)free(data);
+    return 1;
+  }
+  (void)free(data);
+
+  if (user->ccache_fd >= 0) {
+    (void)close(user->ccache_fd);
+  }
+  user->ccache_fd = memfd;
+  user->endtime = endtime;
+  return 0;
+}
+
+static void handle_request(struct ticketd_state *state, const struct ticketd_options *options, int fd, uid_t uid, gid_t gid) __attribute__((nonnull(1, 2)));
+static void handle_request(struct ticketd_state *state, const struct ticketd_options *options, int fd, uid_t uid, gid_t gid) {
+
+  const time_t now = time(NULL);
+  struct ticketd_user *user = get_user(state, uid, gid);
+
+  if (user == NULL) {
+    reply(fd, uid, "1 Out of memory", -1);
+    return;
+  }
+
+  if (user->ccache_fd >= 0 && (time_t)user->endtime - now >= (time_t)options->margin) {
+    reply_ticket(fd, user);
+    return;
+  }
+
+  /* someone else already asked, share their kinit */
+  if (user->child > 0) {
+    if (add_waiter(user, fd) != 0) {
+      reply(fd, uid, "1 Out of memory", -1);
+    }
+    return;
+  }
+
+  if (user->failed_at != 0 && now - user->failed_at < (time_t)options->backoff) {
+    reply(fd, uid, "1 Your last kinit failed, try again shortly", -1);
+    return;
+  }
+
+  user->gid = gid;
+  if (start_kinit(state, user) != 0) {
+    user->failed_at = now;
+    reply(fd, uid, "1 Cannot get a ticket from your kcron keytab, see the " __PROGRAM_NAME " journal", -1);
+    return;
+  }
+  if (add_waiter(user, fd) != 0) {
+    reply(fd, uid, "1 Out of memory", -1);
+  }
+}
+
+static long elapsed_ms(const struct timespec *start) __attribute__((nonnull(1)));
+static long elapsed_ms(const struct timespec *start) {
+  struct timespec now = {0};
+  (void)clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long)(now.tv_sec - start->tv_sec) * 1000L + (long)(now.tv_nsec - start->tv_nsec) / 1000000L;
+}
+
+/* returns 1 once the request is handled or dropped, 0 if the client is not done yet */
+static int read_request(struct ticketd_state *state, const struct ticketd_options *options, const struct ticketd_pending *pending) __attribute__((nonnull(1, 2, 3)))
+__attribute__((warn_unused_result));
+static int read_request(struct ticketd_state *state, const struct ticketd_options *options, const struct ticketd_pending *pending) {
+
+  char request[sizeof(TICKETD_REQUEST)] = {0};
+  const ssize_t received = recv(pending->fd, request, sizeof(request), MSG_DONTWAIT);
+
+  if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return 0;
+  }
+  if (received != (ssize_t)strlen(TICKETD_REQUEST) || memcmp(request, TICKETD_REQUEST, strlen(TICKETD_REQUEST)) != 0) {
+    (void)fprintf(stderr, "%s: Invalid request from uid %u, dropping connection.\n", __PROGRAM_NAME, pending->uid);
+    (void)close(pending->fd);
+    return 1;
+  }
+
+  handle_request(state, options, pending->fd, pending->uid, pending->gid);
+  return 1;
+}
+
+/*
+ * Only accepts, the requests are read from the main poll loop so a client
+ * that connects but never asks holds up nobody else.  While every pending
+ * slot is taken new connections wait in the listen backlog.
+ */
+static void accept_requests(struct ticketd_state *state, const struct ticketd_options *options, int listen_fd) __attribute__((nonnull(1, 2)));
+static void accept_requests(struct ticketd_state *state, const struct ticketd_options *options, int listen_fd) {
+
+  struct ticketd_pending *pending = NULL;
+  int fd = -1;
+
+  struct ucred peer = {0};
+  socklen_t peer_len = sizeof(peer);
+
+  while (state->num_pending < TICKETD_PENDING_MAX) {
+    fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (fd < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) && (errno != ECONNABORTED)) {
+        (void)fprintf(stderr, "%s: Cannot accept connection: %s\n", __PROGRAM_NAME, strerror(errno));
+      }
+      return;
+    }
+
+    peer_len = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) != 0 || peer_len != sizeof(peer)) {
+      (void)fprintf(stderr, "%s: Cannot identify peer, dropping connection.\n", __PROGRAM_NAME);
+      (void)close(fd);
+      continue;
+    }
+
+    pending = &state->pending[state->num_pending];
+    pending->fd = fd;
+    pending->uid = peer.uid;
+    pending->gid = peer.gid;
+    (void)clock_gettime(CLOCK_MONOTONIC, &pending->accepted);
+
+    /* most clients have asked by the time we accept them */
+    if (read_request(state, options, pending) == 0) {
+      state->num_pending++;
+    }
+  }
+}
+
+/* reads whatever the pending connections sent, drops those out of time */
+static void read_pending(struct ticketd_state *state, const struct ticketd_options *options, const struct pollfd *fds) __attribute__((nonnull(1, 2, 3)));
+static void read_pending(struct ticketd_state *state, const struct ticketd_options *options, const struct pollfd *fds) {
+
+  size_t kept = 0;
+
+  for (size_t i = 0; i < state->num_pending; i++) {
+    if (fds[i].revents != 0 && read_request(state, options, &state->pending[i]) == 1) {
+      continue;
+    }
+    if (elapsed_ms(&state->pending[i].accepted) >= TICKETD_REQUEST_TIMEOUT_MS) {
+      (void)fprintf(stderr, "%s: No request in time from uid %u, dropping connection.\n", __PROGRAM_NAME, state->pending[i].uid);
+      (void)close(state->pending[i].fd);
+      continue;
+    }
+    state->pending[kept++] = state->pending[i];
+  }
+  state->num_pending = kept;
+}
+
+/* until the oldest pending connection runs out of time, or the next sweep */
+static int poll_timeout(const struct ticketd_state *state) __attribute__((nonnull(1)));
+static int poll_timeout(const struct ticketd_state *state) {
+  long remaining = 0;
+
+  if (state->num_pending == 0) {
+    return TICKETD_SWEEP_MS;
+  }
+  remaining = TICKETD_REQUEST_TIMEOUT_MS - elapsed_ms(&state->pending[0].accepted);
+  return (remaining > 0) ? (int)remaining : 0;
+}
+
+static void reap(struct ticketd_state *state) __attribute__((nonnull(1)));
+static void reap(struct ticketd_state *state) {
+
+  int status = 0;
+  pid_t child = 0;
+
+  while ((child = waitpid(-1, &status, WNOHANG)) > 0) {
+    for (size_t i = 0; i < state->num_users; i++) {
+      struct ticketd_user *user = &state->users[i];
+      if (user->child != child) {
+        continue;
+      }
+      user->child = 0;
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && load_ccache(state, user) == 0) {
+        user->failed_at = 0;
+        reply_waiters(user, 1);
+      } else {
+        (void)fprintf(stderr, "%s: kinit for uid %u failed.\n", __PROGRAM_NAME, user->uid);
+        user->failed_at = time(NULL);
+        reply_waiters(user, 0);
+      }
+      break;
+    }
+  }
+}
+
+/* nobody should get a copy of an expired ticket, and it need not sit in memory */
+static void sweep(struct ticketd_state *state) __attribute__((nonnull(1)));
+static void sweep(struct ticketd_state *state) {
+  const time_t now = time(NULL);
+  for (size_t i = 0; i < state->num_users; i++) {
+    if (state->users[i].ccache_fd >= 0 && (time_t)state->users[i].endtime <= now) {
+      (void)close(state->users[i].ccache_fd);
+      state->users[i].ccache_fd = -1;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  struct ticketd_options options = {.margin = 1800, .backoff = 30};
+  struct ticketd_state state = {0};
+  struct pollfd fds[2 + TICKETD_PENDING_MAX] = {0};
+  struct signalfd_siginfo info = {0};
+  sigset_t children;
+  time_t last_sweep = time(NULL);
+  int opt = 0;
+  int ready = 0;
+
+  while ((opt = getopt(argc, argv, "m:b:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      if (parse_seconds(optarg, &options.margin) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'b':
+      if (parse_seconds(optarg, &options.backoff) != 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  const int listen_fd = get_listen_fd();
+  if (listen_fd < 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  (void)harden_service();
+
+  state.ccache_dir_fd = open(__TICKETD_CCACHE_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (state.ccache_dir_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, __TICKETD_CCACHE_DIR, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  if (fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK) != 0) {
+    (void)fprintf(stderr, "%s: Cannot make socket non-blocking.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)sigemptyset(&children);
+  (void)sigaddset(&children, SIGCHLD);
+  (void)sigprocmask(SIG_BLOCK, &children, NULL);
+  const int child_fd = signalfd(-1, &children, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (child_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot watch for kinit to finish: %s\n", __PROGRAM_NAME, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  fds[0].fd = listen_fd;
+  fds[1].fd = child_fd;
+  fds[1].events = POLLIN;
+
+  /* unlike kcron-keytabd we stay up while idle, the tickets are the point */
+  while (1) {
+    /* with every pending slot taken, leave new connections in the backlog */
+    fds[0].events = (state.num_pending < TICKETD_PENDING_MAX) ? POLLIN : 0;
+    for (size_t i = 0; i < state.num_pending; i++) {
+      fds[2 + i].fd = state.pending[i].fd;
+      fds[2 + i].events = POLLIN;
+      fds[2 + i].revents = 0;
+    }
+
+    ready = poll(fds, (nfds_t)(2 + state.num_pending), poll_timeout(&state));
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      (void)fprintf(stderr, "%s: Cannot poll socket: %s\n", __PROGRAM_NAME, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    if (fds[1].revents & POLLIN) {
+      while (read(child_fd, &info, sizeof(info)) == sizeof(info)) {
+      }
+      reap(&state);
+    }
+    if (state.num_pending > 0) {
+      read_pending(&state, &options, &fds[2]);
+    }
+    if (fds[0].revents & POLLIN) {
+      accept_requests(&state, &options, listen_fd);
+    }
+    if (time(NULL) - last_sweep >= TICKETD_SWEEP_MS / 1000) {
+      sweep(&state);
+      last_sweep = time(NULL);
+    }
+  }
+}
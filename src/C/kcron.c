@@ -0,0 +1,230 @@
+/*
+ *
+ * One binary for the per job helpers: `kcron name`, `kcron init` and
+ * `kcron status`.  Links named client-keytab-name, init-kcron-keytab or
+ * kcron-status pick the subcommand from argv[0] instead.
+ *
+ * It should be SETUID(3p) root or have the right CAPABILITIES(7) for init,
+ * the other subcommands give those up before doing anything else.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "kcron_caps.h"
+#include "kcron_filename.h"
+#include "kcron_keytab.h"
+#include "kcron_keytab_parse.h"
+#include "kcron_probes.h"
+#include "kcron_setup.h"
+
+struct kcron_command {
+  const char *name;  /* kcron <name> */
+  const char *alias; /* or a link by this name */
+  enum kcron_profile profile;
+  int (*run)(char *keytab_dirname, char *keytab_filename, char *keytab);
+};
+
+static int kcron_name(char *keytab_dirname, char *keytab_filename, char *keytab) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+static int kcron_name(char *keytab_dirname, char *keytab_filename, char *keytab) {
+
+  if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
+    (void)fprintf(stderr, "%s: Cannot determine keytab filename.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  (void)printf("%s\n", keytab);
+  return 0;
+}
+
+static int kcron_init(char *keytab_dirname, char *keytab_filename, char *keytab) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+static int kcron_init(char *keytab_dirname, char *keytab_filename, char *keytab) {
+
+  int rc = 0;
+
+  /* is our client keytab directory set, keytab_dirname is just scratch here */
+  if (get_client_dirname(keytab_dirname) != 0) {
+    (void)fprintf(stderr, "%s: Client keytab directory not set.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  KCRON_STAGE_ENTRY(KCRON_STAGE_FILENAMES);
+  rc = get_filenames(keytab_dirname, keytab_filename, keytab);
+  KCRON_STAGE_RETURN(KCRON_STAGE_FILENAMES, rc);
+  if (rc != 0) {
+    (void)fprintf(stderr, "%s: Cannot determine keytab filename.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  if (create_keytab_if_missing(keytab_dirname, keytab_filename, keytab, getuid(), getgid()) != 0) {
+    return 1;
+  }
+
+  (void)printf("%s\n", keytab);
+  return 0;
+}
+
+/*
+ * One line: keytab, exists, uid, gid, mode, entries, tab separated.
+ * A missing keytab prints "no" and "-" for the rest and is an error.
+ */
+static int kcron_status(char *keytab_dirname, char *keytab_filename, char *keytab) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+static int kcron_status(char *keytab_dirname, char *keytab_filename, char *keytab) {
+
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  struct stat st = {0};
+  size_t offset = 0;
+  unsigned int entries = 0;
+  int rc = 0;
+
+  if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
+    (void)fprintf(stderr, "%s: Cannot determine keytab filename.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  if (fstatat(AT_FDCWD, keytab, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+    if (errno != ENOENT) {
+      (void)fprintf(stderr, "%s: Cannot stat %s: %s\n", __PROGRAM_NAME, keytab, strerror(errno));
+    }
+    (void)printf("%s\tno\t-\t-\t-\t-\n", keytab);
+    return 1;
+  }
+
+  rc = kcron_keytab_map_at(AT_FDCWD, keytab, &map);
+  if (rc != 0) {
+    (void)fprintf(stderr, "%s: Cannot read %s: %s\n", __PROGRAM_NAME, keytab, strerror(rc));
+    (void)printf("%s\tyes\t%u\t%u\t%04o\t-\n", keytab, (unsigned)st.st_uid, (unsigned)st.st_gid, (unsigned)(st.st_mode & 07777));
+    return 1;
+  }
+
+  while ((rc = kcron_keytab_next(&map, &offset, &entry)) > 0) {
+    entries++;
+  }
+  (void)kcron_keytab_unmap(&map);
+
+  if (rc < 0) {
+    (void)fprintf(stderr, "%s: %s is damaged after %u entries.\n", __PROGRAM_NAME, keytab, entries);
+  }
+
+  (void)printf("%s\tyes\t%u\t%u\t%04o\t%u\n", keytab, (unsigned)st.st_uid, (unsigned)st.st_gid, (unsigned)(st.st_mode & 07777), entries);
+  return (rc < 0) ? 1 : 0;
+}
+
+static const struct kcron_command kcron_commands[] = {
+    {"name", "client-keytab-name", KCRON_PROFILE_NAME, kcron_name},
+    {"init", "init-kcron-keytab", KCRON_PROFILE_INIT, kcron_init},
+    {"status", "kcron-status", KCRON_PROFILE_STATUS, kcron_status},
+};
+
+#define KCRON_NUM_COMMANDS (sizeof(kcron_commands) / sizeof(kcron_commands[0]))
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s name|init|status\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  name    print the keytab path\n");
+  (void)fprintf(stderr, "  init    create the keytab if it is missing and print its path\n");
+  (void)fprintf(stderr, "  status  print keytab, exists, uid, gid, mode and entries\n");
+}
+
+/* only looks at strings, nothing here may make a syscall before hardening */
+static const struct kcron_command *find_command(int argc, char *argv[]) __attribute__((nonnull(2)));
+static const struct kcron_command *find_command(int argc, char *argv[]) {
+
+  const char *called_as = NULL;
+
+  if (argc < 1 || argv[0] == NULL) {
+    return NULL;
+  }
+
+  called_as = strrchr(argv[0], '/');
+  called_as = (called_as == NULL) ? argv[0] : called_as + 1;
+
+  for (size_t i = 0; i < KCRON_NUM_COMMANDS; i++) {
+    if (strcmp(called_as, kcron_commands[i].alias) == 0) {
+      return (argc == 1) ? &kcron_commands[i] : NULL;
+    }
+  }
+
+  if (argc != 2) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i < KCRON_NUM_COMMANDS; i++) {
+    if (strcmp(argv[1], kcron_commands[i].name) == 0) {
+      return &kcron_commands[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* fixed storage, nothing is allocated once we are running as root */
+static char keytab[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_dirname[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_filename[FILE_PATH_MAX_LENGTH + 3];
+
+int main(int argc, char *argv[]) {
+
+  const struct kcron_command *command = find_command(argc, argv);
+
+  if (command == NULL) {
+    (void)usage();
+    exit(EXIT_FAILURE);
+  }
+
+  /* the one hardened startup, everything after this runs under the profile */
+  (void)harden_runtime_for(command->profile);
+
+  if (command->run(keytab_dirname, keytab_filename, keytab) != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  exit(EXIT_SUCCESS);
+}
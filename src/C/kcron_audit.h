@@ -0,0 +1,151 @@
+/*
+ *
+ * The rules a keytab directory and its keytab are held to, shared by
+ * kcron-audit and the kcron-indexd snapshot.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_AUDIT_H
+#define KCRON_AUDIT_H 1
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "kcron_filename.h"
+
+#ifndef _0600
+#define _0600 S_IRUSR | S_IWUSR
+#endif
+#ifndef _0700
+#define _0700 S_IRWXU
+#endif
+
+#define KCRON_AUDIT_ORPHAN (1U << 0)
+#define KCRON_AUDIT_NOT_DIRECTORY (1U << 1)
+#define KCRON_AUDIT_DIR_OWNER (1U << 2)
+#define KCRON_AUDIT_DIR_MODE (1U << 3)
+#define KCRON_AUDIT_NO_KEYTAB (1U << 4)
+#define KCRON_AUDIT_KEYTAB_TYPE (1U << 5)
+#define KCRON_AUDIT_KEYTAB_OWNER (1U << 6)
+#define KCRON_AUDIT_KEYTAB_MODE (1U << 7)
+#define KCRON_AUDIT_KEYTAB_LINKS (1U << 8)
+#define KCRON_AUDIT_MISPLACED (1U << 9)
+#define KCRON_AUDIT_UNREADABLE (1U << 10)
+#define KCRON_AUDIT_STRAY (1U << 11)
+#define KCRON_AUDIT_SHARD_OWNER (1U << 12)
+#define KCRON_AUDIT_SHARD_MODE (1U << 13)
+
+/* in bit order, these are what kcron-audit and kcron-index print */
+static const char *const kcron_audit_problem_names[] = {"orphan",      "not-directory", "dir-owner", "dir-mode",   "no-keytab", "keytab-type", "keytab-owner",
+                                                        "keytab-mode", "keytab-links",  "misplaced", "unreadable", "stray",     "shard-owner", "shard-mode"};
+
+/* digits only, no sign or leading zero, and small enough to be a uid */
+int kcron_audit_parse_number(const char *text, unsigned long *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_audit_parse_number(const char *text, unsigned long *value) {
+  unsigned long number = 0;
+
+  if (text[0] == '\0' || (text[0] == '0' && text[1] != '\0') || strlen(text) > 10) {
+    return 1;
+  }
+  for (const char *p = text; *p != '\0'; p++) {
+    if (*p < '0' || *p > '9') {
+      return 1;
+    }
+    number = number * 10 + (unsigned long)(*p - '0');
+  }
+  if (number > UINT32_MAX - 1) {
+    return 1;
+  }
+  *value = number;
+  return 0;
+}
+
+/* the layout this build uses, as get_client_subdir_for_uid() lays it out */
+int kcron_audit_shard_is_used(unsigned int shard, unsigned int shards) __attribute__((const));
+int kcron_audit_shard_is_used(unsigned int shard, unsigned int shards) { return shard < shards; }
+
+int kcron_audit_is_in_place(uid_t uid, int shard, unsigned int shards) __attribute__((const));
+int kcron_audit_is_in_place(uid_t uid, int shard, unsigned int shards) {
+  if (shards == 0) {
+    return shard < 0;
+  }
+  return shard >= 0 && uid % shards == (unsigned int)shard;
+}
+
+/*
+ * The same rules mkdirat_if_missing() and chown_chmod_keytab() make them with.
+ * dir_error and keytab_error are 0 or the errno from looking at each;
+ * pass the number of shards this build uses, as __CLIENT_KEYTAB_SHARDS
+ * may be 0.  Whether the account still exists is up to the caller.
+ */
+unsigned int kcron_audit_check(uid_t uid, int shard, unsigned int shards, const struct statx *dir, int dir_error, const struct statx *keytab, int keytab_error)
+    __attribute__((nonnull(4, 6))) __attribute__((warn_unused_result));
+unsigned int kcron_audit_check(uid_t uid, int shard, unsigned int shards, const struct statx *dir, int dir_error, const struct statx *keytab, int keytab_error) {
+
+  unsigned int problems = 0;
+
+  problems |= (kcron_audit_is_in_place(uid, shard, shards) == 0) ? KCRON_AUDIT_MISPLACED : 0;
+
+  if (dir_error != 0) {
+    return problems | KCRON_AUDIT_UNREADABLE;
+  }
+  if (!S_ISDIR(dir->stx_mode)) {
+    return problems | KCRON_AUDIT_NOT_DIRECTORY;
+  }
+  problems |= (dir->stx_uid != uid) ? KCRON_AUDIT_DIR_OWNER : 0;
+  problems |= ((dir->stx_mode & 07777) != (_0700)) ? KCRON_AUDIT_DIR_MODE : 0;
+
+  if (keytab_error == ENOENT) {
+    return problems | KCRON_AUDIT_NO_KEYTAB;
+  }
+  if (keytab_error != 0) {
+    return problems | KCRON_AUDIT_UNREADABLE;
+  }
+  if (!S_ISREG(keytab->stx_mode)) {
+    return problems | KCRON_AUDIT_KEYTAB_TYPE;
+  }
+  problems |= (keytab->stx_uid != uid) ? KCRON_AUDIT_KEYTAB_OWNER : 0;
+  problems |= ((keytab->stx_mode & 07777) != (_0600)) ? KCRON_AUDIT_KEYTAB_MODE : 0;
+  /* a hard link could be someone else's file */
+  problems |= (keytab->stx_nlink != 1) ? KCRON_AUDIT_KEYTAB_LINKS : 0;
+  return problems;
+}
+
+#endif
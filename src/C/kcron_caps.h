@@ -43,25 +43,95 @@
 
 #if USE_CAPABILITIES == 1
 
+#include <linux/capability.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/capability.h>
+#include <string.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <unistd.h>
+
+typedef int cap_value_t; /* same spelling libcap used */
+
+/*
+ * Our view of the process capability sets.  It is read once with capget(2)
+ * and afterwards only changed by us, so every toggle can be decided here
+ * and capset(2) is only called when the effective set really changes.
+ * capset(2) only changes the calling thread, so each thread keeps its own.
+ */
+struct kcron_cap_state {
+  int loaded;
+  struct __user_cap_header_struct header;
+  struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+};
+
+static _Thread_local struct kcron_cap_state kcron_cap_state = {0};
+
+static int load_capabilities(void) __attribute__((warn_unused_result)) __attribute__((flatten));
+static int load_capabilities(void) {
+  if (kcron_cap_state.loaded == 1) {
+    return 0;
+  }
+
+  kcron_cap_state.header.version = _LINUX_CAPABILITY_VERSION_3;
+  kcron_cap_state.header.pid = 0;
+
+  if (syscall(SYS_capget, &kcron_cap_state.header, kcron_cap_state.data) != 0) {
+    DTRACE_PROBE1(__PROGRAM_NAME, "cap-get", 1);
+    (void)fprintf(stderr, "%s: Unable to read CAPABILITIES\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  DTRACE_PROBE1(__PROGRAM_NAME, "cap-get", 0);
+  kcron_cap_state.loaded = 1;
+  return 0;
+}
+
+static int set_effective_capabilities(const __u32 effective[_LINUX_CAPABILITY_U32S_3]) __attribute__((nonnull(1))) __attribute__((warn_unused_result)) __attribute__((flatten));
+static int set_effective_capabilities(const __u32 effective[_LINUX_CAPABILITY_U32S_3]) {
+
+  struct __user_cap_data_struct wanted[_LINUX_CAPABILITY_U32S_3];
+  int changed = 0;
+
+  (void)memcpy(wanted, kcron_cap_state.data, sizeof(wanted));
+  for (int i = 0; i < _LINUX_CAPABILITY_U32S_3; i++) {
+    if (wanted[i].effective != effective[i]) {
+      wanted[i].effective = effective[i];
+      changed = 1;
+    }
+  }
+
+  if (changed == 0) {
+    /* already there, nothing to tell the kernel */
+    return 0;
+  }
+
+  if (syscall(SYS_capset, &kcron_cap_state.header, wanted) != 0) {
+    DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-active", 1);
+    return 1;
+  }
+
+  DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-active", 0);
+  (void)memcpy(kcron_cap_state.data, wanted, sizeof(wanted));
+  return 0;
+}
 
 int disable_capabilities(void) __attribute__((flatten)) __attribute__((hot));
 int disable_capabilities(void) {
-  cap_t capabilities = cap_get_proc();
+  const __u32 none[_LINUX_CAPABILITY_U32S_3] = {0};
+
+  if (load_capabilities() != 0) {
+    exit(EXIT_FAILURE);
+  }
 
-  if (cap_clear(capabilities)) {
+  if (set_effective_capabilities(none) != 0) {
     /* error */
     DTRACE_PROBE1(__PROGRAM_NAME, "clear_cap", 1);
-    (void)cap_free(capabilities);
     (void)fprintf(stderr, "%s: Unable to clear CAPABILITIES\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
   DTRACE_PROBE1(__PROGRAM_NAME, "clear_cap", 0);
-  (void)cap_free(capabilities);
   return 0;
 }
 
@@ -70,55 +140,89 @@ static void print_cap_error(const char *mode, const cap_value_t expected_cap[],
   (void)fprintf(stderr, "%s: Unable to set CAPABILITIES %s\n", __PROGRAM_NAME, mode);
   (void)fprintf(stderr, "%s: Requested CAPABILITIES %s %i:\n", __PROGRAM_NAME, mode, num_caps);
   for (int i = 0; i < num_caps; i++) {
-    (void)fprintf(stderr, "%s:    capability:%s\n", __PROGRAM_NAME, cap_to_name(expected_cap[i]));
+    /* see capabilities(7) or linux/capability.h for the names */
+    (void)fprintf(stderr, "%s:    capability:%i\n", __PROGRAM_NAME, expected_cap[i]);
   }
 }
 
 int enable_capabilities(const cap_value_t expected_cap[], const int num_caps) __attribute__((nonnull(1))) __attribute__((warn_unused_result)) __attribute__((flatten)) __attribute__((hot));
 int enable_capabilities(const cap_value_t expected_cap[], const int num_caps) {
-  cap_t capabilities = cap_get_proc();
+  __u32 effective[_LINUX_CAPABILITY_U32S_3] = {0};
 
-  /* clear any active capabilities */
-  if (disable_capabilities() != 0) {
-    (void)cap_free(capabilities);
+  if (load_capabilities() != 0) {
     exit(EXIT_FAILURE);
   }
 
-  if (cap_set_flag(capabilities, CAP_PERMITTED, num_caps, expected_cap, CAP_SET) == -1) {
-    DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-permitted", 1);
-    (void)cap_free(capabilities);
-    /* error */
-    (void)print_cap_error("PERMITTED", expected_cap, num_caps);
-    exit(EXIT_FAILURE);
+  /* only what was asked for is active afterwards */
+  for (int i = 0; i < num_caps; i++) {
+    if (expected_cap[i] < 0 || expected_cap[i] > CAP_LAST_CAP) {
+      DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-effective", 1);
+      (void)print_cap_error("ACTIVE", expected_cap, num_caps);
+      exit(EXIT_FAILURE);
+    }
+    effective[CAP_TO_INDEX(expected_cap[i])] |= CAP_TO_MASK(expected_cap[i]);
+  }
+
+  for (int i = 0; i < _LINUX_CAPABILITY_U32S_3; i++) {
+    if ((effective[i] & ~kcron_cap_state.data[i].permitted) != 0) {
+      DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-permitted", 1);
+      /* error */
+      (void)print_cap_error("PERMITTED", expected_cap, num_caps);
+      exit(EXIT_FAILURE);
+    }
   }
   DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-permitted", 0);
 
-  if (cap_set_flag(capabilities, CAP_EFFECTIVE, num_caps, expected_cap, CAP_SET) == -1) {
-    DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-effective", 1);
-    (void)cap_free(capabilities);
+  if (set_effective_capabilities(effective) != 0) {
     /* error */
     (void)print_cap_error("ACTIVE", expected_cap, num_caps);
     exit(EXIT_FAILURE);
   }
-  DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-effective", 0);
 
-  if (cap_set_proc(capabilities) == -1) {
-    DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-active", 1);
-    (void)cap_free(capabilities);
-    /* error */
-    (void)print_cap_error("ACTIVE", expected_cap, num_caps);
-    exit(EXIT_FAILURE);
+  return 0;
+}
+
+/*
+ * Give up every capability for good, effective, permitted and inheritable.
+ * For callers that will never need them again, see harden_runtime_for().
+ */
+int drop_capabilities(void) __attribute__((warn_unused_result)) __attribute__((flatten));
+int drop_capabilities(void) {
+  struct __user_cap_data_struct none[_LINUX_CAPABILITY_U32S_3];
+  int held = 0;
+
+  if (load_capabilities() != 0) {
+    return 1;
   }
-  DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-active", 0);
 
-  (void)cap_free(capabilities);
+  for (int i = 0; i < _LINUX_CAPABILITY_U32S_3; i++) {
+    if (kcron_cap_state.data[i].effective != 0 || kcron_cap_state.data[i].permitted != 0 || kcron_cap_state.data[i].inheritable != 0) {
+      held = 1;
+    }
+  }
+
+  if (held == 0) {
+    /* an unprivileged caller, nothing to give up */
+    DTRACE_PROBE1(__PROGRAM_NAME, "drop_cap", 0);
+    return 0;
+  }
+
+  (void)memset(none, 0, sizeof(none));
+  if (syscall(SYS_capset, &kcron_cap_state.header, none) != 0) {
+    DTRACE_PROBE1(__PROGRAM_NAME, "drop_cap", 1);
+    (void)fprintf(stderr, "%s: Unable to drop CAPABILITIES\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  DTRACE_PROBE1(__PROGRAM_NAME, "drop_cap", 0);
+  (void)memcpy(kcron_cap_state.data, none, sizeof(none));
   return 0;
 }
 #else
 typedef int cap_value_t; /* so prototypes stay identical */
 
 /* If not caps, just return 0 */
-int disable_capabilities(void) __attribute__((warn_unused_result)) __attribute__((flatten));
+int disable_capabilities(void) __attribute__((flatten));
 int disable_capabilities(void) {
   DTRACE_PROBE1(__PROGRAM_NAME, "clear_cap", 2);
   return 0;
@@ -126,10 +230,18 @@ int disable_capabilities(void) {
 
 int enable_capabilities(const cap_value_t expected_cap[], const int num_caps) __attribute__((nonnull(1))) __attribute__((warn_unused_result)) __attribute__((flatten));
 int enable_capabilities(const cap_value_t expected_cap[], const int num_caps) {
+  (void)expected_cap;
+  (void)num_caps;
   DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-permitted", 2);
   DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-flag-effective", 2);
   DTRACE_PROBE1(__PROGRAM_NAME, "cap-set-active", 2);
   return 0;
 }
+
+int drop_capabilities(void) __attribute__((warn_unused_result)) __attribute__((flatten));
+int drop_capabilities(void) {
+  DTRACE_PROBE1(__PROGRAM_NAME, "drop_cap", 2);
+  return 0;
+}
 #endif
 #endif
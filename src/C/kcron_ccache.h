@@ -0,0 +1,223 @@
+/*
+ *
+ * Find the TGT in an MIT FILE credential cache.
+ *
+ * Only the version 3 and 4 (big endian) formats are understood,
+ * every kerberos release in the last twenty years writes version 4.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_CCACHE_H
+#define KCRON_CCACHE_H 1
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+/*
+ * The file is
+ *   uint16  version   (0x0503 or 0x0504)
+ *   uint16  header length and that many bytes of tags (0x0504 only)
+ *   principal         the default client
+ * followed by credentials until the end of the file
+ *   principal         client
+ *   principal         server
+ *   uint16  enctype   (twice for 0x0503)
+ *   data    key
+ *   uint32  authtime, starttime, endtime, renew_till
+ *   uint8   is_skey
+ *   uint32  ticket_flags
+ *   uint32  count, then count of uint16 type and data   (addresses)
+ *   uint32  count, then count of uint16 type and data   (authdata)
+ *   data    ticket
+ *   data    second ticket
+ * where a principal is uint32 name_type, uint32 num_components, data realm
+ * and data component[num_components], and data is a uint32 length and that
+ * many bytes, all big endian.
+ */
+#define KCRON_CCACHE_VERSION_3 0x0503
+#define KCRON_CCACHE_VERSION_4 0x0504
+
+struct kcron_ccache_reader {
+  const unsigned char *p;
+  const unsigned char *end;
+};
+
+static int kcron_ccache_u16(struct kcron_ccache_reader *reader, uint16_t *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int kcron_ccache_u16(struct kcron_ccache_reader *reader, uint16_t *value) {
+  if (reader->end - reader->p < 2) {
+    return 1;
+  }
+  *value = (uint16_t)((unsigned)reader->p[0] << 8 | (unsigned)reader->p[1]);
+  reader->p += 2;
+  return 0;
+}
+
+static int kcron_ccache_u32(struct kcron_ccache_reader *reader, uint32_t *value) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int kcron_ccache_u32(struct kcron_ccache_reader *reader, uint32_t *value) {
+  if (reader->end - reader->p < 4) {
+    return 1;
+  }
+  *value = (uint32_t)reader->p[0] << 24 | (uint32_t)reader->p[1] << 16 | (uint32_t)reader->p[2] << 8 | (uint32_t)reader->p[3];
+  reader->p += 4;
+  return 0;
+}
+
+/* one uint32 length prefixed field, 'data' may be NULL to skip it */
+static int kcron_ccache_data(struct kcron_ccache_reader *reader, const unsigned char **data, uint32_t *length) __attribute__((nonnull(1, 3))) __attribute__((warn_unused_result));
+static int kcron_ccache_data(struct kcron_ccache_reader *reader, const unsigned char **data, uint32_t *length) {
+  if (kcron_ccache_u32(reader, length) != 0 || (uint64_t)(reader->end - reader->p) < *length) {
+    return 1;
+  }
+  if (data != NULL) {
+    *data = reader->p;
+  }
+  reader->p += *length;
+  return 0;
+}
+
+/* 1 if the principal is krbtgt/REALM@REALM */
+static int kcron_ccache_principal(struct kcron_ccache_reader *reader, int *is_tgt) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int kcron_ccache_principal(struct kcron_ccache_reader *reader, int *is_tgt) {
+
+  const unsigned char *realm = NULL;
+  const unsigned char *component[2] = {NULL, NULL};
+  uint32_t realm_length = 0;
+  uint32_t component_length[2] = {0, 0};
+  uint32_t name_type = 0;
+  uint32_t num_components = 0;
+  uint32_t length = 0;
+
+  if (kcron_ccache_u32(reader, &name_type) != 0 || kcron_ccache_u32(reader, &num_components) != 0 || kcron_ccache_data(reader, &realm, &realm_length) != 0) {
+    return 1;
+  }
+  for (uint32_t i = 0; i < num_components; i++) {
+    if (i < 2) {
+      if (kcron_ccache_data(reader, &component[i], &component_length[i]) != 0) {
+        return 1;
+      }
+    } else if (kcron_ccache_data(reader, NULL, &length) != 0) {
+      return 1;
+    }
+  }
+
+  if (is_tgt != NULL) {
+    *is_tgt = num_components == 2 && component_length[0] == strlen("krbtgt") && memcmp(component[0], "krbtgt", strlen("krbtgt")) == 0 &&
+              component_length[1] == realm_length && memcmp(component[1], realm, realm_length) == 0;
+  }
+  return 0;
+}
+
+/* a uint32 count of uint16 type and data pairs */
+static int kcron_ccache_skip_list(struct kcron_ccache_reader *reader) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int kcron_ccache_skip_list(struct kcron_ccache_reader *reader) {
+
+  uint32_t count = 0;
+  uint32_t length = 0;
+  uint16_t type = 0;
+
+  if (kcron_ccache_u32(reader, &count) != 0) {
+    return 1;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (kcron_ccache_u16(reader, &type) != 0 || kcron_ccache_data(reader, NULL, &length) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * The end time of the first krbtgt/REALM@REALM credential.
+ * Returns 0 with *endtime set, 1 if there is no TGT, -1 if the cache is damaged.
+ */
+int kcron_ccache_tgt_endtime(const unsigned char *data, size_t length, uint32_t *endtime) __attribute__((nonnull(1, 3))) __attribute__((warn_unused_result));
+int kcron_ccache_tgt_endtime(const unsigned char *data, size_t length, uint32_t *endtime) {
+
+  struct kcron_ccache_reader reader = {data, data + length};
+  uint32_t times[4] = {0, 0, 0, 0};
+  uint32_t skip = 0;
+  uint16_t version = 0;
+  uint16_t value = 0;
+  int is_tgt = 0;
+
+  if (kcron_ccache_u16(&reader, &version) != 0 || (version != KCRON_CCACHE_VERSION_3 && version != KCRON_CCACHE_VERSION_4)) {
+    return -1;
+  }
+  if (version == KCRON_CCACHE_VERSION_4) {
+    if (kcron_ccache_u16(&reader, &value) != 0 || reader.end - reader.p < value) {
+      return -1;
+    }
+    reader.p += value;
+  }
+  if (kcron_ccache_principal(&reader, NULL) != 0) {
+    return -1;
+  }
+
+  while (reader.p < reader.end) {
+    if (kcron_ccache_principal(&reader, NULL) != 0 || kcron_ccache_principal(&reader, &is_tgt) != 0 || kcron_ccache_u16(&reader, &value) != 0) {
+      return -1;
+    }
+    if (version == KCRON_CCACHE_VERSION_3 && kcron_ccache_u16(&reader, &value) != 0) {
+      return -1;
+    }
+    if (kcron_ccache_data(&reader, NULL, &skip) != 0) {
+      return -1;
+    }
+    for (size_t i = 0; i < 4; i++) {
+      if (kcron_ccache_u32(&reader, &times[i]) != 0) {
+        return -1;
+      }
+    }
+    if (reader.end - reader.p < 1 + 4) {
+      return -1;
+    }
+    reader.p += 1 + 4;
+    if (kcron_ccache_skip_list(&reader) != 0 || kcron_ccache_skip_list(&reader) != 0 || kcron_ccache_data(&reader, NULL, &skip) != 0 ||
+        kcron_ccache_data(&reader, NULL, &skip) != 0) {
+      return -1;
+    }
+
+    if (is_tgt == 1) {
+      *endtime = times[2];
+      return 0;
+    }
+  }
+  return 1;
+}
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ *
+ * A small reader for CRONTAB(5) schedules.
+ *
+ * Only the five time fields (or an @nickname) and, for system crontabs,
+ * the user are kept, the command itself is never looked at.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_CRON_H
+#define KCRON_CRON_H 1
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+/* one bit per allowed value, like cronie keeps them */
+struct kcron_cron_entry {
+  uint64_t minutes;  /* 0-59 */
+  uint32_t hours;    /* 0-23 */
+  uint32_t days;     /* 1-31 */
+  uint16_t months;   /* 1-12 */
+  uint8_t weekdays;  /* 0-6, Sunday is 0 */
+  uint8_t day_or;    /* both day fields restricted, either may match */
+};
+
+struct kcron_cron_field {
+  unsigned int low;
+  unsigned int high;
+  const char *const *names; /* names[0] is 'low' */
+  size_t num_names;
+};
+
+static const char *const kcron_cron_months[] = {"jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
+static const char *const kcron_cron_weekdays[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+static int kcron_cron_value(const char **p, const struct kcron_cron_field *field, unsigned int *value) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+static int kcron_cron_value(const char **p, const struct kcron_cron_field *field, unsigned int *value) {
+  char *end = NULL;
+  unsigned long number = 0;
+
+  for (size_t i = 0; i < field->num_names; i++) {
+    if (strncasecmp(*p, field->names[i], 3) == 0) {
+      *value = field->low + (unsigned int)i;
+      *p += 3;
+      return 0;
+    }
+  }
+
+  if (!isdigit((unsigned char)**p)) {
+    return 1;
+  }
+  number = strtoul(*p, &end, 10);
+  /* 7 is also Sunday */
+  if (number < field->low || number > field->high + ((field->names == kcron_cron_weekdays) ? 1U : 0U)) {
+    return 1;
+  }
+  *value = (unsigned int)number;
+  *p = end;
+  return 0;
+}
+
+/* a list of '*', 'N', 'N-M', any of them with '/step' */
+static int kcron_cron_parse_field(const char *text, const struct kcron_cron_field *field, uint64_t *bits) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+static int kcron_cron_parse_field(const char *text, const struct kcron_cron_field *field, uint64_t *bits) {
+
+  const char *p = text;
+  char *end = NULL;
+  unsigned int first = 0;
+  unsigned int last = 0;
+  unsigned long step = 1;
+
+  *bits = 0;
+  for (;;) {
+    step = 1;
+    if (*p == '*') {
+      first = field->low;
+      last = field->high;
+      p++;
+    } else {
+      if (kcron_cron_value(&p, field, &first) != 0) {
+        return 1;
+      }
+      last = first;
+      if (*p == '-') {
+        p++;
+        if (kcron_cron_value(&p, field, &last) != 0 || last < first) {
+          return 1;
+        }
+      }
+    }
+
+    if (*p == '/') {
+      step = strtoul(p + 1, &end, 10);
+      /* bounded by the size of the field, so the loop below always advances */
+      if (end == p + 1 || step == 0 || step > (unsigned long)(field->high - field->low) + 1) {
+        return 1;
+      }
+      p = end;
+      /* 'N/step' runs from N to the end of the range */
+      if (first == last) {
+        last = field->high;
+      }
+    }
+
+    for (unsigned int value = first; value <= last; value += (unsigned int)step) {
+      *bits |= (uint64_t)1 << ((field->names == kcron_cron_weekdays) ? value % 7 : value);
+    }
+
+    if (*p == '\0') {
+      return 0;
+    }
+    if (*p != ',') {
+      return 1;
+    }
+    p++;
+  }
+}
+
+/*
+ * Returns 1 and fills 'entry' for a schedule, 0 for anything that is not
+ * one (blank, comment, environment, @reboot) and -1 for a line we cannot
+ * read.  A system crontab ('user' not NULL) has the user after the time.
+ */
+int kcron_cron_parse_line(const char *line, struct kcron_cron_entry *entry, char *user, size_t user_size) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_cron_parse_line(const char *line, struct kcron_cron_entry *entry, char *user, size_t user_size) {
+
+  static const struct {
+    const char *name;
+    const char *expansion;
+  } nicknames[] = {
+      {"@yearly", "0 0 1 1 *"}, {"@annually", "0 0 1 1 *"}, {"@monthly", "0 0 1 * *"}, {"@weekly", "0 0 * * 0"},
+      {"@daily", "0 0 * * *"},  {"@midnight", "0 0 * * *"}, {"@hourly", "0 * * * *"},
+  };
+  const struct kcron_cron_field fields[] = {
+      {0, 59, NULL, 0}, {0, 23, NULL, 0}, {1, 31, NULL, 0}, {1, 12, kcron_cron_months, 12}, {0, 6, kcron_cron_weekdays, 7},
+  };
+
+  char text[5][64] = {{0}};
+  char expanded[64] = {0};
+  const char *p = line;
+  const char *start = NULL;
+  uint64_t bits[5] = {0};
+  size_t length = 0;
+  int num_fields = 0;
+
+  while (isspace((unsigned char)*p)) {
+    p++;
+  }
+  if (*p == '\0' || *p == '#') {
+    return 0;
+  }
+
+  /* NAME=value sets the environment for the lines that follow */
+  start = p;
+  while (isalnum((unsigned char)*p) || *p == '_') {
+    p++;
+  }
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+  if (p != start && *p == '=') {
+    return 0;
+  }
+  p = start;
+
+  if (*p == '@') {
+    length = strcspn(p, " \t\n");
+    if (length == strlen("@reboot") && strncmp(p, "@reboot", length) == 0) {
+      return 0;
+    }
+    for (size_t i = 0; i < sizeof(nicknames) / sizeof(nicknames[0]); i++) {
+      if (strlen(nicknames[i].name) == length && strncmp(p, nicknames[i].name, length) == 0) {
+        (void)snprintf(expanded, sizeof(expanded), "%s", nicknames[i].expansion);
+      }
+    }
+    if (expanded[0] == '\0') {
+      return -1;
+    }
+    (void)sscanf(expanded, "%63s %63s %63s %63s %63s", text[0], text[1], text[2], text[3], text[4]);
+    p += length;
+    num_fields = 5;
+  }
+
+  for (; num_fields < 5; num_fields++) {
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    length = strcspn(p, " \t\n");
+    if (length == 0 || length >= sizeof(text[0])) {
+      return -1;
+    }
+    (void)memcpy(text[num_fields], p, length);
+    text[num_fields][length] = '\0';
+    p += length;
+  }
+
+  for (int i = 0; i < 5; i++) {
+    if (kcron_cron_parse_field(text[i], &fields[i], &bits[i]) != 0) {
+      return -1;
+    }
+  }
+
+  if (user != NULL) {
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    length = strcspn(p, " \t\n");
+    if (length == 0 || length >= user_size) {
+      return -1;
+    }
+    (void)memcpy(user, p, length);
+    user[length] = '\0';
+  }
+
+  entry->minutes = bits[0];
+  entry->hours = (uint32_t)bits[1];
+  entry->days = (uint32_t)bits[2];
+  entry->months = (uint16_t)bits[3];
+  entry->weekdays = (uint8_t)bits[4];
+  /* as in cron(8), a day field starting with '*' defers to the other one */
+  entry->day_or = (text[2][0] != '*' && text[4][0] != '*') ? 1 : 0;
+
+  return 1;
+}
+
+int kcron_cron_matches(const struct kcron_cron_entry *entry, const struct tm *tm) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_cron_matches(const struct kcron_cron_entry *entry, const struct tm *tm) {
+
+  const int day = (entry->days >> tm->tm_mday) & 1U;
+  const int weekday = (entry->weekdays >> tm->tm_wday) & 1U;
+
+  if (((entry->minutes >> tm->tm_min) & 1U) == 0 || ((entry->hours >> tm->tm_hour) & 1U) == 0 || ((entry->months >> (tm->tm_mon + 1)) & 1U) == 0) {
+    return 0;
+  }
+  return (entry->day_or == 1) ? (day | weekday) : (day & weekday);
+}
+
+#endif
@@ -43,29 +43,41 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+#include "kcron_probes.h"
+
+int write_empty_keytab_nosync(int filedescriptor) __attribute__((warn_unused_result));
+int write_empty_keytab_nosync(int filedescriptor) {
+
+  /* This magic string makes ktutil and kadmin happy with an empty file */
+  const char emptykeytab[] = {0x05, 0x02};
+
+  if (write(filedescriptor, emptykeytab, sizeof(emptykeytab)) != sizeof(emptykeytab)) {
+    return 1;
+  }
+
+  return 0;
+}
 
 int write_empty_keytab(int filedescriptor) __attribute__((warn_unused_result));
 int write_empty_keytab(int filedescriptor) {
 
+  int rc = 0;
+
   if (filedescriptor == 0) {
     (void)fprintf(stderr, "%s: no keytab file specified.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
-  /* This magic string makes ktutil and kadmin happy with an empty file */
-  const char emptykeytab_a = 0x05;
-  const char emptykeytab_b = 0x02;
-
-  if (write(filedescriptor, &emptykeytab_a, sizeof(emptykeytab_a)) != sizeof(emptykeytab_a)) {
-    (void)fprintf(stderr, "%s: could not write initial block to keytab.\n", __PROGRAM_NAME);
-    exit(EXIT_FAILURE);
-  }
-  if (write(filedescriptor, &emptykeytab_b, sizeof(emptykeytab_b)) != sizeof(emptykeytab_b)) {
+  if (write_empty_keytab_nosync(filedescriptor) != 0) {
     (void)fprintf(stderr, "%s: could not write initial blocks to keytab.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
-  (void)fsync(filedescriptor);
+  KCRON_STAGE_ENTRY(KCRON_STAGE_FSYNC);
+  rc = fsync(filedescriptor);
+  KCRON_STAGE_RETURN(KCRON_STAGE_FSYNC, rc);
 
   return 0;
 }
@@ -0,0 +1,136 @@
+/*
+ *
+ * Hand an open descriptor to another process over SCM_RIGHTS, so the
+ * keytab directory init-kcron-keytab checked is the one its caller writes.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_FDPASS_H
+#define KCRON_FDPASS_H 1
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*
+ * The socket a caller leaves open for 'init-kcron-keytab -s', just past
+ * RLIMIT_NOFILE so the helper's own files still land on 3 and 4 and the
+ * seccomp filter can name it.
+ */
+#define KCRON_FDPASS_SOCKET 5
+
+/* returns 0 or an errno value */
+int kcron_send_fd(int sock, int fd) __attribute__((warn_unused_result));
+int kcron_send_fd(int sock, int fd) {
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg = {0};
+  struct cmsghdr *cmsg = NULL;
+  char byte = 'k';
+  struct iovec iov = {.iov_base = &byte, .iov_len = sizeof(byte)};
+
+  (void)memset(&control, 0, sizeof(control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  (void)memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(byte)) {
+    return errno;
+  }
+
+  return 0;
+}
+
+/* returns the descriptor, close-on-exec, or -1 with errno set */
+int kcron_recv_fd(int sock) __attribute__((warn_unused_result));
+int kcron_recv_fd(int sock) {
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr msg = {0};
+  struct cmsghdr *cmsg = NULL;
+  char byte = 0;
+  struct iovec iov = {.iov_base = &byte, .iov_len = sizeof(byte)};
+  ssize_t got = 0;
+  int fd = -1;
+
+  (void)memset(&control, 0, sizeof(control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  do {
+    got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  } while (got < 0 && errno == EINTR);
+
+  if (got < 0) {
+    return -1;
+  }
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  if (got == 0 || cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+    /* the sender gave up, or sent something else */
+    errno = EBADMSG;
+    return -1;
+  }
+  (void)memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+  if ((msg.msg_flags & MSG_CTRUNC) != 0) {
+    (void)close(fd);
+    errno = EBADMSG;
+    return -1;
+  }
+
+  return fd;
+}
+#endif
@@ -43,8 +43,53 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#define KCRON_KEYTAB_FILENAME "client.keytab"
+
+/* shard directories are 's' and a number, so they never look like a uid */
+#define KCRON_SHARD_PREFIX "s"
+/* users only need to pass through a shard, listing it is not their business */
+#define KCRON_SHARD_MODE (S_IRWXU | S_IXGRP | S_IXOTH)
+
+#ifndef __CLIENT_KEYTAB_SHARDS
+#define __CLIENT_KEYTAB_SHARDS 0
+#endif
+
+/* no messages and no exit(), libkcron shares this with the helpers */
+int format_client_subdir_for_uid(uid_t uid, unsigned int shards, char *subdir, size_t size) __attribute__((nonnull(3))) __attribute__((access(write_only, 3, 4)))
+__attribute__((warn_unused_result));
+int format_client_subdir_for_uid(uid_t uid, unsigned int shards, char *subdir, size_t size) {
+
+  int len = 0;
+
+  /* <uid> or <shard>/<uid>, always relative to __CLIENT_KEYTAB_DIR */
+  if (shards == 0) {
+    len = snprintf(subdir, size, "%u", uid);
+  } else {
+    len = snprintf(subdir, size, "%s%u/%u", KCRON_SHARD_PREFIX, uid % shards, uid);
+  }
+
+  if (len < 0 || (size_t)len >= size) {
+    return 1;
+  }
+
+  return 0;
+}
+
+int get_client_subdir_for_uid(uid_t uid, unsigned int shards, char *subdir, size_t size) __attribute__((nonnull(3))) __attribute__((access(write_only, 3, 4)))
+__attribute__((warn_unused_result));
+int get_client_subdir_for_uid(uid_t uid, unsigned int shards, char *subdir, size_t size) {
+
+  if (format_client_subdir_for_uid(uid, shards, subdir, size) != 0) {
+    (void)fprintf(stderr, "%s: keytab directory name too long.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  return 0;
+}
+
 int get_client_dirname(char *keytab_dir) __attribute__((nonnull(1))) __attribute__((access(read_write, 1))) __attribute__((warn_unused_result)) __attribute__((flatten));
 int get_client_dirname(char *keytab_dir) {
 
@@ -60,37 +105,36 @@ int get_client_dirname(char *keytab_dir) {
   return 0;
 }
 
-int get_filenames(char *keytab_dir, char *keytab_filename, char *keytab) __attribute__((nonnull(1, 2, 3))) __attribute__((access(read_write, 1)))
-__attribute((access(read_write, 2))) __attribute((access(read_write, 3))) __attribute__((warn_unused_result)) __attribute__((flatten));
-int get_filenames(char *keytab_dir, char *keytab_filename, char *keytab) {
-
-  const uid_t uid = getuid();
+int get_filenames_for_uid(uid_t uid, char *keytab_dir, char *keytab_filename, char *keytab) __attribute__((nonnull(2, 3, 4))) __attribute__((access(read_write, 2)))
+__attribute((access(read_write, 3))) __attribute((access(read_write, 4))) __attribute__((warn_unused_result)) __attribute__((flatten));
+int get_filenames_for_uid(uid_t uid, char *keytab_dir, char *keytab_filename, char *keytab) {
 
   const char *nullpointer = NULL;
 
-  /* we are just using an int rather than the name, so this is enough space */
-  char *uid_str = calloc(USERNAME_MAX_LENGTH + 3, sizeof(char));
-
-  if (uid_str == nullpointer) {
-    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
-    exit(EXIT_FAILURE);
-  }
+  /* we are just using ints rather than the name, so this is enough space */
+  char uid_dir[64] = {0};
 
   if ((keytab == nullpointer) || (keytab_dir == nullpointer) || (keytab_filename == nullpointer)) {
     (void)fprintf(stderr, "%s: invalid memory passed in.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
-  /* safely copy the uid from the system into a string */
-  (void)snprintf(uid_str, USERNAME_MAX_LENGTH, "%d", uid);
+  /* safely copy the uid (and its shard) into a string */
+  if (get_client_subdir_for_uid(uid, __CLIENT_KEYTAB_SHARDS, uid_dir, sizeof(uid_dir)) != 0) {
+    return 1;
+  }
 
   /* build our filename variables */
-  (void)snprintf(keytab_filename, FILE_PATH_MAX_LENGTH, "client.keytab");
-  (void)snprintf(keytab_dir, FILE_PATH_MAX_LENGTH, "%s/%s", __CLIENT_KEYTAB_DIR, uid_str);
+  (void)snprintf(keytab_filename, FILE_PATH_MAX_LENGTH, "%s", KCRON_KEYTAB_FILENAME);
+  (void)snprintf(keytab_dir, FILE_PATH_MAX_LENGTH, "%s/%s", __CLIENT_KEYTAB_DIR, uid_dir);
   (void)snprintf(keytab, FILE_PATH_MAX_LENGTH, "%s/%s", keytab_dir, keytab_filename);
 
-  (void)free(uid_str);
-
   return 0;
 }
+
+int get_filenames(char *keytab_dir, char *keytab_filename, char *keytab) __attribute__((nonnull(1, 2, 3))) __attribute__((access(read_write, 1)))
+__attribute((access(read_write, 2))) __attribute((access(read_write, 3))) __attribute__((warn_unused_result)) __attribute__((flatten));
+int get_filenames(char *keytab_dir, char *keytab_filename, char *keytab) {
+  return get_filenames_for_uid(getuid(), keytab_dir, keytab_filename, keytab);
+}
 #endif
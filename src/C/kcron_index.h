@@ -0,0 +1,583 @@
+/*
+ *
+ * The kcron-indexd snapshot: a fixed size header and an open addressed
+ * table of fixed size records keyed by uid, in one file readers map.
+ *
+ * kcron-indexd changes records in place under a sequence count, so a
+ * lookup is a few loads from the mapping and never a system call.  When
+ * the table has to grow a new file is renamed over the old one and the
+ * old one is marked superseded, which is the only time a reader maps
+ * anything again.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_INDEX_H
+#define KCRON_INDEX_H 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KCRON_INDEX_MAGIC "KCRONIDX"
+#define KCRON_INDEX_VERSION 1
+#define KCRON_INDEX_MIN_SLOTS 1024U
+
+#define KCRON_INDEX_SLOT_EMPTY 0
+#define KCRON_INDEX_SLOT_USED 1
+#define KCRON_INDEX_SLOT_DELETED 2 /* keeps a probe chain going */
+
+/* record flags, problems with the directory and keytab are KCRON_AUDIT_ bits */
+#define KCRON_INDEX_FLAG_DAMAGED (1U << 0) /* the keytab did not parse to the end */
+
+/* a writer that died part way through leaves the count odd forever */
+#define KCRON_INDEX_MAX_SPINS (1UL << 24)
+
+/* all host endian, the file never leaves the machine */
+struct kcron_index_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t num_slots;   /* a power of two */
+  uint32_t num_records; /* slots in use */
+  uint32_t num_deleted;
+  uint32_t superseded; /* there is a newer file at the path, map that */
+  uint64_t sequence;   /* odd while records are being changed */
+  int64_t built;       /* when the scan behind this file ran */
+  int64_t updated;     /* when a record last changed */
+  int64_t heartbeat;   /* kcron-indexd bumps this while it is watching */
+};
+
+struct kcron_index_record {
+  uint32_t uid;
+  uint32_t slot_state;
+  int32_t shard;     /* -1 directly in the client keytab directory */
+  uint32_t problems; /* KCRON_AUDIT_ bits */
+  uint64_t inode;    /* of the keytab, 0 without one */
+  uint64_t size;
+  int64_t mtime;
+  uint32_t mtime_nsec;
+  uint32_t kvno; /* the highest in the keytab */
+  uint32_t entries;
+  uint32_t keytab_mode;
+  uint32_t dir_mode;
+  uint32_t flags;
+};
+
+_Static_assert(sizeof(struct kcron_index_header) == 64, "the index header is part of the file format");
+_Static_assert(sizeof(struct kcron_index_record) == 64, "an index record is part of the file format");
+
+/* what a reader has mapped */
+struct kcron_index {
+  const char *path;
+  const unsigned char *map;
+  size_t length;
+  const struct kcron_index_header *header;
+  const struct kcron_index_record *records;
+};
+
+/* what kcron-indexd has mapped, the file is only at path once published */
+struct kcron_index_writer {
+  const char *path;
+  char temp_path[FILE_PATH_MAX_LENGTH];
+  unsigned char *map;
+  size_t length;
+  struct kcron_index_header *header;
+  struct kcron_index_record *records;
+  mode_t mode;
+  gid_t group;
+};
+
+static uint32_t kcron_index_hash(uint32_t uid, uint32_t num_slots) __attribute__((const));
+static uint32_t kcron_index_hash(uint32_t uid, uint32_t num_slots) { return (uid * 2654435761U) & (num_slots - 1); }
+
+/* a file we can trust the sizes in, or EINVAL */
+static int kcron_index_check(const unsigned char *map, size_t length) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int kcron_index_check(const unsigned char *map, size_t length) {
+
+  const struct kcron_index_header *header = (const struct kcron_index_header *)map;
+
+  if (length < sizeof(struct kcron_index_header)) {
+    return EINVAL;
+  }
+  if (memcmp(header->magic, KCRON_INDEX_MAGIC, sizeof(header->magic)) != 0 || header->version != KCRON_INDEX_VERSION ||
+      header->record_size != sizeof(struct kcron_index_record)) {
+    return EINVAL;
+  }
+  if (header->num_slots == 0 || (header->num_slots & (header->num_slots - 1)) != 0 ||
+      (length - sizeof(struct kcron_index_header)) / sizeof(struct kcron_index_record) < header->num_slots) {
+    return EINVAL;
+  }
+  return 0;
+}
+
+/*
+ * Map the snapshot at path, which must stay put while the index is open.
+ * Returns 0 or an errno value, EINVAL when the file is not an index.
+ */
+int kcron_index_open(struct kcron_index *index, const char *path) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_index_open(struct kcron_index *index, const char *path) {
+
+  struct stat st = {0};
+  void *map = NULL;
+  int error = 0;
+
+  index->path = path;
+  index->map = NULL;
+  index->length = 0;
+
+  const int fd = open(path, O_RDONLY | O_NOFOLLOW | O_NOCTTY | O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+  if (fstat(fd, &st) != 0) {
+    error = errno;
+    (void)close(fd);
+    return error;
+  }
+  if (!S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(struct kcron_index_header)) {
+    (void)close(fd);
+    return EINVAL;
+  }
+
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  error = errno;
+  (void)close(fd);
+  if (map == MAP_FAILED) {
+    return error;
+  }
+  if (kcron_index_check(map, (size_t)st.st_size) != 0) {
+    (void)munmap(map, (size_t)st.st_size);
+    return EINVAL;
+  }
+
+  index->map = map;
+  index->length = (size_t)st.st_size;
+  index->header = (const struct kcron_index_header *)index->map;
+  index->records = (const struct kcron_index_record *)(index->map + sizeof(struct kcron_index_header));
+  return 0;
+}
+
+void kcron_index_close(struct kcron_index *index) __attribute__((nonnull(1)));
+void kcron_index_close(struct kcron_index *index) {
+  if (index->map != NULL) {
+    (void)munmap((void *)index->map, index->length);
+  }
+  index->map = NULL;
+  index->length = 0;
+}
+
+/*
+ * Start a read, following the path to a newer file if this one is superseded.
+ * Returns 0 with the sequence count to check afterwards, or an errno value:
+ * EAGAIN when the writer never finished.
+ */
+static int kcron_index_read_begin(struct kcron_index *index, uint64_t *sequence) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int kcron_index_read_begin(struct kcron_index *index, uint64_t *sequence) {
+
+  struct kcron_index newer = {0};
+  int error = 0;
+
+  if (__atomic_load_n(&index->header->superseded, __ATOMIC_ACQUIRE) != 0) {
+    error = kcron_index_open(&newer, index->path);
+    if (error != 0) {
+      return error;
+    }
+    kcron_index_close(index);
+    *index = newer;
+  }
+
+  for (unsigned long spins = 0; spins < KCRON_INDEX_MAX_SPINS; spins++) {
+    *sequence = __atomic_load_n(&index->header->sequence, __ATOMIC_ACQUIRE);
+    if ((*sequence & 1) == 0) {
+      return 0;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+  return EAGAIN;
+}
+
+/* 1 if the writer got in while we were copying, so copy again */
+static int kcron_index_read_retry(const struct kcron_index *index, uint64_t sequence) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int kcron_index_read_retry(const struct kcron_index *index, uint64_t sequence) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&index->header->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+/*
+ * Copy out the record for uid.
+ * Returns 1 with a record, 0 if the uid is not in the index, -1 with errno set.
+ */
+int kcron_index_lookup(struct kcron_index *index, uid_t uid, struct kcron_index_record *record) __attribute__((nonnull(1, 3))) __attribute__((warn_unused_result));
+int kcron_index_lookup(struct kcron_index *index, uid_t uid, struct kcron_index_record *record) {
+
+  uint64_t sequence = 0;
+  int found = 0;
+  int error = 0;
+
+  do {
+    error = kcron_index_read_begin(index, &sequence);
+    if (error != 0) {
+      errno = error;
+      return -1;
+    }
+
+    found = 0;
+    const uint32_t num_slots = index->header->num_slots;
+    uint32_t slot = kcron_index_hash((uint32_t)uid, num_slots);
+    for (uint32_t probes = 0; probes < num_slots; probes++, slot = (slot + 1) & (num_slots - 1)) {
+      const struct kcron_index_record *candidate = &index->records[slot];
+      if (candidate->slot_state == KCRON_INDEX_SLOT_EMPTY) {
+        break;
+      }
+      if (candidate->slot_state == KCRON_INDEX_SLOT_USED && candidate->uid == (uint32_t)uid) {
+        (void)memcpy(record, candidate, sizeof(struct kcron_index_record));
+        found = 1;
+        break;
+      }
+    }
+  } while (kcron_index_read_retry(index, sequence) != 0);
+
+  return found;
+}
+
+/* a consistent copy of the header, for the counts and times in it */
+int kcron_index_stat(struct kcron_index *index, struct kcron_index_header *header) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_index_stat(struct kcron_index *index, struct kcron_index_header *header) {
+
+  uint64_t sequence = 0;
+  int error = 0;
+
+  do {
+    error = kcron_index_read_begin(index, &sequence);
+    if (error != 0) {
+      errno = error;
+      return -1;
+    }
+    (void)memcpy(header, index->header, sizeof(struct kcron_index_header));
+    header->heartbeat = __atomic_load_n(&index->header->heartbeat, __ATOMIC_RELAXED);
+  } while (kcron_index_read_retry(index, sequence) != 0);
+
+  return 0;
+}
+
+/*
+ * Copy out every record, in slot order, into a buffer of header.num_records.
+ * Returns the number copied, or -1 with errno set.
+ */
+long kcron_index_dump(struct kcron_index *index, struct kcron_index_record **records) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+long kcron_index_dump(struct kcron_index *index, struct kcron_index_record **records) {
+
+  struct kcron_index_record *copy = NULL;
+  uint64_t sequence = 0;
+  long count = 0;
+  int error = 0;
+
+  *records = NULL;
+  do {
+    error = kcron_index_read_begin(index, &sequence);
+    if (error != 0) {
+      (void)free(copy);
+      errno = error;
+      return -1;
+    }
+
+    count = 0;
+    (void)free(copy);
+    const uint32_t num_records = index->header->num_records;
+    copy = malloc(((size_t)num_records + 1) * sizeof(struct kcron_index_record));
+    if (copy == NULL) {
+      return -1;
+    }
+    for (uint32_t slot = 0; slot < index->header->num_slots && (uint32_t)count < num_records; slot++) {
+      if (index->records[slot].slot_state == KCRON_INDEX_SLOT_USED) {
+        (void)memcpy(&copy[count++], &index->records[slot], sizeof(struct kcron_index_record));
+      }
+    }
+  } while (kcron_index_read_retry(index, sequence) != 0);
+
+  *records = copy;
+  return count;
+}
+
+/*
+ * Make an empty, unpublished index next to path with room for num_slots,
+ * a power of two.  Returns 0 or an errno value.
+ */
+int kcron_index_create(struct kcron_index_writer *writer, const char *path, uint32_t num_slots, mode_t mode, gid_t group) __attribute__((nonnull(1, 2)))
+__attribute__((warn_unused_result));
+int kcron_index_create(struct kcron_index_writer *writer, const char *path, uint32_t num_slots, mode_t mode, gid_t group) {
+
+  void *map = NULL;
+  int error = 0;
+
+  (void)memset(writer, 0, sizeof(struct kcron_index_writer));
+  writer->path = path;
+  writer->mode = mode;
+  writer->group = group;
+  writer->length = sizeof(struct kcron_index_header) + (size_t)num_slots * sizeof(struct kcron_index_record);
+
+  if (snprintf(writer->temp_path, sizeof(writer->temp_path), "%s.XXXXXX", path) >= (int)sizeof(writer->temp_path)) {
+    return ENAMETOOLONG;
+  }
+  const int fd = mkostemp(writer->temp_path, O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+  if (fchmod(fd, mode) != 0 || (group != (gid_t)-1 && fchown(fd, (uid_t)-1, group) != 0) || ftruncate(fd, (off_t)writer->length) != 0) {
+    error = errno;
+    (void)close(fd);
+    (void)unlink(writer->temp_path);
+    return error;
+  }
+
+  map = mmap(NULL, writer->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  error = errno;
+  (void)close(fd);
+  if (map == MAP_FAILED) {
+    (void)unlink(writer->temp_path);
+    return error;
+  }
+
+  writer->map = map;
+  writer->header = (struct kcron_index_header *)writer->map;
+  writer->records = (struct kcron_index_record *)(writer->map + sizeof(struct kcron_index_header));
+  (void)memcpy(writer->header->magic, KCRON_INDEX_MAGIC, sizeof(writer->header->magic));
+  writer->header->version = KCRON_INDEX_VERSION;
+  writer->header->record_size = sizeof(struct kcron_index_record);
+  writer->header->num_slots = num_slots;
+  writer->header->built = (int64_t)time(NULL);
+  writer->header->updated = writer->header->built;
+  writer->header->heartbeat = writer->header->built;
+  return 0;
+}
+
+/* drop an index that was never published */
+void kcron_index_abandon(struct kcron_index_writer *writer) __attribute__((nonnull(1)));
+void kcron_index_abandon(struct kcron_index_writer *writer) {
+  if (writer->map != NULL) {
+    (void)munmap(writer->map, writer->length);
+    (void)unlink(writer->temp_path);
+  }
+  writer->map = NULL;
+}
+
+/* mark the file behind fd superseded, for a previous kcron-indexd's index */
+static void kcron_index_supersede_fd(int fd) {
+
+  struct stat st = {0};
+  void *map = NULL;
+
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(struct kcron_index_header)) {
+    return;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    return;
+  }
+  if (kcron_index_check(map, (size_t)st.st_size) == 0) {
+    __atomic_store_n(&((struct kcron_index_header *)map)->superseded, 1, __ATOMIC_RELEASE);
+  }
+  (void)munmap(map, (size_t)st.st_size);
+}
+
+/*
+ * Rename the new index over the path and tell anyone still reading the
+ * previous one to map it again.  previous is unmapped; without one,
+ * whatever index was at the path before is marked instead.
+ */
+int kcron_index_publish(struct kcron_index_writer *writer, struct kcron_index_writer *previous) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_index_publish(struct kcron_index_writer *writer, struct kcron_index_writer *previous) {
+
+  int old_fd = -1;
+
+  if (previous == NULL || previous->map == NULL) {
+    old_fd = open(writer->path, O_RDWR | O_NOFOLLOW | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  }
+
+  if (rename(writer->temp_path, writer->path) != 0) {
+    const int error = errno;
+    if (old_fd >= 0) {
+      (void)close(old_fd);
+    }
+    return error;
+  }
+  writer->temp_path[0] = '\0';
+
+  if (old_fd >= 0) {
+    kcron_index_supersede_fd(old_fd);
+    (void)close(old_fd);
+  }
+  if (previous != NULL && previous->map != NULL) {
+    __atomic_store_n(&previous->header->superseded, 1, __ATOMIC_RELEASE);
+    (void)munmap(previous->map, previous->length);
+    previous->map = NULL;
+  }
+  return 0;
+}
+
+/* the writer side of the sequence count, records only change between these */
+void kcron_index_begin(struct kcron_index_writer *writer) __attribute__((nonnull(1)));
+void kcron_index_begin(struct kcron_index_writer *writer) {
+  __atomic_store_n(&writer->header->sequence, writer->header->sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void kcron_index_end(struct kcron_index_writer *writer) __attribute__((nonnull(1)));
+void kcron_index_end(struct kcron_index_writer *writer) {
+  writer->header->updated = (int64_t)time(NULL);
+  __atomic_store_n(&writer->header->sequence, writer->header->sequence + 1, __ATOMIC_RELEASE);
+}
+
+void kcron_index_heartbeat(struct kcron_index_writer *writer) __attribute__((nonnull(1)));
+void kcron_index_heartbeat(struct kcron_index_writer *writer) { __atomic_store_n(&writer->header->heartbeat, (int64_t)time(NULL), __ATOMIC_RELAXED); }
+
+/* the slot uid is in, or the one it should go in, UINT32_MAX when full */
+static uint32_t kcron_index_find_slot(const struct kcron_index_writer *writer, uint32_t uid) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static uint32_t kcron_index_find_slot(const struct kcron_index_writer *writer, uint32_t uid) {
+
+  const uint32_t num_slots = writer->header->num_slots;
+  uint32_t slot = kcron_index_hash(uid, num_slots);
+  uint32_t reuse = UINT32_MAX;
+
+  for (uint32_t probes = 0; probes < num_slots; probes++, slot = (slot + 1) & (num_slots - 1)) {
+    const struct kcron_index_record *candidate = &writer->records[slot];
+    if (candidate->slot_state == KCRON_INDEX_SLOT_EMPTY) {
+      return (reuse != UINT32_MAX) ? reuse : slot;
+    }
+    if (candidate->slot_state == KCRON_INDEX_SLOT_USED && candidate->uid == uid) {
+      return slot;
+    }
+    if (candidate->slot_state == KCRON_INDEX_SLOT_DELETED && reuse == UINT32_MAX) {
+      reuse = slot;
+    }
+  }
+  return reuse;
+}
+
+/* add or replace the record for record->uid, between begin and end; 1 if full */
+int kcron_index_put(struct kcron_index_writer *writer, const struct kcron_index_record *record) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_index_put(struct kcron_index_writer *writer, const struct kcron_index_record *record) {
+
+  const uint32_t slot = kcron_index_find_slot(writer, record->uid);
+  if (slot == UINT32_MAX) {
+    return 1;
+  }
+
+  struct kcron_index_record *target = &writer->records[slot];
+  if (target->slot_state != KCRON_INDEX_SLOT_USED) {
+    if (target->slot_state == KCRON_INDEX_SLOT_DELETED) {
+      writer->header->num_deleted--;
+    }
+    writer->header->num_records++;
+  }
+  (void)memcpy(target, record, sizeof(struct kcron_index_record));
+  target->slot_state = KCRON_INDEX_SLOT_USED;
+  return 0;
+}
+
+/* drop the record for uid if there is one, between begin and end */
+void kcron_index_remove(struct kcron_index_writer *writer, uint32_t uid) __attribute__((nonnull(1)));
+void kcron_index_remove(struct kcron_index_writer *writer, uint32_t uid) {
+
+  const uint32_t slot = kcron_index_find_slot(writer, uid);
+  if (slot == UINT32_MAX || writer->records[slot].slot_state != KCRON_INDEX_SLOT_USED) {
+    return;
+  }
+  (void)memset(&writer->records[slot], 0, sizeof(struct kcron_index_record));
+  writer->records[slot].slot_state = KCRON_INDEX_SLOT_DELETED;
+  writer->header->num_records--;
+  writer->header->num_deleted++;
+}
+
+/* the table size that keeps count records under half full */
+uint32_t kcron_index_slots_for(size_t count) __attribute__((const));
+uint32_t kcron_index_slots_for(size_t count) {
+  uint32_t num_slots = KCRON_INDEX_MIN_SLOTS;
+  while ((size_t)num_slots < count * 2 && num_slots < (1U << 31)) {
+    num_slots <<= 1;
+  }
+  return num_slots;
+}
+
+/*
+ * Make sure count more records fit with the table at most three quarters
+ * used, counting deleted slots.  If not, the live records move to a new
+ * published file and *writer becomes that one.  Call outside begin and end.
+ * Returns 0 or an errno value.
+ */
+int kcron_index_reserve(struct kcron_index_writer *writer, size_t count) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_index_reserve(struct kcron_index_writer *writer, size_t count) {
+
+  struct kcron_index_writer grown = {0};
+  const struct kcron_index_header *header = writer->header;
+  int error = 0;
+
+  if (((size_t)header->num_records + header->num_deleted + count) * 4 <= (size_t)header->num_slots * 3) {
+    return 0;
+  }
+
+  error = kcron_index_create(&grown, writer->path, kcron_index_slots_for((size_t)header->num_records + count), writer->mode, writer->group);
+  if (error != 0) {
+    return error;
+  }
+  grown.header->built = header->built;
+  for (uint32_t slot = 0; slot < header->num_slots; slot++) {
+    if (writer->records[slot].slot_state == KCRON_INDEX_SLOT_USED && kcron_index_put(&grown, &writer->records[slot]) != 0) {
+      kcron_index_abandon(&grown);
+      return ENOSPC;
+    }
+  }
+  error = kcron_index_publish(&grown, writer);
+  if (error != 0) {
+    kcron_index_abandon(&grown);
+    return error;
+  }
+  *writer = grown;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,344 @@
+/*
+ *
+ * A simple place where we keep our KADM5 calls
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_KADM5_H
+#define KCRON_KADM5_H 1
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <kadm5/admin.h>
+#include <krb5.h>
+
+static void print_krb5_error(krb5_context context, krb5_error_code code, const char *what) __attribute__((nonnull(3))) __attribute__((access(read_only, 3)));
+static void print_krb5_error(krb5_context context, krb5_error_code code, const char *what) {
+  const char *message = krb5_get_error_message(context, code);
+  (void)fprintf(stderr, "%s: %s: %s\n", __PROGRAM_NAME, what, message);
+  (void)krb5_free_error_message(context, message);
+}
+
+int kcron_kadm5_open(krb5_context context, const char *admin_principal, const char *realm, void **server_handle) __attribute__((nonnull(2, 4))) __attribute__((warn_unused_result));
+int kcron_kadm5_open(krb5_context context, const char *admin_principal, const char *realm, void **server_handle) {
+
+  kadm5_config_params params = {0};
+  krb5_ccache ccache = NULL;
+  kadm5_ret_t code = 0;
+
+  const char *nullstring = NULL;
+
+  /* kcroninit already got us a kadmin/admin ticket in KRB5CCNAME */
+  code = krb5_cc_default(context, &ccache);
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot open credential cache");
+    return 1;
+  }
+
+  if (realm != nullstring) {
+    params.mask |= KADM5_CONFIG_REALM;
+    params.realm = (char *)realm;
+  }
+
+  code = kadm5_init_with_creds(context, (char *)admin_principal, ccache, (char *)KADM5_ADMIN_SERVICE, &params, KADM5_STRUCT_VERSION, KADM5_API_VERSION_2, NULL, server_handle);
+  (void)krb5_cc_close(context, ccache);
+
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot connect to kadmin");
+    return 1;
+  }
+
+  return 0;
+}
+
+int kcron_kadm5_ensure_principal(krb5_context context, void *server_handle, krb5_principal principal, const char *principal_name) __attribute__((nonnull(2, 3, 4)))
+__attribute__((warn_unused_result));
+int kcron_kadm5_ensure_principal(krb5_context context, void *server_handle, krb5_principal principal, const char *principal_name) {
+
+  kadm5_principal_ent_rec entry = {0};
+  kadm5_ret_t code = 0;
+
+  code = kadm5_get_principal(server_handle, principal, &entry, KADM5_PRINCIPAL);
+  if (code == 0) {
+    (void)kadm5_free_principal_ent(server_handle, &entry);
+    (void)printf("Principal %s already exists in Kerberos database.\n", principal_name);
+    return 0;
+  }
+
+  if (code != KADM5_UNK_PRINC) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot look up principal");
+    return 1;
+  }
+
+  (void)printf("Creating principal %s\n", principal_name);
+
+  /* same as 'add_principal -randkey -pwexpire never', a NULL password gets random keys */
+  (void)memset(&entry, 0, sizeof(entry));
+  entry.principal = principal;
+  entry.pw_expiration = 0;
+
+  code = kadm5_create_principal(server_handle, &entry, KADM5_PRINCIPAL | KADM5_PW_EXPIRATION, NULL);
+  if (code != 0 && code != KADM5_DUP) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot create principal");
+    return 1;
+  }
+
+  /* Check if created successfully */
+  (void)memset(&entry, 0, sizeof(entry));
+  code = kadm5_get_principal(server_handle, principal, &entry, KADM5_PRINCIPAL);
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Principal missing after create");
+    return 1;
+  }
+  (void)kadm5_free_principal_ent(server_handle, &entry);
+
+  return 0;
+}
+
+int kcron_kadm5_extract(krb5_context context, void *server_handle, krb5_principal principal, const char *keytab_name, krb5_kvno *kvno) __attribute__((nonnull(2, 3, 4, 5)))
+__attribute__((warn_unused_result));
+int kcron_kadm5_extract(krb5_context context, void *server_handle, krb5_principal principal, const char *keytab_name, krb5_kvno *kvno) {
+
+  kadm5_principal_ent_rec entry = {0};
+  krb5_keytab_entry keytab_entry = {0};
+  krb5_keyblock *keys = NULL;
+  krb5_keytab keytab = NULL;
+  krb5_timestamp now = 0;
+  kadm5_ret_t code = 0;
+  int num_keys = 0;
+  int result = 0;
+
+  /* this is what ktadd does, new keys then ask for the new kvno */
+  code = kadm5_randkey_principal(server_handle, principal, &keys, &num_keys);
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot randomize keys");
+    return 1;
+  }
+
+  code = kadm5_get_principal(server_handle, principal, &entry, KADM5_PRINCIPAL | KADM5_KVNO);
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot read new key version");
+    result = 1;
+  }
+
+  if (result == 0) {
+    code = krb5_kt_resolve(context, keytab_name, &keytab);
+    if (code != 0) {
+      print_krb5_error(context, (krb5_error_code)code, "Cannot open keytab");
+      result = 1;
+    }
+  }
+
+  if (result == 0) {
+    *kvno = entry.kvno;
+    (void)krb5_timeofday(context, &now);
+
+    for (int i = 0; i < num_keys; i++) {
+      keytab_entry.principal = principal;
+      keytab_entry.vno = entry.kvno;
+      keytab_entry.key = keys[i];
+      keytab_entry.timestamp = now;
+
+      code = krb5_kt_add_entry(context, keytab, &keytab_entry);
+      if (code != 0) {
+        print_krb5_error(context, (krb5_error_code)code, "Cannot write key to keytab");
+        result = 1;
+        break;
+      }
+    }
+    (void)krb5_kt_close(context, keytab);
+  }
+
+  if (entry.principal != NULL) {
+    (void)kadm5_free_principal_ent(server_handle, &entry);
+  }
+  for (int i = 0; i < num_keys; i++) {
+    (void)krb5_free_keyblock_contents(context, &keys[i]);
+  }
+  (void)free(keys);
+
+  return result;
+}
+
+int kcron_keytab_verify(krb5_context context, const char *keytab_name, krb5_principal principal, krb5_kvno kvno) __attribute__((nonnull(2, 3))) __attribute__((warn_unused_result));
+int kcron_keytab_verify(krb5_context context, const char *keytab_name, krb5_principal principal, krb5_kvno kvno) {
+
+  krb5_keytab_entry keytab_entry = {0};
+  krb5_kt_cursor cursor = NULL;
+  krb5_keytab keytab = NULL;
+  krb5_error_code code = 0;
+  char *name = NULL;
+  char enctype[64] = {0};
+  int found = 0;
+
+  code = krb5_kt_resolve(context, keytab_name, &keytab);
+  if (code != 0) {
+    print_krb5_error(context, code, "Cannot open keytab");
+    return 1;
+  }
+
+  code = krb5_kt_start_seq_get(context, keytab, &cursor);
+  if (code != 0) {
+    print_krb5_error(context, code, "Cannot read keytab");
+    (void)krb5_kt_close(context, keytab);
+    return 1;
+  }
+
+  while (krb5_kt_next_entry(context, keytab, &keytab_entry, &cursor) == 0) {
+    if (keytab_entry.vno == kvno && krb5_principal_compare(context, keytab_entry.principal, principal)) {
+      found++;
+      if (krb5_unparse_name(context, keytab_entry.principal, &name) == 0) {
+        if (krb5_enctype_to_name(keytab_entry.key.enctype, 0, enctype, sizeof(enctype)) != 0) {
+          (void)snprintf(enctype, sizeof(enctype), "etype %d", keytab_entry.key.enctype);
+        }
+        (void)printf("%4u %s (%s)\n", keytab_entry.vno, name, enctype);
+        (void)krb5_free_unparsed_name(context, name);
+      }
+    }
+    (void)krb5_free_keytab_entry_contents(context, &keytab_entry);
+  }
+
+  (void)krb5_kt_end_seq_get(context, keytab, &cursor);
+  (void)krb5_kt_close(context, keytab);
+
+  if (found == 0) {
+    (void)fprintf(stderr, "%s: no keys for kvno %u found in %s\n", __PROGRAM_NAME, kvno, keytab_name);
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * The principal's current kvno and the enctypes the KDC holds for it,
+ * at most max of them.  Key contents never leave kadmind for a remote
+ * client, only their kvno and enctype.
+ */
+int kcron_kadm5_current_keys(krb5_context context, void *server_handle, krb5_principal principal, krb5_kvno *kvno, krb5_enctype *enctypes, int max, int *num_enctypes)
+    __attribute__((nonnull(2, 3, 4, 5, 7))) __attribute__((warn_unused_result));
+int kcron_kadm5_current_keys(krb5_context context, void *server_handle, krb5_principal principal, krb5_kvno *kvno, krb5_enctype *enctypes, int max, int *num_enctypes) {
+
+  kadm5_principal_ent_rec entry = {0};
+  kadm5_ret_t code = 0;
+
+  *num_enctypes = 0;
+
+  code = kadm5_get_principal(server_handle, principal, &entry, KADM5_PRINCIPAL | KADM5_KVNO | KADM5_KEY_DATA);
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot read key version");
+    return 1;
+  }
+
+  /* the database keeps only the low 16 bits of each key's kvno, in a signed short */
+  *kvno = entry.kvno;
+  for (int i = 0; i < entry.n_key_data && *num_enctypes < max; i++) {
+    if ((krb5_kvno)(uint16_t)entry.key_data[i].key_data_kvno == (entry.kvno & 0xffff)) {
+      enctypes[(*num_enctypes)++] = entry.key_data[i].key_data_type[0];
+    }
+  }
+
+  (void)kadm5_free_principal_ent(server_handle, &entry);
+  return 0;
+}
+
+/* primary/cron/host@REALM, the only principals kcron ever deletes */
+int kcron_kadm5_is_cron_principal(const char *name) __attribute__((nonnull(1))) __attribute__((pure));
+int kcron_kadm5_is_cron_principal(const char *name) {
+  const char *slash = strchr(name, '/');
+  const char *host = NULL;
+
+  if (slash == NULL || slash == name || strncmp(slash, "/cron/", 6) != 0) {
+    return 0;
+  }
+  host = slash + 6;
+  return (host[0] != '\0' && host[0] != '@' && strcspn(host, "/") == strlen(host)) ? 1 : 0;
+}
+
+/*
+ * Delete every cron principal matching glob, as kadmin's list_principals
+ * matches it, over the one session.  With dry_run they are only listed.
+ */
+int kcron_kadm5_delete_matching(krb5_context context, void *server_handle, const char *glob, int dry_run, size_t *deleted) __attribute__((nonnull(2, 3, 5)))
+__attribute__((warn_unused_result));
+int kcron_kadm5_delete_matching(krb5_context context, void *server_handle, const char *glob, int dry_run, size_t *deleted) {
+
+  krb5_principal principal = NULL;
+  kadm5_ret_t code = 0;
+  char **names = NULL;
+  int num_names = 0;
+  int result = 0;
+
+  code = kadm5_get_principals(server_handle, (char *)glob, &names, &num_names);
+  if (code != 0) {
+    print_krb5_error(context, (krb5_error_code)code, "Cannot list principals");
+    return 1;
+  }
+
+  for (int i = 0; i < num_names; i++) {
+    if (kcron_kadm5_is_cron_principal(names[i]) == 0) {
+      (void)printf("Skipping %s, not a cron principal\n", names[i]);
+      continue;
+    }
+    if (dry_run == 1) {
+      (void)printf("Would delete principal %s\n", names[i]);
+      (*deleted)++;
+      continue;
+    }
+
+    if (krb5_parse_name(context, names[i], &principal) != 0) {
+      (void)fprintf(stderr, "%s: Invalid principal %s.\n", __PROGRAM_NAME, names[i]);
+      result = 1;
+      continue;
+    }
+    code = kadm5_delete_principal(server_handle, principal);
+    (void)krb5_free_principal(context, principal);
+    if (code != 0 && code != KADM5_UNK_PRINC) {
+      print_krb5_error(context, (krb5_error_code)code, names[i]);
+      result = 1;
+      continue;
+    }
+    (void)printf("Deleted principal %s\n", names[i]);
+    (*deleted)++;
+  }
+
+  (void)kadm5_free_name_list(server_handle, names, num_names);
+  return result;
+}
+#endif
@@ -0,0 +1,450 @@
+/*
+ *
+ * A simple place where we keep the steps that build a keytab on disk
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_KEYTAB_H
+#define KCRON_KEYTAB_H 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "kcron_caps.h"
+#include "kcron_empty_keytab_file.h"
+#include "kcron_keytab_tmpfile.h"
+#include "kcron_probes.h"
+#include "kcron_resolve.h"
+
+#ifndef _0600
+#define _0600 S_IRUSR | S_IWUSR
+#endif
+#ifndef _0700
+#define _0700 S_IRWXU
+#endif
+
+int mkdirat_if_missing(int parent_fd, const char *name, const char *dir, uid_t owner, gid_t group, mode_t mode) __attribute__((nonnull(2, 3))) __attribute__((access(read_only, 2)))
+__attribute__((access(read_only, 3))) __attribute__((warn_unused_result));
+int mkdirat_if_missing(int parent_fd, const char *name, const char *dir, uid_t owner, gid_t group, mode_t mode) {
+
+#if USE_CAPABILITIES == 1
+  const cap_value_t caps[] = {CAP_CHOWN, CAP_DAC_OVERRIDE};
+#else
+  const cap_value_t caps[] = {-1};
+#endif
+  int num_caps = sizeof(caps) / sizeof(cap_value_t);
+
+  int made = 0;
+  int dir_fd = -1;
+
+  if (enable_capabilities(caps, num_caps) != 0) {
+    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  /* use of CAP_DAC_OVERRIDE, an existing directory is not an error */
+  if (mkdirat(parent_fd, name, mode) == 0) {
+    made = 1;
+  } else if (errno != EEXIST) {
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to mkdir %s\n", __PROGRAM_NAME, dir);
+    return -1;
+  }
+
+  /* use of CAP_DAC_OVERRIDE as the dir may be chmod 700 for not our euid */
+  /* O_DIRECTORY and no symlinks, so whatever we get really is a directory */
+  /* below parent_fd, there is no window for someone to swap it on us.    */
+  dir_fd = openat_beneath(parent_fd, name, O_RDONLY | O_DIRECTORY, 0);
+  if (dir_fd < 0) {
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to locate %s ?\n", __PROGRAM_NAME, dir);
+    (void)fprintf(stderr, "%s: This may be a permissions error?\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  /* use of CAP_CHOWN, only for a directory we just made */
+  if (made == 1 && fchown(dir_fd, owner, group) != 0) {
+    (void)close(dir_fd);
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to chown %i:%i %s\n", __PROGRAM_NAME, owner, group, dir);
+    (void)fprintf(stderr, "%s: This may be a permissions error?\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  if (disable_capabilities() != 0) {
+    (void)close(dir_fd);
+    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  return dir_fd;
+}
+
+int mkshardat_if_missing(int client_fd, const char *name, const char *dir) __attribute__((nonnull(2, 3))) __attribute__((access(read_only, 2))) __attribute__((access(read_only, 3)))
+__attribute__((warn_unused_result));
+int mkshardat_if_missing(int client_fd, const char *name, const char *dir) {
+
+#if USE_CAPABILITIES == 1
+  const cap_value_t caps[] = {CAP_CHOWN, CAP_DAC_OVERRIDE};
+#else
+  const cap_value_t caps[] = {-1};
+#endif
+  int num_caps = sizeof(caps) / sizeof(cap_value_t);
+
+  struct stat st = {0};
+  int made = 0;
+  int shard_fd = -1;
+
+  /* shards belong to whoever owns the client keytab directory */
+  if (fstat(client_fd, &st) != 0) {
+    (void)fprintf(stderr, "%s: Cannot stat %s.\n", __PROGRAM_NAME, __CLIENT_KEYTAB_DIR);
+    return -1;
+  }
+
+  if (enable_capabilities(caps, num_caps) != 0) {
+    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  if (mkdirat(client_fd, name, KCRON_SHARD_MODE) == 0) {
+    made = 1;
+  } else if (errno != EEXIST) {
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to mkdir %s\n", __PROGRAM_NAME, dir);
+    return -1;
+  }
+
+  shard_fd = openat_beneath(client_fd, name, O_RDONLY | O_DIRECTORY, 0);
+  if (shard_fd < 0) {
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to locate %s ?\n", __PROGRAM_NAME, dir);
+    return -1;
+  }
+
+  /* chmod while it is still ours, our umask may have taken the x bits */
+  if (made == 1 && (fchmod(shard_fd, KCRON_SHARD_MODE) != 0 || fchown(shard_fd, st.st_uid, st.st_gid) != 0)) {
+    (void)close(shard_fd);
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to set owner and mode on %s\n", __PROGRAM_NAME, dir);
+    return -1;
+  }
+
+  if (disable_capabilities() != 0) {
+    (void)close(shard_fd);
+    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  return shard_fd;
+}
+
+int chown_chmod_keytab(int filedescriptor, const char *keytab, uid_t uid, gid_t gid) __attribute__((nonnull(2))) __attribute__((access(read_only, 2))) __attribute__((warn_unused_result));
+int chown_chmod_keytab(int filedescriptor, const char *keytab, uid_t uid, gid_t gid) {
+
+#if USE_CAPABILITIES == 1
+  const cap_value_t keytab_caps[] = {CAP_CHOWN};
+#else
+  const cap_value_t keytab_caps[] = {-1};
+#endif
+  const int num_caps = sizeof(keytab_caps) / sizeof(cap_value_t);
+
+  struct stat st = {0};
+
+  if (filedescriptor == 0) {
+    (void)fprintf(stderr, "%s: Invalid file %s.\n", __PROGRAM_NAME, keytab);
+    return 1;
+  }
+
+  if (enable_capabilities(keytab_caps, num_caps) != 0) {
+    (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /* did the file really create on disk */
+  /* use of CAP_DAC_OVERRIDE because dir should be chmod 700 */
+  if (fstat(filedescriptor, &st) != 0) {
+    (void)fprintf(stderr, "%s: Cannot stat file %s.\n", __PROGRAM_NAME, keytab);
+    return 1;
+  }
+
+  if (disable_capabilities() != 0) {
+    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  if (!S_ISREG(st.st_mode)) {
+    (void)fprintf(stderr, "%s: %s is not a regular file.\n", __PROGRAM_NAME, keytab);
+    return 1;
+  }
+
+  /* ensure permissions are as expected on keytab file */
+  /* newly created file should have out euid as owner, so no caps needed */
+  if (fchmod(filedescriptor, _0600) != 0) {
+    (void)disable_capabilities();
+    (void)fprintf(stderr, "%s: Unable to chmod %o %s\n", __PROGRAM_NAME, _0600, keytab);
+    return 1;
+  }
+
+  /* Set the right owner of our keytab */
+  /* Don't switch euid to uid as that may permit write to program memory */
+  if (st.st_uid != uid || st.st_gid != gid) {
+
+    if (enable_capabilities(keytab_caps, num_caps) != 0) {
+      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+      return 1;
+    }
+
+    /* use of CAP_CHOWN, needed for SUID mode */
+    if (fchown(filedescriptor, uid, gid) != 0) {
+      (void)disable_capabilities();
+      (void)fprintf(stderr, "%s: Unable to chown %d:%d %s\n", __PROGRAM_NAME, uid, gid, keytab);
+      return 1;
+    }
+
+    if (disable_capabilities() != 0) {
+      (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+/* hands dir_fd to the caller when they asked for it, closes it otherwise */
+int keep_or_close_dir(int dir_fd, int *keep_dir_fd) __attribute__((warn_unused_result));
+int keep_or_close_dir(int dir_fd, int *keep_dir_fd) {
+  if (keep_dir_fd == NULL) {
+    (void)close(dir_fd);
+  } else {
+    *keep_dir_fd = dir_fd;
+  }
+  return 0;
+}
+
+/*
+ * With keep_dir_fd set, the validated user directory is left open there on
+ * success so a caller can hand it on rather than walk the path again.
+ */
+int create_keytab_if_missing_at(const char *keytab_dirname, const char *keytab_filename, const char *keytab, uid_t uid, gid_t gid, int *keep_dir_fd)
+__attribute__((nonnull(1, 2, 3))) __attribute__((access(read_only, 1))) __attribute__((access(read_only, 2))) __attribute__((access(read_only, 3))) __attribute__((warn_unused_result));
+int create_keytab_if_missing_at(const char *keytab_dirname, const char *keytab_filename, const char *keytab, uid_t uid, gid_t gid, int *keep_dir_fd) {
+
+  const size_t client_len = strlen(__CLIENT_KEYTAB_DIR);
+
+  char shard[FILE_PATH_MAX_LENGTH] = {0};
+  const char *user_dir = NULL;
+  const char *slash = NULL;
+
+  int client_fd = -1;
+  int parent_fd = -1;
+  int dir_fd = -1;
+  struct stat st = {0};
+  int filedescriptor = -1;
+  int open_errno = 0;
+  int named = 0;
+  int rc = 0;
+
+#if USE_CAPABILITIES == 1
+  const cap_value_t caps[] = {CAP_DAC_OVERRIDE};
+#else
+  const cap_value_t caps[] = {-1};
+#endif
+  const int num_caps = sizeof(caps) / sizeof(cap_value_t);
+
+  /* the user directory is 0700 and owned by uid, which need not be us */
+  const uid_t euid = geteuid();
+
+  /* everything below is relative to the client keytab directory */
+  if (strncmp(keytab_dirname, __CLIENT_KEYTAB_DIR, client_len) != 0 || keytab_dirname[client_len] != '/') {
+    (void)fprintf(stderr, "%s: %s is not within %s.\n", __PROGRAM_NAME, keytab_dirname, __CLIENT_KEYTAB_DIR);
+    return 1;
+  }
+
+  client_fd = open_client_dir();
+  if (client_fd < 0) {
+    return 1;
+  }
+
+  /* with a sharded layout the user directory lives one level down */
+  user_dir = keytab_dirname + client_len + 1;
+  slash = strchr(user_dir, '/');
+  if (slash == NULL) {
+    parent_fd = client_fd;
+  } else {
+    (void)snprintf(shard, sizeof(shard), "%.*s", (int)(slash - user_dir), user_dir);
+    parent_fd = mkshardat_if_missing(client_fd, shard, keytab_dirname);
+    (void)close(client_fd);
+    if (parent_fd < 0) {
+      return 1;
+    }
+    user_dir = slash + 1;
+  }
+
+  /* make sure our storage directory exists */
+  KCRON_STAGE_ENTRY(KCRON_STAGE_MKDIR);
+  dir_fd = mkdirat_if_missing(parent_fd, user_dir, keytab_dirname, uid, gid, _0700);
+  KCRON_STAGE_RETURN(KCRON_STAGE_MKDIR, dir_fd);
+
+  /* we have the fd, don't need this one any more */
+  (void)close(parent_fd);
+
+  if (dir_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot make dir %s.\n", __PROGRAM_NAME, keytab_dirname);
+    return 1;
+  }
+
+  if (euid != uid) {
+    /* the directory is 0700 and owned by the user, not by our euid */
+    if (enable_capabilities(caps, num_caps) != 0) {
+      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+      (void)close(dir_fd);
+      return 1;
+    }
+  }
+
+  /* If it exists but has the wrong permissions/owner do nothing, it is safer */
+  if (fstatat(dir_fd, keytab_filename, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+    if (disable_capabilities() != 0) {
+      (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+      (void)close(dir_fd);
+      return 1;
+    }
+    return keep_or_close_dir(dir_fd, keep_dir_fd);
+  }
+
+  /* unnamed until it is complete, so nobody can open a half made keytab */
+  KCRON_STAGE_ENTRY(KCRON_STAGE_OPENAT);
+  filedescriptor = kcron_keytab_tmpfile(dir_fd, O_WRONLY);
+  open_errno = errno;
+  if (filedescriptor < 0 && kcron_keytab_tmpfile_unsupported(open_errno) == 1) {
+    /* O_EXCL does the existence check for us */
+    filedescriptor = openat_beneath(dir_fd, keytab_filename, O_WRONLY | O_CREAT | O_EXCL, _0600);
+    open_errno = errno;
+    named = 1;
+  }
+  KCRON_STAGE_RETURN(KCRON_STAGE_OPENAT, filedescriptor);
+
+  if (disable_capabilities() != 0) {
+    /* technically we might not have active caps now, but eh              */
+    (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+    if (filedescriptor >= 0) {
+      (void)close(filedescriptor);
+    }
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  if (filedescriptor < 0) {
+    if (open_errno == EEXIST) {
+      return keep_or_close_dir(dir_fd, keep_dir_fd);
+    }
+    (void)close(dir_fd);
+    (void)fprintf(stderr, "%s: %s is missing, cannot create.\n", __PROGRAM_NAME, keytab);
+    return 1;
+  }
+
+  /* write to it first to ensure its content is right before we set owner/mode */
+  if (write_empty_keytab_nosync(filedescriptor) != 0) {
+    (void)fprintf(stderr, "%s: Cannot create keytab : %s.\n", __PROGRAM_NAME, keytab);
+    (void)close(filedescriptor);
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  KCRON_STAGE_ENTRY(KCRON_STAGE_CHOWN_CHMOD);
+  rc = chown_chmod_keytab(filedescriptor, keytab, uid, gid);
+  KCRON_STAGE_RETURN(KCRON_STAGE_CHOWN_CHMOD, rc);
+  if (rc != 0) {
+    (void)fprintf(stderr, "%s: Cannot set permissions on keytab : %s.\n", __PROGRAM_NAME, keytab);
+    (void)close(filedescriptor);
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  /* once, with the content, owner and mode all final */
+  KCRON_STAGE_ENTRY(KCRON_STAGE_FSYNC);
+  rc = fsync(filedescriptor);
+  KCRON_STAGE_RETURN(KCRON_STAGE_FSYNC, rc);
+  if (rc != 0) {
+    (void)fprintf(stderr, "%s: Cannot sync keytab : %s.\n", __PROGRAM_NAME, keytab);
+    (void)close(filedescriptor);
+    (void)close(dir_fd);
+    return 1;
+  }
+
+  if (named == 0) {
+    if (euid != uid && enable_capabilities(caps, num_caps) != 0) {
+      (void)fprintf(stderr, "%s: Cannot enable capabilities.\n", __PROGRAM_NAME);
+      (void)close(filedescriptor);
+      (void)close(dir_fd);
+      return 1;
+    }
+
+    /* use of CAP_DAC_OVERRIDE, someone else linking one in first is fine */
+    rc = kcron_keytab_link(filedescriptor, dir_fd, keytab_filename);
+
+    if (disable_capabilities() != 0) {
+      (void)fprintf(stderr, "%s: Cannot drop capabilities.\n", __PROGRAM_NAME);
+      (void)close(filedescriptor);
+      (void)close(dir_fd);
+      return 1;
+    }
+    if (rc != 0 && rc != EEXIST) {
+      (void)fprintf(stderr, "%s: Cannot link keytab into place : %s: %s.\n", __PROGRAM_NAME, keytab, strerror(rc));
+      (void)close(filedescriptor);
+      (void)close(dir_fd);
+      return 1;
+    }
+  }
+
+  (void)close(filedescriptor);
+  return keep_or_close_dir(dir_fd, keep_dir_fd);
+}
+
+int create_keytab_if_missing(const char *keytab_dirname, const char *keytab_filename, const char *keytab, uid_t uid, gid_t gid) __attribute__((nonnull(1, 2, 3)))
+__attribute__((access(read_only, 1))) __attribute__((access(read_only, 2))) __attribute__((access(read_only, 3))) __attribute__((warn_unused_result));
+int create_keytab_if_missing(const char *keytab_dirname, const char *keytab_filename, const char *keytab, uid_t uid, gid_t gid) {
+  return create_keytab_if_missing_at(keytab_dirname, keytab_filename, keytab, uid, gid, NULL);
+}
+#endif
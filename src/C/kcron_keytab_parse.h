@@ -0,0 +1,464 @@
+/*
+ *
+ * A zero copy reader for the MIT 0x0502 keytab format.
+ *
+ * The keytab is mapped read only and each entry points back into the
+ * mapping, nothing is copied or allocated.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_KEYTAB_PARSE_H
+#define KCRON_KEYTAB_PARSE_H 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/*
+ * The file is the two byte version followed by records of
+ *   int32   size      (negative for a hole left by a removed entry)
+ *   uint16  num_components
+ *   data    realm
+ *   data    component[num_components]
+ *   uint32  name_type
+ *   uint32  timestamp
+ *   uint8   vno8
+ *   uint16  enctype
+ *   data    key
+ *   uint32  vno       (optional, overrides vno8 when present)
+ * where data is a uint16 length and that many bytes, all big endian.
+ */
+#define KCRON_KEYTAB_VERSION 0x0502
+
+/* enough for a kcron keytab, which only ever holds one principal */
+#define KCRON_KEYTAB_READ_MAX 16384
+
+struct kcron_keytab_map {
+  const unsigned char *data;
+  size_t length;
+  int mapped;    /* 1 from kcron_keytab_map_at(), 0 for a caller's buffer */
+  int truncated; /* the file did not fit in the caller's buffer */
+};
+
+struct kcron_keytab_entry {
+  const unsigned char *realm;
+  const unsigned char *components;
+  uint16_t realm_length;
+  uint16_t num_components;
+  uint32_t name_type;
+  uint32_t timestamp;
+  uint32_t kvno;
+  uint16_t enctype;
+};
+
+static uint16_t kcron_keytab_u16(const unsigned char *p) __attribute__((nonnull(1)));
+static uint16_t kcron_keytab_u16(const unsigned char *p) { return (uint16_t)((unsigned)p[0] << 8 | (unsigned)p[1]); }
+
+static uint32_t kcron_keytab_u32(const unsigned char *p) __attribute__((nonnull(1)));
+static uint32_t kcron_keytab_u32(const unsigned char *p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3]; }
+
+/* skip one length prefixed field, returns 1 if it runs past the record */
+static int kcron_keytab_skip_data(const unsigned char *end, const unsigned char **p) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+static int kcron_keytab_skip_data(const unsigned char *end, const unsigned char **p) {
+  if (end - *p < 2) {
+    return 1;
+  }
+  const uint16_t length = kcron_keytab_u16(*p);
+  if (end - *p - 2 < length) {
+    return 1;
+  }
+  *p += 2 + length;
+  return 0;
+}
+
+/*
+ * Map a keytab relative to dir_fd (AT_FDCWD for a plain path).
+ * Returns 0 on success or an errno value, EINVAL for a bad header.
+ */
+int kcron_keytab_map_at(int dir_fd, const char *path, struct kcron_keytab_map *map) __attribute__((nonnull(2, 3))) __attribute__((warn_unused_result));
+int kcron_keytab_map_at(int dir_fd, const char *path, struct kcron_keytab_map *map) {
+
+  struct stat st = {0};
+  void *data = NULL;
+  int error = 0;
+
+  map->data = NULL;
+  map->length = 0;
+  map->mapped = 0;
+  map->truncated = 0;
+
+  /* a FIFO in a user's directory must not hang us, only regular files get mapped */
+  const int fd = openat(dir_fd, path, O_RDONLY | O_NOFOLLOW | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+
+  if (fstat(fd, &st) != 0) {
+    error = errno;
+    (void)close(fd);
+    return error;
+  }
+
+  if (!S_ISREG(st.st_mode) || st.st_size < 2) {
+    (void)close(fd);
+    return EINVAL;
+  }
+
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  error = errno;
+  (void)close(fd);
+  if (data == MAP_FAILED) {
+    return error;
+  }
+
+  map->data = data;
+  map->length = (size_t)st.st_size;
+  map->mapped = 1;
+
+  if (kcron_keytab_u16(map->data) != KCRON_KEYTAB_VERSION) {
+    (void)munmap(data, map->length);
+    map->data = NULL;
+    map->length = 0;
+    map->mapped = 0;
+    return EINVAL;
+  }
+
+  return 0;
+}
+
+/*
+ * Like kcron_keytab_map_at(), but copies at most size bytes into buffer.
+ * A mapping dies with SIGBUS when its owner truncates the file under us,
+ * so root daemons and libkcron read keytabs that users own this way.
+ * A keytab cut short by its owner, or longer than buffer, just looks
+ * damaged to kcron_keytab_next() at that point, map->truncated tells
+ * the second apart.
+ */
+int kcron_keytab_read_at(int dir_fd, const char *path, unsigned char *buffer, size_t size, struct kcron_keytab_map *map) __attribute__((nonnull(2, 3, 5)))
+__attribute__((access(write_only, 3, 4))) __attribute__((warn_unused_result));
+int kcron_keytab_read_at(int dir_fd, const char *path, unsigned char *buffer, size_t size, struct kcron_keytab_map *map) {
+
+  struct stat st = {0};
+  size_t want = 0;
+  size_t used = 0;
+  ssize_t got = 0;
+  int error = 0;
+
+  map->data = NULL;
+  map->length = 0;
+  map->mapped = 0;
+  map->truncated = 0;
+
+  /* a FIFO in a user's directory must not hang us, only regular files get read */
+  const int fd = openat(dir_fd, path, O_RDONLY | O_NOFOLLOW | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+
+  if (fstat(fd, &st) != 0) {
+    error = errno;
+    (void)close(fd);
+    return error;
+  }
+
+  if (!S_ISREG(st.st_mode) || st.st_size < 2) {
+    (void)close(fd);
+    return EINVAL;
+  }
+
+  want = ((size_t)st.st_size < size) ? (size_t)st.st_size : size;
+  map->truncated = ((size_t)st.st_size > size) ? 1 : 0;
+
+  while (used < want) {
+    got = pread(fd, buffer + used, want - used, (off_t)used);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0) {
+      error = errno;
+      (void)close(fd);
+      return error;
+    }
+    if (got == 0) {
+      /* shrunk since the fstat(), parse what is there */
+      break;
+    }
+    used += (size_t)got;
+  }
+  (void)close(fd);
+
+  if (used < 2 || kcron_keytab_u16(buffer) != KCRON_KEYTAB_VERSION) {
+    return EINVAL;
+  }
+
+  map->data = buffer;
+  map->length = used;
+  return 0;
+}
+
+void kcron_keytab_unmap(struct kcron_keytab_map *map) __attribute__((nonnull(1)));
+void kcron_keytab_unmap(struct kcron_keytab_map *map) {
+  if (map->data != NULL && map->mapped == 1) {
+    (void)munmap((void *)map->data, map->length);
+  }
+  map->data = NULL;
+  map->length = 0;
+  map->mapped = 0;
+}
+
+/*
+ * Step to the next entry, *offset starts at 0.
+ * Returns 1 with an entry, 0 at the end of the file, -1 if the file is damaged.
+ */
+int kcron_keytab_next(const struct kcron_keytab_map *map, size_t *offset, struct kcron_keytab_entry *entry) __attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result));
+int kcron_keytab_next(const struct kcron_keytab_map *map, size_t *offset, struct kcron_keytab_entry *entry) {
+
+  const unsigned char *record = NULL;
+  const unsigned char *end = NULL;
+  const unsigned char *p = NULL;
+  int32_t size = 0;
+
+  if (*offset < 2) {
+    *offset = 2;
+  }
+
+  while (*offset < map->length) {
+    if (map->length - *offset < 4) {
+      return -1;
+    }
+    size = (int32_t)kcron_keytab_u32(map->data + *offset);
+    *offset += 4;
+
+    if (size == 0) {
+      /* trailing zeros are unused space */
+      return 0;
+    }
+    if (size < 0) {
+      if (size == INT32_MIN || (size_t)(-(int64_t)size) > map->length - *offset) {
+        return -1;
+      }
+      *offset += (size_t)(-(int64_t)size);
+      continue;
+    }
+    if ((size_t)size > map->length - *offset) {
+      return -1;
+    }
+
+    record = map->data + *offset;
+    end = record + size;
+    *offset += (size_t)size;
+    p = record;
+
+    if (end - p < 2) {
+      return -1;
+    }
+    entry->num_components = kcron_keytab_u16(p);
+    p += 2;
+
+    entry->realm = p + 2;
+    if (kcron_keytab_skip_data(end, &p) != 0) {
+      return -1;
+    }
+    entry->realm_length = kcron_keytab_u16(entry->realm - 2);
+
+    entry->components = p;
+    for (uint16_t i = 0; i < entry->num_components; i++) {
+      if (kcron_keytab_skip_data(end, &p) != 0) {
+        return -1;
+      }
+    }
+
+    /* name_type, timestamp, vno8 and enctype */
+    if (end - p < 11) {
+      return -1;
+    }
+    entry->name_type = kcron_keytab_u32(p);
+    entry->timestamp = kcron_keytab_u32(p + 4);
+    entry->kvno = p[8];
+    entry->enctype = kcron_keytab_u16(p + 9);
+    p += 11;
+
+    if (kcron_keytab_skip_data(end, &p) != 0) {
+      return -1;
+    }
+
+    if (end - p >= 4 && kcron_keytab_u32(p) != 0) {
+      entry->kvno = kcron_keytab_u32(p);
+    }
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/* does this entry belong to 'principal' (name/instance@REALM) */
+int kcron_keytab_principal_is(const struct kcron_keytab_entry *entry, const char *principal) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_keytab_principal_is(const struct kcron_keytab_entry *entry, const char *principal) {
+
+  const unsigned char *p = entry->components;
+  const char *want = principal;
+  uint16_t length = 0;
+
+  for (uint16_t i = 0; i < entry->num_components; i++) {
+    length = kcron_keytab_u16(p);
+    if (i > 0) {
+      if (*want != '/') {
+        return 0;
+      }
+      want++;
+    }
+    if (strnlen(want, length) != length || memcmp(want, p + 2, length) != 0) {
+      return 0;
+    }
+    want += length;
+    p += 2 + length;
+  }
+
+  if (*want != '@' || strlen(want + 1) != entry->realm_length) {
+    return 0;
+  }
+  return memcmp(want + 1, entry->realm, entry->realm_length) == 0;
+}
+
+void kcron_keytab_fprint_principal(FILE *stream, const struct kcron_keytab_entry *entry) __attribute__((nonnull(1, 2)));
+void kcron_keytab_fprint_principal(FILE *stream, const struct kcron_keytab_entry *entry) {
+
+  const unsigned char *p = entry->components;
+  uint16_t length = 0;
+
+  for (uint16_t i = 0; i < entry->num_components; i++) {
+    length = kcron_keytab_u16(p);
+    if (i > 0) {
+      (void)fputc('/', stream);
+    }
+    (void)fwrite(p + 2, 1, length, stream);
+    p += 2 + length;
+  }
+  (void)fputc('@', stream);
+  (void)fwrite(entry->realm, 1, entry->realm_length, stream);
+}
+
+/* as above into 'buffer', 1 if it did not fit */
+int kcron_keytab_snprint_principal(char *buffer, size_t size, const struct kcron_keytab_entry *entry) __attribute__((nonnull(1, 3))) __attribute__((warn_unused_result));
+int kcron_keytab_snprint_principal(char *buffer, size_t size, const struct kcron_keytab_entry *entry) {
+
+  const unsigned char *p = entry->components;
+  size_t used = 0;
+  uint16_t length = 0;
+
+  for (uint16_t i = 0; i <= entry->num_components; i++) {
+    if (i == entry->num_components) {
+      length = entry->realm_length;
+    } else {
+      length = kcron_keytab_u16(p);
+    }
+    /* separator, the text and room for the final NUL */
+    if (used + 1 + length + 1 > size) {
+      buffer[0] = '\0';
+      return 1;
+    }
+    if (i > 0) {
+      buffer[used++] = (i == entry->num_components) ? '@' : '/';
+    }
+    if (i == entry->num_components) {
+      (void)memcpy(buffer + used, entry->realm, length);
+    } else {
+      (void)memcpy(buffer + used, p + 2, length);
+      p += 2 + length;
+    }
+    used += length;
+  }
+  buffer[used] = '\0';
+  return 0;
+}
+
+/*
+ * The principal of the first entry, which for a kcron keytab is the only one.
+ * Returns 0 with 'buffer' set, 1 for an empty, damaged or unreadable keytab.
+ */
+int kcron_keytab_first_principal_at(int dir_fd, const char *path, char *buffer, size_t size) __attribute__((nonnull(2, 3))) __attribute__((warn_unused_result));
+int kcron_keytab_first_principal_at(int dir_fd, const char *path, char *buffer, size_t size) {
+
+  unsigned char data[KCRON_KEYTAB_READ_MAX];
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  size_t offset = 0;
+  int result = 1;
+
+  /* the root daemons ask this of keytabs their users own, so no mmap() */
+  if (kcron_keytab_read_at(dir_fd, path, data, sizeof(data), &map) != 0) {
+    return 1;
+  }
+  if (kcron_keytab_next(&map, &offset, &entry) == 1 && kcron_keytab_snprint_principal(buffer, size, &entry) == 0) {
+    result = 0;
+  }
+  kcron_keytab_unmap(&map);
+  return result;
+}
+
+const char *kcron_keytab_enctype_name(uint16_t enctype) __attribute__((returns_nonnull));
+const char *kcron_keytab_enctype_name(uint16_t enctype) {
+  switch (enctype) {
+  case 16:
+    return "des3-cbc-sha1";
+  case 17:
+    return "aes128-cts-hmac-sha1-96";
+  case 18:
+    return "aes256-cts-hmac-sha1-96";
+  case 19:
+    return "aes128-cts-hmac-sha256-128";
+  case 20:
+    return "aes256-cts-hmac-sha384-192";
+  case 23:
+    return "arcfour-hmac";
+  case 25:
+    return "camellia128-cts-cmac";
+  case 26:
+    return "camellia256-cts-cmac";
+  default:
+    return "unknown";
+  }
+}
+
+#endif
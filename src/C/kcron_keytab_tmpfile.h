@@ -0,0 +1,215 @@
+/*
+ *
+ * Write a keytab as an unnamed O_TMPFILE in its directory and give it
+ * the keytab's name only once it is complete, so anyone opening the
+ * keytab sees either the old file or the whole new one.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_KEYTAB_TMPFILE_H
+#define KCRON_KEYTAB_TMPFILE_H 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "kcron_empty_keytab_file.h"
+#include "kcron_resolve.h"
+
+#ifndef _0600
+#define _0600 S_IRUSR | S_IWUSR
+#endif
+
+/* tries at a free temporary name before kcron_keytab_replace() gives up */
+#define KCRON_KEYTAB_TMPFILE_TRIES 16
+
+/*
+ * An unnamed file for a new keytab in dir_fd, flags is O_WRONLY or O_RDWR.
+ * Returns -1 with errno set, EOPNOTSUPP or EISDIR when the kernel or
+ * filesystem has no O_TMPFILE.
+ */
+int kcron_keytab_tmpfile(int dir_fd, int flags) __attribute__((warn_unused_result));
+int kcron_keytab_tmpfile(int dir_fd, int flags) { return openat_beneath(dir_fd, ".", O_TMPFILE | flags, _0600); }
+
+/* 1 when kcron_keytab_tmpfile() failed because O_TMPFILE is not there to use */
+int kcron_keytab_tmpfile_unsupported(int error) __attribute__((const));
+int kcron_keytab_tmpfile_unsupported(int error) { return error == EOPNOTSUPP || error == EISDIR || error == EINVAL; }
+
+/*
+ * Give the file behind filedescriptor the name in dir_fd.
+ * Returns 0 or an errno value, EEXIST when the name is taken.
+ */
+int kcron_keytab_link(int filedescriptor, int dir_fd, const char *name) __attribute__((nonnull(3))) __attribute__((warn_unused_result));
+int kcron_keytab_link(int filedescriptor, int dir_fd, const char *name) {
+
+  char proc_path[32] = {0};
+
+  /* AT_EMPTY_PATH wants CAP_DAC_READ_SEARCH before 6.10, /proc does not */
+  if (linkat(filedescriptor, "", dir_fd, name, AT_EMPTY_PATH) == 0) {
+    return 0;
+  }
+  if (errno != ENOENT && errno != EPERM) {
+    return errno;
+  }
+
+  (void)snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", filedescriptor);
+  if (linkat(AT_FDCWD, proc_path, dir_fd, name, AT_SYMLINK_FOLLOW) != 0) {
+    return errno;
+  }
+  return 0;
+}
+
+/*
+ * Without O_TMPFILE: a new file in dir_fd under a free ".name.pid.n", left
+ * in temp_name for a later renameat(2) over name or unlinkat(2).
+ * Returns -1 with errno set.
+ */
+int kcron_keytab_tempname(int dir_fd, const char *name, char *temp_name, size_t size, int flags) __attribute__((nonnull(2, 3))) __attribute__((access(write_only, 3, 4)))
+__attribute__((warn_unused_result));
+int kcron_keytab_tempname(int dir_fd, const char *name, char *temp_name, size_t size, int flags) {
+
+  int filedescriptor = -1;
+
+  errno = EEXIST;
+  for (unsigned int attempt = 0; attempt < KCRON_KEYTAB_TMPFILE_TRIES && filedescriptor < 0 && errno == EEXIST; attempt++) {
+    (void)snprintf(temp_name, size, ".%s.%d.%u", name, (int)getpid(), attempt);
+    filedescriptor = openat_beneath(dir_fd, temp_name, flags | O_CREAT | O_EXCL, _0600);
+  }
+  if (filedescriptor < 0) {
+    temp_name[0] = '\0';
+  }
+  return filedescriptor;
+}
+
+/*
+ * Fill the new file behind filedescriptor with a copy of name in dir_fd,
+ * or just the keytab header when name does not exist yet.
+ * Returns -1 with errno set.
+ */
+int kcron_keytab_copy_into(int filedescriptor, int dir_fd, const char *name) __attribute__((nonnull(3))) __attribute__((warn_unused_result));
+int kcron_keytab_copy_into(int filedescriptor, int dir_fd, const char *name) {
+
+  char buffer[4096] = {0};
+  ssize_t length = 0;
+  int source_fd = -1;
+  int error = 0;
+
+  source_fd = openat_beneath(dir_fd, name, O_RDONLY | O_NOFOLLOW, 0);
+  if (source_fd < 0) {
+    error = errno;
+    if (error == ENOENT && write_empty_keytab_nosync(filedescriptor) == 0) {
+      return 0;
+    }
+    errno = error;
+    return -1;
+  }
+
+  while ((length = read(source_fd, buffer, sizeof(buffer))) > 0) {
+    if (write(filedescriptor, buffer, (size_t)length) != length) {
+      length = -1;
+      break;
+    }
+  }
+  error = errno;
+  (void)close(source_fd);
+
+  if (length < 0) {
+    errno = (error == 0) ? EIO : error;
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * An unnamed O_RDWR copy of name in dir_fd to add keys to, holding just the
+ * keytab header when name does not exist yet.
+ * Returns -1 with errno set.
+ */
+int kcron_keytab_tmpfile_copy(int dir_fd, const char *name) __attribute__((nonnull(2))) __attribute__((warn_unused_result));
+int kcron_keytab_tmpfile_copy(int dir_fd, const char *name) {
+
+  int filedescriptor = -1;
+  int error = 0;
+
+  filedescriptor = kcron_keytab_tmpfile(dir_fd, O_RDWR);
+  if (filedescriptor < 0) {
+    return -1;
+  }
+
+  if (kcron_keytab_copy_into(filedescriptor, dir_fd, name) != 0) {
+    error = errno;
+    (void)close(filedescriptor);
+    errno = error;
+    return -1;
+  }
+  return filedescriptor;
+}
+
+/*
+ * Put the file behind filedescriptor in place of name in dir_fd, which
+ * need not exist yet.  RENAME(2) swaps the name over in one step, so it
+ * goes through a temporary name in the same directory first.
+ * Returns 0 or an errno value.
+ */
+int kcron_keytab_replace(int filedescriptor, int dir_fd, const char *name) __attribute__((nonnull(3))) __attribute__((warn_unused_result));
+int kcron_keytab_replace(int filedescriptor, int dir_fd, const char *name) {
+
+  char temp_name[FILE_PATH_MAX_LENGTH] = {0};
+  int error = EEXIST;
+
+  for (unsigned int attempt = 0; attempt < KCRON_KEYTAB_TMPFILE_TRIES && error == EEXIST; attempt++) {
+    (void)snprintf(temp_name, sizeof(temp_name), ".%s.%d.%u", name, (int)getpid(), attempt);
+    error = kcron_keytab_link(filedescriptor, dir_fd, temp_name);
+  }
+  if (error != 0) {
+    return error;
+  }
+
+  if (renameat(dir_fd, temp_name, dir_fd, name) != 0) {
+    error = errno;
+    (void)unlinkat(dir_fd, temp_name, 0);
+    return error;
+  }
+  return 0;
+}
+
+#endif
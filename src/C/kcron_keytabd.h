@@ -0,0 +1,73 @@
+/*
+ *
+ * A simple place where we keep the kcron-keytabd wire protocol
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_KEYTABD_H
+#define KCRON_KEYTABD_H 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+ * The request carries no data, the peer is identified with SO_PEERCRED.
+ * Replies are a single SOCK_SEQPACKET message of the form:
+ *   "0 /path/to/client.keytab"  on success
+ *   "1 some error text"         on failure
+ */
+#define KEYTABD_REQUEST "init"
+#define KEYTABD_REPLY_MAX_LENGTH (FILE_PATH_MAX_LENGTH + 3)
+
+int keytabd_sockaddr(struct sockaddr_un *addr) __attribute__((nonnull(1))) __attribute__((access(read_write, 1))) __attribute__((warn_unused_result));
+int keytabd_sockaddr(struct sockaddr_un *addr) {
+
+  (void)memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+
+  if (strlen(__KEYTABD_SOCKET) >= sizeof(addr->sun_path)) {
+    (void)fprintf(stderr, "%s: socket path %s is too long.\n", __PROGRAM_NAME, __KEYTABD_SOCKET);
+    return 1;
+  }
+
+  (void)snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", __KEYTABD_SOCKET);
+  return 0;
+}
+#endif
@@ -0,0 +1,237 @@
+/*
+ *
+ * A small reader for the krb5.conf(5) profile format.
+ *
+ * Only what kcron needs is kept: the default realm and every file or
+ * directory that was read to find it.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_KRB5CONF_H
+#define KCRON_KRB5CONF_H 1
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define KCRON_KRB5CONF_MAX_DEPTH 8
+#define KCRON_KRB5CONF_MAX_DEPS 64
+#define KCRON_KRB5CONF_VALUE_LENGTH 256
+
+struct kcron_krb5conf {
+  char default_realm[KCRON_KRB5CONF_VALUE_LENGTH];
+  char deps[KCRON_KRB5CONF_MAX_DEPS][FILE_PATH_MAX_LENGTH];
+  size_t num_deps;
+};
+
+static void kcron_krb5conf_add_dep(struct kcron_krb5conf *conf, const char *path) __attribute__((nonnull(1, 2)));
+static void kcron_krb5conf_add_dep(struct kcron_krb5conf *conf, const char *path) {
+  if (conf->num_deps < KCRON_KRB5CONF_MAX_DEPS) {
+    (void)snprintf(conf->deps[conf->num_deps++], FILE_PATH_MAX_LENGTH, "%s", path);
+  }
+}
+
+/* strip leading and trailing blanks in place */
+static char *kcron_krb5conf_trim(char *text) __attribute__((nonnull(1))) __attribute__((returns_nonnull));
+static char *kcron_krb5conf_trim(char *text) {
+  char *end = NULL;
+
+  while (isspace((unsigned char)*text)) {
+    text++;
+  }
+  end = text + strlen(text);
+  while (end > text && isspace((unsigned char)end[-1])) {
+    *--end = '\0';
+  }
+  return text;
+}
+
+/* libkrb5 only takes names of letters, digits, dashes and underscores, or ending in .conf */
+static int kcron_krb5conf_includable(const char *name) __attribute__((nonnull(1)));
+static int kcron_krb5conf_includable(const char *name) {
+  const size_t length = strlen(name);
+
+  if (length > 5 && strcmp(name + length - 5, ".conf") == 0) {
+    return 1;
+  }
+  for (const char *p = name; *p != '\0'; p++) {
+    if (!isalnum((unsigned char)*p) && *p != '-' && *p != '_') {
+      return 0;
+    }
+  }
+  return length > 0;
+}
+
+static int kcron_krb5conf_file(struct kcron_krb5conf *conf, const char *path, int depth) __attribute__((nonnull(1, 2)));
+
+static int kcron_krb5conf_dir(struct kcron_krb5conf *conf, const char *path, int depth) __attribute__((nonnull(1, 2)));
+static int kcron_krb5conf_dir(struct kcron_krb5conf *conf, const char *path, int depth) {
+  char file[FILE_PATH_MAX_LENGTH] = {0};
+  struct dirent **names = NULL;
+  int rc = 0;
+
+  const int count = scandir(path, &names, NULL, alphasort);
+  if (count < 0) {
+    return 0;
+  }
+  kcron_krb5conf_add_dep(conf, path);
+
+  for (int i = 0; i < count; i++) {
+    if (kcron_krb5conf_includable(names[i]->d_name) == 1) {
+      (void)snprintf(file, sizeof(file), "%s%s%s", path, (path[strlen(path) - 1] == '/') ? "" : "/", names[i]->d_name);
+      rc |= kcron_krb5conf_file(conf, file, depth + 1);
+    }
+    (void)free(names[i]);
+  }
+  (void)free(names);
+  return rc;
+}
+
+static int kcron_krb5conf_file(struct kcron_krb5conf *conf, const char *path, int depth) {
+
+  char line[FILE_PATH_MAX_LENGTH] = {0};
+  char section[KCRON_KRB5CONF_VALUE_LENGTH] = {0};
+  char *text = NULL;
+  char *equals = NULL;
+  char *tag = NULL;
+  char *value = NULL;
+  char *close = NULL;
+  int nesting = 0;
+  int rc = 0;
+
+  if (depth > KCRON_KRB5CONF_MAX_DEPTH) {
+    (void)fprintf(stderr, "%s: krb5.conf includes nest too deeply at %s\n", __PROGRAM_NAME, path);
+    return 1;
+  }
+
+  FILE *input = fopen(path, "re");
+  if (input == NULL) {
+    return 0;
+  }
+  kcron_krb5conf_add_dep(conf, path);
+
+  while (fgets(line, sizeof(line), input) != NULL) {
+    text = kcron_krb5conf_trim(line);
+
+    if (*text == '\0' || *text == '#' || *text == ';') {
+      continue;
+    }
+
+    if (strncmp(text, "includedir", 10) == 0 && isspace((unsigned char)text[10])) {
+      rc |= kcron_krb5conf_dir(conf, kcron_krb5conf_trim(text + 10), depth);
+      continue;
+    }
+    if (strncmp(text, "include", 7) == 0 && isspace((unsigned char)text[7])) {
+      rc |= kcron_krb5conf_file(conf, kcron_krb5conf_trim(text + 7), depth + 1);
+      continue;
+    }
+
+    if (*text == '[') {
+      close = strchr(text, ']');
+      if (close != NULL) {
+        *close = '\0';
+        (void)snprintf(section, sizeof(section), "%s", kcron_krb5conf_trim(text + 1));
+        nesting = 0;
+      }
+      continue;
+    }
+
+    if (*text == '}') {
+      if (nesting > 0) {
+        nesting--;
+      }
+      continue;
+    }
+
+    equals = strchr(text, '=');
+    if (equals == NULL) {
+      continue;
+    }
+    *equals = '\0';
+    tag = kcron_krb5conf_trim(text);
+    value = kcron_krb5conf_trim(equals + 1);
+
+    /* [realms] and [domain_realm] are made of these, skip what is inside */
+    if (*value == '{') {
+      nesting++;
+      continue;
+    }
+
+    /* a trailing '*' marks the value final, it changes nothing for us */
+    if (strlen(value) > 1 && value[strlen(value) - 1] == '*') {
+      value[strlen(value) - 1] = '\0';
+      value = kcron_krb5conf_trim(value);
+    }
+    if (value[0] == '"' && strlen(value) > 1 && value[strlen(value) - 1] == '"') {
+      value[strlen(value) - 1] = '\0';
+      value++;
+    }
+
+    /* like libkrb5, the first value seen wins */
+    if (nesting == 0 && strcmp(section, "libdefaults") == 0 && strcmp(tag, "default_realm") == 0 && conf->default_realm[0] == '\0') {
+      (void)snprintf(conf->default_realm, sizeof(conf->default_realm), "%s", value);
+    }
+  }
+
+  (void)fclose(input);
+  return rc;
+}
+
+/*
+ * Read every file in a KRB5_CONFIG style colon separated list.
+ * Missing files are skipped, just as libkrb5 does.
+ */
+int kcron_krb5conf_load(const char *path_list, struct kcron_krb5conf *conf) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+int kcron_krb5conf_load(const char *path_list, struct kcron_krb5conf *conf) {
+  char paths[FILE_PATH_MAX_LENGTH] = {0};
+  char *saveptr = NULL;
+  int rc = 0;
+
+  (void)memset(conf, 0, sizeof(*conf));
+  (void)snprintf(paths, sizeof(paths), "%s", path_list);
+
+  for (char *path = strtok_r(paths, ":", &saveptr); path != NULL; path = strtok_r(NULL, ":", &saveptr)) {
+    rc |= kcron_krb5conf_file(conf, path, 0);
+  }
+
+  return rc;
+}
+
+#endif
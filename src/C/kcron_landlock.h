@@ -48,16 +48,22 @@
 #include <linux/landlock.h>
 #include <sys/syscall.h>
 
-void set_kcron_landlock(void) __attribute__((flatten));
-void set_kcron_landlock(void) {
+/* what each profile may do beneath the parent of the client keytab directory */
+#define KCRON_LANDLOCK_INIT_ACCESS                                                                                                                                         \
+  (LANDLOCK_ACCESS_FS_WRITE_FILE | LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR | LANDLOCK_ACCESS_FS_MAKE_DIR | LANDLOCK_ACCESS_FS_MAKE_REG)
+#define KCRON_LANDLOCK_STATUS_ACCESS (LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR)
+#define KCRON_LANDLOCK_NO_ACCESS 0
+
+/* an allowed_access of KCRON_LANDLOCK_NO_ACCESS denies the whole filesystem */
+void set_kcron_landlock_access(__u64 allowed_access) __attribute__((flatten));
+void set_kcron_landlock_access(__u64 allowed_access) {
 
   int landlock_ruleset_fd = 0;
   long int landlock_error = 0;
 
   long int landlock_abi = syscall(__NR_landlock_create_ruleset, NULL, 0, LANDLOCK_CREATE_RULESET_VERSION);
 
-  char *client_keytab_dirname = calloc(FILE_PATH_MAX_LENGTH + 3, sizeof(char));
-  const char *nullstring = NULL;
+  static char client_keytab_dirname[FILE_PATH_MAX_LENGTH + 3];
 
   struct landlock_ruleset_attr ruleset_attr = {
       .handled_access_fs = LANDLOCK_ACCESS_FS_EXECUTE | LANDLOCK_ACCESS_FS_WRITE_FILE | LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR |
@@ -67,21 +73,14 @@ void set_kcron_landlock(void) {
   };
 
   struct landlock_path_beneath_attr path_beneath = {
-      .allowed_access = LANDLOCK_ACCESS_FS_WRITE_FILE | LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR | LANDLOCK_ACCESS_FS_MAKE_DIR | LANDLOCK_ACCESS_FS_MAKE_REG,
+      .allowed_access = allowed_access,
   };
 
-  /* verify memory can be allocated */
-  if (client_keytab_dirname == nullstring) {
-    (void)fprintf(stderr, "%s: Unable to allocate memory.\n", __PROGRAM_NAME);
-    exit(EXIT_FAILURE);
-  }
-
   /* landlock unsupported, this is not an error exactly */
   if (landlock_abi > 0) {
 
-    if (get_client_dirname(client_keytab_dirname) != 0) {
+    if (allowed_access != KCRON_LANDLOCK_NO_ACCESS && get_client_dirname(client_keytab_dirname) != 0) {
       (void)fprintf(stderr, "%s: Client keytab directory not set.\n", __PROGRAM_NAME);
-      (void)free(client_keytab_dirname);
       (void)close(landlock_ruleset_fd);
       exit(EXIT_FAILURE);
     }
@@ -89,32 +88,30 @@ void set_kcron_landlock(void) {
     landlock_ruleset_fd = (int)syscall(__NR_landlock_create_ruleset, &ruleset_attr, sizeof(ruleset_attr), 0);
     if (landlock_ruleset_fd < 0) {
       (void)fprintf(stderr, "%s: landlock is enabled but non-functional?\n", __PROGRAM_NAME);
-      (void)free(client_keytab_dirname);
       (void)close(landlock_ruleset_fd);
       exit(EXIT_FAILURE);
     }
 
-    path_beneath.parent_fd = open(dirname(client_keytab_dirname), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
-    if (path_beneath.parent_fd < 0) {
-      (void)fprintf(stderr, "%s: landlock could not find %s?\n", __PROGRAM_NAME, client_keytab_dirname);
-      (void)free(client_keytab_dirname);
-      (void)close(landlock_ruleset_fd);
-      exit(EXIT_FAILURE);
-    }
-
-    landlock_error = syscall(__NR_landlock_add_rule, landlock_ruleset_fd, LANDLOCK_RULE_PATH_BENEATH, &path_beneath, 0);
-    (void)close(path_beneath.parent_fd);
-
-    if (landlock_error) {
-      (void)fprintf(stderr, "%s: landlock could not apply ruleset to %s?\n", __PROGRAM_NAME, client_keytab_dirname);
-      (void)free(client_keytab_dirname);
-      (void)close(landlock_ruleset_fd);
-      exit(EXIT_FAILURE);
+    if (allowed_access != KCRON_LANDLOCK_NO_ACCESS) {
+      path_beneath.parent_fd = open(dirname(client_keytab_dirname), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+      if (path_beneath.parent_fd < 0) {
+        (void)fprintf(stderr, "%s: landlock could not find %s?\n", __PROGRAM_NAME, client_keytab_dirname);
+        (void)close(landlock_ruleset_fd);
+        exit(EXIT_FAILURE);
+      }
+
+      landlock_error = syscall(__NR_landlock_add_rule, landlock_ruleset_fd, LANDLOCK_RULE_PATH_BENEATH, &path_beneath, 0);
+      (void)close(path_beneath.parent_fd);
+
+      if (landlock_error) {
+        (void)fprintf(stderr, "%s: landlock could not apply ruleset to %s?\n", __PROGRAM_NAME, client_keytab_dirname);
+        (void)close(landlock_ruleset_fd);
+        exit(EXIT_FAILURE);
+      }
     }
 
     if (syscall(__NR_landlock_restrict_self, landlock_ruleset_fd, 0)) {
       (void)fprintf(stderr, "%s: landlock could not apply ruleset to self?\n", __PROGRAM_NAME);
-      (void)free(client_keytab_dirname);
       (void)close(landlock_ruleset_fd);
       exit(EXIT_FAILURE);
     }
@@ -122,4 +119,7 @@ void set_kcron_landlock(void) {
     (void)close(landlock_ruleset_fd);
   }
 }
+
+void set_kcron_landlock(void) __attribute__((flatten));
+void set_kcron_landlock(void) { set_kcron_landlock_access(KCRON_LANDLOCK_INIT_ACCESS); }
 #endif
@@ -0,0 +1,75 @@
+/*
+ *
+ * Pick up the socket systemd opened for us, see SD_LISTEN_FDS(3).
+ * We don't need all of libsystemd for this.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_LISTEN_H
+#define KCRON_LISTEN_H 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define SD_LISTEN_FDS_START 3
+
+int get_listen_fd(void) __attribute__((warn_unused_result));
+int get_listen_fd(void) {
+
+  const char *nullstring = NULL;
+  const char *listen_pid = getenv("LISTEN_PID");
+  const char *listen_fds = getenv("LISTEN_FDS");
+
+  if ((listen_pid == nullstring) || (listen_fds == nullstring)) {
+    (void)fprintf(stderr, "%s: not started from a systemd socket.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  if (strtol(listen_pid, NULL, 10) != (long)getpid()) {
+    (void)fprintf(stderr, "%s: LISTEN_PID is not for us.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  if (strtol(listen_fds, NULL, 10) != 1) {
+    (void)fprintf(stderr, "%s: expected exactly one socket from systemd.\n", __PROGRAM_NAME);
+    return -1;
+  }
+
+  return SD_LISTEN_FDS_START;
+}
+#endif
@@ -0,0 +1,181 @@
+/*
+ *
+ * A simple place where we keep one pass over the NSS passwd database
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_NSS_H
+#define KCRON_NSS_H 1
+
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/*
+ * Walking a large LDAP/SSSD directory one getpwuid() at a time is slow,
+ * so tools that touch many users load the passwd database once.
+ * Note SSSD only answers getpwent() with 'enumerate = true'.
+ */
+struct kcron_nss_user {
+  uid_t uid;
+  gid_t gid;
+  char *name;
+};
+
+struct kcron_nss_cache {
+  struct kcron_nss_user *users;
+  struct kcron_nss_user **by_name;
+  size_t count;
+};
+
+static int kcron_nss_cmp_uid(const void *a, const void *b) {
+  const struct kcron_nss_user *left = a;
+  const struct kcron_nss_user *right = b;
+  return (left->uid > right->uid) - (left->uid < right->uid);
+}
+
+static int kcron_nss_cmp_name(const void *a, const void *b) {
+  const struct kcron_nss_user *const *left = a;
+  const struct kcron_nss_user *const *right = b;
+  return strcmp((*left)->name, (*right)->name);
+}
+
+void kcron_nss_free(struct kcron_nss_cache *cache) __attribute__((nonnull(1)));
+void kcron_nss_free(struct kcron_nss_cache *cache) {
+  for (size_t i = 0; i < cache->count; i++) {
+    (void)free(cache->users[i].name);
+  }
+  (void)free(cache->users);
+  (void)free(cache->by_name);
+  cache->users = NULL;
+  cache->by_name = NULL;
+  cache->count = 0;
+}
+
+int kcron_nss_load(struct kcron_nss_cache *cache) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_nss_load(struct kcron_nss_cache *cache) {
+
+  const struct passwd *pw = NULL;
+  struct kcron_nss_user *grown = NULL;
+  size_t allocated = 0;
+  size_t unique = 0;
+
+  cache->users = NULL;
+  cache->by_name = NULL;
+  cache->count = 0;
+
+  setpwent();
+  while ((pw = getpwent()) != NULL) {
+    if (cache->count == allocated) {
+      allocated = (allocated == 0) ? 1024 : allocated * 2;
+      grown = realloc(cache->users, allocated * sizeof(struct kcron_nss_user));
+      if (grown == NULL) {
+        endpwent();
+        kcron_nss_free(cache);
+        (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+        return 1;
+      }
+      cache->users = grown;
+    }
+
+    cache->users[cache->count].uid = pw->pw_uid;
+    cache->users[cache->count].gid = pw->pw_gid;
+    cache->users[cache->count].name = strdup(pw->pw_name);
+    if (cache->users[cache->count].name == NULL) {
+      endpwent();
+      kcron_nss_free(cache);
+      (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    cache->count++;
+  }
+  endpwent();
+
+  if (cache->count == 0) {
+    return 0;
+  }
+
+  /* like getpwuid(), the first entry for a uid wins */
+  qsort(cache->users, cache->count, sizeof(struct kcron_nss_user), kcron_nss_cmp_uid);
+  unique = 1;
+  for (size_t i = 1; i < cache->count; i++) {
+    if (cache->users[i].uid == cache->users[unique - 1].uid) {
+      (void)free(cache->users[i].name);
+      continue;
+    }
+    cache->users[unique++] = cache->users[i];
+  }
+  cache->count = unique;
+
+  cache->by_name = calloc(cache->count, sizeof(struct kcron_nss_user *));
+  if (cache->by_name == NULL) {
+    kcron_nss_free(cache);
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  for (size_t i = 0; i < cache->count; i++) {
+    cache->by_name[i] = &cache->users[i];
+  }
+  qsort(cache->by_name, cache->count, sizeof(struct kcron_nss_user *), kcron_nss_cmp_name);
+
+  return 0;
+}
+
+const struct kcron_nss_user *kcron_nss_by_uid(const struct kcron_nss_cache *cache, uid_t uid) __attribute__((nonnull(1)));
+const struct kcron_nss_user *kcron_nss_by_uid(const struct kcron_nss_cache *cache, uid_t uid) {
+  const struct kcron_nss_user key = {.uid = uid};
+  if (cache->count == 0) {
+    return NULL;
+  }
+  return bsearch(&key, cache->users, cache->count, sizeof(struct kcron_nss_user), kcron_nss_cmp_uid);
+}
+
+const struct kcron_nss_user *kcron_nss_by_name(const struct kcron_nss_cache *cache, const char *name) __attribute__((nonnull(1, 2)));
+const struct kcron_nss_user *kcron_nss_by_name(const struct kcron_nss_cache *cache, const char *name) {
+  const struct kcron_nss_user key = {.name = (char *)name};
+  const struct kcron_nss_user *keyp = &key;
+  struct kcron_nss_user *const *found = NULL;
+
+  if (cache->count == 0) {
+    return NULL;
+  }
+  found = bsearch(&keyp, cache->by_name, cache->count, sizeof(struct kcron_nss_user *), kcron_nss_cmp_name);
+  return (found == NULL) ? NULL : *found;
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+ *
+ * Where we keep our per-stage USDT probe points
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_PROBES_H
+#define KCRON_PROBES_H 1
+
+/*
+ * Every stage fires kcron:stage__entry(stage) when it starts and
+ * kcron:stage__return(stage, rc) when it is done.  The numbers are part of
+ * the interface of src/trace/ so only ever append to this list.
+ */
+enum kcron_stage {
+  KCRON_STAGE_ULIMITS = 1,
+  KCRON_STAGE_LANDLOCK = 2,
+  KCRON_STAGE_SECCOMP = 3,
+  KCRON_STAGE_FILENAMES = 4,
+  KCRON_STAGE_MKDIR = 5,
+  KCRON_STAGE_OPENAT = 6,
+  KCRON_STAGE_FSYNC = 7,
+  KCRON_STAGE_CHOWN_CHMOD = 8
+};
+
+#define KCRON_STAGE_ENTRY(stage) DTRACE_PROBE1(kcron, stage__entry, stage)
+#define KCRON_STAGE_RETURN(stage, rc) DTRACE_PROBE2(kcron, stage__return, stage, rc)
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ *
+ * Where we resolve the keytab directory and file relative to one
+ * descriptor for the client keytab directory, see OPENAT2(2).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_RESOLVE_H
+#define KCRON_RESOLVE_H 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if HAVE_OPENAT2_H == 1
+#include <linux/openat2.h>
+#endif
+
+/* set once the kernel tells us it has no openat2 */
+static int kcron_no_openat2 = 0;
+
+int open_client_dir(void) __attribute__((warn_unused_result));
+int open_client_dir(void) {
+  /* the one and only full path walk */
+  const int client_fd = open(__CLIENT_KEYTAB_DIR, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+  if (client_fd < 0) {
+    (void)fprintf(stderr, "%s: Client keytab directory does not exist: %s.\n", __PROGRAM_NAME, __CLIENT_KEYTAB_DIR);
+    (void)fprintf(stderr, "%s: Contact your admin to have it created.\n", __PROGRAM_NAME);
+  }
+
+  return client_fd;
+}
+
+int openat_beneath(int dir_fd, const char *name, int flags, mode_t mode) __attribute__((nonnull(2))) __attribute__((access(read_only, 2))) __attribute__((warn_unused_result));
+int openat_beneath(int dir_fd, const char *name, int flags, mode_t mode) {
+
+#if HAVE_OPENAT2_H == 1 && defined(__NR_openat2)
+  struct open_how how = {0};
+  long filedescriptor = -1;
+
+  if (kcron_no_openat2 == 0) {
+    how.flags = (__u64)(flags | O_NOFOLLOW | O_CLOEXEC);
+    how.mode = ((flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE) ? mode : 0;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS | RESOLVE_NO_MAGICLINKS;
+
+    filedescriptor = syscall(__NR_openat2, dir_fd, name, &how, sizeof(how));
+    if (filedescriptor >= 0 || errno != ENOSYS) {
+      return (int)filedescriptor;
+    }
+    kcron_no_openat2 = 1;
+  }
+#endif
+
+  /* Older kernel, a single name with O_NOFOLLOW cannot leave dir_fd */
+  /* and an O_TMPFILE in "." has no name to leave it by                */
+  if (strchr(name, '/') != NULL || strcmp(name, "..") == 0 || (strcmp(name, ".") == 0 && (flags & O_TMPFILE) != O_TMPFILE)) {
+    errno = EXDEV;
+    return -1;
+  }
+
+  return openat(dir_fd, name, flags | O_NOFOLLOW | O_CLOEXEC, mode);
+}
+
+#endif
@@ -41,172 +41,36 @@
 #ifndef KCRON_SECCOMP_H
 #define KCRON_SECCOMP_H 1
 
-#include <seccomp.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/prctl.h>
 
-#include <sys/stat.h>
+/* generated at build time from kcron_seccomp_rules.h by kcron-seccomp-bpf */
+#include "kcron_seccomp_bpf.h"
 
-#ifndef _0600
-#define _0600 S_IRUSR | S_IWUSR
-#endif
-
-int set_kcron_seccomp(void) __attribute__((warn_unused_result)) __attribute__((flatten));
-int set_kcron_seccomp(void) {
-
-  scmp_filter_ctx ctx = seccomp_init(SCMP_ACT_KILL); /* default action: kill */
-
-  if (ctx == NULL) {
-    exit(EXIT_FAILURE);
-  }
-
-  /* Basic features */
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(rt_sigreturn), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'rt_sigreturn'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(brk), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'brk'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(exit), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'exit'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(exit_group), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'exit_group'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-
-  /* Permitted actions */
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(geteuid), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'geteuid'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(getuid), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'getuid'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(getgid), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'getgid'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
+/* generated filters are a static array, this is their instruction count */
+#define KCRON_SECCOMP_LEN(filter) (sizeof(filter) / sizeof((filter)[0]))
 
-  /*
-   * STDOUT
-   */
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1, SCMP_A0(SCMP_CMP_EQ, 1)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'write' to stdout.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-
-  /*
-   * STDERR
-   */
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1, SCMP_A0(SCMP_CMP_EQ, 2)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'write' to stderr.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
+int set_kcron_seccomp_filter(const struct sock_filter *filter, size_t len) __attribute__((nonnull(1))) __attribute__((warn_unused_result)) __attribute__((flatten));
+int set_kcron_seccomp_filter(const struct sock_filter *filter, size_t len) {
 
-  /*
-   *   Our directory handle
-   */
-
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(openat), 0) != 0) {
-    /* not sure how to restrict this to the args I want */
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'openat'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
+  const struct sock_fprog program = {
+      .len = (unsigned short)len,
+      .filter = (struct sock_filter *)filter,
+  };
 
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(close), 1, SCMP_A0(SCMP_CMP_EQ, 3)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'close'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
+  /* no_new_privs is already set by harden_runtime */
+  if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program, 0, 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot load seccomp filter.\n", __PROGRAM_NAME);
+    return 1;
   }
 
-  /*
-   *   Our file handle
-   */
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1, SCMP_A0(SCMP_CMP_EQ, 4)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'write' to our file handle.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(close), 1, SCMP_A0(SCMP_CMP_EQ, 4)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'close'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fsync), 1, SCMP_A0(SCMP_CMP_EQ, 4)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'fsync' on file handle.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fchmod), 2, SCMP_A0(SCMP_CMP_EQ, 4), SCMP_A1(SCMP_CMP_EQ, _0600)) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'fchmod' for mode 0600 only.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-
-  /*
-   *   General usage, not sure how to restrict these to the args I want....
-   */
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fstat), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'fstat'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(stat), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'stat'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(newfstatat), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'newfstatat'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(mkdir), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'mkdir'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fchown), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'fchown'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-
-#if USE_CAPABILITIES == 1
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(capget), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'capget'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(capset), 0) != 0) {
-    (void)fprintf(stderr, "%s: Cannot set allowlist 'capset'.\n", __PROGRAM_NAME);
-    (void)seccomp_release(ctx);
-    exit(EXIT_FAILURE);
-  }
-#endif
-
-  /* Load rules */
-  (void)seccomp_load(ctx);
-
-  /* Release memory */
-  (void)seccomp_release(ctx);
-
   return 0;
 }
 
+int set_kcron_seccomp(void) __attribute__((warn_unused_result)) __attribute__((flatten));
+int set_kcron_seccomp(void) { return set_kcron_seccomp_filter(kcron_seccomp_filter, KCRON_SECCOMP_LEN(kcron_seccomp_filter)); }
+
 #endif
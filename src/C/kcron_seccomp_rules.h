@@ -0,0 +1,373 @@
+/*
+ *
+ * The seccomp allowlist for init-kcron-keytab.
+ *
+ * This is only compiled into the build time filter generator and the tests,
+ * the installed binaries load the BPF program it produces.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_SECCOMP_RULES_H
+#define KCRON_SECCOMP_RULES_H 1
+
+#include <fcntl.h>
+#include <linux/filter.h>
+#include <seccomp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+
+#include "kcron_fdpass.h"
+#include "kcron_filename.h"
+
+#ifndef _0600
+#define _0600 S_IRUSR | S_IWUSR
+#endif
+
+/*
+ * Every profile below starts from these: exit, the heap, our ids and
+ * writing to stdout/stderr.  `kcron name` needs nothing more.
+ */
+int kcron_seccomp_add_common_rules(scmp_filter_ctx ctx) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_seccomp_add_common_rules(scmp_filter_ctx ctx) {
+
+  /* Basic features */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(rt_sigreturn), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'rt_sigreturn'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(brk), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'brk'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  /* glibc seeds malloc with this on the first allocation, which is after */
+  /* the filter is loaded when landlock has not already called malloc     */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(getrandom), 1, SCMP_A2(SCMP_CMP_EQ, GRND_NONBLOCK)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'getrandom'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(exit), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'exit'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(exit_group), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'exit_group'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /* Permitted actions */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(geteuid), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'geteuid'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(getuid), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'getuid'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(getgid), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'getgid'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /*
+   * STDOUT
+   */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1, SCMP_A0(SCMP_CMP_EQ, 1)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'write' to stdout.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  /* stdio asks if stdout is a terminal before the first printf */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(ioctl), 2, SCMP_A0(SCMP_CMP_EQ, 1), SCMP_A1(SCMP_CMP_EQ, TCGETS)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'ioctl' TCGETS on stdout.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /*
+   * STDERR
+   */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1, SCMP_A0(SCMP_CMP_EQ, 2)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'write' to stderr.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  return 0;
+}
+
+/* init-kcron-keytab and `kcron init`, makes the directories and keytab */
+int kcron_seccomp_add_rules(scmp_filter_ctx ctx) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_seccomp_add_rules(scmp_filter_ctx ctx) {
+
+  if (kcron_seccomp_add_common_rules(ctx) != 0) {
+    return 1;
+  }
+
+  /*
+   *   Our directory handle
+   */
+
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(openat), 0) != 0) {
+    /* not sure how to restrict this to the args I want */
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'openat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+#ifdef __NR_openat2
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(openat2), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'openat2'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+#endif
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(mkdirat), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'mkdirat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /*
+   *   Our file handle, we hold at most the client dir, the user dir and
+   *   the keytab at once so the keytab lands on 3 or 4 (see RLIMIT_NOFILE)
+   */
+  for (unsigned int fd = 3; fd <= 4; fd++) {
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(close), 1, SCMP_A0(SCMP_CMP_EQ, fd)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'close'.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1, SCMP_A0(SCMP_CMP_EQ, fd)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'write' to our file handle.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fsync), 1, SCMP_A0(SCMP_CMP_EQ, fd)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'fsync' on file handle.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    /* the finished O_TMPFILE keytab gets its name, see kcron_keytab_link() */
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(linkat), 3, SCMP_A0(SCMP_CMP_EQ, fd), SCMP_A2(SCMP_CMP_LE, 4), SCMP_A4(SCMP_CMP_EQ, AT_EMPTY_PATH)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'linkat' from our file handle.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(linkat), 2, SCMP_A2(SCMP_CMP_EQ, fd), SCMP_A4(SCMP_CMP_EQ, AT_SYMLINK_FOLLOW)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'linkat' through /proc/self/fd.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fchmod), 2, SCMP_A0(SCMP_CMP_EQ, fd), SCMP_A1(SCMP_CMP_EQ, _0600)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'fchmod' for mode 0600 only.\n", __PROGRAM_NAME);
+      return 1;
+    }
+#if __CLIENT_KEYTAB_SHARDS > 0
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fchmod), 2, SCMP_A0(SCMP_CMP_EQ, fd), SCMP_A1(SCMP_CMP_EQ, KCRON_SHARD_MODE)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'fchmod' for new shard directories.\n", __PROGRAM_NAME);
+      return 1;
+    }
+#endif
+  }
+
+  /* 'init-kcron-keytab -s' hands its caller the keytab directory */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(sendmsg), 2, SCMP_A0(SCMP_CMP_EQ, KCRON_FDPASS_SOCKET), SCMP_A2(SCMP_CMP_EQ, MSG_NOSIGNAL)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'sendmsg' to our caller.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  /*
+   *   General usage, not sure how to restrict these to the args I want....
+   */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fstat), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'fstat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(stat), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'stat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(newfstatat), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'newfstatat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(mkdir), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'mkdir'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fchown), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'fchown'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+#if USE_CAPABILITIES == 1
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(capget), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'capget'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(capset), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'capset'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+#endif
+
+  return 0;
+}
+
+/* `kcron name`, computes a path and prints it */
+int kcron_seccomp_add_name_rules(scmp_filter_ctx ctx) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_seccomp_add_name_rules(scmp_filter_ctx ctx) {
+
+  if (kcron_seccomp_add_common_rules(ctx) != 0) {
+    return 1;
+  }
+
+  /* stdio looks at stdout before the first printf and nothing else */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fstat), 1, SCMP_A0(SCMP_CMP_EQ, 1)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'fstat' on stdout.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(newfstatat), 1, SCMP_A0(SCMP_CMP_EQ, 1)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'newfstatat' on stdout.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  return 0;
+}
+
+/* `kcron status`, reads the keytab but may not change anything */
+int kcron_seccomp_add_status_rules(scmp_filter_ctx ctx) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_seccomp_add_status_rules(scmp_filter_ctx ctx) {
+
+  if (kcron_seccomp_add_common_rules(ctx) != 0) {
+    return 1;
+  }
+
+  /* read only opens, O_TMPFILE needs a write mode so it is excluded as well */
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(openat), 1, SCMP_A2(SCMP_CMP_MASKED_EQ, O_ACCMODE | O_CREAT | O_TRUNC, O_RDONLY)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'openat' read only.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  for (unsigned int fd = 3; fd <= 4; fd++) {
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(close), 1, SCMP_A0(SCMP_CMP_EQ, fd)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'close'.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    /* kcron_keytab_map_at() maps the keytab to count the entries */
+    if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(mmap), 3, SCMP_A2(SCMP_CMP_EQ, PROT_READ), SCMP_A3(SCMP_CMP_EQ, MAP_PRIVATE), SCMP_A4(SCMP_CMP_EQ, fd)) != 0) {
+      (void)fprintf(stderr, "%s: Cannot set allowlist 'mmap' read only.\n", __PROGRAM_NAME);
+      return 1;
+    }
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(munmap), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'munmap'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(fstat), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'fstat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, SCMP_SYS(newfstatat), 0) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set allowlist 'newfstatat'.\n", __PROGRAM_NAME);
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * The profiles kcron-seccomp-bpf compiles, each becomes a
+ * `static const struct sock_filter <name>[]` in kcron_seccomp_bpf.h.
+ */
+struct kcron_seccomp_profile {
+  const char *name;
+  int (*add_rules)(scmp_filter_ctx ctx);
+};
+
+static const struct kcron_seccomp_profile kcron_seccomp_profiles[] = {
+    {"kcron_seccomp_filter", kcron_seccomp_add_rules},
+    {"kcron_seccomp_filter_name", kcron_seccomp_add_name_rules},
+    {"kcron_seccomp_filter_status", kcron_seccomp_add_status_rules},
+};
+
+#define KCRON_SECCOMP_NUM_PROFILES (sizeof(kcron_seccomp_profiles) / sizeof(kcron_seccomp_profiles[0]))
+
+scmp_filter_ctx kcron_seccomp_build_profile(const struct kcron_seccomp_profile *profile) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+scmp_filter_ctx kcron_seccomp_build_profile(const struct kcron_seccomp_profile *profile) {
+
+  scmp_filter_ctx ctx = seccomp_init(SCMP_ACT_KILL); /* default action: kill */
+
+  if (ctx == NULL) {
+    (void)fprintf(stderr, "%s: Cannot initialize seccomp filter.\n", __PROGRAM_NAME);
+    return NULL;
+  }
+
+  if (profile->add_rules(ctx) != 0) {
+    (void)fprintf(stderr, "%s: Cannot build seccomp profile %s.\n", __PROGRAM_NAME, profile->name);
+    (void)seccomp_release(ctx);
+    return NULL;
+  }
+
+  return ctx;
+}
+
+size_t kcron_seccomp_export(scmp_filter_ctx ctx, struct sock_filter *program, size_t max_len) __attribute__((nonnull(1, 2))) __attribute__((warn_unused_result));
+size_t kcron_seccomp_export(scmp_filter_ctx ctx, struct sock_filter *program, size_t max_len) {
+
+  /* libseccomp only exports to a file descriptor */
+  FILE *exported = tmpfile();
+  size_t len = 0;
+
+  if (exported == NULL) {
+    (void)fprintf(stderr, "%s: Cannot create temporary file.\n", __PROGRAM_NAME);
+    return 0;
+  }
+
+  if (seccomp_export_bpf(ctx, fileno(exported)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot export seccomp filter.\n", __PROGRAM_NAME);
+    (void)fclose(exported);
+    return 0;
+  }
+
+  rewind(exported);
+  len = fread(program, sizeof(struct sock_filter), max_len, exported);
+  if (len == max_len && fgetc(exported) != EOF) {
+    (void)fprintf(stderr, "%s: Seccomp filter is larger than %zu instructions.\n", __PROGRAM_NAME, max_len);
+    len = 0;
+  }
+
+  (void)fclose(exported);
+  return len;
+}
+
+#endif
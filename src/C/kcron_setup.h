@@ -46,6 +46,7 @@
 #include <sys/prctl.h>
 #include <sys/ptrace.h>
 #include <sys/resource.h>
+#include <unistd.h>
 
 #if USE_SECCOMP == 1
 #include "kcron_seccomp.h"
@@ -56,9 +57,21 @@
 #endif
 
 #include "kcron_caps.h"
+#include "kcron_probes.h"
 
-int set_kcron_ulimits(void) __attribute__((warn_unused_result)) __attribute__((flatten));
-int set_kcron_ulimits(void) {
+/*
+ * What the rest of the process is going to do, each gets its own seccomp
+ * filter and landlock ruleset.  Only KCRON_PROFILE_INIT keeps the
+ * privileges it was started with.
+ */
+enum kcron_profile {
+  KCRON_PROFILE_INIT = 0,
+  KCRON_PROFILE_NAME,
+  KCRON_PROFILE_STATUS,
+};
+
+int set_kcron_ulimits(enum kcron_profile profile) __attribute__((warn_unused_result)) __attribute__((flatten));
+int set_kcron_ulimits(enum kcron_profile profile) {
 
   const struct rlimit proc = {0, 0};
   if (setrlimit(RLIMIT_NPROC, &proc) != 0) {
@@ -66,8 +79,9 @@ int set_kcron_ulimits(void) {
     return 1;
   }
 
+  /* only init writes a file, the others may print to a log of any size */
   const struct rlimit filesize = {64, 64};
-  if (setrlimit(RLIMIT_FSIZE, &filesize) != 0) {
+  if (profile == KCRON_PROFILE_INIT && setrlimit(RLIMIT_FSIZE, &filesize) != 0) {
     (void)fprintf(stderr, "%s: Cannot lower max file size.\n", __PROGRAM_NAME);
     return 1;
   }
@@ -112,13 +126,49 @@ int set_kcron_ulimits(void) {
   return 0;
 }
 
-void harden_runtime(void) __attribute__((flatten));
-void harden_runtime(void) {
+/* back to the invoking user for good, setuid and file capabilities alike */
+int drop_privileges(void) __attribute__((warn_unused_result)) __attribute__((flatten));
+int drop_privileges(void) {
+
+  const uid_t uid = getuid();
+  const gid_t gid = getgid();
+
+  if (getegid() != gid && setresgid(gid, gid, gid) != 0) {
+    (void)fprintf(stderr, "%s: Cannot reset group to %u.\n", __PROGRAM_NAME, (unsigned)gid);
+    return 1;
+  }
+
+  if (geteuid() != uid && setresuid(uid, uid, uid) != 0) {
+    (void)fprintf(stderr, "%s: Cannot reset user to %u.\n", __PROGRAM_NAME, (unsigned)uid);
+    return 1;
+  }
+
+  return drop_capabilities();
+}
+
+static char kcron_stdout_buffer[BUFSIZ];
+
+void harden_runtime_for(enum kcron_profile profile) __attribute__((flatten));
+void harden_runtime_for(enum kcron_profile profile) {
+
+  int rc = 0;
+
   if (freopen("/dev/null", "r", stdin) == NULL) {
     (void)fprintf(stderr, "%s: Cannot reset stdin to /dev/null.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
+  /* stdio would malloc a buffer for the first printf, it gets this one */
+  if (setvbuf(stdout, kcron_stdout_buffer, _IOFBF, sizeof(kcron_stdout_buffer)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set a buffer for stdout.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (profile != KCRON_PROFILE_INIT && drop_privileges() != 0) {
+    (void)fprintf(stderr, "%s: Cannot drop privileges.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
   if (prctl(PR_SET_DUMPABLE, 0) != 0) {
     (void)fprintf(stderr, "%s: Cannot disable core dumps.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
@@ -134,18 +184,46 @@ void harden_runtime(void) {
     exit(EXIT_FAILURE);
   }
 
-  if (set_kcron_ulimits() != 0) {
+  KCRON_STAGE_ENTRY(KCRON_STAGE_ULIMITS);
+  rc = set_kcron_ulimits(profile);
+  KCRON_STAGE_RETURN(KCRON_STAGE_ULIMITS, rc);
+  if (rc != 0) {
     (void)fprintf(stderr, "%s: Cannot set ulimits.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
 
 #if USE_LANDLOCK == 1
   /* do landlock before seccomp so the tools to change it become unreachable */
-  (void)set_kcron_landlock();
+  KCRON_STAGE_ENTRY(KCRON_STAGE_LANDLOCK);
+  switch (profile) {
+  case KCRON_PROFILE_NAME:
+    (void)set_kcron_landlock_access(KCRON_LANDLOCK_NO_ACCESS);
+    break;
+  case KCRON_PROFILE_STATUS:
+    (void)set_kcron_landlock_access(KCRON_LANDLOCK_STATUS_ACCESS);
+    break;
+  default:
+    (void)set_kcron_landlock_access(KCRON_LANDLOCK_INIT_ACCESS);
+    break;
+  }
+  KCRON_STAGE_RETURN(KCRON_STAGE_LANDLOCK, 0);
 #endif
 
 #if USE_SECCOMP == 1
-  if (set_kcron_seccomp() != 0) {
+  KCRON_STAGE_ENTRY(KCRON_STAGE_SECCOMP);
+  switch (profile) {
+  case KCRON_PROFILE_NAME:
+    rc = set_kcron_seccomp_filter(kcron_seccomp_filter_name, KCRON_SECCOMP_LEN(kcron_seccomp_filter_name));
+    break;
+  case KCRON_PROFILE_STATUS:
+    rc = set_kcron_seccomp_filter(kcron_seccomp_filter_status, KCRON_SECCOMP_LEN(kcron_seccomp_filter_status));
+    break;
+  default:
+    rc = set_kcron_seccomp();
+    break;
+  }
+  KCRON_STAGE_RETURN(KCRON_STAGE_SECCOMP, rc);
+  if (rc != 0) {
     (void)fprintf(stderr, "%s: Cannot drop useless syscalls.\n", __PROGRAM_NAME);
     exit(EXIT_FAILURE);
   }
@@ -156,4 +234,7 @@ void harden_runtime(void) {
     exit(EXIT_FAILURE);
   }
 }
+
+void harden_runtime(void) __attribute__((flatten));
+void harden_runtime(void) { harden_runtime_for(KCRON_PROFILE_INIT); }
 #endif
@@ -0,0 +1,297 @@
+/*
+ *
+ * Run many STATX(2) calls at once, through io_uring when the kernel
+ * lets us and across a few threads when it does not.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_STATX_H
+#define KCRON_STATX_H 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if USE_IO_URING == 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#endif
+
+#define KCRON_STATX_MAX_THREADS 64
+
+/* io_uring needs 5.6 for IORING_OP_STATX, and may be off by sysctl */
+#define KCRON_STATX_BACKEND_THREADS 0
+#define KCRON_STATX_BACKEND_IO_URING 1
+
+struct kcron_statx_request {
+  int dir_fd;
+  const char *path; /* must stay put until the batch is done */
+  struct statx stx;
+  int error; /* 0 or an errno value */
+};
+
+struct kcron_statx_queue {
+  struct kcron_statx_request *requests;
+  size_t count;
+  atomic_size_t next;
+};
+
+static void *kcron_statx_worker(void *arg) __attribute__((nonnull(1)));
+static void *kcron_statx_worker(void *arg) {
+  struct kcron_statx_queue *queue = arg;
+  size_t index = 0;
+
+  while ((index = atomic_fetch_add(&queue->next, 1)) < queue->count) {
+    struct kcron_statx_request *request = &queue->requests[index];
+    request->error = (statx(request->dir_fd, request->path, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_BASIC_STATS, &request->stx) == 0) ? 0 : errno;
+  }
+  return NULL;
+}
+
+static void kcron_statx_threads(struct kcron_statx_request *requests, size_t count, long num_threads) __attribute__((nonnull(1)));
+static void kcron_statx_threads(struct kcron_statx_request *requests, size_t count, long num_threads) {
+
+  struct kcron_statx_queue queue = {.requests = requests, .count = count};
+  pthread_t threads[KCRON_STATX_MAX_THREADS];
+  long started = 0;
+
+  if (num_threads > KCRON_STATX_MAX_THREADS) {
+    num_threads = KCRON_STATX_MAX_THREADS;
+  }
+  atomic_init(&queue.next, 0);
+  for (started = 0; started < num_threads; started++) {
+    if (pthread_create(&threads[started], NULL, kcron_statx_worker, &queue) != 0) {
+      break;
+    }
+  }
+  if (started == 0) {
+    (void)kcron_statx_worker(&queue);
+  }
+  for (long i = 0; i < started; i++) {
+    (void)pthread_join(threads[i], NULL);
+  }
+}
+
+#if USE_IO_URING == 1
+/* the bare syscalls, liburing would be one more dependency for ~100 lines */
+struct kcron_uring {
+  int fd;
+  unsigned int entries;
+  unsigned char *sq_ring;
+  unsigned char *cq_ring;
+  size_t sq_ring_size;
+  size_t cq_ring_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  struct io_uring_params params;
+};
+
+static void kcron_uring_close(struct kcron_uring *ring) __attribute__((nonnull(1)));
+static void kcron_uring_close(struct kcron_uring *ring) {
+  if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+    (void)munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+    (void)munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) {
+    (void)munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+  if (ring->fd >= 0) {
+    (void)close(ring->fd);
+  }
+}
+
+static int kcron_uring_open(struct kcron_uring *ring, unsigned int entries) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int kcron_uring_open(struct kcron_uring *ring, unsigned int entries) {
+
+  (void)memset(ring, 0, sizeof(*ring));
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &ring->params);
+  if (ring->fd < 0) {
+    return 1;
+  }
+
+  /* IORING_OP_STATX is 5.6, IORING_FEAT_FAST_POLL is 5.7, so this is new enough */
+  if ((ring->params.features & IORING_FEAT_FAST_POLL) == 0) {
+    kcron_uring_close(ring);
+    return 1;
+  }
+
+  ring->entries = ring->params.sq_entries;
+  ring->sq_ring_size = ring->params.sq_off.array + ring->params.sq_entries * sizeof(unsigned int);
+  ring->cq_ring_size = ring->params.cq_off.cqes + ring->params.cq_entries * sizeof(struct io_uring_cqe);
+  if (ring->params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_ring_size = (ring->sq_ring_size > ring->cq_ring_size) ? ring->sq_ring_size : ring->cq_ring_size;
+  }
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    kcron_uring_close(ring);
+    return 1;
+  }
+  if (ring->params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      kcron_uring_close(ring);
+      return 1;
+    }
+  }
+  ring->sqes_size = ring->params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    kcron_uring_close(ring);
+    return 1;
+  }
+  return 0;
+}
+
+/* returns 1 if the ring failed before any work was done, so threads can take over */
+static int kcron_statx_uring(struct kcron_statx_request *requests, size_t count) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+static int kcron_statx_uring(struct kcron_statx_request *requests, size_t count) {
+
+  struct kcron_uring ring = {0};
+  size_t submitted = 0;
+  size_t completed = 0;
+  unsigned int in_flight = 0;
+  unsigned int to_submit = 0;
+  long entered = 0;
+
+  if (kcron_uring_open(&ring, 256) != 0) {
+    return 1;
+  }
+
+  unsigned int *sq_tail = (unsigned int *)(ring.sq_ring + ring.params.sq_off.tail);
+  const unsigned int sq_mask = *(unsigned int *)(ring.sq_ring + ring.params.sq_off.ring_mask);
+  unsigned int *sq_array = (unsigned int *)(ring.sq_ring + ring.params.sq_off.array);
+  unsigned int *cq_head = (unsigned int *)(ring.cq_ring + ring.params.cq_off.head);
+  const unsigned int *cq_tail = (unsigned int *)(ring.cq_ring + ring.params.cq_off.tail);
+  const unsigned int cq_mask = *(unsigned int *)(ring.cq_ring + ring.params.cq_off.ring_mask);
+  const struct io_uring_cqe *cqes = (const struct io_uring_cqe *)(ring.cq_ring + ring.params.cq_off.cqes);
+
+  while (completed < count) {
+    /* keep the ring full */
+    to_submit = 0;
+    unsigned int tail = *sq_tail;
+    while (submitted < count && in_flight + to_submit < ring.entries) {
+      struct io_uring_sqe *sqe = &ring.sqes[tail & sq_mask];
+      (void)memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_STATX;
+      sqe->fd = requests[submitted].dir_fd;
+      sqe->addr = (uint64_t)(uintptr_t)requests[submitted].path;
+      sqe->len = STATX_BASIC_STATS;
+      sqe->off = (uint64_t)(uintptr_t)&requests[submitted].stx;
+      sqe->statx_flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+      sqe->user_data = submitted;
+      sq_array[tail & sq_mask] = tail & sq_mask;
+      tail++;
+      submitted++;
+      to_submit++;
+    }
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+    entered = syscall(__NR_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (entered < 0) {
+      if (errno == EINTR) {
+        in_flight += to_submit;
+        continue;
+      }
+      kcron_uring_close(&ring);
+      /* nothing is in flight yet, hand it all to the threads */
+      return (completed == 0 && in_flight == 0) ? 1 : -1;
+    }
+    in_flight += to_submit;
+
+    unsigned int head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+      if (cqe->user_data < count) {
+        requests[cqe->user_data].error = (cqe->res < 0) ? -cqe->res : 0;
+      }
+      head++;
+      in_flight--;
+      completed++;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  kcron_uring_close(&ring);
+  return 0;
+}
+#endif
+
+/*
+ * statx() every request with AT_SYMLINK_NOFOLLOW.
+ * Returns the backend that did the work, or -1 if io_uring broke part way.
+ */
+int kcron_statx_batch(struct kcron_statx_request *requests, size_t count, long num_threads, int allow_uring) __attribute__((nonnull(1))) __attribute__((warn_unused_result));
+int kcron_statx_batch(struct kcron_statx_request *requests, size_t count, long num_threads, int allow_uring) {
+
+  if (count == 0) {
+    return KCRON_STATX_BACKEND_THREADS;
+  }
+
+#if USE_IO_URING == 1
+  if (allow_uring == 1) {
+    switch (kcron_statx_uring(requests, count)) {
+    case 0:
+      return KCRON_STATX_BACKEND_IO_URING;
+    case 1:
+      break;
+    default:
+      return -1;
+    }
+  }
+#else
+  (void)allow_uring;
+#endif
+
+  kcron_statx_threads(requests, count, num_threads);
+  return KCRON_STATX_BACKEND_THREADS;
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ *
+ * Get a user a TGT from their keytab without ever running as them in
+ * this process: a child drops to the user and runs KINIT(1).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef KCRON_TGT_H
+#define KCRON_TGT_H 1
+
+#include <grp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
+/*
+ * Returns the pid of the child running kinit, or -1.  'ccache' may be
+ * NULL for the user's default from krb5.conf, which is what their cron
+ * jobs will look in.  kinit is killed after 'timeout' seconds.
+ */
+pid_t kcron_tgt_acquire(const char *kinit, uid_t uid, gid_t gid, const char *keytab, const char *principal, const char *ccache, unsigned int timeout)
+    __attribute__((nonnull(1, 4, 5))) __attribute__((warn_unused_result));
+pid_t kcron_tgt_acquire(const char *kinit, uid_t uid, gid_t gid, const char *keytab, const char *principal, const char *ccache, unsigned int timeout) {
+
+  char ccache_env[FILE_PATH_MAX_LENGTH] = {0};
+  char config_env[FILE_PATH_MAX_LENGTH] = {0};
+  char *envp[4] = {"PATH=/usr/bin:/bin", NULL, NULL, NULL};
+  char *const argv[] = {(char *)kinit, "-k", "-t", (char *)keytab, (char *)principal, NULL};
+  const char *krb5_config = getenv("KRB5_CONFIG");
+  sigset_t none;
+  int num_env = 1;
+
+  if (ccache != NULL) {
+    (void)snprintf(ccache_env, sizeof(ccache_env), "KRB5CCNAME=%s", ccache);
+    envp[num_env++] = ccache_env;
+  }
+  if (krb5_config != NULL) {
+    (void)snprintf(config_env, sizeof(config_env), "KRB5_CONFIG=%s", krb5_config);
+    envp[num_env++] = config_env;
+  }
+
+  const pid_t child = fork();
+  if (child != 0) {
+    return child;
+  }
+
+  /* the parent may have blocked signals it waits for, kinit should not */
+  (void)sigemptyset(&none);
+  (void)sigprocmask(SIG_SETMASK, &none, NULL);
+
+  /* no supplementary groups, no NSS lookup in here */
+  if (setgroups(1, &gid) != 0 || setgid(gid) != 0 || setuid(uid) != 0) {
+    (void)fprintf(stderr, "%s: Cannot become %u:%u.\n", __PROGRAM_NAME, uid, gid);
+    _exit(EXIT_FAILURE);
+  }
+  if (uid != 0 && (setuid(0) == 0 || geteuid() == 0)) {
+    (void)fprintf(stderr, "%s: Still able to become root as %u, giving up.\n", __PROGRAM_NAME, uid);
+    _exit(EXIT_FAILURE);
+  }
+
+  /* nothing of ours should leak into kinit */
+  (void)syscall(SYS_close_range, 3U, ~0U, CLOSE_RANGE_CLOEXEC);
+  if (chdir("/") != 0) {
+    _exit(EXIT_FAILURE);
+  }
+
+  (void)alarm(timeout);
+  (void)execve(kinit, argv, envp);
+  (void)fprintf(stderr, "%s: Cannot run %s.\n", __PROGRAM_NAME, kinit);
+  _exit(127);
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ *
+ * libkcron, keytab path resolution and status for in-process callers.
+ *
+ * This shares kcron_filename.h with the helpers so it always agrees with
+ * them about the layout, but must never print or exit() inside a caller.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "libkcron"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "kcron_filename.h"
+#include "kcron_keytab_parse.h"
+#include "libkcron.h"
+
+const char *kcron_keytab_basedir(void) { return __CLIENT_KEYTAB_DIR; }
+
+int kcron_keytab_dir_for_uid(uid_t uid, char *dir, size_t size) {
+
+  /* we are just using ints rather than the name, so this is enough space */
+  char uid_dir[64] = {0};
+  int len = 0;
+
+  if (format_client_subdir_for_uid(uid, __CLIENT_KEYTAB_SHARDS, uid_dir, sizeof(uid_dir)) != 0) {
+    errno = ERANGE;
+    return -1;
+  }
+
+  len = snprintf(dir, size, "%s/%s", __CLIENT_KEYTAB_DIR, uid_dir);
+  if (len < 0 || (size_t)len >= size) {
+    errno = ERANGE;
+    return -1;
+  }
+
+  return 0;
+}
+
+int kcron_keytab_path_for_uid(uid_t uid, char *path, size_t size) {
+
+  char uid_dir[64] = {0};
+  int len = 0;
+
+  if (format_client_subdir_for_uid(uid, __CLIENT_KEYTAB_SHARDS, uid_dir, sizeof(uid_dir)) != 0) {
+    errno = ERANGE;
+    return -1;
+  }
+
+  len = snprintf(path, size, "%s/%s/%s", __CLIENT_KEYTAB_DIR, uid_dir, KCRON_KEYTAB_FILENAME);
+  if (len < 0 || (size_t)len >= size) {
+    errno = ERANGE;
+    return -1;
+  }
+
+  return 0;
+}
+
+int kcron_keytab_status_for_uid(uid_t uid, struct kcron_keytab_status *status) {
+
+  char keytab[FILE_PATH_MAX_LENGTH + 1] = {0};
+  struct stat st = {0};
+
+  (void)memset(status, 0, sizeof(*status));
+
+  if (kcron_keytab_path_for_uid(uid, keytab, sizeof(keytab)) != 0) {
+    return -1;
+  }
+
+  if (fstatat(AT_FDCWD, keytab, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+    /* no keytab, or no directory for one yet */
+    if (errno == ENOENT || errno == ENOTDIR) {
+      return 0;
+    }
+    return -1;
+  }
+
+  status->exists = 1;
+  status->uid = st.st_uid;
+  status->gid = st.st_gid;
+  status->mode = st.st_mode;
+  status->size = (unsigned long long)st.st_size;
+  status->usable = S_ISREG(st.st_mode) && st.st_uid == uid && (st.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+
+  return 0;
+}
+
+int kcron_keytab_entries_for_uid(uid_t uid, unsigned int *entries) {
+
+  char keytab[FILE_PATH_MAX_LENGTH + 1] = {0};
+  unsigned char data[KCRON_KEYTAB_READ_MAX];
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  size_t offset = 0;
+  int rc = 0;
+
+  *entries = 0;
+
+  if (kcron_keytab_path_for_uid(uid, keytab, sizeof(keytab)) != 0) {
+    return -1;
+  }
+
+  /* a copy, a mapping would SIGBUS our host when the owner truncates the file */
+  rc = kcron_keytab_read_at(AT_FDCWD, keytab, data, sizeof(data), &map);
+  if (rc != 0) {
+    errno = rc;
+    return -1;
+  }
+
+  while ((rc = kcron_keytab_next(&map, &offset, &entry)) > 0) {
+    (*entries)++;
+  }
+  (void)kcron_keytab_unmap(&map);
+
+  if (rc < 0) {
+    errno = (map.truncated == 1) ? EFBIG : EBADMSG;
+    return -1;
+  }
+
+  return 0;
+}
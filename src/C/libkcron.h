@@ -0,0 +1,89 @@
+/*
+ *
+ * The public interface of libkcron, where the kcron keytab of a user lives
+ * and whether it is there, for batch system plugins and other in-process callers.
+ *
+ * Nothing here allocates, prints or exits.  Functions return 0 on success
+ * and -1 with errno set on failure.
+ *
+ */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef LIBKCRON_H
+#define LIBKCRON_H 1
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped with the soname, the symbols are versioned LIBKCRON_<major> */
+#define LIBKCRON_VERSION_MAJOR 1
+
+struct kcron_keytab_status {
+  int exists; /* 0 if there is no keytab, the rest is only set when 1 */
+  int usable; /* a regular file owned by the user, no one else can read it */
+  uid_t uid;
+  gid_t gid;
+  mode_t mode;
+  unsigned long long size;
+  unsigned long reserved[4]; /* room to grow without a new soname */
+};
+
+/* the directory all keytabs live under, a static string */
+const char *kcron_keytab_basedir(void);
+
+/* the directory holding the keytab of uid, ERANGE if size is too small */
+int kcron_keytab_dir_for_uid(uid_t uid, char *dir, size_t size) __attribute__((nonnull(2)));
+
+/* the keytab of uid, ERANGE if size is too small */
+int kcron_keytab_path_for_uid(uid_t uid, char *path, size_t size) __attribute__((nonnull(2)));
+
+/* one fstatat(), a missing keytab is not an error */
+int kcron_keytab_status_for_uid(uid_t uid, struct kcron_keytab_status *status) __attribute__((nonnull(2)));
+
+/*
+ * Reads a copy of the keytab, never a mapping of it.  EBADMSG if it is
+ * damaged, EFBIG past 16 KiB, entries holds those before the problem.
+ */
+int kcron_keytab_entries_for_uid(uid_t uid, unsigned int *entries) __attribute__((nonnull(2)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ *
+ * A simple program that asks kcron-keytabd to generate a blank keytab
+ * in a deterministic location.
+ *
+ * It needs no special privileges, the service identifies us by our socket.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "request-kcron-keytab"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "kcron_keytabd.h"
+
+int main(void) {
+
+  struct sockaddr_un addr = {0};
+
+  const char *nullstring = NULL;
+  ssize_t received = 0;
+  int sock = -1;
+
+  char *reply = calloc(KEYTABD_REPLY_MAX_LENGTH + 1, sizeof(char));
+
+  if (reply == nullstring) {
+    (void)fprintf(stderr, "%s: unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (keytabd_sockaddr(&addr) != 0) {
+    (void)free(reply);
+    exit(EXIT_FAILURE);
+  }
+
+  sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    (void)fprintf(stderr, "%s: Cannot create socket: %s\n", __PROGRAM_NAME, strerror(errno));
+    (void)free(reply);
+    exit(EXIT_FAILURE);
+  }
+
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot connect to %s: %s\n", __PROGRAM_NAME, addr.sun_path, strerror(errno));
+    (void)close(sock);
+    (void)free(reply);
+    exit(EXIT_FAILURE);
+  }
+
+  if (send(sock, KEYTABD_REQUEST, strlen(KEYTABD_REQUEST), MSG_NOSIGNAL) < 0) {
+    (void)fprintf(stderr, "%s: Cannot send request: %s\n", __PROGRAM_NAME, strerror(errno));
+    (void)close(sock);
+    (void)free(reply);
+    exit(EXIT_FAILURE);
+  }
+
+  received = recv(sock, reply, KEYTABD_REPLY_MAX_LENGTH, 0);
+  (void)close(sock);
+
+  if (received < 3 || (reply[0] != '0' && reply[0] != '1') || reply[1] != ' ') {
+    (void)fprintf(stderr, "%s: No valid reply from %s.\n", __PROGRAM_NAME, addr.sun_path);
+    (void)free(reply);
+    exit(EXIT_FAILURE);
+  }
+
+  reply[received] = '\0';
+
+  if (reply[0] != '0') {
+    (void)fprintf(stderr, "%s: %s\n", __PROGRAM_NAME, reply + 2);
+    (void)free(reply);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)printf("%s\n", reply + 2);
+
+  (void)free(reply);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,105 @@
+#!/bin/bash -u
+
+###########################################################
+#
+# Copyright 2023 Fermi Research Alliance, LLC
+#
+# This software was produced under U.S. Government contract DE-AC02-07CH11359 for Fermi National Accelerator Laboratory (Fermilab), which is operated by Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S. Government has rights to use, reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified to produce derivative works, such modified software should be clearly marked, so as not to confuse it with the version available from Fermilab.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###########################################################
+#        Functions
+###########################################################
+usage() {
+    echo '' >&2
+    echo "$0 [-t percent] baseline.json candidate.json" >&2
+    echo '  Compare the median time and, for whole runs of a binary,' >&2
+    echo '  the peak RSS of every kcron-bench result and exit 1 if' >&2
+    echo '  any is worse than the baseline by more than percent' >&2
+    echo '  (default 10).' >&2
+    echo '' >&2
+    exit 1
+}
+
+###########################################################
+#        Options
+###########################################################
+THRESHOLD=10
+if ! args=$(getopt -o t:h -- "$@"); then
+    usage
+fi
+
+eval set -- "$args"
+while true; do
+    case $1 in
+    -t)
+        THRESHOLD=$2
+        shift 2
+        ;;
+    --)
+        shift
+        break
+        ;;
+    *)
+        usage
+        ;;
+    esac
+done
+
+if [[ $# -ne 2 ]] || [[ ! -r $1 ]] || [[ ! -r $2 ]]; then
+    usage
+fi
+
+###########################################################
+#        Run
+###########################################################
+# kcron-bench writes one result per line, so awk is enough
+awk -v threshold="${THRESHOLD}" '
+function field(line, key,    rest) {
+    rest = substr(line, index(line, "\"" key "\": ") + length(key) + 4)
+    sub(/^"/, "", rest)
+    sub(/[",}].*$/, "", rest)
+    return rest
+}
+function compare(key, old, new,    change, flag) {
+    change = (old > 0) ? (new - old) * 100.0 / old : 0
+    flag = ""
+    if (change > threshold) {
+        flag = "  REGRESSION"
+        regressions++
+    }
+    printf "%-48s %12d %12d %+7.1f%%%s\n", key, old, new, change, flag
+}
+/"median_ns"/ {
+    key = field($0, "name") " " field($0, "backing")
+    rss = (index($0, "\"maxrss_kb\"") > 0) ? field($0, "maxrss_kb") : ""
+    if (FNR == NR) {
+        baseline[key] = field($0, "median_ns")
+        baseline_rss[key] = rss
+        next
+    }
+    if (!(key in baseline)) {
+        printf "%-48s %12s %12d %8s\n", key, "-", field($0, "median_ns"), "new"
+        next
+    }
+    compare(key, baseline[key], field($0, "median_ns"))
+    # exec results also carry the peak RSS of the binary in kB
+    if (rss != "" && baseline_rss[key] != "") {
+        compare(key " rss_kB", baseline_rss[key], rss)
+    }
+}
+BEGIN {
+    printf "%-48s %12s %12s %8s\n", "benchmark", "baseline", "candidate", "change"
+}
+END {
+    if (regressions > 0) {
+        printf "\n%d result(s) worse than the baseline by more than %s%%\n", regressions, threshold
+        exit 1
+    }
+}
+' "$1" "$2"
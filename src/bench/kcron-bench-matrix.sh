@@ -0,0 +1,136 @@
+#!/bin/bash -u
+
+###########################################################
+#
+# Copyright 2023 Fermi Research Alliance, LLC
+#
+# This software was produced under U.S. Government contract DE-AC02-07CH11359 for Fermi National Accelerator Laboratory (Fermilab), which is operated by Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S. Government has rights to use, reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified to produce derivative works, such modified software should be clearly marked, so as not to confuse it with the version available from Fermilab.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+###########################################################
+#        Functions
+###########################################################
+usage() {
+    echo '' >&2
+    echo "$0 [-n iterations] [-l] [-s] source_dir output_dir" >&2
+    echo '  Build and run kcron-bench for every combination of' >&2
+    echo '  USE_CAPABILITIES, USE_LANDLOCK and USE_SECCOMP.' >&2
+    echo '' >&2
+    echo '  -n iterations  samples per benchmark (default 1000)' >&2
+    echo '  -l             also time a loopback ext4 filesystem (needs root)' >&2
+    echo '  -s             also build every combination with USE_STATIC_PIE' >&2
+    echo '' >&2
+    echo '  Compare two results with kcron-bench-compare.sh' >&2
+    echo '' >&2
+    exit 1
+}
+
+###########################################################
+cleanup() {
+    if [[ -n ${LOOP_MOUNT} ]] && mountpoint -q "${LOOP_MOUNT}"; then
+        umount "${LOOP_MOUNT}"
+    fi
+}
+
+###########################################################
+#        Options
+###########################################################
+ITERATIONS=1000
+LOOPBACK=0
+LOOP_MOUNT=''
+STATIC_PIE=(OFF)
+if ! args=$(getopt -o n:lsh -- "$@"); then
+    usage
+fi
+
+eval set -- "$args"
+while true; do
+    case $1 in
+    -n)
+        ITERATIONS=$2
+        shift 2
+        ;;
+    -l)
+        LOOPBACK=1
+        shift
+        ;;
+    -s)
+        STATIC_PIE=(OFF ON)
+        shift
+        ;;
+    --)
+        shift
+        break
+        ;;
+    *)
+        usage
+        ;;
+    esac
+done
+
+if [[ $# -ne 2 ]]; then
+    usage
+fi
+
+SOURCE_DIR=$(realpath "$1")
+OUTPUT_DIR=$(realpath -m "$2")
+mkdir -p "${OUTPUT_DIR}"
+
+###########################################################
+#        Loopback filesystem
+###########################################################
+BACKINGS=()
+if [[ ${LOOPBACK} -eq 1 ]]; then
+    if [[ $(id -u) -ne 0 ]]; then
+        echo 'A loopback filesystem needs root' >&2
+        exit 2
+    fi
+    trap cleanup EXIT
+    LOOP_MOUNT="${OUTPUT_DIR}/loop"
+    truncate -s 256M "${OUTPUT_DIR}/loop.img"
+    mkfs.ext4 -q -F "${OUTPUT_DIR}/loop.img"
+    mkdir -p "${LOOP_MOUNT}"
+    mount -o loop "${OUTPUT_DIR}/loop.img" "${LOOP_MOUNT}"
+    BACKINGS=(-B "ext4-loop=${LOOP_MOUNT}")
+fi
+
+###########################################################
+#        Run
+###########################################################
+for static_pie in "${STATIC_PIE[@]}"; do
+    for caps in ON OFF; do
+        for landlock in ON OFF; do
+            for seccomp in ON OFF; do
+                name="caps-${caps}_landlock-${landlock}_seccomp-${seccomp}"
+                if [[ ${static_pie} == 'ON' ]]; then
+                    name="${name}_static-pie"
+                fi
+                build="${OUTPUT_DIR}/build-${name}"
+
+                echo "== ${name}"
+                if ! cmake -S "${SOURCE_DIR}" -B "${build}" -DCMAKE_BUILD_TYPE=RelWithDebInfo -DUSE_KADM5=OFF -DUSE_STATIC_PIE=${static_pie} \
+                    -DUSE_CAPABILITIES=${caps} -DUSE_LANDLOCK=${landlock} -DUSE_SECCOMP=${seccomp} >"${build}.log" 2>&1; then
+                    echo "cmake failed, see ${build}.log" >&2
+                    exit 2
+                fi
+                if ! cmake --build "${build}" --target kcron-bench init-kcron-keytab client-keytab-name >>"${build}.log" 2>&1; then
+                    echo "build failed, see ${build}.log" >&2
+                    exit 2
+                fi
+
+                if ! "${build}/kcron-bench" -n "${ITERATIONS}" -i "${build}/init-kcron-keytab" -c "${build}/client-keytab-name" ${BACKINGS[@]+"${BACKINGS[@]}"} -o "${OUTPUT_DIR}/${name}.json"; then
+                    echo "kcron-bench failed for ${name}" >&2
+                    exit 2
+                fi
+            done
+        done
+    done
+done
+
+echo ''
+echo "Results are in ${OUTPUT_DIR}/*.json"
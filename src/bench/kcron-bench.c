@@ -0,0 +1,735 @@
+/*
+ *
+ * Micro and macro benchmarks for the kcron helpers.
+ *
+ * The helpers are timed in process and the installed style binaries are
+ * timed end to end, all inside a private user and mount namespace so the
+ * real client keytab directory is never touched.  Results are written as
+ * JSON, one result per line, for kcron-bench-compare.sh.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "kcron-bench"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mount.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kcron_filename.h"
+#include "kcron_keytab.h"
+#include "kcron_setup.h"
+
+#define BENCH_DEFAULT_ITERATIONS 1000
+#define BENCH_WARMUP 10
+#define BENCH_MAX_BACKINGS 8
+#define BENCH_MAX_POPULATIONS 8
+#define BENCH_LOOKUP_DIR ".kcron-bench-lookup"
+#define BENCH_LOOKUP_FIRST_UID 1000
+/* what lookups with a flat layout are compared against */
+#define BENCH_LOOKUP_SHARDS ((__CLIENT_KEYTAB_SHARDS > 0) ? __CLIENT_KEYTAB_SHARDS : 256U)
+
+#ifndef USE_CAPABILITIES
+#define USE_CAPABILITIES 0
+#endif
+#ifndef USE_LANDLOCK
+#define USE_LANDLOCK 0
+#endif
+#ifndef USE_SECCOMP
+#define USE_SECCOMP 0
+#endif
+#ifndef USE_STATIC_PIE
+#define USE_STATIC_PIE 0
+#endif
+
+struct bench_backing {
+  const char *label;
+  const char *path;
+};
+
+struct bench_run {
+  FILE *output;
+  uint64_t *samples;
+  long maxrss_kb; /* peak RSS of an exec'd binary, 0 when not measured */
+  size_t iterations;
+  int first_result;
+  size_t populations[BENCH_MAX_POPULATIONS];
+  size_t num_populations;
+};
+
+static void usage(void) {
+  (void)fprintf(stderr, "Usage: %s -i init-kcron-keytab -c client-keytab-name [-n iterations] [-P users,...] [-o out.json] [-B label=dir]...\n", __PROGRAM_NAME);
+  (void)fprintf(stderr, "  -n iterations  samples per benchmark (default %d)\n", BENCH_DEFAULT_ITERATIONS);
+  (void)fprintf(stderr, "  -P users,...   keytab directories to time lookups among, flat and\n");
+  (void)fprintf(stderr, "                 with %u shards (default 1000,10000)\n", BENCH_LOOKUP_SHARDS);
+  (void)fprintf(stderr, "  -o file        write JSON here rather than stdout\n");
+  (void)fprintf(stderr, "  -B label=dir   also time keytab creation with dir bind mounted over\n");
+  (void)fprintf(stderr, "                 the client keytab directory, eg a loopback ext4 mount\n");
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts = {0};
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  const uint64_t left = *(const uint64_t *)a;
+  const uint64_t right = *(const uint64_t *)b;
+  return (left > right) - (left < right);
+}
+
+static void report(struct bench_run *run, const char *name, const char *backing) __attribute__((nonnull(1, 2, 3)));
+static void report(struct bench_run *run, const char *name, const char *backing) {
+
+  uint64_t total = 0;
+
+  qsort(run->samples, run->iterations, sizeof(uint64_t), cmp_u64);
+  for (size_t i = 0; i < run->iterations; i++) {
+    total += run->samples[i];
+  }
+
+  (void)fprintf(run->output, "%s\n    {\"name\": \"%s\", \"backing\": \"%s\", \"iterations\": %zu, \"min_ns\": %lu, \"median_ns\": %lu, \"p90_ns\": %lu, \"mean_ns\": %lu",
+                (run->first_result == 1) ? "" : ",", name, backing, run->iterations, (unsigned long)run->samples[0], (unsigned long)run->samples[run->iterations / 2],
+                (unsigned long)run->samples[run->iterations * 9 / 10], (unsigned long)(total / run->iterations));
+  if (run->maxrss_kb > 0) {
+    (void)fprintf(run->output, ", \"maxrss_kb\": %ld", run->maxrss_kb);
+  }
+  (void)fprintf(run->output, "}");
+  run->first_result = 0;
+
+  (void)fprintf(stderr, "%s: %-32s %-10s median %8lu ns  p90 %8lu ns", __PROGRAM_NAME, name, backing, (unsigned long)run->samples[run->iterations / 2],
+                (unsigned long)run->samples[run->iterations * 9 / 10]);
+  if (run->maxrss_kb > 0) {
+    (void)fprintf(stderr, "  rss %6ld kB", run->maxrss_kb);
+  }
+  (void)fprintf(stderr, "\n");
+  run->maxrss_kb = 0;
+}
+
+static int write_file(const char *path, const char *content) __attribute__((nonnull(1, 2)));
+static int write_file(const char *path, const char *content) {
+  const int fd = open(path, O_WRONLY | O_CLOEXEC);
+  const size_t len = strlen(content);
+
+  if (fd < 0) {
+    return 1;
+  }
+  if (write(fd, content, len) != (ssize_t)len) {
+    (void)close(fd);
+    return 1;
+  }
+  return close(fd);
+}
+
+/* uid 0 in a new user namespace, with a tmpfs under the client keytab directory */
+static int setup_namespace(void) {
+  char uid_map[64] = {0};
+  char gid_map[64] = {0};
+  char ancestor[FILE_PATH_MAX_LENGTH] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  struct stat st = {0};
+
+  (void)snprintf(uid_map, sizeof(uid_map), "0 %u 1\n", getuid());
+  (void)snprintf(gid_map, sizeof(gid_map), "0 %u 1\n", getgid());
+
+  if (unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0) {
+    (void)fprintf(stderr, "%s: Cannot create a user and mount namespace: %s\n", __PROGRAM_NAME, strerror(errno));
+    return 1;
+  }
+  if (write_file("/proc/self/setgroups", "deny") != 0 || write_file("/proc/self/uid_map", uid_map) != 0 || write_file("/proc/self/gid_map", gid_map) != 0) {
+    (void)fprintf(stderr, "%s: Cannot map our uid into the namespace.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+    (void)fprintf(stderr, "%s: Cannot make our mounts private: %s\n", __PROGRAM_NAME, strerror(errno));
+    return 1;
+  }
+
+  (void)snprintf(ancestor, sizeof(ancestor), "%s", __CLIENT_KEYTAB_DIR);
+  while (stat(ancestor, &st) != 0) {
+    (void)snprintf(path, sizeof(path), "%s", dirname(ancestor));
+    (void)snprintf(ancestor, sizeof(ancestor), "%s", path);
+  }
+  if (strcmp(ancestor, "/") == 0) {
+    (void)fprintf(stderr, "%s: Refusing to mount a tmpfs over /.\n", __PROGRAM_NAME);
+    return 1;
+  }
+  if (mount("tmpfs", ancestor, "tmpfs", MS_NOSUID | MS_NODEV, "mode=0755") != 0) {
+    (void)fprintf(stderr, "%s: Cannot mount a tmpfs on %s: %s\n", __PROGRAM_NAME, ancestor, strerror(errno));
+    return 1;
+  }
+
+  (void)snprintf(path, sizeof(path), "%s", __CLIENT_KEYTAB_DIR);
+  for (char *slash = path + strlen(ancestor) + 1; slash != NULL; slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    (void)mkdir(path, 0755);
+    *slash = '/';
+  }
+  if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    return 1;
+  }
+
+  return 0;
+}
+
+/* put the user directory back the way we found it, not timed */
+static void remove_user_dir(void) {
+  char subdir[64] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+
+  /* mkdirat_if_missing is timed at the top level whatever the layout */
+  (void)snprintf(path, sizeof(path), "%s/0", __CLIENT_KEYTAB_DIR);
+  (void)rmdir(path);
+
+  if (get_client_subdir_for_uid(0, __CLIENT_KEYTAB_SHARDS, subdir, sizeof(subdir)) != 0) {
+    return;
+  }
+  (void)snprintf(path, sizeof(path), "%s/%s/%s", __CLIENT_KEYTAB_DIR, subdir, KCRON_KEYTAB_FILENAME);
+  (void)unlink(path);
+  (void)snprintf(path, sizeof(path), "%s/%s", __CLIENT_KEYTAB_DIR, subdir);
+  (void)rmdir(path);
+}
+
+static void bench_get_filenames(struct bench_run *run) __attribute__((nonnull(1)));
+static void bench_get_filenames(struct bench_run *run) {
+  char keytab[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char keytab_dirname[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char keytab_filename[FILE_PATH_MAX_LENGTH + 3] = {0};
+  uint64_t start = 0;
+
+  for (size_t i = 0; i < run->iterations + BENCH_WARMUP; i++) {
+    start = now_ns();
+    if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
+      exit(EXIT_FAILURE);
+    }
+    if (i >= BENCH_WARMUP) {
+      run->samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+  }
+  report(run, "get_filenames", "-");
+}
+
+static int bench_mkdirat_if_missing(struct bench_run *run, const char *backing) __attribute__((nonnull(1, 2)));
+static int bench_mkdirat_if_missing(struct bench_run *run, const char *backing) {
+  char dir[FILE_PATH_MAX_LENGTH] = {0};
+  uint64_t start = 0;
+  int dir_fd = -1;
+
+  (void)snprintf(dir, sizeof(dir), "%s/0", __CLIENT_KEYTAB_DIR);
+
+  const int client_fd = open_client_dir();
+  if (client_fd < 0) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < run->iterations + BENCH_WARMUP; i++) {
+    remove_user_dir();
+    start = now_ns();
+    dir_fd = mkdirat_if_missing(client_fd, "0", dir, 0, 0, _0700);
+    if (i >= BENCH_WARMUP) {
+      run->samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+    if (dir_fd < 0) {
+      (void)close(client_fd);
+      return 1;
+    }
+    (void)close(dir_fd);
+  }
+  (void)close(client_fd);
+  remove_user_dir();
+
+  report(run, "mkdirat_if_missing", backing);
+  return 0;
+}
+
+static int bench_create_keytab(struct bench_run *run, const char *backing, int existing) __attribute__((nonnull(1, 2)));
+static int bench_create_keytab(struct bench_run *run, const char *backing, int existing) {
+  char keytab[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char keytab_dirname[FILE_PATH_MAX_LENGTH + 3] = {0};
+  char keytab_filename[FILE_PATH_MAX_LENGTH + 3] = {0};
+  uint64_t start = 0;
+  int rc = 0;
+
+  if (get_filenames(keytab_dirname, keytab_filename, keytab) != 0) {
+    return 1;
+  }
+
+  remove_user_dir();
+  for (size_t i = 0; i < run->iterations + BENCH_WARMUP; i++) {
+    if (existing == 0) {
+      remove_user_dir();
+    }
+    start = now_ns();
+    rc = create_keytab_if_missing(keytab_dirname, keytab_filename, keytab, 0, 0);
+    if (i >= BENCH_WARMUP) {
+      run->samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+    if (rc != 0) {
+      return 1;
+    }
+  }
+  remove_user_dir();
+
+  report(run, (existing == 0) ? "create_keytab_fresh" : "create_keytab_existing", backing);
+  return 0;
+}
+
+/* make or remove population keytab directories below BENCH_LOOKUP_DIR, not timed */
+static int lookup_population(int lookup_fd, size_t population, unsigned int shards, int create);
+static int lookup_population(int lookup_fd, size_t population, unsigned int shards, int create) {
+  const char emptykeytab[] = {0x05, 0x02};
+  char subdir[64] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  char *slash = NULL;
+  int fd = -1;
+
+  for (size_t i = 0; i < population; i++) {
+    if (get_client_subdir_for_uid((uid_t)(BENCH_LOOKUP_FIRST_UID + i), shards, subdir, sizeof(subdir)) != 0) {
+      return 1;
+    }
+    (void)snprintf(path, sizeof(path), "%s/%s", subdir, KCRON_KEYTAB_FILENAME);
+    slash = strchr(subdir, '/');
+
+    if (create == 0) {
+      (void)unlinkat(lookup_fd, path, 0);
+      (void)unlinkat(lookup_fd, subdir, AT_REMOVEDIR);
+      if (slash != NULL) {
+        *slash = '\0';
+        (void)unlinkat(lookup_fd, subdir, AT_REMOVEDIR);
+      }
+      continue;
+    }
+
+    if (slash != NULL) {
+      *slash = '\0';
+      if (mkdirat(lookup_fd, subdir, KCRON_SHARD_MODE) != 0 && errno != EEXIST) {
+        return 1;
+      }
+      *slash = '/';
+    }
+    if (mkdirat(lookup_fd, subdir, _0700) != 0) {
+      return 1;
+    }
+    fd = openat(lookup_fd, path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, _0600);
+    if (fd < 0 || write(fd, emptykeytab, sizeof(emptykeytab)) != sizeof(emptykeytab)) {
+      if (fd >= 0) {
+        (void)close(fd);
+      }
+      return 1;
+    }
+    (void)close(fd);
+  }
+  return 0;
+}
+
+/*
+ * One full path walk to a user's keytab, as kinit would do it.  A hit is a
+ * random existing user, a miss is a user never looked up before, as for
+ * init-kcron-keytab's first run, so no negative dentry can answer it.
+ */
+static int time_lookups(struct bench_run *run, size_t population, unsigned int shards, int miss) __attribute__((nonnull(1)));
+static int time_lookups(struct bench_run *run, size_t population, unsigned int shards, int miss) {
+  char subdir[64] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  uint64_t start = 0;
+  uint64_t seed = 0x9e3779b97f4a7c15ULL;
+  uid_t uid = 0;
+  int fd = -1;
+
+  for (size_t i = 0; i < run->iterations + BENCH_WARMUP; i++) {
+    /* xorshift, the same sequence every run so results compare */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    uid = (uid_t)(BENCH_LOOKUP_FIRST_UID + ((miss == 1) ? population + i : seed % population));
+    if (get_client_subdir_for_uid(uid, shards, subdir, sizeof(subdir)) != 0) {
+      return 1;
+    }
+    (void)snprintf(path, sizeof(path), "%s/%s/%s/%s", __CLIENT_KEYTAB_DIR, BENCH_LOOKUP_DIR, subdir, KCRON_KEYTAB_FILENAME);
+
+    start = now_ns();
+    fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (i >= BENCH_WARMUP) {
+      run->samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+    if ((fd < 0) != (miss == 1)) {
+      (void)fprintf(stderr, "%s: Unexpected result opening %s\n", __PROGRAM_NAME, path);
+      if (fd >= 0) {
+        (void)close(fd);
+      }
+      return 1;
+    }
+    if (fd >= 0) {
+      (void)close(fd);
+    }
+  }
+  return 0;
+}
+
+static int bench_lookup(struct bench_run *run, const char *backing, size_t population, unsigned int shards) __attribute__((nonnull(1, 2)));
+static int bench_lookup(struct bench_run *run, const char *backing, size_t population, unsigned int shards) {
+  char layout[32] = {0};
+  char name[64] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  int lookup_fd = -1;
+  int rc = 0;
+
+  if (shards == 0) {
+    (void)snprintf(layout, sizeof(layout), "flat");
+  } else {
+    (void)snprintf(layout, sizeof(layout), "%s%u", KCRON_SHARD_PREFIX, shards);
+  }
+
+  (void)snprintf(path, sizeof(path), "%s/%s", __CLIENT_KEYTAB_DIR, BENCH_LOOKUP_DIR);
+  if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    return 1;
+  }
+  lookup_fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (lookup_fd < 0 || lookup_population(lookup_fd, population, shards, 1) != 0) {
+    (void)fprintf(stderr, "%s: Cannot populate %s with %zu users: %s\n", __PROGRAM_NAME, path, population, strerror(errno));
+    rc = 1;
+  }
+
+  if (rc == 0 && time_lookups(run, population, shards, 0) == 0) {
+    (void)snprintf(name, sizeof(name), "lookup_%s_%zu", layout, population);
+    report(run, name, backing);
+  } else {
+    rc = 1;
+  }
+  if (rc == 0 && time_lookups(run, population, shards, 1) == 0) {
+    (void)snprintf(name, sizeof(name), "lookup_miss_%s_%zu", layout, population);
+    report(run, name, backing);
+  } else {
+    rc = 1;
+  }
+
+  if (lookup_fd >= 0) {
+    (void)lookup_population(lookup_fd, population, shards, 0);
+    (void)close(lookup_fd);
+  }
+  (void)snprintf(path, sizeof(path), "%s/%s", __CLIENT_KEYTAB_DIR, BENCH_LOOKUP_DIR);
+  (void)rmdir(path);
+
+  return rc;
+}
+
+/* harden_runtime() cannot be undone, so each sample is a fresh child */
+static int bench_harden_runtime(struct bench_run *run) __attribute__((nonnull(1)));
+static int bench_harden_runtime(struct bench_run *run) {
+  uint64_t elapsed = 0;
+  int pipe_fd[2] = {-1, -1};
+  int status = 0;
+  pid_t child = 0;
+
+  for (size_t i = 0; i < run->iterations + BENCH_WARMUP; i++) {
+    if (pipe2(pipe_fd, O_CLOEXEC) != 0) {
+      return 1;
+    }
+
+    child = fork();
+    if (child < 0) {
+      return 1;
+    }
+    if (child == 0) {
+      /* the seccomp filter still lets us write to stdout, and RLIMIT_NOFILE */
+      /* is about to drop below the descriptors the parent holds            */
+      if (dup2(pipe_fd[1], STDOUT_FILENO) < 0 || syscall(SYS_close_range, 3U, ~0U, 0) != 0) {
+        _exit(EXIT_FAILURE);
+      }
+      const uint64_t start = now_ns();
+      harden_runtime();
+      elapsed = now_ns() - start;
+      _exit((write(STDOUT_FILENO, &elapsed, sizeof(elapsed)) == sizeof(elapsed)) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    (void)close(pipe_fd[1]);
+    if (read(pipe_fd[0], &elapsed, sizeof(elapsed)) != sizeof(elapsed)) {
+      elapsed = 0;
+    }
+    (void)close(pipe_fd[0]);
+
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      (void)fprintf(stderr, "%s: harden_runtime() failed in the child.\n", __PROGRAM_NAME);
+      return 1;
+    }
+    if (i >= BENCH_WARMUP) {
+      run->samples[i - BENCH_WARMUP] = elapsed;
+    }
+  }
+
+  report(run, "harden_runtime", "-");
+  return 0;
+}
+
+/* fork, exec and reap one of our binaries, stdout goes to /dev/null */
+/* the time is exec to exit and the peak RSS is the largest of any sample */
+static int bench_exec(struct bench_run *run, int exe_fd, const char *name, int fresh) __attribute__((nonnull(1, 3)));
+static int bench_exec(struct bench_run *run, int exe_fd, const char *name, int fresh) {
+  char *const argv[] = {(char *)name, NULL};
+  char *const envp[] = {NULL};
+  struct rusage usage = {0};
+  uint64_t start = 0;
+  int status = 0;
+  pid_t child = 0;
+
+  const int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (devnull < 0) {
+    return 1;
+  }
+
+  for (size_t i = 0; i < run->iterations + BENCH_WARMUP; i++) {
+    if (fresh == 1) {
+      remove_user_dir();
+    }
+
+    start = now_ns();
+    child = fork();
+    if (child < 0) {
+      (void)close(devnull);
+      return 1;
+    }
+    if (child == 0) {
+      if (dup2(devnull, STDOUT_FILENO) < 0) {
+        _exit(EXIT_FAILURE);
+      }
+      (void)syscall(SYS_execveat, exe_fd, "", argv, envp, AT_EMPTY_PATH);
+      _exit(EXIT_FAILURE);
+    }
+    if (wait4(child, &status, 0, &usage) != child || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      (void)fprintf(stderr, "%s: %s did not exit cleanly.\n", __PROGRAM_NAME, name);
+      (void)close(devnull);
+      return 1;
+    }
+    if (i >= BENCH_WARMUP) {
+      run->samples[i - BENCH_WARMUP] = now_ns() - start;
+      if (usage.ru_maxrss > run->maxrss_kb) {
+        run->maxrss_kb = usage.ru_maxrss;
+      }
+    }
+  }
+  (void)close(devnull);
+
+  if (strcmp(name, "init-kcron-keytab") == 0) {
+    report(run, (fresh == 1) ? "exec_init_kcron_keytab_fresh" : "exec_init_kcron_keytab_existing", "tmpfs");
+  } else {
+    report(run, "exec_client_keytab_name", "-");
+  }
+  return 0;
+}
+
+static int bench_backing(struct bench_run *run, const char *label) __attribute__((nonnull(1, 2)));
+static int bench_backing(struct bench_run *run, const char *label) {
+  int rc = 0;
+
+  rc |= bench_mkdirat_if_missing(run, label);
+  rc |= bench_create_keytab(run, label, 0);
+  rc |= bench_create_keytab(run, label, 1);
+  for (size_t i = 0; i < run->num_populations; i++) {
+    rc |= bench_lookup(run, label, run->populations[i], 0);
+    rc |= bench_lookup(run, label, run->populations[i], BENCH_LOOKUP_SHARDS);
+  }
+  return rc;
+}
+
+/* the helpers we time drop our effective set, take back what mount needs */
+static int enable_mount_capabilities(void) {
+#if USE_CAPABILITIES == 1
+  const cap_value_t caps[] = {CAP_SYS_ADMIN};
+  return enable_capabilities(caps, sizeof(caps) / sizeof(cap_value_t));
+#else
+  return 0;
+#endif
+}
+
+int main(int argc, char *argv[]) {
+
+  struct bench_backing backings[BENCH_MAX_BACKINGS] = {0};
+  struct bench_run run = {.output = stdout, .iterations = BENCH_DEFAULT_ITERATIONS, .first_result = 1, .populations = {1000, 10000}, .num_populations = 2};
+  const char *init_path = NULL;
+  const char *client_path = NULL;
+  const char *output_path = NULL;
+  char *equals = NULL;
+  char *end = NULL;
+  char *token = NULL;
+  size_t num_backings = 0;
+  int init_fd = -1;
+  int client_fd = -1;
+  int rc = 0;
+  int opt = 0;
+
+  while ((opt = getopt(argc, argv, "i:c:n:P:o:B:h")) != -1) {
+    switch (opt) {
+    case 'i':
+      init_path = optarg;
+      break;
+    case 'c':
+      client_path = optarg;
+      break;
+    case 'n':
+      errno = 0;
+      run.iterations = strtoul(optarg, &end, 10);
+      if (errno != 0 || *end != '\0' || run.iterations == 0) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'P':
+      run.num_populations = 0;
+      for (token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")) {
+        if (run.num_populations == BENCH_MAX_POPULATIONS) {
+          usage();
+          exit(EXIT_FAILURE);
+        }
+        errno = 0;
+        run.populations[run.num_populations] = strtoul(token, &end, 10);
+        if (errno != 0 || *end != '\0' || run.populations[run.num_populations] == 0) {
+          usage();
+          exit(EXIT_FAILURE);
+        }
+        run.num_populations++;
+      }
+      break;
+    case 'o':
+      output_path = optarg;
+      break;
+    case 'B':
+      equals = strchr(optarg, '=');
+      if (equals == NULL || num_backings == BENCH_MAX_BACKINGS) {
+        usage();
+        exit(EXIT_FAILURE);
+      }
+      *equals = '\0';
+      backings[num_backings].label = optarg;
+      backings[num_backings].path = equals + 1;
+      num_backings++;
+      break;
+    default:
+      usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (init_path == NULL || client_path == NULL) {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+
+  /* hold on to the binaries, the tmpfs may hide the build tree */
+  init_fd = open(init_path, O_PATH | O_CLOEXEC);
+  client_fd = open(client_path, O_PATH | O_CLOEXEC);
+  if (init_fd < 0 || client_fd < 0) {
+    (void)fprintf(stderr, "%s: Cannot open %s or %s.\n", __PROGRAM_NAME, init_path, client_path);
+    exit(EXIT_FAILURE);
+  }
+
+  run.samples = calloc(run.iterations, sizeof(uint64_t));
+  if (run.samples == NULL) {
+    (void)fprintf(stderr, "%s: Unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (output_path != NULL) {
+    run.output = fopen(output_path, "we");
+    if (run.output == NULL) {
+      (void)fprintf(stderr, "%s: Cannot write %s: %s\n", __PROGRAM_NAME, output_path, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (setup_namespace() != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  (void)fprintf(run.output, "{\n  \"build\": {\"capabilities\": %s, \"landlock\": %s, \"seccomp\": %s, \"static_pie\": %s},\n  \"results\": [",
+                (USE_CAPABILITIES == 1) ? "true" : "false", (USE_LANDLOCK == 1) ? "true" : "false", (USE_SECCOMP == 1) ? "true" : "false",
+                (USE_STATIC_PIE == 1) ? "true" : "false");
+
+  bench_get_filenames(&run);
+  rc |= bench_backing(&run, "tmpfs");
+  rc |= bench_harden_runtime(&run);
+  rc |= bench_exec(&run, client_fd, "client-keytab-name", 0);
+  rc |= bench_exec(&run, init_fd, "init-kcron-keytab", 1);
+  rc |= bench_exec(&run, init_fd, "init-kcron-keytab", 0);
+
+  for (size_t i = 0; i < num_backings; i++) {
+    if (enable_mount_capabilities() != 0 || mount(backings[i].path, __CLIENT_KEYTAB_DIR, NULL, MS_BIND, NULL) != 0) {
+      (void)fprintf(stderr, "%s: Cannot bind mount %s: %s\n", __PROGRAM_NAME, backings[i].path, strerror(errno));
+      rc = 1;
+      continue;
+    }
+    rc |= bench_backing(&run, backings[i].label);
+    if (enable_mount_capabilities() != 0 || umount2(__CLIENT_KEYTAB_DIR, MNT_DETACH) != 0) {
+      (void)fprintf(stderr, "%s: Cannot unmount %s: %s\n", __PROGRAM_NAME, backings[i].path, strerror(errno));
+      rc = 1;
+      break;
+    }
+  }
+
+  (void)fprintf(run.output, "\n  ]\n}\n");
+
+  if (run.output != stdout && fclose(run.output) != 0) {
+    rc = 1;
+  }
+  (void)free(run.samples);
+  (void)close(init_fd);
+  (void)close(client_fd);
+
+  if (rc != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
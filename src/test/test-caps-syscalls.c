@@ -0,0 +1,170 @@
+/*
+ *
+ * Count the capget(2)/capset(2) calls kcron_caps.h makes for a typical
+ * sequence of capability toggles.
+ *
+ * The toggles run in a new user namespace so we hold every capability there,
+ * if one cannot be created the test is skipped.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-caps-syscalls"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kcron_caps.h"
+
+#define EXIT_SKIP 77
+
+/* one capget to learn our sets, then one capset per real change */
+#define EXPECTED_CAPGET 1
+#define EXPECTED_CAPSET 6
+
+static void toggle_capabilities(void) __attribute__((noreturn));
+static void toggle_capabilities(void) {
+  const cap_value_t keytab_caps[] = {CAP_CHOWN, CAP_DAC_OVERRIDE};
+  const cap_value_t chown_caps[] = {CAP_CHOWN};
+
+  if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0) {
+    _exit(EXIT_SKIP);
+  }
+
+  if (unshare(CLONE_NEWUSER) != 0) {
+    _exit(EXIT_SKIP);
+  }
+
+  (void)raise(SIGSTOP);
+
+  /* this mirrors what mkdirat_if_missing and chown_chmod_keytab do */
+  (void)disable_capabilities();                   /* capget + capset */
+  (void)disable_capabilities();                   /* nothing */
+  if (enable_capabilities(keytab_caps, 2) != 0) { /* capset */
+    _exit(EXIT_FAILURE);
+  }
+  if (enable_capabilities(keytab_caps, 2) != 0) { /* nothing */
+    _exit(EXIT_FAILURE);
+  }
+  if (enable_capabilities(chown_caps, 1) != 0) {  /* capset */
+    _exit(EXIT_FAILURE);
+  }
+  (void)disable_capabilities();                   /* capset */
+  if (enable_capabilities(chown_caps, 1) != 0) {  /* capset */
+    _exit(EXIT_FAILURE);
+  }
+  (void)disable_capabilities();                   /* capset */
+  (void)disable_capabilities();                   /* nothing */
+
+  _exit(EXIT_SUCCESS);
+}
+
+int main(void) {
+
+  struct __ptrace_syscall_info info = {0};
+  int status = 0;
+  int capget_calls = 0;
+  int capset_calls = 0;
+
+  const pid_t child = fork();
+  if (child < 0) {
+    (void)fprintf(stderr, "%s: Cannot fork: %s\n", __PROGRAM_NAME, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  if (child == 0) {
+    toggle_capabilities();
+  }
+
+  if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) {
+    if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SKIP) {
+      (void)printf("%s: cannot trace or cannot create a user namespace, skipping\n", __PROGRAM_NAME);
+      exit(EXIT_SKIP);
+    }
+    (void)fprintf(stderr, "%s: child did not stop\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  if (ptrace(PTRACE_SETOPTIONS, child, NULL, (void *)(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL)) != 0) {
+    (void)fprintf(stderr, "%s: Cannot set ptrace options: %s\n", __PROGRAM_NAME, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  while (ptrace(PTRACE_SYSCALL, child, NULL, NULL) == 0 && waitpid(child, &status, 0) == child) {
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      break;
+    }
+    if (!WIFSTOPPED(status) || WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+      continue;
+    }
+    if (ptrace(PTRACE_GET_SYSCALL_INFO, child, (void *)sizeof(info), &info) <= 0) {
+      continue;
+    }
+    if (info.op != PTRACE_SYSCALL_INFO_ENTRY) {
+      continue;
+    }
+    if (info.entry.nr == SYS_capget) {
+      capget_calls++;
+    } else if (info.entry.nr == SYS_capset) {
+      capset_calls++;
+    }
+  }
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    (void)fprintf(stderr, "%s: capability toggles failed\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  (void)printf("%s: capget %d (expected %d), capset %d (expected %d)\n", __PROGRAM_NAME, capget_calls, EXPECTED_CAPGET, capset_calls, EXPECTED_CAPSET);
+
+  if (capget_calls != EXPECTED_CAPGET || capset_calls != EXPECTED_CAPSET) {
+    exit(EXIT_FAILURE);
+  }
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,166 @@
+/*
+ *
+ * Check we find the TGT end time in MIT FILE ccaches.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-ccache"
+#endif
+
+#include "autoconf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kcron_ccache.h"
+
+#define CHECK(x)                                                                                                                                                                                       \
+  do {                                                                                                                                                                                                 \
+    if (!(x)) {                                                                                                                                                                                        \
+      (void)fprintf(stderr, "%s: %s:%d: check failed: %s\n", __PROGRAM_NAME, __FILE__, __LINE__, #x);                                                                                                 \
+      failed = 1;                                                                                                                                                                                      \
+    }                                                                                                                                                                                                  \
+  } while (0)
+
+static unsigned char ccache[1024];
+static size_t ccache_length = 0;
+
+static void put_u16(uint16_t value) {
+  ccache[ccache_length++] = (unsigned char)(value >> 8);
+  ccache[ccache_length++] = (unsigned char)value;
+}
+
+static void put_u32(uint32_t value) {
+  put_u16((uint16_t)(value >> 16));
+  put_u16((uint16_t)value);
+}
+
+static void put_data(const char *text) __attribute__((nonnull(1)));
+static void put_data(const char *text) {
+  put_u32((uint32_t)strlen(text));
+  (void)memcpy(ccache + ccache_length, text, strlen(text));
+  ccache_length += strlen(text);
+}
+
+static void put_principal(const char *realm, const char *first, const char *second) __attribute__((nonnull(1, 2)));
+static void put_principal(const char *realm, const char *first, const char *second) {
+  put_u32(1);
+  put_u32((second == NULL) ? 1 : 2);
+  put_data(realm);
+  put_data(first);
+  if (second != NULL) {
+    put_data(second);
+  }
+}
+
+static void put_header(uint16_t version) {
+  ccache_length = 0;
+  put_u16(version);
+  if (version == KCRON_CCACHE_VERSION_4) {
+    /* one kdc time offset tag */
+    put_u16(12);
+    put_u16(1);
+    put_u16(8);
+    put_u32(0);
+    put_u32(0);
+  }
+  put_principal("EXAMPLE.COM", "user", "cron");
+}
+
+static void put_credential(uint16_t version, const char *server_realm, const char *server_first, const char *server_second, uint32_t endtime) __attribute__((nonnull(2, 3)));
+static void put_credential(uint16_t version, const char *server_realm, const char *server_first, const char *server_second, uint32_t endtime) {
+  put_principal("EXAMPLE.COM", "user", "cron");
+  put_principal(server_realm, server_first, server_second);
+  put_u16(18);
+  if (version == KCRON_CCACHE_VERSION_3) {
+    put_u16(18);
+  }
+  put_data("0123456789abcdef0123456789abcdef");
+  put_u32(endtime - 36000);
+  put_u32(endtime - 36000);
+  put_u32(endtime);
+  put_u32(endtime + 86400);
+  ccache[ccache_length++] = 0;
+  put_u32(0x40e10000);
+  /* one address, no authdata */
+  put_u32(1);
+  put_u16(2);
+  put_data("\x7f\x01\x01\x01");
+  put_u32(0);
+  put_data("ticket");
+  put_data("");
+}
+
+int main(void) {
+
+  uint32_t endtime = 0;
+  int failed = 0;
+
+  /* kinit stores a config entry before the TGT */
+  put_header(KCRON_CCACHE_VERSION_4);
+  put_credential(KCRON_CCACHE_VERSION_4, "X-CACHECONF:", "krb5_ccache_conf_data", "pa_type", 0);
+  put_credential(KCRON_CCACHE_VERSION_4, "EXAMPLE.COM", "krbtgt", "EXAMPLE.COM", 1800000000);
+  CHECK(kcron_ccache_tgt_endtime(ccache, ccache_length, &endtime) == 0);
+  CHECK(endtime == 1800000000);
+
+  /* every byte short of the end is damaged or has lost the TGT */
+  for (size_t length = 0; length < ccache_length; length++) {
+    CHECK(kcron_ccache_tgt_endtime(ccache, length, &endtime) != 0);
+  }
+
+  /* a cross realm TGT and a service ticket are not ours */
+  put_header(KCRON_CCACHE_VERSION_3);
+  put_credential(KCRON_CCACHE_VERSION_3, "EXAMPLE.COM", "krbtgt", "OTHER.COM", 1800000001);
+  put_credential(KCRON_CCACHE_VERSION_3, "EXAMPLE.COM", "host", "host.example.com", 1800000002);
+  CHECK(kcron_ccache_tgt_endtime(ccache, ccache_length, &endtime) == 1);
+  put_credential(KCRON_CCACHE_VERSION_3, "EXAMPLE.COM", "krbtgt", "EXAMPLE.COM", 1800000003);
+  CHECK(kcron_ccache_tgt_endtime(ccache, ccache_length, &endtime) == 0);
+  CHECK(endtime == 1800000003);
+
+  /* a keytab is not a ccache */
+  ccache[0] = 0x05;
+  ccache[1] = 0x02;
+  CHECK(kcron_ccache_tgt_endtime(ccache, ccache_length, &endtime) == -1);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
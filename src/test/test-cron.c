@@ -0,0 +1,146 @@
+/*
+ *
+ * Check kcron_cron.h reads crontab schedules the way cron(8) does.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-cron"
+#endif
+
+#include "autoconf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kcron_cron.h"
+
+#define CHECK(x)                                                                                                                                                                                       \
+  do {                                                                                                                                                                                                 \
+    if (!(x)) {                                                                                                                                                                                        \
+      (void)fprintf(stderr, "%s: %s:%d: check failed: %s\n", __PROGRAM_NAME, __FILE__, __LINE__, #x);                                                                                                 \
+      failed = 1;                                                                                                                                                                                      \
+    }                                                                                                                                                                                                  \
+  } while (0)
+
+/* tm for year-month-day hour:minute, with the weekday filled in */
+static struct tm at(int year, int month, int day, int hour, int minute) {
+  struct tm tm = {0};
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month - 1;
+  tm.tm_mday = day;
+  tm.tm_hour = hour;
+  tm.tm_min = minute;
+  tm.tm_isdst = -1;
+  (void)mktime(&tm);
+  return tm;
+}
+
+static int matches(const char *line, struct tm tm) __attribute__((nonnull(1)));
+static int matches(const char *line, struct tm tm) {
+  struct kcron_cron_entry entry = {0};
+  if (kcron_cron_parse_line(line, &entry, NULL, 0) != 1) {
+    return -1;
+  }
+  return kcron_cron_matches(&entry, &tm);
+}
+
+int main(void) {
+
+  struct kcron_cron_entry entry = {0};
+  char user[64] = {0};
+  int failed = 0;
+
+  (void)setenv("TZ", "UTC", 1);
+  tzset();
+
+  /* lines that are not schedules */
+  CHECK(kcron_cron_parse_line("", &entry, NULL, 0) == 0);
+  CHECK(kcron_cron_parse_line("   # 0 * * * * comment", &entry, NULL, 0) == 0);
+  CHECK(kcron_cron_parse_line("MAILTO=someone@example.com", &entry, NULL, 0) == 0);
+  CHECK(kcron_cron_parse_line("SHELL = /bin/bash", &entry, NULL, 0) == 0);
+  CHECK(kcron_cron_parse_line("@reboot /bin/true", &entry, NULL, 0) == 0);
+
+  /* and ones we cannot read */
+  CHECK(kcron_cron_parse_line("60 * * * * /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("* * 0 * * /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("5-1 * * * * /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("*/0 * * * * /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("*/4294967296 * * * * /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("* */25 * * * /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("@fortnightly /bin/true", &entry, NULL, 0) == -1);
+  CHECK(kcron_cron_parse_line("* * *", &entry, NULL, 0) == -1);
+
+  /* 2024-01-01 was a Monday */
+  CHECK(matches("0 * * * * cmd", at(2024, 1, 1, 13, 0)) == 1);
+  CHECK(matches("0 * * * * cmd", at(2024, 1, 1, 13, 1)) == 0);
+  CHECK(matches("*/15 9-17 * * mon-fri cmd", at(2024, 1, 1, 9, 45)) == 1);
+  CHECK(matches("*/15 9-17 * * mon-fri cmd", at(2024, 1, 1, 18, 0)) == 0);
+  CHECK(matches("*/15 9-17 * * mon-fri cmd", at(2024, 1, 6, 9, 0)) == 0);
+  CHECK(matches("5/20 * * * * cmd", at(2024, 1, 1, 0, 45)) == 1);
+  CHECK(matches("5/20 * * * * cmd", at(2024, 1, 1, 0, 40)) == 0);
+  CHECK(matches("0,30 1,13 * jan,Jul * cmd", at(2024, 7, 4, 13, 30)) == 1);
+  CHECK(matches("0,30 1,13 * jan,Jul * cmd", at(2024, 8, 4, 13, 30)) == 0);
+
+  /* Sunday is both 0 and 7 */
+  CHECK(matches("0 0 * * 7 cmd", at(2024, 1, 7, 0, 0)) == 1);
+  CHECK(matches("0 0 * * 5-7 cmd", at(2024, 1, 7, 0, 0)) == 1);
+  CHECK(matches("@weekly cmd", at(2024, 1, 7, 0, 0)) == 1);
+  CHECK(matches("@monthly cmd", at(2024, 2, 1, 0, 0)) == 1);
+  CHECK(matches("@hourly cmd", at(2024, 2, 1, 5, 0)) == 1);
+
+  /* with both day fields restricted either one will do */
+  CHECK(matches("0 0 13 * fri cmd", at(2024, 1, 13, 0, 0)) == 1);
+  CHECK(matches("0 0 13 * fri cmd", at(2024, 1, 5, 0, 0)) == 1);
+  CHECK(matches("0 0 13 * fri cmd", at(2024, 1, 6, 0, 0)) == 0);
+  CHECK(matches("0 0 13 * * cmd", at(2024, 1, 5, 0, 0)) == 0);
+  CHECK(matches("0 0 */2 * fri cmd", at(2024, 1, 6, 0, 0)) == 0);
+
+  /* system crontabs name the user */
+  CHECK(kcron_cron_parse_line("*/5 * * * * someone /usr/bin/job --flag", &entry, user, sizeof(user)) == 1);
+  CHECK(strcmp(user, "someone") == 0);
+  CHECK(kcron_cron_parse_line("@daily other /usr/bin/job", &entry, user, sizeof(user)) == 1);
+  CHECK(strcmp(user, "other") == 0);
+  CHECK(kcron_cron_parse_line("*/5 * * * *", &entry, user, sizeof(user)) == -1);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
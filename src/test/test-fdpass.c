@@ -0,0 +1,106 @@
+/*
+ *
+ * Check kcron_fdpass.h hands over the directory it was given.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-fdpass"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kcron_fdpass.h"
+
+int main(void) {
+
+  struct stat sent = {0};
+  struct stat got = {0};
+  int sockets[2] = {-1, -1};
+  int status = 0;
+  int failed = 0;
+  int fd = -1;
+  pid_t pid = 0;
+
+  if (stat("/", &sent) != 0 || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  pid = fork();
+  if (pid < 0) {
+    exit(EXIT_FAILURE);
+  }
+  if (pid == 0) {
+    (void)close(sockets[0]);
+    fd = open("/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    _exit((fd >= 0 && kcron_send_fd(sockets[1], fd) == 0) ? 0 : 1);
+  }
+
+  (void)close(sockets[1]);
+  fd = kcron_recv_fd(sockets[0]);
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    (void)fprintf(stderr, "%s: sender failed\n", __PROGRAM_NAME);
+    failed = 1;
+  }
+
+  if (fd < 0 || fstat(fd, &got) != 0 || got.st_dev != sent.st_dev || got.st_ino != sent.st_ino) {
+    (void)fprintf(stderr, "%s: did not get / back: %s\n", __PROGRAM_NAME, strerror(errno));
+    failed = 1;
+  } else if ((fcntl(fd, F_GETFD) & FD_CLOEXEC) == 0) {
+    (void)fprintf(stderr, "%s: received descriptor is not close-on-exec\n", __PROGRAM_NAME);
+    failed = 1;
+  }
+
+  /* the sender is gone, so there is nothing more to receive */
+  errno = 0;
+  if (kcron_recv_fd(sockets[0]) != -1 || errno != EBADMSG) {
+    (void)fprintf(stderr, "%s: expected EBADMSG once the sender closed\n", __PROGRAM_NAME);
+    failed = 1;
+  }
+
+  return failed;
+}
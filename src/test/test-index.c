@@ -0,0 +1,166 @@
+/*
+ *
+ * Check the kcron-indexd snapshot: records survive growing the table,
+ * deleted slots do not break probing, and a reader follows a newer file.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-index"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "kcron_index.h"
+
+#define CHECK(x)                                                                                                                                                                                       \
+  do {                                                                                                                                                                                                 \
+    if (!(x)) {                                                                                                                                                                                        \
+      (void)fprintf(stderr, "%s: %s:%d: check failed: %s\n", __PROGRAM_NAME, __FILE__, __LINE__, #x);                                                                                                 \
+      failed = 1;                                                                                                                                                                                      \
+    }                                                                                                                                                                                                  \
+  } while (0)
+
+/* several times KCRON_INDEX_MIN_SLOTS, so the table has to grow */
+#define TEST_RECORDS 5000
+
+static void make_record(struct kcron_index_record *record, uint32_t uid) {
+  (void)memset(record, 0, sizeof(struct kcron_index_record));
+  record->uid = uid;
+  record->shard = -1;
+  record->inode = (uint64_t)uid * 7;
+  record->kvno = uid % 5;
+  record->entries = 2;
+}
+
+int main(void) {
+
+  struct kcron_index_writer writer = {0};
+  struct kcron_index_writer first = {0};
+  struct kcron_index reader = {0};
+  struct kcron_index_record record = {0};
+  struct kcron_index_record *records = NULL;
+  char directory[] = "/tmp/test-index.XXXXXX";
+  char path[sizeof(directory) + 8] = {0};
+  int failed = 0;
+  int fd = -1;
+
+  if (mkdtemp(directory) == NULL) {
+    exit(EXIT_FAILURE);
+  }
+  (void)snprintf(path, sizeof(path), "%s/index", directory);
+
+  /* anything else at the path is refused */
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  CHECK(fd >= 0 && write(fd, "KCRONIDX but not really an index, too short", 44) == 44);
+  (void)close(fd);
+  CHECK(kcron_index_open(&reader, path) == EINVAL);
+
+  CHECK(kcron_index_create(&first, path, KCRON_INDEX_MIN_SLOTS, 0600, (gid_t)-1) == 0);
+  CHECK(kcron_index_publish(&first, NULL) == 0);
+  CHECK(kcron_index_open(&reader, path) == 0);
+  CHECK(kcron_index_lookup(&reader, 1000, &record) == 0);
+
+  /* a writer that fills up moves to a bigger file, the reader follows */
+  writer = first;
+  for (uint32_t uid = 1000; uid < 1000 + TEST_RECORDS; uid++) {
+    make_record(&record, uid);
+    CHECK(kcron_index_reserve(&writer, 1) == 0);
+    kcron_index_begin(&writer);
+    CHECK(kcron_index_put(&writer, &record) == 0);
+    kcron_index_end(&writer);
+  }
+  CHECK(writer.header->num_slots > KCRON_INDEX_MIN_SLOTS);
+  CHECK(writer.header->num_records == TEST_RECORDS);
+  CHECK((writer.header->sequence & 1) == 0);
+
+  CHECK(kcron_index_lookup(&reader, 1000 + TEST_RECORDS - 1, &record) == 1);
+  CHECK(reader.header->num_slots == writer.header->num_slots);
+  CHECK(record.inode == (uint64_t)(1000 + TEST_RECORDS - 1) * 7);
+
+  /* every other one gone, the rest still found past the deleted slots */
+  kcron_index_begin(&writer);
+  for (uint32_t uid = 1000; uid < 1000 + TEST_RECORDS; uid += 2) {
+    kcron_index_remove(&writer, uid);
+  }
+  kcron_index_end(&writer);
+  CHECK(writer.header->num_records == TEST_RECORDS / 2);
+  for (uint32_t uid = 1000; uid < 1000 + TEST_RECORDS; uid++) {
+    const int found = kcron_index_lookup(&reader, uid, &record);
+    CHECK(found == (int)(uid % 2));
+    if (found == 1) {
+      CHECK(record.uid == uid && record.kvno == uid % 5 && record.entries == 2);
+    }
+  }
+
+  /* replacing a record does not add one */
+  make_record(&record, 1001);
+  record.kvno = 42;
+  kcron_index_begin(&writer);
+  CHECK(kcron_index_put(&writer, &record) == 0);
+  kcron_index_end(&writer);
+  CHECK(writer.header->num_records == TEST_RECORDS / 2);
+  CHECK(kcron_index_lookup(&reader, 1001, &record) == 1 && record.kvno == 42);
+
+  CHECK(kcron_index_dump(&reader, &records) == TEST_RECORDS / 2);
+  (void)free(records);
+
+  /* an index from a writer that went away is superseded by the next one */
+  CHECK(kcron_index_create(&first, path, KCRON_INDEX_MIN_SLOTS, 0600, (gid_t)-1) == 0);
+  CHECK(kcron_index_publish(&first, NULL) == 0);
+  CHECK(kcron_index_lookup(&reader, 1001, &record) == 0);
+  CHECK(reader.header->num_slots == KCRON_INDEX_MIN_SLOTS);
+
+  (void)munmap(writer.map, writer.length);
+  (void)munmap(first.map, first.length);
+  kcron_index_close(&reader);
+  (void)unlink(path);
+  (void)rmdir(directory);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
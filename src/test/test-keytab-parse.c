@@ -0,0 +1,207 @@
+/*
+ *
+ * Build a keytab by hand and check kcron_keytab_parse.h reads it back.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-keytab-parse"
+#endif
+
+#include "autoconf.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "kcron_keytab_parse.h"
+
+#define CHECK(x)                                                                                                                                                                                       \
+  do {                                                                                                                                                                                                 \
+    if (!(x)) {                                                                                                                                                                                        \
+      (void)fprintf(stderr, "%s: %s:%d: check failed: %s\n", __PROGRAM_NAME, __FILE__, __LINE__, #x);                                                                                                 \
+      failed = 1;                                                                                                                                                                                      \
+    }                                                                                                                                                                                                  \
+  } while (0)
+
+static unsigned char keytab[512];
+static size_t keytab_length = 0;
+
+static void put_u16(uint16_t value) {
+  keytab[keytab_length++] = (unsigned char)(value >> 8);
+  keytab[keytab_length++] = (unsigned char)value;
+}
+
+static void put_u32(uint32_t value) {
+  put_u16((uint16_t)(value >> 16));
+  put_u16((uint16_t)value);
+}
+
+static void put_data(const char *text) __attribute__((nonnull(1)));
+static void put_data(const char *text) {
+  put_u16((uint16_t)strlen(text));
+  (void)memcpy(keytab + keytab_length, text, strlen(text));
+  keytab_length += strlen(text);
+}
+
+/* one entry for user/cron/host.example.com@EXAMPLE.COM */
+static void put_entry(uint32_t timestamp, uint8_t kvno8, uint16_t enctype, uint32_t kvno32, int with_kvno32) {
+  const size_t size_at = keytab_length;
+
+  put_u32(0);
+  put_u16(3);
+  put_data("EXAMPLE.COM");
+  put_data("user");
+  put_data("cron");
+  put_data("host.example.com");
+  put_u32(1);
+  put_u32(timestamp);
+  keytab[keytab_length++] = kvno8;
+  put_u16(enctype);
+  put_data("0123456789abcdef");
+  if (with_kvno32 != 0) {
+    put_u32(kvno32);
+  }
+
+  const uint32_t size = (uint32_t)(keytab_length - size_at - 4);
+  keytab[size_at] = (unsigned char)(size >> 24);
+  keytab[size_at + 1] = (unsigned char)(size >> 16);
+  keytab[size_at + 2] = (unsigned char)(size >> 8);
+  keytab[size_at + 3] = (unsigned char)size;
+}
+
+int main(void) {
+
+  char path[] = "/tmp/test-keytab-parse.XXXXXX";
+  struct kcron_keytab_map map = {0};
+  struct kcron_keytab_entry entry = {0};
+  unsigned char copy[sizeof(keytab)] = {0};
+  char principal[64] = {0};
+  size_t offset = 0;
+  int failed = 0;
+
+  put_u16(KCRON_KEYTAB_VERSION);
+  put_entry(1700000000, 3, 18, 0, 0);
+  /* a hole left by a removed entry */
+  put_u32((uint32_t)-8);
+  put_u32(0xdeadbeef);
+  put_u32(0xdeadbeef);
+  /* kvno 300 does not fit in vno8 */
+  put_entry(1700000001, 44, 17, 300, 1);
+
+  const int fd = mkstemp(path);
+  if (fd < 0 || write(fd, keytab, keytab_length) != (ssize_t)keytab_length || close(fd) != 0) {
+    (void)fprintf(stderr, "%s: cannot write %s\n", __PROGRAM_NAME, path);
+    exit(EXIT_FAILURE);
+  }
+
+  CHECK(kcron_keytab_map_at(AT_FDCWD, path, &map) == 0);
+  if (map.data == NULL) {
+    (void)unlink(path);
+    exit(EXIT_FAILURE);
+  }
+
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 1);
+  CHECK(entry.kvno == 3);
+  CHECK(entry.enctype == 18);
+  CHECK(entry.timestamp == 1700000000);
+  CHECK(kcron_keytab_principal_is(&entry, "user/cron/host.example.com@EXAMPLE.COM") == 1);
+  CHECK(kcron_keytab_principal_is(&entry, "user/cron/host.example.com@EXAMPLE.CO") == 0);
+  CHECK(kcron_keytab_principal_is(&entry, "user/cron@EXAMPLE.COM") == 0);
+  CHECK(kcron_keytab_principal_is(&entry, "user/cron/host.example.com/x@EXAMPLE.COM") == 0);
+  CHECK(kcron_keytab_snprint_principal(principal, sizeof(principal), &entry) == 0);
+  CHECK(strcmp(principal, "user/cron/host.example.com@EXAMPLE.COM") == 0);
+  CHECK(kcron_keytab_snprint_principal(principal, strlen("user/cron/host.example.com@EXAMPLE.COM"), &entry) == 1);
+
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 1);
+  CHECK(entry.kvno == 300);
+  CHECK(entry.enctype == 17);
+  CHECK(entry.timestamp == 1700000001);
+
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 0);
+  kcron_keytab_unmap(&map);
+
+  /* the same through a buffer, as the root daemons and libkcron read it */
+  offset = 0;
+  CHECK(kcron_keytab_read_at(AT_FDCWD, path, copy, sizeof(copy), &map) == 0);
+  CHECK(map.mapped == 0 && map.truncated == 0 && map.length == keytab_length);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 1);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 1);
+  CHECK(entry.kvno == 300);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 0);
+  kcron_keytab_unmap(&map);
+
+  /* a buffer too short for the file keeps what fits and says so */
+  offset = 0;
+  CHECK(kcron_keytab_read_at(AT_FDCWD, path, copy, keytab_length - 4, &map) == 0);
+  CHECK(map.truncated == 1 && map.length == keytab_length - 4);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 1);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == -1);
+  kcron_keytab_unmap(&map);
+
+  /* a record claiming more bytes than the file has */
+  keytab[5] = 0xff;
+  const int damaged = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+  if (damaged < 0 || write(damaged, keytab, keytab_length) != (ssize_t)keytab_length || close(damaged) != 0) {
+    (void)unlink(path);
+    exit(EXIT_FAILURE);
+  }
+  offset = 0;
+  CHECK(kcron_keytab_map_at(AT_FDCWD, path, &map) == 0);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == -1);
+  kcron_keytab_unmap(&map);
+
+  /* the empty keytab init-kcron-keytab writes */
+  const int empty = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+  if (empty < 0 || write(empty, keytab, 2) != 2 || close(empty) != 0) {
+    (void)unlink(path);
+    exit(EXIT_FAILURE);
+  }
+  offset = 0;
+  CHECK(kcron_keytab_map_at(AT_FDCWD, path, &map) == 0);
+  CHECK(kcron_keytab_next(&map, &offset, &entry) == 0);
+  kcron_keytab_unmap(&map);
+
+  (void)unlink(path);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
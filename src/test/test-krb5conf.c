@@ -0,0 +1,140 @@
+/*
+ *
+ * Check kcron_krb5conf.h follows include, includedir and first value wins.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-krb5conf"
+#endif
+
+#include "autoconf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "kcron_krb5conf.h"
+
+static char top[FILE_PATH_MAX_LENGTH];
+
+static int write_conf(const char *name, const char *content) __attribute__((nonnull(1, 2)));
+static int write_conf(const char *name, const char *content) {
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  FILE *output = NULL;
+
+  (void)snprintf(path, sizeof(path), "%s/%s", top, name);
+  output = fopen(path, "we");
+  if (output == NULL) {
+    return 1;
+  }
+  (void)fputs(content, output);
+  return fclose(output);
+}
+
+int main(void) {
+
+  char main_conf[FILE_PATH_MAX_LENGTH] = {0};
+  char conf_d[FILE_PATH_MAX_LENGTH] = {0};
+  char content[FILE_PATH_MAX_LENGTH] = {0};
+  char command[FILE_PATH_MAX_LENGTH] = {0};
+  static struct kcron_krb5conf conf;
+  int failed = 0;
+
+  (void)snprintf(top, sizeof(top), "/tmp/test-krb5conf.XXXXXX");
+  if (mkdtemp(top) == NULL) {
+    exit(EXIT_FAILURE);
+  }
+  (void)snprintf(main_conf, sizeof(main_conf), "%s/krb5.conf", top);
+  (void)snprintf(conf_d, sizeof(conf_d), "%s/conf.d", top);
+  (void)mkdir(conf_d, 0700);
+
+  /* a default_realm inside a realm block or a comment is not the default */
+  (void)snprintf(content, sizeof(content),
+                 "# default_realm = COMMENT.ORG\n"
+                 "includedir %s/\n"
+                 "[realms]\n"
+                 " MAIN.ORG = {\n"
+                 "  default_realm = NESTED.ORG\n"
+                 " }\n"
+                 "[libdefaults]\n"
+                 " ; default_realm = SEMICOLON.ORG\n"
+                 " default_realm = MAIN.ORG\n",
+                 conf_d);
+  if (write_conf("krb5.conf", content) != 0 || write_conf("conf.d/20-late.conf", "[libdefaults]\n default_realm = LATE.ORG\n") != 0 ||
+      write_conf("conf.d/10-early", "[libdefaults]\n default_realm = \"EARLY.ORG\" *\n") != 0 || write_conf("conf.d/05-editor.conf~", "[libdefaults]\n default_realm = BACKUP.ORG\n") != 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  if (kcron_krb5conf_load(main_conf, &conf) != 0 || strcmp(conf.default_realm, "EARLY.ORG") != 0) {
+    (void)fprintf(stderr, "%s: expected EARLY.ORG from includedir, got '%s'\n", __PROGRAM_NAME, conf.default_realm);
+    failed = 1;
+  }
+  if (conf.num_deps != 4) {
+    (void)fprintf(stderr, "%s: expected 4 files read, got %zu\n", __PROGRAM_NAME, conf.num_deps);
+    failed = 1;
+  }
+
+  (void)snprintf(command, sizeof(command), "%s/conf.d/10-early", top);
+  (void)unlink(command);
+  if (kcron_krb5conf_load(main_conf, &conf) != 0 || strcmp(conf.default_realm, "LATE.ORG") != 0) {
+    (void)fprintf(stderr, "%s: expected LATE.ORG, got '%s'\n", __PROGRAM_NAME, conf.default_realm);
+    failed = 1;
+  }
+
+  /* a colon separated KRB5_CONFIG with a missing first entry */
+  (void)snprintf(command, sizeof(command), "%s/missing:%s", top, main_conf);
+  (void)snprintf(content, sizeof(content), "%s/conf.d/20-late.conf", top);
+  (void)unlink(content);
+  if (kcron_krb5conf_load(command, &conf) != 0 || strcmp(conf.default_realm, "MAIN.ORG") != 0) {
+    (void)fprintf(stderr, "%s: expected MAIN.ORG, got '%s'\n", __PROGRAM_NAME, conf.default_realm);
+    failed = 1;
+  }
+
+  (void)snprintf(content, sizeof(content), "%s/conf.d/05-editor.conf~", top);
+  (void)unlink(content);
+  (void)rmdir(conf_d);
+  (void)unlink(main_conf);
+  (void)rmdir(top);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
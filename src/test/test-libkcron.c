@@ -0,0 +1,106 @@
+/*
+ *
+ * Check libkcron agrees with the helpers about where keytabs live.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-libkcron"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "kcron_filename.h"
+#include "libkcron.h"
+
+static char keytab[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_dirname[FILE_PATH_MAX_LENGTH + 3];
+static char keytab_filename[FILE_PATH_MAX_LENGTH + 3];
+
+int main(void) {
+
+  const uid_t uids[] = {0, 1, 255, 256, 65534, getuid(), (uid_t)-2};
+  char path[FILE_PATH_MAX_LENGTH + 1] = {0};
+  char dir[FILE_PATH_MAX_LENGTH + 1] = {0};
+  char tiny[8] = {0};
+  struct kcron_keytab_status status = {0};
+  int failed = 0;
+
+  if (strcmp(kcron_keytab_basedir(), __CLIENT_KEYTAB_DIR) != 0) {
+    (void)fprintf(stderr, "%s: basedir %s is not %s\n", __PROGRAM_NAME, kcron_keytab_basedir(), __CLIENT_KEYTAB_DIR);
+    failed = 1;
+  }
+
+  for (size_t i = 0; i < sizeof(uids) / sizeof(uids[0]); i++) {
+    if (get_filenames_for_uid(uids[i], keytab_dirname, keytab_filename, keytab) != 0 || kcron_keytab_path_for_uid(uids[i], path, sizeof(path)) != 0 ||
+        kcron_keytab_dir_for_uid(uids[i], dir, sizeof(dir)) != 0) {
+      (void)fprintf(stderr, "%s: no path for uid %u\n", __PROGRAM_NAME, (unsigned)uids[i]);
+      failed = 1;
+      continue;
+    }
+    if (strcmp(path, keytab) != 0 || strcmp(dir, keytab_dirname) != 0) {
+      (void)fprintf(stderr, "%s: uid %u got %s in %s, expected %s in %s\n", __PROGRAM_NAME, (unsigned)uids[i], path, dir, keytab, keytab_dirname);
+      failed = 1;
+    }
+  }
+
+  /* a short buffer is an error for the caller, not a truncated path */
+  errno = 0;
+  if (kcron_keytab_path_for_uid(0, tiny, sizeof(tiny)) != -1 || errno != ERANGE) {
+    (void)fprintf(stderr, "%s: expected ERANGE for an 8 byte buffer\n", __PROGRAM_NAME);
+    failed = 1;
+  }
+
+  /* nobody has this uid, so either there is no keytab or we may not look */
+  if (kcron_keytab_status_for_uid((uid_t)-2, &status) == 0) {
+    if (status.exists != 0 || status.usable != 0) {
+      (void)fprintf(stderr, "%s: found a keytab for uid %u\n", __PROGRAM_NAME, (unsigned)-2);
+      failed = 1;
+    }
+  } else if (errno != EACCES) {
+    (void)fprintf(stderr, "%s: status for uid %u: %s\n", __PROGRAM_NAME, (unsigned)-2, strerror(errno));
+    failed = 1;
+  }
+
+  return failed;
+}
@@ -0,0 +1,107 @@
+/*
+ *
+ * Check the BPF program embedded in init-kcron-keytab matches what
+ * libseccomp builds from kcron_seccomp_rules.h today.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-seccomp-bpf"
+#endif
+
+#include "autoconf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kcron_seccomp_bpf.h"
+#include "kcron_seccomp_rules.h"
+
+#define KCRON_SECCOMP_MAX_INSNS 4096 /* BPF_MAXINSNS */
+
+/* must be in the same order as kcron_seccomp_profiles[] */
+static const struct {
+  const struct sock_filter *filter;
+  size_t len;
+} embedded[] = {
+    {kcron_seccomp_filter, sizeof(kcron_seccomp_filter) / sizeof(kcron_seccomp_filter[0])},
+    {kcron_seccomp_filter_name, sizeof(kcron_seccomp_filter_name) / sizeof(kcron_seccomp_filter_name[0])},
+    {kcron_seccomp_filter_status, sizeof(kcron_seccomp_filter_status) / sizeof(kcron_seccomp_filter_status[0])},
+};
+
+_Static_assert(sizeof(embedded) / sizeof(embedded[0]) == KCRON_SECCOMP_NUM_PROFILES, "every seccomp profile must be checked");
+
+int main(void) {
+
+  struct sock_filter program[KCRON_SECCOMP_MAX_INSNS];
+  scmp_filter_ctx ctx = NULL;
+  size_t len = 0;
+
+  for (size_t profile = 0; profile < KCRON_SECCOMP_NUM_PROFILES; profile++) {
+    const char *name = kcron_seccomp_profiles[profile].name;
+    const struct sock_filter *filter = embedded[profile].filter;
+
+    ctx = kcron_seccomp_build_profile(&kcron_seccomp_profiles[profile]);
+    if (ctx == NULL) {
+      exit(EXIT_FAILURE);
+    }
+
+    len = kcron_seccomp_export(ctx, program, KCRON_SECCOMP_MAX_INSNS);
+    (void)seccomp_release(ctx);
+    if (len == 0) {
+      exit(EXIT_FAILURE);
+    }
+
+    if (len != embedded[profile].len) {
+      (void)fprintf(stderr, "%s: embedded %s has %zu instructions, libseccomp built %zu.\n", __PROGRAM_NAME, name, embedded[profile].len, len);
+      exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < len; i++) {
+      if (memcmp(&program[i], &filter[i], sizeof(struct sock_filter)) != 0) {
+        (void)fprintf(stderr, "%s: %s instruction %zu differs: {0x%04x, %u, %u, 0x%08x} != {0x%04x, %u, %u, 0x%08x}\n", __PROGRAM_NAME, name, i, filter[i].code, filter[i].jt,
+                      filter[i].jf, filter[i].k, program[i].code, program[i].jt, program[i].jf, program[i].k);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    (void)printf("%s: %s %zu instructions match\n", __PROGRAM_NAME, name, len);
+  }
+
+  exit(EXIT_SUCCESS);
+}
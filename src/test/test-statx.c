@@ -0,0 +1,116 @@
+/*
+ *
+ * Check both kcron_statx_batch() backends agree with plain STATX(2).
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-statx"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "kcron_statx.h"
+
+#define CHECK(x)                                                                                                                                                                                       \
+  do {                                                                                                                                                                                                 \
+    if (!(x)) {                                                                                                                                                                                        \
+      (void)fprintf(stderr, "%s: %s:%d: check failed: %s\n", __PROGRAM_NAME, __FILE__, __LINE__, #x);                                                                                                 \
+      failed = 1;                                                                                                                                                                                      \
+    }                                                                                                                                                                                                  \
+  } while (0)
+
+/* more than one ring's worth, so the io_uring path has to refill */
+#define TEST_REQUESTS 1000
+
+static const char *const paths[] = {"/", "/dev/null", "/proc/self", "/does/not/exist", "tmp", "etc/passwd"};
+
+int main(void) {
+
+  struct kcron_statx_request *requests = calloc(TEST_REQUESTS, sizeof(struct kcron_statx_request));
+  struct statx expected = {0};
+  int failed = 0;
+  int error = 0;
+
+  if (requests == NULL) {
+    exit(EXIT_FAILURE);
+  }
+
+  const int root_fd = open("/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (root_fd < 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  for (int allow_uring = 0; allow_uring <= 1; allow_uring++) {
+    for (size_t i = 0; i < TEST_REQUESTS; i++) {
+      (void)memset(&requests[i], 0, sizeof(requests[i]));
+      requests[i].dir_fd = (paths[i % 6][0] == '/') ? AT_FDCWD : root_fd;
+      requests[i].path = paths[i % 6];
+      requests[i].error = -1;
+    }
+
+    const int backend = kcron_statx_batch(requests, TEST_REQUESTS, 4, allow_uring);
+    CHECK(backend >= 0);
+    (void)fprintf(stderr, "%s: ran with %s\n", __PROGRAM_NAME, (backend == KCRON_STATX_BACKEND_IO_URING) ? "io_uring" : "threads");
+
+    for (size_t i = 0; i < TEST_REQUESTS; i++) {
+      error = (statx(requests[i].dir_fd, requests[i].path, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_BASIC_STATS, &expected) == 0) ? 0 : errno;
+      CHECK(requests[i].error == error);
+      if (error == 0) {
+        CHECK(requests[i].stx.stx_ino == expected.stx_ino);
+        CHECK(requests[i].stx.stx_mode == expected.stx_mode);
+        CHECK(requests[i].stx.stx_uid == expected.stx_uid);
+      }
+    }
+  }
+
+  (void)close(root_fd);
+  (void)free(requests);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,569 @@
+/*
+ *
+ * Run init-kcron-keytab and client-keytab-name under PTRACE(2) and hold
+ * their system calls and file descriptors to the budget in syscall-budget.txt
+ *
+ * Everything runs in a private user and mount namespace with a tmpfs over
+ * the client keytab directory, so the host is never touched.  If such a
+ * namespace cannot be made the test is skipped.
+ *
+ */
+#include "autoconf.h" /* for our automatic config bits        */
+/*
+
+   Copyright 2023 Fermi Research Alliance, LLC
+
+   This software was produced under U.S. Government contract DE-AC02-07CH11359
+   for Fermi National Accelerator Laboratory (Fermilab), which is operated by
+   Fermi Research Alliance, LLC for the U.S. Department of Energy. The U.S.
+   Government has rights to use, reproduce, and distribute this software.
+   NEITHER THE GOVERNMENT NOR FERMI RESEARCH ALLIANCE, LLC MAKES ANY WARRANTY,
+   EXPRESS OR IMPLIED, OR ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.
+   If software is modified to produce derivative works, such modified software
+   should be clearly marked, so as not to confuse it with the version available
+   from Fermilab.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR FERMI RESEARCH ALLIANCE, LLC BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE.
+
+*/
+
+#ifndef __PROGRAM_NAME
+#define __PROGRAM_NAME "test-syscall-budget"
+#endif
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/close_range.h>
+#include <libgen.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mount.h>
+#include <sys/ptrace.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "kcron_filename.h"
+
+#define EXIT_SKIP 77
+#define MAX_SYSCALLS 4096
+#define MAX_BUDGET_LINES 256
+
+/* 'binary@linkage' budget lines only hold for this kind of build */
+#if USE_STATIC_PIE == 1
+#define BUDGET_LINKAGE "static-pie"
+#else
+#define BUDGET_LINKAGE "dynamic"
+#endif
+
+struct syscall_name {
+  const char *name;
+  long nr;
+};
+
+#define SYSCALL_NAME(x) {#x, SYS_##x}
+
+/* names for the calls we expect to see, anything else prints as a number */
+static const struct syscall_name syscall_names[] = {
+    SYSCALL_NAME(read),          SYSCALL_NAME(write),          SYSCALL_NAME(close),     SYSCALL_NAME(fstat),      SYSCALL_NAME(newfstatat), SYSCALL_NAME(openat),
+    SYSCALL_NAME(mmap),          SYSCALL_NAME(mprotect),       SYSCALL_NAME(munmap),    SYSCALL_NAME(brk),        SYSCALL_NAME(pread64),    SYSCALL_NAME(getuid),
+    SYSCALL_NAME(getgid),        SYSCALL_NAME(geteuid),        SYSCALL_NAME(getegid),   SYSCALL_NAME(prctl),      SYSCALL_NAME(prlimit64),  SYSCALL_NAME(capget),
+    SYSCALL_NAME(capset),        SYSCALL_NAME(mkdirat),        SYSCALL_NAME(fchown),    SYSCALL_NAME(fchmod),     SYSCALL_NAME(fsync),      SYSCALL_NAME(dup3),
+    SYSCALL_NAME(exit_group),    SYSCALL_NAME(set_tid_address), SYSCALL_NAME(set_robust_list), SYSCALL_NAME(getrandom), SYSCALL_NAME(seccomp), SYSCALL_NAME(ioctl),
+    SYSCALL_NAME(lseek),         SYSCALL_NAME(fcntl),          SYSCALL_NAME(linkat),
+#ifdef SYS_arch_prctl
+    SYSCALL_NAME(arch_prctl),
+#endif
+#ifdef SYS_access
+    SYSCALL_NAME(access),
+#endif
+#ifdef SYS_stat
+    SYSCALL_NAME(stat),
+#endif
+#ifdef SYS_mkdir
+    SYSCALL_NAME(mkdir),
+#endif
+#ifdef SYS_dup2
+    SYSCALL_NAME(dup2),
+#endif
+#ifdef SYS_open
+    SYSCALL_NAME(open),
+#endif
+#ifdef SYS_rseq
+    SYSCALL_NAME(rseq),
+#endif
+#ifdef SYS_openat2
+    SYSCALL_NAME(openat2),
+#endif
+#ifdef SYS_landlock_create_ruleset
+    SYSCALL_NAME(landlock_create_ruleset), SYSCALL_NAME(landlock_add_rule), SYSCALL_NAME(landlock_restrict_self),
+#endif
+};
+
+struct budget_line {
+  char binary[64];
+  char scenario[64];
+  char key[64];
+  long max;
+};
+
+struct trace_result {
+  long calls[MAX_SYSCALLS];
+  long sequence[MAX_SYSCALLS];
+  size_t sequence_len;
+  long total;
+  long max_fd;
+  int status;
+};
+
+static const char *syscall_to_name(long nr) {
+  for (size_t i = 0; i < sizeof(syscall_names) / sizeof(syscall_names[0]); i++) {
+    if (syscall_names[i].nr == nr) {
+      return syscall_names[i].name;
+    }
+  }
+  return NULL;
+}
+
+static long name_to_syscall(const char *name) __attribute__((nonnull(1)));
+static long name_to_syscall(const char *name) {
+  for (size_t i = 0; i < sizeof(syscall_names) / sizeof(syscall_names[0]); i++) {
+    if (strcmp(syscall_names[i].name, name) == 0) {
+      return syscall_names[i].nr;
+    }
+  }
+  return -1;
+}
+
+static int write_file(const char *path, const char *content) __attribute__((nonnull(1, 2)));
+static int write_file(const char *path, const char *content) {
+  const int fd = open(path, O_WRONLY | O_CLOEXEC);
+  const size_t len = strlen(content);
+
+  if (fd < 0) {
+    return 1;
+  }
+  if (write(fd, content, len) != (ssize_t)len) {
+    (void)close(fd);
+    return 1;
+  }
+  return close(fd);
+}
+
+static size_t load_budget(const char *path, struct budget_line *budget) __attribute__((nonnull(1, 2)));
+static size_t load_budget(const char *path, struct budget_line *budget) {
+  FILE *input = fopen(path, "re");
+  char line[256] = {0};
+  char *at = NULL;
+  size_t count = 0;
+
+  if (input == NULL) {
+    (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  while (fgets(line, sizeof(line), input) != NULL && count < MAX_BUDGET_LINES) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if (sscanf(line, "%63s %63s %63s %ld", budget[count].binary, budget[count].scenario, budget[count].key, &budget[count].max) != 4) {
+      (void)fprintf(stderr, "%s: Invalid budget line: %s", __PROGRAM_NAME, line);
+      exit(EXIT_FAILURE);
+    }
+    at = strchr(budget[count].binary, '@');
+    if (at != NULL) {
+      if (strcmp(at + 1, BUDGET_LINKAGE) != 0) {
+        continue;
+      }
+      *at = '\0';
+    }
+    count++;
+  }
+
+  (void)fclose(input);
+  return count;
+}
+
+/* only ever called in our private mount namespace */
+static int setup_namespace(void) {
+  char uid_map[64] = {0};
+  char gid_map[64] = {0};
+  char ancestor[FILE_PATH_MAX_LENGTH] = {0};
+  char path[FILE_PATH_MAX_LENGTH] = {0};
+  struct stat st = {0};
+
+  (void)snprintf(uid_map, sizeof(uid_map), "0 %u 1\n", getuid());
+  (void)snprintf(gid_map, sizeof(gid_map), "0 %u 1\n", getgid());
+
+  if (unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0) {
+    return EXIT_SKIP;
+  }
+
+  if (write_file("/proc/self/setgroups", "deny") != 0 || write_file("/proc/self/uid_map", uid_map) != 0 || write_file("/proc/self/gid_map", gid_map) != 0) {
+    return EXIT_SKIP;
+  }
+
+  if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+    return EXIT_SKIP;
+  }
+
+  /* tmpfs over the nearest directory that exists, never over / */
+  (void)snprintf(ancestor, sizeof(ancestor), "%s", __CLIENT_KEYTAB_DIR);
+  while (stat(ancestor, &st) != 0) {
+    (void)snprintf(path, sizeof(path), "%s", dirname(ancestor));
+    (void)snprintf(ancestor, sizeof(ancestor), "%s", path);
+  }
+  if (strcmp(ancestor, "/") == 0) {
+    return EXIT_SKIP;
+  }
+
+  if (mount("tmpfs", ancestor, "tmpfs", MS_NOSUID | MS_NODEV, "mode=0755") != 0) {
+    return EXIT_SKIP;
+  }
+
+  /* mkdir -p __CLIENT_KEYTAB_DIR */
+  (void)snprintf(path, sizeof(path), "%s", __CLIENT_KEYTAB_DIR);
+  for (char *slash = path + strlen(ancestor) + 1; slash != NULL; slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    (void)mkdir(path, 0755);
+    *slash = '/';
+  }
+  if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+    (void)fprintf(stderr, "%s: Cannot make %s: %s\n", __PROGRAM_NAME, path, strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* we are uid 0 in here, so our keytab is <dir>/[s0/]0/client.keytab */
+static int setup_scenario(const char *scenario) __attribute__((nonnull(1)));
+static int setup_scenario(const char *scenario) {
+  const char emptykeytab[] = {0x05, 0x02};
+  const char junk[] = "not a keytab";
+  char subdir[64] = {0};
+  char dir[FILE_PATH_MAX_LENGTH] = {0};
+  char shard[FILE_PATH_MAX_LENGTH] = {0};
+  char keytab[FILE_PATH_MAX_LENGTH] = {0};
+  int fd = -1;
+
+  if (get_client_subdir_for_uid(0, __CLIENT_KEYTAB_SHARDS, subdir, sizeof(subdir)) != 0) {
+    return 1;
+  }
+  (void)snprintf(dir, sizeof(dir), "%s/%s", __CLIENT_KEYTAB_DIR, subdir);
+  (void)snprintf(keytab, sizeof(keytab), "%s", dir);
+  (void)snprintf(shard, sizeof(shard), "%s", dirname(keytab));
+  (void)snprintf(keytab, sizeof(keytab), "%s/client.keytab", dir);
+
+  (void)unlink(keytab);
+  (void)rmdir(dir);
+  if (__CLIENT_KEYTAB_SHARDS > 0) {
+    (void)rmdir(shard);
+  }
+
+  if (strcmp(scenario, "fresh") == 0) {
+    return 0;
+  }
+
+  if (__CLIENT_KEYTAB_SHARDS > 0 && mkdir(shard, KCRON_SHARD_MODE) != 0) {
+    return 1;
+  }
+  if (mkdir(dir, 0700) != 0) {
+    return 1;
+  }
+  if (strcmp(scenario, "existing_dir") == 0) {
+    return 0;
+  }
+
+  /* An unprivileged namespace maps a single uid, so a keytab with the   */
+  /* wrong mode and content stands in for one owned by someone else.    */
+  fd = open(keytab, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, strcmp(scenario, "wrong_owner") == 0 ? 0644 : 0600);
+  if (fd < 0) {
+    return 1;
+  }
+  if (strcmp(scenario, "wrong_owner") == 0) {
+    if (write(fd, junk, sizeof(junk)) != sizeof(junk)) {
+      (void)close(fd);
+      return 1;
+    }
+  } else if (write(fd, emptykeytab, sizeof(emptykeytab)) != sizeof(emptykeytab)) {
+    (void)close(fd);
+    return 1;
+  }
+  return close(fd);
+}
+
+/* whatever was there before must be left alone, anything new is ours */
+static int check_keytab(const char *scenario, int created) __attribute__((nonnull(1)));
+static int check_keytab(const char *scenario, int created) {
+  char subdir[64] = {0};
+  char keytab[FILE_PATH_MAX_LENGTH] = {0};
+  struct stat st = {0};
+
+  if (get_client_subdir_for_uid(0, __CLIENT_KEYTAB_SHARDS, subdir, sizeof(subdir)) != 0) {
+    return 1;
+  }
+  (void)snprintf(keytab, sizeof(keytab), "%s/%s/client.keytab", __CLIENT_KEYTAB_DIR, subdir);
+
+  /* a shard init-kcron-keytab made must still let every user through */
+  if (__CLIENT_KEYTAB_SHARDS > 0 && created != 0) {
+    (void)snprintf(keytab, sizeof(keytab), "%s/%s", __CLIENT_KEYTAB_DIR, subdir);
+    if (stat(dirname(keytab), &st) != 0 || (st.st_mode & 07777) != KCRON_SHARD_MODE) {
+      return 1;
+    }
+    (void)snprintf(keytab, sizeof(keytab), "%s/%s/client.keytab", __CLIENT_KEYTAB_DIR, subdir);
+  }
+
+  if (stat(keytab, &st) != 0) {
+    return (created == 0 && (strcmp(scenario, "fresh") == 0 || strcmp(scenario, "existing_dir") == 0)) ? 0 : 1;
+  }
+  if (strcmp(scenario, "wrong_owner") == 0) {
+    return ((st.st_mode & 07777) == 0644 && st.st_size == sizeof("not a keytab")) ? 0 : 1;
+  }
+  return ((st.st_mode & 07777) == 0600 && st.st_size == 2) ? 0 : 1;
+}
+
+static int trace_binary(int exe_fd, const char *binary, struct trace_result *result) __attribute__((nonnull(2, 3)));
+static int trace_binary(int exe_fd, const char *binary, struct trace_result *result) {
+
+  struct __ptrace_syscall_info info = {0};
+  char *const argv[] = {(char *)binary, NULL};
+  char *const envp[] = {NULL};
+  long last_nr = -1;
+  int status = 0;
+  int exec_seen = 0;
+  int devnull = -1;
+
+  (void)memset(result, 0, sizeof(*result));
+
+  const pid_t child = fork();
+  if (child < 0) {
+    return 1;
+  }
+
+  if (child == 0) {
+    devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (devnull < 0 || dup2(devnull, STDOUT_FILENO) < 0) {
+      _exit(EXIT_FAILURE);
+    }
+    /* nothing but stdio should leak in from whoever runs the tests */
+    if (syscall(SYS_close_range, 3U, ~0U, CLOSE_RANGE_CLOEXEC) != 0) {
+      _exit(EXIT_FAILURE);
+    }
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) != 0) {
+      _exit(EXIT_FAILURE);
+    }
+    (void)raise(SIGSTOP);
+    (void)syscall(SYS_execveat, exe_fd, "", argv, envp, AT_EMPTY_PATH);
+    _exit(EXIT_FAILURE);
+  }
+
+  if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) {
+    return 1;
+  }
+
+  if (ptrace(PTRACE_SETOPTIONS, child, NULL, (void *)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL)) != 0) {
+    return 1;
+  }
+
+  while (ptrace(PTRACE_SYSCALL, child, NULL, NULL) == 0 && waitpid(child, &status, 0) == child) {
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      break;
+    }
+    if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+      /* only count what the binary does, not our own setup */
+      exec_seen = 1;
+      continue;
+    }
+    if (exec_seen == 0 || !WIFSTOPPED(status) || WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+      continue;
+    }
+    if (ptrace(PTRACE_GET_SYSCALL_INFO, child, (void *)sizeof(info), &info) <= 0) {
+      continue;
+    }
+
+    if (info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+      last_nr = (long)info.entry.nr;
+      result->total++;
+      if (last_nr >= 0 && last_nr < MAX_SYSCALLS) {
+        result->calls[last_nr]++;
+      }
+      if (result->sequence_len < MAX_SYSCALLS) {
+        result->sequence[result->sequence_len++] = last_nr;
+      }
+    } else if (info.op == PTRACE_SYSCALL_INFO_EXIT && info.exit.is_error == 0) {
+      if (last_nr == SYS_openat || last_nr == SYS_dup3 || last_nr == SYS_fcntl || (last_nr == name_to_syscall("openat2")) || (last_nr == name_to_syscall("open")) ||
+          (last_nr == name_to_syscall("dup2"))) {
+        if (last_nr != SYS_fcntl && info.exit.rval > result->max_fd) {
+          result->max_fd = info.exit.rval;
+        }
+      }
+    }
+  }
+
+  result->status = status;
+  return 0;
+}
+
+static void print_sequence(const char *binary, const char *scenario, const struct trace_result *result) __attribute__((nonnull(1, 2, 3)));
+static void print_sequence(const char *binary, const char *scenario, const struct trace_result *result) {
+  const char *name = NULL;
+  size_t run = 0;
+
+  (void)printf("%s %s: %ld syscalls, highest fd %ld\n ", binary, scenario, result->total, result->max_fd);
+  for (size_t i = 0; i < result->sequence_len; i += run) {
+    run = 1;
+    while (i + run < result->sequence_len && result->sequence[i + run] == result->sequence[i]) {
+      run++;
+    }
+    name = syscall_to_name(result->sequence[i]);
+    if (name != NULL) {
+      (void)printf(" %s", name);
+    } else {
+      (void)printf(" #%ld", result->sequence[i]);
+    }
+    if (run > 1) {
+      (void)printf("*%zu", run);
+    }
+  }
+  (void)printf("\n");
+}
+
+static int check_budget(const char *binary, const char *scenario, const struct trace_result *result, const struct budget_line *budget, size_t budget_len)
+    __attribute__((nonnull(1, 2, 3, 4)));
+static int check_budget(const char *binary, const char *scenario, const struct trace_result *result, const struct budget_line *budget, size_t budget_len) {
+  int failed = 0;
+  long used = 0;
+  long nr = 0;
+
+  for (size_t i = 0; i < budget_len; i++) {
+    if (strcmp(budget[i].binary, binary) != 0 || (strcmp(budget[i].scenario, scenario) != 0 && strcmp(budget[i].scenario, "*") != 0)) {
+      continue;
+    }
+
+    if (strcmp(budget[i].key, "total") == 0) {
+      used = result->total;
+    } else if (strcmp(budget[i].key, "max_fd") == 0) {
+      used = result->max_fd;
+    } else {
+      nr = name_to_syscall(budget[i].key);
+      if (nr < 0 || nr >= MAX_SYSCALLS) {
+        (void)fprintf(stderr, "%s: unknown syscall '%s' in budget\n", __PROGRAM_NAME, budget[i].key);
+        failed = 1;
+        continue;
+      }
+      used = result->calls[nr];
+    }
+
+    if (used > budget[i].max) {
+      (void)printf("  OVER BUDGET: %s %s %s %ld > %ld\n", binary, scenario, budget[i].key, used, budget[i].max);
+      failed = 1;
+    }
+  }
+
+  return failed;
+}
+
+int main(int argc, char *argv[]) {
+
+  const char *scenarios[] = {"fresh", "existing_dir", "existing_keytab", "wrong_owner"};
+  struct budget_line budget[MAX_BUDGET_LINES];
+  struct trace_result *result = NULL;
+  size_t budget_len = 0;
+  int exe_fd[2] = {-1, -1};
+  const char *binary[2] = {NULL, NULL};
+  int rc = 0;
+  int failed = 0;
+
+  if (argc != 4) {
+    (void)fprintf(stderr, "Usage: %s budget.txt init-kcron-keytab client-keytab-name\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  budget_len = load_budget(argv[1], budget);
+
+  /* hold on to the binaries, the tmpfs may hide the build tree */
+  for (int i = 0; i < 2; i++) {
+    exe_fd[i] = open(argv[i + 2], O_PATH | O_CLOEXEC);
+    if (exe_fd[i] < 0) {
+      (void)fprintf(stderr, "%s: Cannot open %s: %s\n", __PROGRAM_NAME, argv[i + 2], strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    binary[i] = basename(argv[i + 2]);
+  }
+
+  rc = setup_namespace();
+  if (rc == EXIT_SKIP) {
+    (void)printf("%s: cannot create a user and mount namespace, skipping\n", __PROGRAM_NAME);
+  }
+  if (rc != EXIT_SUCCESS) {
+    exit(rc);
+  }
+
+  result = calloc(1, sizeof(struct trace_result));
+  if (result == NULL) {
+    (void)fprintf(stderr, "%s: Unable to allocate memory.\n", __PROGRAM_NAME);
+    exit(EXIT_FAILURE);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+      if (setup_scenario(scenarios[s]) != 0) {
+        (void)fprintf(stderr, "%s: Cannot set up scenario %s\n", __PROGRAM_NAME, scenarios[s]);
+        exit(EXIT_FAILURE);
+      }
+
+      if (trace_binary(exe_fd[i], binary[i], result) != 0) {
+        (void)fprintf(stderr, "%s: Cannot trace %s\n", __PROGRAM_NAME, binary[i]);
+        exit(EXIT_FAILURE);
+      }
+
+      print_sequence(binary[i], scenarios[s], result);
+
+      if (WIFSIGNALED(result->status)) {
+        (void)printf("  FAILED: %s %s killed by signal %d\n", binary[i], scenarios[s], WTERMSIG(result->status));
+        failed = 1;
+      } else if (!WIFEXITED(result->status) || WEXITSTATUS(result->status) != EXIT_SUCCESS) {
+        (void)printf("  FAILED: %s %s exited %d\n", binary[i], scenarios[s], WEXITSTATUS(result->status));
+        failed = 1;
+      }
+
+      if (check_keytab(scenarios[s], i == 0) != 0) {
+        (void)printf("  FAILED: %s %s left the wrong keytab behind\n", binary[i], scenarios[s]);
+        failed = 1;
+      }
+
+      failed |= check_budget(binary[i], scenarios[s], result, budget, budget_len);
+    }
+  }
+
+  (void)free(result);
+
+  if (failed != 0) {
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}